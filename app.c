@@ -26,6 +26,153 @@ void encode()
     set_clock_pwr(SI5351_CLK0, 0);
 }
 
+#ifdef WSPR_USE_TABLES
+#include "wspr_tables.h"
+
+// 直接从wspr_tablegen生成的Flash表格发射，开机不运行编码器和si5351_Calc()
+void encode_from_table(const wspr_band_table_t *band, const wspr_message_table_t *msg)
+{
+    uint8_t i;
+
+    // 1. 写入共享的PLL参数并复位PLL，CLK0从首个符号的音调开始
+    si5351_StartOutput(SI5351_PLL_A, band->pll_regs, 0, band->tone_regs[WSPR_TABLE_SYMBOL(msg, 0)],
+                       band->clk_control);
+
+    // 2. 每个符号只写入对应音调的MultiSynth0寄存器映像
+    for (i = 0; i < WSPR_SYMBOL_COUNT; i++)
+    {
+        si5351_writeRegs(SI5351_MS_BASE(0), band->tone_regs[WSPR_TABLE_SYMBOL(msg, i)]);
+
+        // 等待定时器中断
+        proceed = false;
+        while (!proceed);
+    }
+
+    // 3. 关闭输出
+    si5351_EnableOutputs(0);
+}
+#endif
+
+#ifdef WSPR_USE_RAMP
+#include "wspr_ramp.h"
+
+static wspr_ramp_t ramp;
+
+// 换音时平滑过渡：符号定时器需配置为每个符号中断WSPR_RAMP_TICKS次，
+// 每个符号开头的steps次中断各写一步P2寄存器，其余中断保持音调不变
+void encode_ramped(wspr_ramp_shape_t shape, uint8_t steps)
+{
+    uint8_t i, t, prev;
+
+    // 1. 编码WSPR消息，并为本次发射预先算好全部过渡寄存器值
+    wspr_encode(call, loc, dbm, tx_buffer);
+    if (wspr_ramp_plan(&ramp, (uint64_t)freq * 100, 0, SI5351_DRIVE_STRENGTH_8MA, shape, steps) < 0)
+        return;
+
+    // 2. 写入PLL和首个音调，打开输出
+    wspr_ramp_start(&ramp, tx_buffer[0]);
+    prev = tx_buffer[0];
+
+    // 3. 每次中断只查表写寄存器
+    for (i = 0; i < WSPR_SYMBOL_COUNT; i++)
+    {
+        for (t = 0; t < WSPR_RAMP_TICKS; t++)
+        {
+            wspr_ramp_tick(&ramp, prev, tx_buffer[i], t);
+
+            // 等待定时器中断
+            proceed = false;
+            while (!proceed);
+        }
+        prev = tx_buffer[i];
+    }
+
+    // 4. 关闭输出
+    si5351_EnableOutputs(0);
+}
+#endif
+
+#ifdef WSPR_USE_MULTI
+#include "wspr_multi.h"
+
+static wspr_multi_t multi;
+static uint8_t multi_buffer[WSPR_MULTI_OUTPUTS][SYMBOL_COUNT];
+
+// CLK0~CLK2同时在各自波段发射各自的消息，band_freq为0的输出不用
+void encode_multi(const unsigned long band_freq[WSPR_MULTI_OUTPUTS], const char *calls[WSPR_MULTI_OUTPUTS],
+                  const char *locs[WSPR_MULTI_OUTPUTS], const uint8_t dbms[WSPR_MULTI_OUTPUTS])
+{
+    uint64_t f[WSPR_MULTI_OUTPUTS];
+    uint8_t tones[WSPR_MULTI_OUTPUTS];
+    uint8_t i, k;
+
+    // 1. 编码各输出的消息，并规划共用的PLL和各音调寄存器
+    for (k = 0; k < WSPR_MULTI_OUTPUTS; k++)
+    {
+        f[k] = (uint64_t)band_freq[k] * 100;
+        if (band_freq[k])
+            wspr_encode(calls[k], locs[k], dbms[k], multi_buffer[k]);
+        else
+            memset(multi_buffer[k], 0, SYMBOL_COUNT);
+    }
+    if (wspr_multi_plan(&multi, f, SI5351_DRIVE_STRENGTH_8MA) < 0)
+        return;
+
+    // 2. 写入PLL和各输出首个音调，打开输出
+    for (k = 0; k < WSPR_MULTI_OUTPUTS; k++)
+        tones[k] = multi_buffer[k][0];
+    wspr_multi_start(&multi, tones);
+
+    // 3. 每个符号边沿把所有输出的变化合并为一次连续写
+    for (i = 0; i < WSPR_SYMBOL_COUNT; i++)
+    {
+        for (k = 0; k < WSPR_MULTI_OUTPUTS; k++)
+            tones[k] = multi_buffer[k][i];
+        wspr_multi_symbol(&multi, tones);
+
+        // 等待定时器中断
+        proceed = false;
+        while (!proceed);
+    }
+
+    // 4. 关闭输出
+    si5351_EnableOutputs(0);
+}
+#endif
+
+#ifdef WSPR_USE_SYNTH
+#include "wspr_synth.h"
+
+static wspr_synth_table_t synth_table;
+
+// 与芯片无关的发射：backend为wspr_synth_si5351、wspr_synth_ad9850等，dev为对应的设备参数
+void encode_synth(const wspr_synth_backend_t *backend, void *dev)
+{
+    uint8_t i;
+
+    // 1. 编码WSPR消息，并为本次发射算好四个音调的寄存器映像
+    wspr_encode(call, loc, dbm, tx_buffer);
+    if (wspr_synth_plan(&synth_table, backend, dev, (uint64_t)freq * 100) != 0)
+        return;
+
+    // 2. 初始化芯片并发射首个音调
+    wspr_synth_start(&synth_table, tx_buffer[0]);
+
+    // 3. 每个符号只按符号值查表写出
+    for (i = 0; i < WSPR_SYMBOL_COUNT; i++)
+    {
+        wspr_synth_tone(&synth_table, tx_buffer[i]);
+
+        // 等待定时器中断
+        proceed = false;
+        while (!proceed);
+    }
+
+    // 4. 关闭输出
+    wspr_synth_stop(&synth_table);
+}
+#endif
+
 
 unsigned long freq = 14097100UL;  // 发射频率14.0971MHz
 char call[7] = "BI1TPH";     // 呼号(最大6字符+终止符)
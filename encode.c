@@ -1,15 +1,13 @@
-#define WSPR_BIT_COUNT 162
-#define WSPR_SYMBOL_COUNT 162
-#define WSPR_MESSAGE_BYTE_SIZE 11
-
 #include <stdint.h>
 #include <string.h>
 #include <ctype.h>
+#include "encode.h"
 #include "nhash.h"
+#include "wspr_trace.h"
+#include "wspr_mode.h"
 
-static char callsign[12];
-static char locator[7];
-static int8_t power;
+// 不可重入接口wspr_message_prep()/wspr_bit_packing()共用的消息状态
+static wspr_message_t message_state;
 
 /**
  * @brief 合并同步向量到符号数组中。
@@ -22,8 +20,8 @@ static int8_t power;
 void wspr_merge_sync_vector(uint8_t *g, uint8_t *symbols)
 {
 	uint8_t i;
-	// WSPR 协议的同步向量，长度为 162
-	const uint8_t sync_vector[WSPR_SYMBOL_COUNT] =
+	// WSPR 协议的同步向量，长度为 162；static 保证放在只读段，不在栈上重建
+	static const uint8_t sync_vector[WSPR_SYMBOL_COUNT] =
 		{1, 1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 0, 0, 1, 0, 0,
 		 1, 0, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 1, 0, 0,
 		 0, 0, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 0, 1, 1, 0, 1,
@@ -32,11 +30,13 @@ void wspr_merge_sync_vector(uint8_t *g, uint8_t *symbols)
 		 0, 0, 1, 0, 0, 1, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 0, 1,
 		 1, 1, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0,
 		 1, 1, 0, 1, 0, 1, 1, 0, 0, 0, 1, 1, 0, 0, 0};
+	WSPR_TRACE_BEGIN(t0);
 
 	for (i = 0; i < WSPR_SYMBOL_COUNT; i++)
 	{
 		symbols[i] = sync_vector[i] + (2 * g[i]); // 合并同步向量和比特流
 	}
+	WSPR_TRACE_END(WSPR_STAGE_MERGE_SYNC, t0);
 }
 
 /**
@@ -50,6 +50,7 @@ void wspr_interleave(uint8_t *s)
 {
 	uint8_t d[WSPR_BIT_COUNT];
 	uint8_t rev, index_temp, i, j, k;
+	WSPR_TRACE_BEGIN(t0);
 
 	i = 0;
 
@@ -81,6 +82,7 @@ void wspr_interleave(uint8_t *s)
 	}
 
 	memcpy(s, d, WSPR_BIT_COUNT); // 拷贝交织后的数据回原数组
+	WSPR_TRACE_END(WSPR_STAGE_INTERLEAVE, t0);
 }
 
 /**
@@ -101,6 +103,7 @@ void convolve(uint8_t *c, uint8_t *s, uint8_t message_size, uint8_t bit_size)
 	uint8_t input_bit, parity_bit;
 	uint8_t bit_count = 0;
 	uint8_t i, j, k;
+	WSPR_TRACE_BEGIN(t0);
 
 	for (i = 0; i < message_size; i++)
 	{
@@ -142,6 +145,7 @@ void convolve(uint8_t *c, uint8_t *s, uint8_t message_size, uint8_t bit_size)
 			}
 		}
 	}
+	WSPR_TRACE_END(WSPR_STAGE_CONVOLVE, t0);
 }
 
 /**
@@ -200,16 +204,21 @@ void pad_callsign(char * call)
 }
 
 /**
- * @brief WSPR 消息比特打包。
+ * @brief WSPR 消息比特打包（可重入版本）。
  *
+ * @param msg 经 wspr_message_prep_r() 规范化的消息。
  * @param c 输出的比特数组，长度至少为 11 字节。
  *
- * 该函数根据 callsign、locator、power 等全局变量，将消息内容打包为比特流。
+ * 该函数根据 msg 中的 callsign、locator、power，将消息内容打包为比特流。
  * 支持三种类型的 WSPR 消息（普通、带斜杠、特殊格式）。
  */
-void wspr_bit_packing(uint8_t *c)
+void wspr_bit_packing_r(wspr_message_t *msg, uint8_t *c)
 {
 	uint32_t n, m;
+	char *callsign = msg->callsign;
+	char *locator = msg->locator;
+	int8_t power = msg->power;
+	WSPR_TRACE_BEGIN(t0);
 
 	// 判断消息类型（1、2、3）
 	char *slash_avail = strchr(callsign, (int)'/');
@@ -222,7 +231,9 @@ void wspr_bit_packing(uint8_t *c)
 		char *bracket_avail = strchr(callsign, (int)'>');
 		int call_len = bracket_avail - callsign - 1;
 		strncpy(base_call, callsign + 1, call_len);
+		WSPR_TRACE_BEGIN(t1);
 		uint32_t hash = nhash_(base_call, &call_len, &init_val);
+		WSPR_TRACE_END(WSPR_STAGE_NHASH, t1);
 		hash &= 32767;
 
 		// 6 字符网格转换为 callsign 格式，首字符移到末尾
@@ -415,19 +426,254 @@ void wspr_bit_packing(uint8_t *c)
 	c[8] = 0;
 	c[9] = 0;
 	c[10] = 0;
+	WSPR_TRACE_END(WSPR_STAGE_PACK, t0);
+}
+
+/*
+ * 字符编码查找表：数字 0-9，字母（大小写）10-35，其余 36（与空格相同）。
+ * 同时兼作字符分类：<10 为数字，10~35 为字母。
+ */
+#define WSPR_CODE_SPACE 36
+static const uint8_t wspr_char_code[256] = {
+	36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+	36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+	36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 36, 36, 36, 36, 36, 36,
+	36, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+	25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 36, 36, 36, 36,
+	36, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+	25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 36, 36, 36, 36,
+	36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+	36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+	36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+	36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+	36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+	36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+	36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+	36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36};
+
+#define WSPR_IS_DIGIT_CODE(k) ((k) < 10)
+#define WSPR_IS_ALPHA_CODE(k) ((k) >= 10 && (k) < 36)
+
+/**
+ * @brief 6 字符呼号的 28 位编码（36/36/10/27/27/27 进制 Horner 展开）。
+ *
+ * @param p 字符起始地址。
+ * @param len 可用字符数，不足 6 个时其余按空格处理。
+ * @param pad 是否按 pad_callsign() 的规则在第 2 位为数字时右移补空格。
+ */
+static uint32_t wspr_pack_call(const char *p, uint8_t len, uint8_t pad)
+{
+	uint8_t k[6];
+	uint8_t i;
+
+	for (i = 0; i < 6; i++)
+	{
+		k[i] = (i < len) ? wspr_char_code[(uint8_t)p[i]] : WSPR_CODE_SPACE;
+	}
+	if (pad && WSPR_IS_DIGIT_CODE(k[1]) && WSPR_IS_ALPHA_CODE(k[2]))
+	{
+		for (i = 5; i > 0; i--)
+		{
+			k[i] = k[i - 1];
+		}
+		k[0] = WSPR_CODE_SPACE;
+	}
+
+	// 后三位只允许字母/空格，减 10 后与 wspr_bit_packing_r() 一样按 uint32 运算
+	return ((((k[0] * 36u + k[1]) * 10u + k[2]) * 27u + (k[3] - 10u)) * 27u + (k[4] - 10u)) * 27u + (k[5] - 10u);
+}
+
+/**
+ * @brief 统一的 WSPR 消息打包，返回 50 比特载荷。
+ *
+ * @param msg 经 wspr_message_prep_r() 规范化的消息。
+ * @return uint64_t 低 50 位为载荷：高 28 位呼号 n，低 22 位网格/功率 m，
+ *         按高位在前的顺序即为 wspr_bit_packing_r() 输出的 c[0]~c[6]。
+ *
+ * 四种消息类型共用一次查表 Horner 展开，不修改 msg。结果与
+ * wspr_bit_packing_r() 逐位一致（见 wspr_bench --check）。
+ */
+uint64_t wspr_pack50(const wspr_message_t *msg)
+{
+	const char *call = msg->callsign;
+	const char *loc = msg->locator;
+	int32_t power = msg->power;
+	uint32_t n, m;
+	uint8_t slash;
+	uint64_t word;
+	WSPR_TRACE_BEGIN(t0);
+
+	for (slash = 0; slash < 12 && call[slash] != '/'; slash++)
+	{
+	}
+
+	if (call[0] == '<')
+	{
+		// 类型 3：呼号哈希 + 6 字符网格（首字符移到末尾后按呼号格式编码）
+		char rotated[6];
+		int call_len;
+		uint32_t init_val = 146;
+		uint8_t bracket;
+
+		for (bracket = 1; bracket < 12 && call[bracket] != '>'; bracket++)
+		{
+		}
+		call_len = bracket - 1;
+		WSPR_TRACE_BEGIN(t1);
+		m = nhash_(call + 1, &call_len, &init_val) & 32767;
+		WSPR_TRACE_END(WSPR_STAGE_NHASH, t1);
+		m = (m * 128) - (power + 1) + 64;
+
+		rotated[0] = loc[1];
+		rotated[1] = loc[2];
+		rotated[2] = loc[3];
+		rotated[3] = loc[4];
+		rotated[4] = loc[5];
+		rotated[5] = loc[0];
+		n = wspr_pack_call(rotated, 6, 0);
+	}
+	else if (slash == 12)
+	{
+		// 类型 1
+		n = wspr_pack_call(call, 12, 1);
+		m = ((179 - 10 * (loc[0] - 'A') - (loc[2] - '0')) * 180) +
+			(10 * (loc[1] - 'A')) + (loc[3] - '0');
+		m = (m * 128) + power + 64;
+	}
+	else
+	{
+		// 类型 2：斜杠后第 2、3 个字符决定是单字符后缀、两位数字后缀还是前缀
+		char s2 = (slash + 2 < 12) ? call[slash + 2] : 0;
+		char s3 = (slash + 3 < 12) ? call[slash + 3] : 0;
+
+		if (s2 == ' ' || s2 == 0)
+		{
+			uint8_t x = wspr_char_code[(uint8_t)call[slash + 1]];
+			n = wspr_pack_call(call, slash, 1);
+			m = 60000 - 32768 + ((x == WSPR_CODE_SPACE) ? 38 : x);
+			m = (m * 128) + power + 2 + 64;
+		}
+		else if (s3 == ' ' || s3 == 0)
+		{
+			n = wspr_pack_call(call, slash, 1);
+			m = 10 * (call[slash + 1] - 48) + call[slash + 2] - 48;
+			m = 60000 + 26 + m;
+			m = (m * 128) + power + 2 + 64;
+		}
+		else
+		{
+			uint8_t p0 = (slash > 0) ? wspr_char_code[(uint8_t)call[0]] : WSPR_CODE_SPACE;
+			uint8_t p1 = (slash > 1) ? wspr_char_code[(uint8_t)call[1]] : WSPR_CODE_SPACE;
+			uint8_t p2 = (slash > 2) ? wspr_char_code[(uint8_t)call[2]] : WSPR_CODE_SPACE;
+
+			if (slash < 3 || call[2] == ' ')
+			{
+				// 右对齐前缀
+				p2 = p1;
+				p1 = p0;
+				p0 = WSPR_CODE_SPACE;
+			}
+			n = wspr_pack_call(call + slash + 1, 11 - slash, 1);
+			m = (37 * p0 + p1) * 37 + p2;
+			if (m >= 32768)
+			{
+				m -= 32768;
+				m = (m * 128) + power + 2 + 64;
+			}
+			else
+			{
+				m = (m * 128) + power + 1 + 64;
+			}
+		}
+	}
+
+	// 与 wspr_bit_packing_r() 相同：m 的第 18~21 位与第 26~29 位合并到同一半字节
+	m = (m & 0x3ffff) | ((((m >> 18) | (m >> 26)) & 0x0f) << 18);
+	word = ((uint64_t)(n & 0x0fffffff) << 22) | m;
+	WSPR_TRACE_END(WSPR_STAGE_PACK, t0);
+	return word;
+}
+
+/**
+ * @brief 32 位奇偶校验（异或折叠 + 16 项查表），适合没有 popcount 指令的 MCU。
+ */
+static uint8_t wspr_parity32(uint32_t x)
+{
+	x ^= x >> 16;
+	x ^= x >> 8;
+	x ^= x >> 4;
+	return (uint8_t)((0x6996 >> (x & 0x0f)) & 1);
 }
 
 /**
- * @brief WSPR 消息预处理，包括呼号、网格和功率的校验与规范化。
+ * @brief 64 位末尾零计数，w 不能为 0。
+ */
+static uint8_t wspr_ctz64(uint64_t w)
+{
+#if defined(__GNUC__)
+	return (uint8_t)__builtin_ctzll(w);
+#else
+	uint8_t n = 0;
+	while (!(w & 1))
+	{
+		w >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+/**
+ * @brief 直接对 wspr_pack50() 的 50 比特载荷做卷积编码。
+ *
+ * @param word 50 比特载荷（低 50 位有效）。
+ * @param s 输出比特流，长度为 WSPR_BIT_COUNT。
  *
+ * 输入为 50 个载荷比特加 31 个尾零，与 convolve(c, s, 11, 162) 结果相同。
+ */
+void wspr_convolve50(uint64_t word, uint8_t *s)
+{
+	uint32_t reg = 0;
+	uint8_t i;
+	WSPR_TRACE_BEGIN(t0);
+
+	for (i = 0; i < WSPR_BIT_COUNT / 2; i++)
+	{
+		reg = (reg << 1) | (uint32_t)((i < 50) ? ((word >> (49 - i)) & 1) : 0);
+		s[2 * i] = wspr_parity32(reg & 0xf2d05351);
+		s[2 * i + 1] = wspr_parity32(reg & 0xe4613c47);
+	}
+	WSPR_TRACE_END(WSPR_STAGE_CONVOLVE, t0);
+}
+
+/**
+ * @brief WSPR 消息比特打包。
+ *
+ * @param c 输出的比特数组，长度至少为 11 字节。
+ *
+ * 使用上一次 wspr_message_prep() 保存的消息状态，不可重入。
+ */
+void wspr_bit_packing(uint8_t *c)
+{
+	wspr_bit_packing_r(&message_state, c);
+}
+
+/**
+ * @brief WSPR 消息预处理（可重入版本），包括呼号、网格和功率的校验与规范化。
+ *
+ * @param msg 输出的规范化消息。
  * @param call 呼号字符串，最大 12 字符。
  * @param loc 网格定位字符串，4 或 6 字符。
  * @param dbm 功率（dBm）。
  *
  * 该函数会对输入的呼号、网格和功率进行合法性校验和标准化处理。
  */
-void wspr_message_prep(char *call, char *loc, int8_t dbm)
+void wspr_message_prep_r(wspr_message_t *msg, char *call, char *loc, int8_t dbm)
 {
+	char *callsign = msg->callsign;
+	char *locator = msg->locator;
+	WSPR_TRACE_BEGIN(t0);
 	// 呼号校验与填充
 	// -------------------------------
 
@@ -447,6 +693,7 @@ void wspr_message_prep(char *call, char *loc, int8_t dbm)
 	call[12] = 0;
 
 	strncpy(callsign, call, 12);
+	callsign[12] = 0;
 
 	// 网格定位校验
 	if (strlen(loc) == 4 || strlen(loc) == 6)
@@ -488,17 +735,17 @@ void wspr_message_prep(char *call, char *loc, int8_t dbm)
 
 	// 功率校验，只允许特定步进
 	#define VALID_DBM_SIZE 28
-	const int8_t valid_dbm[VALID_DBM_SIZE] =
+	static const int8_t valid_dbm[VALID_DBM_SIZE] =
 		{-30, -27, -23, -20, -17, -13, -10, -7, -3,
 		 0, 3, 7, 10, 13, 17, 20, 23, 27, 30, 33, 37, 40,
 		 43, 47, 50, 53, 57, 60};
 	// 默认赋值为最小值，防止未赋值
-	power = valid_dbm[0];
+	msg->power = valid_dbm[0];
 	for (i = 0; i < VALID_DBM_SIZE; i++)
 	{
 		if (dbm == valid_dbm[i])
 		{
-			power = dbm;
+			msg->power = dbm;
 		}
 	}
 	// 如果不是合法功率，向下取整
@@ -506,9 +753,288 @@ void wspr_message_prep(char *call, char *loc, int8_t dbm)
 	{
 		if (dbm < valid_dbm[i] && dbm >= valid_dbm[i - 1])
 		{
-			power = valid_dbm[i - 1];
+			msg->power = valid_dbm[i - 1];
 		}
 	}
+	WSPR_TRACE_END(WSPR_STAGE_PREP, t0);
+}
+
+/**
+ * @brief WSPR 消息预处理，结果保存在模块内部状态中，供 wspr_bit_packing() 使用。
+ *
+ * 不可重入，多线程请使用 wspr_message_prep_r()。
+ */
+void wspr_message_prep(char *call, char *loc, int8_t dbm)
+{
+	wspr_message_prep_r(&message_state, call, loc, dbm);
+}
+
+/*
+ * 比特平面表示：162 个信道比特按 bit i = w[i >> 6] 的第 (i & 63) 位存放在三个
+ * uint64_t 中，同步向量同样是一个平面。符号只在使用端（发射循环、输出文件）
+ * 才展开为字节：symbol[i] = sync[i] + 2 * data[i]。
+ */
+
+// 同步向量平面，与 wspr_merge_sync_vector() 中的 sync_vector 相同
+const wspr_plane_t wspr_sync_plane = {{0x58b340a407a47103ULL, 0xe2cdc90456349558ULL, 0x0000000063580ca0ULL}};
+
+// 交织置换：卷积输出第 i 个比特写到交织后的第 wspr_interleave_dest[i] 位
+const uint8_t wspr_interleave_dest[WSPR_BIT_COUNT] = {
+	0, 128, 64, 32, 160, 96, 16, 144, 80, 48, 112, 8, 136, 72, 40, 104, 24, 152,
+	88, 56, 120, 4, 132, 68, 36, 100, 20, 148, 84, 52, 116, 12, 140, 76, 44, 108,
+	28, 156, 92, 60, 124, 2, 130, 66, 34, 98, 18, 146, 82, 50, 114, 10, 138, 74,
+	42, 106, 26, 154, 90, 58, 122, 6, 134, 70, 38, 102, 22, 150, 86, 54, 118, 14,
+	142, 78, 46, 110, 30, 158, 94, 62, 126, 1, 129, 65, 33, 161, 97, 17, 145, 81,
+	49, 113, 9, 137, 73, 41, 105, 25, 153, 89, 57, 121, 5, 133, 69, 37, 101, 21,
+	149, 85, 53, 117, 13, 141, 77, 45, 109, 29, 157, 93, 61, 125, 3, 131, 67, 35,
+	99, 19, 147, 83, 51, 115, 11, 139, 75, 43, 107, 27, 155, 91, 59, 123, 7, 135,
+	71, 39, 103, 23, 151, 87, 55, 119, 15, 143, 79, 47, 111, 31, 159, 95, 63, 127,
+};
+
+/*
+ * 卷积 + 交织的生成矩阵：第 k 行是载荷第 k 个比特（从高位起）单独为 1 时
+ * 交织后的 162 比特输出。卷积和交织都是 GF(2) 线性运算，任意载荷的结果
+ * 即为所有置位比特对应行的异或。由 WSPR_CONV_IMPULSE 和
+ * wspr_interleave_dest 离线生成，wspr_bench --check 会与逐字节路径比对。
+ */
+static const wspr_plane_t wspr_generator_rows[50] = {
+	{{0x0400001505040051ULL, 0x1404001505111554ULL, 0x0000000000100141ULL}},
+	{{0x0010014100140040ULL, 0x0511155505040051ULL, 0x0000000000150444ULL}},
+	{{0x0015044401401000ULL, 0x0504005100140040ULL, 0x0000000115551150ULL}},
+	{{0x1555115004451500ULL, 0x0014004001401000ULL, 0x0000000000510450ULL}},
+	{{0x0051045011505554ULL, 0x0140100004451500ULL, 0x0000000000401400ULL}},
+	{{0x0040140004505100ULL, 0x0445150011505554ULL, 0x0000000010004010ULL}},
+	{{0x1000401014004000ULL, 0x1150555404505100ULL, 0x0000000015004540ULL}},
+	{{0x1500454040100004ULL, 0x0450510014004000ULL, 0x0000000055545014ULL}},
+	{{0x5554501445400054ULL, 0x1400400040100004ULL, 0x0000000051005040ULL}},
+	{{0x5100504050145456ULL, 0x4010000445400054ULL, 0x0000000040000044ULL}},
+	{{0x4000004450400016ULL, 0x4540005450145456ULL, 0x0000000000041002ULL}},
+	{{0x0004100200440002ULL, 0x5014545450400016ULL, 0x0000000200544052ULL}},
+	{{0x0054405210020400ULL, 0x5040001600440002ULL, 0x0000000254541406ULL}},
+	{{0x5454140640525400ULL, 0x0044000210020400ULL, 0x0000000200164006ULL}},
+	{{0x0016400614065446ULL, 0x1002040240525400ULL, 0x0000000000024400ULL}},
+	{{0x0002440040041600ULL, 0x4052540214065446ULL, 0x0000000004020204ULL}},
+	{{0x0402020444000200ULL, 0x1406544440041600ULL, 0x0000000254025202ULL}},
+	{{0x5402520202060240ULL, 0x4004160044000200ULL, 0x0000000054440644ULL}},
+	{{0x5444064452000246ULL, 0x4400020202060240ULL, 0x0000000016000402ULL}},
+	{{0x1600040206444446ULL, 0x0206024052000246ULL, 0x0000000002020042ULL}},
+	{{0x0202004204000064ULL, 0x5200024606444446ULL, 0x0000000202400620ULL}},
+	{{0x0240062000420220ULL, 0x0644444604000064ULL, 0x0000000202460026ULL}},
+	{{0x0246002606224020ULL, 0x0400006400420220ULL, 0x0000000044464460ULL}},
+	{{0x4446446000244620ULL, 0x0042022206224020ULL, 0x0000000000640040ULL}},
+	{{0x0064004044604642ULL, 0x0622402000244620ULL, 0x0000000002224200ULL}},
+	{{0x0222420000406400ULL, 0x0024462044604642ULL, 0x0000000040202260ULL}},
+	{{0x4020226042002220ULL, 0x4460464000406400ULL, 0x0000000246202400ULL}},
+	{{0x4620240022622002ULL, 0x0040640042002220ULL, 0x0000000046406042ULL}},
+	{{0x4640604224002062ULL, 0x4200222022622002ULL, 0x0000000064004000ULL}},
+	{{0x6400400060404062ULL, 0x2262200224002062ULL, 0x0000000222200022ULL}},
+	{{0x222000224002004aULL, 0x2400206060404062ULL, 0x0000000220026228ULL}},
+	{{0x2002622800222028ULL, 0x604040624002004aULL, 0x0000000220600048ULL}},
+	{{0x20600048622a0208ULL, 0x4002004800222028ULL, 0x000000024062400aULL}},
+	{{0x4062400a004a6008ULL, 0x00222028622a0208ULL, 0x0000000000480202ULL}},
+	{{0x0048020240086202ULL, 0x622a020a004a6008ULL, 0x0000000020282200ULL}},
+	{{0x2028220002004800ULL, 0x004a600a40086202ULL, 0x00000000020a2a2aULL}},
+	{{0x020a2a2a22002808ULL, 0x4008620002004800ULL, 0x00000002600a4a00ULL}},
+	{{0x600a4a002a2a0a20ULL, 0x0200480222002808ULL, 0x0000000062000802ULL}},
+	{{0x620008024a000a0aULL, 0x220028082a2a0a20ULL, 0x0000000048020020ULL}},
+	{{0x480200200800002aULL, 0x2a2a0a224a000a0aULL, 0x0000000028080028ULL}},
+	{{0x2808002800200282ULL, 0x4a000a080800002aULL, 0x000000020a222aa8ULL}},
+	{{0x0a222aa8002a0888ULL, 0x0800002800200282ULL, 0x000000020a0800a2ULL}},
+	{{0x0a0800a22aaa22a0ULL, 0x00200280002a0888ULL, 0x0000000200280080ULL}},
+	{{0x0028008000a208a0ULL, 0x002a088a2aaa22a0ULL, 0x0000000002802000ULL}},
+	{{0x0280200000802800ULL, 0x2aaa22a000a208a0ULL, 0x00000000088a2a00ULL}},
+	{{0x088a2a0020008020ULL, 0x00a208a000802800ULL, 0x0000000022a0aaa8ULL}},
+	{{0x22a0aaa82a008a80ULL, 0x0080280020008020ULL, 0x0000000008a0a200ULL}},
+	{{0x08a0a200aaa8a028ULL, 0x200080202a008a80ULL, 0x0000000028008000ULL}},
+	{{0x28008000a200a080ULL, 0x2a008a80aaa8a028ULL, 0x0000000080200008ULL}},
+	{{0x8020000880000088ULL, 0xaaa8a028a200a080ULL, 0x000000008a8000a8ULL}},
+};
+
+/**
+ * @brief 对 50 比特载荷做卷积编码，输出未交织的比特平面。
+ *
+ * @param word wspr_pack50() 的载荷。
+ * @param s 输出平面，等价于 wspr_convolve50() 的 162 字节输出。
+ *
+ * 每个置位的输入比特贡献一份左移 2k 位的冲激响应（无进位乘法）。
+ */
+void wspr_convolve_plane(uint64_t word, wspr_plane_t *s)
+{
+	uint64_t w[3] = {0, 0, 0};
+	WSPR_TRACE_BEGIN(t0);
+
+	// 与 JT9 等模式共用的卷积内核（wspr_mode.h）
+	wspr_mode_convolve(w, word, 50, 0);
+	s->w[0] = w[0];
+	s->w[1] = w[1];
+	s->w[2] = w[2];
+	WSPR_TRACE_END(WSPR_STAGE_CONVOLVE, t0);
+}
+
+/**
+ * @brief 比特平面上的交织：按 wspr_interleave_dest 置换每个置位比特。
+ *
+ * @param s 未交织平面。
+ * @param d 输出的交织后平面，等价于 wspr_interleave() 的结果。
+ */
+void wspr_interleave_plane(const wspr_plane_t *s, wspr_plane_t *d)
+{
+	uint64_t out[3] = {0, 0, 0};
+	WSPR_TRACE_BEGIN(t0);
+
+	wspr_mode_interleave(s->w, out, wspr_interleave_dest, WSPR_BIT_COUNT);
+	d->w[0] = out[0];
+	d->w[1] = out[1];
+	d->w[2] = out[2];
+	WSPR_TRACE_END(WSPR_STAGE_INTERLEAVE, t0);
+}
+
+/**
+ * @brief 卷积与交织合并为一步：按载荷置位比特异或生成矩阵的行。
+ *
+ * @param word wspr_pack50() 的载荷。
+ * @param d 输出的交织后信道比特平面。
+ */
+void wspr_convolve_interleave_plane(uint64_t word, wspr_plane_t *d)
+{
+	uint64_t w0 = 0, w1 = 0, w2 = 0;
+	WSPR_TRACE_BEGIN(t0);
+
+	word &= 0x3ffffffffffffULL;
+	while (word)
+	{
+		const wspr_plane_t *row = &wspr_generator_rows[49 - wspr_ctz64(word)];
+		w0 ^= row->w[0];
+		w1 ^= row->w[1];
+		w2 ^= row->w[2];
+		word &= word - 1;
+	}
+	d->w[0] = w0;
+	d->w[1] = w1;
+	d->w[2] = w2;
+	WSPR_TRACE_END(WSPR_STAGE_CONV_INTERLEAVE, t0);
+}
+
+/**
+ * @brief 把信道比特平面与同步平面合并展开为 162 个字节符号（0~3）。
+ */
+void wspr_plane_to_symbols(const wspr_plane_t *d, uint8_t *symbols)
+{
+	uint8_t i, k;
+	WSPR_TRACE_BEGIN(t0);
+
+	// 逐个 64 位字移位取比特，避免每个符号重新计算字下标
+	for (i = 0; i < 3; i++)
+	{
+		uint64_t sync = wspr_sync_plane.w[i];
+		uint64_t data = d->w[i];
+		uint8_t n = (i < 2) ? 64 : WSPR_SYMBOL_COUNT - 128;
+		for (k = 0; k < n; k++)
+		{
+			*symbols++ = (uint8_t)((sync & 1) | ((data & 1) << 1));
+			sync >>= 1;
+			data >>= 1;
+		}
+	}
+	WSPR_TRACE_END(WSPR_STAGE_MERGE_SYNC, t0);
+}
+
+/**
+ * @brief 把信道比特平面与同步平面合并为每字节 4 个符号的打包格式（41 字节）。
+ *
+ * 布局与 wspr_table.h 中 WSPR_TABLE_SYMBOL() 相同：符号 i 位于第 i/4 字节的
+ * 第 2*(i%4) 位起，低位为同步比特，高位为信道比特。
+ */
+void wspr_plane_to_packed(const wspr_plane_t *d, uint8_t *packed)
+{
+	uint8_t i;
+	WSPR_TRACE_BEGIN(t0);
+
+	for (i = 0; i < (WSPR_SYMBOL_COUNT + 3) / 4; i++)
+	{
+		uint8_t bit = (uint8_t)(i * 4);
+		// 取同步平面和信道平面各 4 比特，交错成 8 比特
+		uint8_t sync = (uint8_t)((wspr_sync_plane.w[bit >> 6] >> (bit & 63)) & 0x0f);
+		uint8_t data = (uint8_t)((d->w[bit >> 6] >> (bit & 63)) & 0x0f);
+		uint8_t v = 0;
+		uint8_t k;
+		for (k = 0; k < 4; k++)
+		{
+			v |= (uint8_t)((((sync >> k) & 1) | (((data >> k) & 1) << 1)) << (2 * k));
+		}
+		packed[i] = v;
+	}
+	WSPR_TRACE_END(WSPR_STAGE_MERGE_SYNC, t0);
+}
+
+/**
+ * @brief 比特平面版本的 WSPR 编码，输出交织后的信道比特平面。
+ *
+ * @param call 呼号（最长 12 字符）。
+ * @param loc Maidenhead 网格定位（最长 6 字符）。
+ * @param dbm 输出功率（dBm）。
+ * @param data 输出平面；符号为 wspr_sync_plane 与 data 逐位合并。
+ *
+ * 可重入、线程安全。
+ */
+void wspr_encode_plane(const char *call, const char *loc, const int8_t dbm, wspr_plane_t *data)
+{
+	char call_[13];
+	char loc_[7];
+	wspr_message_t msg;
+
+	strncpy(call_, call, 12);
+	call_[12] = '\0';
+	strncpy(loc_, loc, 6);
+	loc_[6] = '\0';
+
+	wspr_message_prep_r(&msg, call_, loc_, dbm);
+	wspr_convolve_interleave_plane(wspr_pack50(&msg), data);
+}
+
+/**
+ * @brief 低 RAM 占用的 WSPR 编码，中间数据都放在调用者的输出缓冲区里。
+ *
+ * @param call 呼号（最长 12 字符）。
+ * @param loc Maidenhead 网格定位（最长 6 字符）。
+ * @param dbm 输出功率（dBm）。
+ * @param symbols 输出的符号数组，长度为 WSPR_SYMBOL_COUNT，同时用作暂存区。
+ *
+ * 呼号和网格的可写副本放在 symbols[0..19]，打包成 50 比特载荷后，卷积、
+ * 交织和同步合并在同一个循环里完成，每个输出比特直接写到交织后的位置。
+ * 只用到 wspr_char_code、wspr_interleave_dest 和 wspr_sync_plane 三张
+ * 只读表（共约 450 字节），不引用生成矩阵。可重入、线程安全。
+ */
+void wspr_encode_inplace(const char *call, const char *loc, const int8_t dbm, uint8_t *symbols)
+{
+	char *call_ = (char *)symbols;
+	char *loc_ = (char *)symbols + 13;
+	wspr_message_t msg;
+	uint64_t word;
+	uint32_t reg = 0;
+	uint8_t i;
+
+	strncpy(call_, call, 12);
+	call_[12] = '\0';
+	strncpy(loc_, loc, 6);
+	loc_[6] = '\0';
+
+	wspr_message_prep_r(&msg, call_, loc_, dbm);
+	word = wspr_pack50(&msg);
+
+	// 载荷已在寄存器里，暂存区可以被覆盖
+	WSPR_TRACE_BEGIN(t0);
+	for (i = 0; i < WSPR_BIT_COUNT; i += 2)
+	{
+		uint8_t k = i >> 1;
+		uint8_t d0 = wspr_interleave_dest[i];
+		uint8_t d1 = wspr_interleave_dest[i + 1];
+
+		reg = (reg << 1) | (uint32_t)((k < 50) ? ((word >> (49 - k)) & 1) : 0);
+		symbols[d0] = (uint8_t)(WSPR_PLANE_BIT(&wspr_sync_plane, d0) | (wspr_parity32(reg & 0xf2d05351) << 1));
+		symbols[d1] = (uint8_t)(WSPR_PLANE_BIT(&wspr_sync_plane, d1) | (wspr_parity32(reg & 0xe4613c47) << 1));
+	}
+	WSPR_TRACE_END(WSPR_STAGE_CONV_INTERLEAVE, t0);
 }
 
 /*
@@ -520,34 +1046,23 @@ void wspr_message_prep(char *call, char *loc, int8_t dbm)
  * @param symbols 输出的符号数组，长度为 WSPR_SYMBOL_COUNT。
  *
  * 该函数将呼号、网格和功率编码为 WSPR 协议的符号序列。
- * 支持 Type 1、2、3 消息。
+ * 支持 Type 1、2、3 消息。所有状态都在栈上，可重入、线程安全。
  */
 void wspr_encode(const char *call, const char *loc, const int8_t dbm, uint8_t *symbols)
 {
-    char call_[13];
-    char loc_[7];
-    uint8_t dbm_ = dbm;
-    strncpy(call_, call, 12);
-    call_[12] = '\0';
-    strncpy(loc_, loc, 6);
-    loc_[6] = '\0';
-
-    // 确保消息文本符合标准
-    wspr_message_prep(call_, loc_, dbm_);
-
-    // 比特打包
-    uint8_t c[WSPR_MESSAGE_BYTE_SIZE];
-    wspr_bit_packing(c);
-
-    // 卷积编码
-    uint8_t s[WSPR_SYMBOL_COUNT];
-    convolve(c, s, WSPR_MESSAGE_BYTE_SIZE, WSPR_BIT_COUNT);
-
-    // 交织处理
-    wspr_interleave(s);
-
-    // 合并同步向量
-    wspr_merge_sync_vector(s, symbols);
-}
+    WSPR_TRACE_BEGIN(t0);
+#ifdef WSPR_ENCODE_SMALL
+    // 小 RAM 构建：不在栈上放比特平面，直接在输出缓冲区里编码
+    wspr_encode_inplace(call, loc, dbm, symbols);
+#else
+    wspr_plane_t data;
+
+    // 规范化、打包、卷积和交织都在比特平面上完成
+    wspr_encode_plane(call, loc, dbm, &data);
 
+    // 合并同步向量，展开为字节符号
+    wspr_plane_to_symbols(&data, symbols);
+#endif
+    WSPR_TRACE_END(WSPR_STAGE_ENCODE, t0);
+}
 
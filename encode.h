@@ -1,6 +1,55 @@
 #ifndef ENCODE_H
 #define ENCODE_H
 
+#include <stdint.h>
+
+#define WSPR_BIT_COUNT 162
+#define WSPR_SYMBOL_COUNT 162
+#define WSPR_MESSAGE_BYTE_SIZE 11
+
+// 规范化后的消息（呼号、网格、功率）
+typedef struct {
+	char callsign[13];
+	char locator[7];
+	int8_t power;
+} wspr_message_t;
+
+// 162比特平面：第i比特位于w[i >> 6]的第(i & 63)位
+typedef struct {
+	uint64_t w[3];
+} wspr_plane_t;
+
+#define WSPR_PLANE_BIT(p, i) ((uint8_t)(((p)->w[(i) >> 6] >> ((i) & 63)) & 1))
+
+// 同步向量平面；符号i = 同步比特 + 2 * 信道比特
+extern const wspr_plane_t wspr_sync_plane;
+// 交织置换：卷积输出第i比特写到交织后的第wspr_interleave_dest[i]位
+extern const uint8_t wspr_interleave_dest[WSPR_BIT_COUNT];
+
+// 可重入、线程安全。定义WSPR_ENCODE_SMALL时等同于wspr_encode_inplace()
 void wspr_encode(const char *call, const char *loc, const int8_t dbm, uint8_t *symbols);
+// 低RAM版本：以symbols为暂存区，卷积、交织、同步合并一次完成
+void wspr_encode_inplace(const char *call, const char *loc, const int8_t dbm, uint8_t *symbols);
+
+// 编码流程的各个阶段，供基准测试等工具单独调用。
+// 带_r后缀的版本通过msg传递状态，可重入；不带后缀的版本共用模块内部状态。
+void wspr_message_prep_r(wspr_message_t *msg, char *call, char *loc, int8_t dbm);
+void wspr_bit_packing_r(wspr_message_t *msg, uint8_t *c);
+// 统一查表打包：返回50比特载荷（高28位呼号，低22位网格/功率），wspr_convolve50()直接使用
+uint64_t wspr_pack50(const wspr_message_t *msg);
+void wspr_convolve50(uint64_t word, uint8_t *s);
+
+// 比特平面流程：信道比特始终以三个uint64_t传递，只在使用端展开为符号
+void wspr_encode_plane(const char *call, const char *loc, const int8_t dbm, wspr_plane_t *data);
+void wspr_convolve_plane(uint64_t word, wspr_plane_t *s);
+void wspr_interleave_plane(const wspr_plane_t *s, wspr_plane_t *d);
+void wspr_convolve_interleave_plane(uint64_t word, wspr_plane_t *d);
+void wspr_plane_to_symbols(const wspr_plane_t *d, uint8_t *symbols);
+void wspr_plane_to_packed(const wspr_plane_t *d, uint8_t *packed);
+void wspr_message_prep(char *call, char *loc, int8_t dbm);
+void wspr_bit_packing(uint8_t *c);
+void convolve(uint8_t *c, uint8_t *s, uint8_t message_size, uint8_t bit_size);
+void wspr_interleave(uint8_t *s);
+void wspr_merge_sync_vector(uint8_t *g, uint8_t *symbols);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,402 @@
+/*
+ * rf_harmonics.c - Si5351方波输出经低通滤波后的谐波发射预测
+ *
+ * Si5351的CLKx输出近似为梯形波：占空比D、上升/下降时间tr。
+ * 其第n次谐波的单边幅度为
+ *     a_n = 2A·D·|sinc(πnD)|·|sinc(πn·f·tr)|,   sinc(x) = sin(x)/x
+ * D=0.5、tr=0时退化为理想方波（只有奇次谐波，幅度按1/n下降）。
+ * 驱动强度取si5351DriveStrength_t各档（si5351.h中注释的2.2/7.5/9.5/10.7dBm），
+ * 作为理想方波基波送入50欧负载的功率来标定A；再乘以滤波器在n·f处的|S21|，
+ * 得到天线端口每个谐波的功率，与法规限值比较。
+ *
+ * 每个WSPR频段×4个音调×4档驱动强度为一个任务，全部频段由线程池并行计算。
+ *
+ * 滤波器：可用--preset/--ftr/元件指定一个电路用于所有频段；默认40m、30m用
+ * RF.m中的7mhz、10mhz电路，其余频段按Filter1.ftr的类型（7阶0.3dB切比雪夫）
+ * 把截止频率放在--cutoff倍f0处综合参考电路。--s2p给出矢网实测的滤波器板时，
+ * 所有频段都用测量数据插值得到的S21。
+ *
+ * 限值（--mask）：
+ *   fcc     47 CFR 97.307：基波<30MHz时杂散比基波低43dB；基波30~225MHz时
+ *           比基波低40dB且不超过25µW，但不必低于10µW（按平均功率<=25W）
+ *   itu     ITU-R SM.329 A类（业余业务）：43+10log(P/W)与50dBc中较宽松者
+ *   dbc:N   统一为比基波低N dB
+ *
+ * 编译：
+ *   gcc -O3 -o rf_harmonics rf_harmonics.c rf_ladder.c rf_synth.c rf_touchstone.c -lm -lpthread
+ *
+ * 用法：
+ *   rf_harmonics [-j 线程数] [--band Hz]... [--drive 2|4|6|8]... [--duty %] [--rise ns]
+ *                [--harmonics N] [--mask fcc|itu|dbc:N] [--cutoff 倍数] [--ql Q] [--qc Q]
+ *                [--z0 欧姆] [--preset 名称 | --ftr 文件 | --s2p 文件 | 元件...]
+ *                [--interp mp|ri|rational] [-o out.csv]
+ *
+ * CSV列：band_hz,drive_ma,tone,harmonic,freq_hz,source_dbm,s21_db,out_dbm,dbc,limit_dbm,margin_db
+ * 频段汇总（每档驱动强度下最差谐波的裕量）输出到stdout。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "si5351.h"
+#include "rf_ladder.h"
+#include "rf_synth.h"
+#include "rf_touchstone.h"
+
+#define MAX_THREADS 256
+#define MAX_HARMONICS 64
+#define TONES 4
+#define DRIVES 4
+#define RF_PI 3.14159265358979323846
+// WSPR音调间隔（Hz）
+#define TONE_SPACING (12000.0 / 8192.0)
+
+static const double wspr_bands[] = {
+    137500, 475700, 1838100, 3570100, 5288700, 7040100, 10140200,
+    14097100, 18106100, 21096100, 24926100, 28126100, 50294500,
+};
+#define WSPR_BAND_COUNT (sizeof(wspr_bands) / sizeof(wspr_bands[0]))
+
+// 与si5351.h中的注释一致：50欧负载上的输出功率
+static const struct {
+    si5351DriveStrength_t drive;
+    int ma;
+    double dbm;
+} drives[DRIVES] = {
+    {SI5351_DRIVE_STRENGTH_2MA, 2, 2.2},
+    {SI5351_DRIVE_STRENGTH_4MA, 4, 7.5},
+    {SI5351_DRIVE_STRENGTH_6MA, 6, 9.5},
+    {SI5351_DRIVE_STRENGTH_8MA, 8, 10.7},
+};
+
+typedef enum { MASK_FCC, MASK_ITU, MASK_DBC } mask_kind_t;
+
+static struct {
+    double duty;     // 0~1
+    double rise;     // 秒
+    int harmonics;   // 计算到第几次谐波
+    mask_kind_t mask;
+    double mask_dbc; // MASK_DBC的衰减量
+    double cutoff;   // 参考电路截止频率/f0
+    double rs, rl;
+    double q_l, q_c;
+} cfg = {0.5, 1e-9, 15, MASK_FCC, 50, 1.25, 50, 50, 100, 500};
+
+// 一次谐波计算的结果
+typedef struct {
+    double freq;
+    double source_dbm, s21_db, out_dbm, dbc, limit_dbm;
+} harmonic_t;
+
+typedef struct {
+    int band;   // wspr_bands下标
+    int drive;  // drives下标
+    int tone;
+    harmonic_t h[MAX_HARMONICS];
+    double worst_margin;
+    int worst_n;
+} task_t;
+
+static rf_ladder_t band_ladder[WSPR_BAND_COUNT];
+static const char *band_filter_name[WSPR_BAND_COUNT];
+static rf_s2p_t meas;
+static const char *s2p_path;
+static rf_interp_t interp = RF_INTERP_MAGPHASE;
+static task_t *tasks;
+static int task_count;
+static int next_task;
+
+// ---------------------------------------------------------------- 频谱与限值
+
+static double sinc(double x) {
+    return fabs(x) < 1e-12 ? 1.0 : sin(x) / x;
+}
+
+// 梯形波第n次谐波相对理想方波基波（4A/π中的A取1）的幅度
+static double trapezoid_rel(int n, double f) {
+    double a = 2.0 * cfg.duty * fabs(sinc(RF_PI * n * cfg.duty)) * fabs(sinc(RF_PI * n * f * cfg.rise));
+    return a / (2.0 / RF_PI);
+}
+
+// 天线端口基波功率为p1（dBm）时频率f处杂散的上限（dBm）
+static double mask_limit(double f0, double p1) {
+    switch (cfg.mask) {
+    case MASK_FCC:
+        if (f0 < 30e6) return p1 - 43.0;
+        {
+            // 30~225MHz：比基波低40dB且<=25µW（-16dBm），但不必低于10µW（-20dBm）
+            double l = p1 - 40.0 < -16.0 ? p1 - 40.0 : -16.0;
+            return l > -20.0 ? l : -20.0;
+        }
+    case MASK_ITU: {
+        // 43+10log(P/W)与50dBc中较宽松者，即 max(P-50dB, -43dBW)
+        double l = p1 - 50.0;
+        return l > -13.0 ? l : -13.0;
+    }
+    case MASK_DBC:
+        break;
+    }
+    return p1 - cfg.mask_dbc;
+}
+
+static void run_task(task_t *t) {
+    double f = wspr_bands[t->band] + t->tone * TONE_SPACING;
+    double freq[MAX_HARMONICS];
+    rf_sparams_t s;
+    double p1;
+    int n;
+
+    for (n = 1; n <= cfg.harmonics; n++) freq[n - 1] = n * f;
+    if (rf_sparams_alloc(&s, (size_t)cfg.harmonics) != 0) return;
+    if (s2p_path) {
+        rf_s2p_eval_sparams(&meas, interp, freq, (size_t)cfg.harmonics, &s);
+    } else {
+        rf_ladder_sweep(&band_ladder[t->band], freq, (size_t)cfg.harmonics, cfg.rs, cfg.rl, &s);
+    }
+
+    for (n = 1; n <= cfg.harmonics; n++) {
+        harmonic_t *h = &t->h[n - 1];
+        double rel = trapezoid_rel(n, f);
+        h->freq = freq[n - 1];
+        // 低于-240dB按不存在处理（占空比正好50%时偶次谐波为0）
+        h->source_dbm = rel > 1e-12 ? drives[t->drive].dbm + 20.0 * log10(rel) : -400.0;
+        h->s21_db = rf_db(s.s21_re[n - 1], s.s21_im[n - 1]);
+        h->out_dbm = h->source_dbm + h->s21_db;
+    }
+    p1 = t->h[0].out_dbm;
+    t->worst_margin = HUGE_VAL;
+    t->worst_n = 0;
+    for (n = 1; n <= cfg.harmonics; n++) {
+        harmonic_t *h = &t->h[n - 1];
+        h->dbc = h->out_dbm - p1;
+        h->limit_dbm = mask_limit(f, p1);
+        if (n > 1 && h->limit_dbm - h->out_dbm < t->worst_margin) {
+            t->worst_margin = h->limit_dbm - h->out_dbm;
+            t->worst_n = n;
+        }
+    }
+    rf_sparams_free(&s);
+}
+
+static void *worker(void *arg) {
+    (void)arg;
+    for (;;) {
+        int i = __atomic_fetch_add(&next_task, 1, __ATOMIC_RELAXED);
+        if (i >= task_count) break;
+        run_task(&tasks[i]);
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------- 命令行
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int parse_mask(const char *s) {
+    if (strcmp(s, "fcc") == 0) {
+        cfg.mask = MASK_FCC;
+    } else if (strcmp(s, "itu") == 0) {
+        cfg.mask = MASK_ITU;
+    } else if (strncmp(s, "dbc:", 4) == 0 && atof(s + 4) > 0) {
+        cfg.mask = MASK_DBC;
+        cfg.mask_dbc = atof(s + 4);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int band_sel[WSPR_BAND_COUNT], drive_sel[DRIVES];
+    int band_any = 0, drive_any = 0, bad_args = 0;
+    const char *out_path = NULL;
+    const char *preset = NULL;
+    const char *ftr_path = NULL;
+    rf_ladder_t custom;
+    pthread_t th[MAX_THREADS];
+    double t0, t1;
+    size_t b;
+    int a, i, d, n;
+
+    memset(band_sel, 0, sizeof(band_sel));
+    memset(drive_sel, 0, sizeof(drive_sel));
+    custom.count = 0;
+    for (a = 1; a < argc; a++) {
+        double v;
+        if (strcmp(argv[a], "-j") == 0 && a + 1 < argc) {
+            threads = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--band") == 0 && a + 1 < argc) {
+            int found = 0;
+            if (rf_parse_value(argv[++a], &v) != 0) v = 0;
+            // 按最近的WSPR频段匹配，允许写7M、14.097M等
+            for (b = 0; b < WSPR_BAND_COUNT; b++) {
+                if (fabs(wspr_bands[b] - v) < 0.05 * wspr_bands[b]) {
+                    band_sel[b] = found = band_any = 1;
+                }
+            }
+            if (!found) bad_args = 1;
+        } else if (strcmp(argv[a], "--drive") == 0 && a + 1 < argc) {
+            int ma = atoi(argv[++a]);
+            int found = 0;
+            for (d = 0; d < DRIVES; d++) {
+                if (drives[d].ma == ma) drive_sel[d] = found = drive_any = 1;
+            }
+            if (!found) bad_args = 1;
+        } else if (strcmp(argv[a], "--duty") == 0 && a + 1 < argc) {
+            cfg.duty = atof(argv[++a]) / 100;
+            if (cfg.duty <= 0 || cfg.duty >= 1) bad_args = 1;
+        } else if (strcmp(argv[a], "--rise") == 0 && a + 1 < argc) {
+            cfg.rise = atof(argv[++a]) * 1e-9;
+            if (cfg.rise < 0) bad_args = 1;
+        } else if (strcmp(argv[a], "--harmonics") == 0 && a + 1 < argc) {
+            cfg.harmonics = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--mask") == 0 && a + 1 < argc) {
+            if (parse_mask(argv[++a]) != 0) bad_args = 1;
+        } else if (strcmp(argv[a], "--cutoff") == 0 && a + 1 < argc) {
+            cfg.cutoff = atof(argv[++a]);
+            if (cfg.cutoff <= 0) bad_args = 1;
+        } else if (strcmp(argv[a], "--ql") == 0 && a + 1 < argc) {
+            cfg.q_l = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--qc") == 0 && a + 1 < argc) {
+            cfg.q_c = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--z0") == 0 && a + 1 < argc) {
+            cfg.rs = cfg.rl = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--preset") == 0 && a + 1 < argc) {
+            preset = argv[++a];
+        } else if (strcmp(argv[a], "--ftr") == 0 && a + 1 < argc) {
+            ftr_path = argv[++a];
+        } else if (strcmp(argv[a], "--s2p") == 0 && a + 1 < argc) {
+            s2p_path = argv[++a];
+        } else if (strcmp(argv[a], "--interp") == 0 && a + 1 < argc) {
+            if (rf_parse_interp(argv[++a], &interp) != 0) bad_args = 1;
+        } else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+            out_path = argv[++a];
+        } else {
+            rf_element_t e;
+            if (rf_parse_element(argv[a], &e) != 0 || rf_ladder_add(&custom, &e) != 0) bad_args = 1;
+        }
+    }
+    if (bad_args || cfg.harmonics < 2 || cfg.harmonics > MAX_HARMONICS || cfg.rs <= 0) {
+        fprintf(stderr, "用法: %s [-j 线程数] [--band Hz]... [--drive 2|4|6|8]... [--duty %%] [--rise ns]\n"
+                        "          [--harmonics N] [--mask fcc|itu|dbc:N] [--cutoff 倍数] [--ql Q] [--qc Q]\n"
+                        "          [--z0 欧姆] [--preset 名称 | --ftr 文件 | --s2p 文件 | 元件...]\n"
+                        "          [--interp mp|ri|rational] [-o out.csv]\n",
+                argv[0]);
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    if (s2p_path) {
+        char err[128];
+        const char *slash = strrchr(s2p_path, '/');
+        double f_top = 0;
+        if (rf_s2p_open_cached(s2p_path, &meas, err, sizeof(err)) != 0) {
+            fprintf(stderr, "%s: %s\n", s2p_path, err);
+            return 1;
+        }
+        for (b = 0; b < WSPR_BAND_COUNT; b++) {
+            band_filter_name[b] = slash ? slash + 1 : s2p_path;
+            if (!band_any || band_sel[b]) f_top = wspr_bands[b];
+        }
+        f_top = cfg.harmonics * (f_top + (TONES - 1) * TONE_SPACING);
+        if (f_top > meas.freq[meas.n - 1]) {
+            fprintf(stderr, "注意：%s 只测到 %.6g Hz，更高的谐波取端点值（最高 %.6g Hz）\n", s2p_path,
+                    meas.freq[meas.n - 1], f_top);
+        }
+    }
+
+    // 每个频段的滤波器
+    for (b = 0; b < WSPR_BAND_COUNT && !s2p_path; b++) {
+        rf_ladder_t *l = &band_ladder[b];
+        int ret = 0;
+        if (preset) {
+            ret = rf_ladder_preset(preset, l);
+            band_filter_name[b] = preset;
+        } else if (ftr_path) {
+            rf_filter_spec_t spec;
+            ret = rf_ftr_load(ftr_path, &spec);
+            if (ret == 0) ret = rf_synth_ladder(&spec, l, NULL);
+            band_filter_name[b] = ftr_path;
+        } else if (custom.count) {
+            *l = custom;
+            band_filter_name[b] = "custom";
+        } else {
+            ret = rf_band_filter(wspr_bands[b], cfg.cutoff, cfg.rs, l, &band_filter_name[b]);
+        }
+        if (ret != 0) {
+            fprintf(stderr, "无法建立滤波器: %s\n", preset ? preset : ftr_path ? ftr_path : "?");
+            return 1;
+        }
+        rf_ladder_default_q(l, cfg.q_l, cfg.q_c);
+    }
+
+    tasks = (task_t *)calloc(WSPR_BAND_COUNT * DRIVES * TONES, sizeof(task_t));
+    if (!tasks) return 1;
+    for (b = 0; b < WSPR_BAND_COUNT; b++) {
+        if (band_any && !band_sel[b]) continue;
+        for (d = 0; d < DRIVES; d++) {
+            if (drive_any && !drive_sel[d]) continue;
+            for (i = 0; i < TONES; i++) {
+                tasks[task_count].band = (int)b;
+                tasks[task_count].drive = d;
+                tasks[task_count].tone = i;
+                task_count++;
+            }
+        }
+    }
+
+    t0 = now_sec();
+    for (i = 0; i < threads; i++) pthread_create(&th[i], NULL, worker, NULL);
+    for (i = 0; i < threads; i++) pthread_join(th[i], NULL);
+    t1 = now_sec();
+
+    if (out_path) {
+        FILE *out = fopen(out_path, "w");
+        if (!out) {
+            perror(out_path);
+            return 1;
+        }
+        fprintf(out, "band_hz,drive_ma,tone,harmonic,freq_hz,source_dbm,s21_db,out_dbm,dbc,limit_dbm,margin_db\n");
+        for (i = 0; i < task_count; i++) {
+            const task_t *t = &tasks[i];
+            for (n = 1; n <= cfg.harmonics; n++) {
+                const harmonic_t *h = &t->h[n - 1];
+                fprintf(out, "%.0f,%d,%d,%d,%.3f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n", wspr_bands[t->band],
+                        drives[t->drive].ma, t->tone, n, h->freq, h->source_dbm, h->s21_db, h->out_dbm,
+                        h->dbc, h->limit_dbm, h->limit_dbm - h->out_dbm);
+            }
+        }
+        fclose(out);
+    }
+
+    // 汇总：每个频段、每档驱动强度下4个音调中最差的谐波
+    printf("占空比 %.1f%%，上升时间 %.2f ns，%d 次谐波，限值 %s\n", cfg.duty * 100, cfg.rise * 1e9,
+           cfg.harmonics, cfg.mask == MASK_FCC ? "FCC 97.307" : cfg.mask == MASK_ITU ? "ITU-R SM.329" : "dBc");
+    printf("%10s  %-12s %5s %9s %9s %4s %9s  %s\n", "频段MHz", "滤波器", "驱动", "输出dBm", "最差dBc",
+           "次", "裕量dB", "结果");
+    for (i = 0; i < task_count; i += TONES) {
+        const task_t *worst = &tasks[i];
+        int k;
+        for (k = 1; k < TONES; k++) {
+            if (tasks[i + k].worst_margin < worst->worst_margin) worst = &tasks[i + k];
+        }
+        printf("%10.4f  %-12s %3dmA %9.2f %9.1f %4d %9.1f  %s\n", wspr_bands[worst->band] / 1e6,
+               band_filter_name[worst->band], drives[worst->drive].ma, worst->h[0].out_dbm,
+               worst->h[worst->worst_n - 1].dbc, worst->worst_n, worst->worst_margin,
+               worst->worst_margin >= 0 ? "合格" : "超标");
+    }
+    fprintf(stderr, "%d 个任务（频段×驱动×音调），%d 线程，%.3f 秒\n", task_count, threads, t1 - t0);
+    free(tasks);
+    if (s2p_path) rf_s2p_free(&meas);
+    return 0;
+}
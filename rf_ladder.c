@@ -0,0 +1,582 @@
+/*
+ * rf_ladder.c - LC梯形网络ABCD级联仿真，见rf_ladder.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "rf_ladder.h"
+
+#define RF_PI 3.14159265358979323846
+
+const char *const rf_preset_names[] = {"7mhz", "10mhz", "10mhz-test", NULL};
+
+// 与RF.m中注释掉/启用的三组配置一致
+static const char *const rf_preset_specs[] = {
+    "PC=680p SL=1.5u PC=1n SL=1.5u PC=1n SL=1.5u PC=680p",
+    "PC=470p SL=1u PC=680p SL=1u PC=680p SL=1u PC=470p",
+    "PC=330p SL=680n PC=330p",
+};
+
+// ---------------------------------------------------------------- 解析与格式化
+
+int rf_parse_value(const char *s, double *v) {
+    char *end;
+    double x = strtod(s, &end);
+    double scale = 1.0;
+
+    if (end == s) return -1;
+    switch (*end) {
+    case 'f': scale = 1e-15; end++; break;
+    case 'p': scale = 1e-12; end++; break;
+    case 'n': scale = 1e-9; end++; break;
+    case 'u': scale = 1e-6; end++; break;
+    case 'm': scale = 1e-3; end++; break;
+    case 'k': case 'K': scale = 1e3; end++; break;
+    case 'M': scale = 1e6; end++; break;
+    case 'G': scale = 1e9; end++; break;
+    default: break;
+    }
+    // 允许跟单位字母，如680pF、1.5uH、50ohm
+    while (isalpha((unsigned char)*end)) end++;
+    if (*end != 0) return -1;
+    *v = x * scale;
+    return 0;
+}
+
+static void format_value(double v, char *buf, size_t size) {
+    static const struct { double scale; char suffix; } si[] = {
+        {1e9, 'G'}, {1e6, 'M'}, {1e3, 'k'}, {1.0, 0},
+        {1e-3, 'm'}, {1e-6, 'u'}, {1e-9, 'n'}, {1e-12, 'p'}, {1e-15, 'f'},
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(si) / sizeof(si[0]); i++) {
+        if (fabs(v) >= si[i].scale * 0.9999999 || i + 1 == sizeof(si) / sizeof(si[0])) {
+            if (si[i].suffix) {
+                snprintf(buf, size, "%.6g%c", v / si[i].scale, si[i].suffix);
+            } else {
+                snprintf(buf, size, "%.6g", v);
+            }
+            return;
+        }
+    }
+}
+
+int rf_parse_element(const char *s, rf_element_t *e) {
+    char buf[128];
+    char *tok, *save;
+
+    memset(e, 0, sizeof(*e));
+    if (strlen(s) >= sizeof(buf)) return -1;
+    if (s[0] == 'S' || s[0] == 's') {
+        e->placement = RF_SERIES;
+    } else if (s[0] == 'P' || s[0] == 'p') {
+        e->placement = RF_SHUNT;
+    } else {
+        return -1;
+    }
+    strcpy(buf, s + 1);
+
+    for (tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(tok, '=');
+        double v;
+        if (!eq || rf_parse_value(eq + 1, &v) != 0 || v < 0) return -1;
+        *eq = 0;
+        if (strcmp(tok, "R") == 0) e->r = v;
+        else if (strcmp(tok, "L") == 0) e->l = v;
+        else if (strcmp(tok, "C") == 0) e->c = v;
+        else if (strcmp(tok, "q") == 0) e->q_l = e->q_c = v;
+        else if (strcmp(tok, "ql") == 0) e->q_l = v;
+        else if (strcmp(tok, "qc") == 0) e->q_c = v;
+        else if (strcmp(tok, "dcr") == 0) e->dcr_l = v;
+        else if (strcmp(tok, "esr") == 0) e->esr_c = v;
+        else return -1;
+    }
+    if (e->r == 0 && e->l == 0 && e->c == 0) return -1;
+    return 0;
+}
+
+int rf_format_element(const rf_element_t *e, char *buf, size_t size) {
+    char v[32];
+    size_t n = 0;
+    int first = 1;
+
+#define APPEND(key, val)                                                         \
+    do {                                                                         \
+        format_value(val, v, sizeof(v));                                         \
+        n += (size_t)snprintf(buf + n, n < size ? size - n : 0, "%s%s=%s",      \
+                              first ? "" : ",", key, v);                         \
+        first = 0;                                                               \
+    } while (0)
+
+    n += (size_t)snprintf(buf, size, "%c", e->placement == RF_SERIES ? 'S' : 'P');
+    if (e->r > 0) APPEND("R", e->r);
+    if (e->l > 0) APPEND("L", e->l);
+    if (e->c > 0) APPEND("C", e->c);
+    if (e->l > 0 && e->q_l > 0) APPEND("ql", e->q_l);
+    if (e->c > 0 && e->q_c > 0) APPEND("qc", e->q_c);
+    if (e->l > 0 && e->dcr_l > 0) APPEND("dcr", e->dcr_l);
+    if (e->c > 0 && e->esr_c > 0) APPEND("esr", e->esr_c);
+#undef APPEND
+    return (int)n;
+}
+
+int rf_ladder_add(rf_ladder_t *ladder, const rf_element_t *e) {
+    if (ladder->count >= RF_MAX_ELEMENTS) return -1;
+    ladder->e[ladder->count++] = *e;
+    return 0;
+}
+
+void rf_ladder_default_q(rf_ladder_t *ladder, double q_l, double q_c) {
+    int i;
+    for (i = 0; i < ladder->count; i++) {
+        if (ladder->e[i].q_l == 0) ladder->e[i].q_l = q_l;
+        if (ladder->e[i].q_c == 0) ladder->e[i].q_c = q_c;
+    }
+}
+
+int rf_ladder_preset(const char *name, rf_ladder_t *ladder) {
+    char buf[256];
+    char *tok, *save;
+    int i;
+
+    for (i = 0; rf_preset_names[i]; i++) {
+        if (strcmp(name, rf_preset_names[i]) == 0) break;
+    }
+    if (!rf_preset_names[i]) return -1;
+
+    ladder->count = 0;
+    snprintf(buf, sizeof(buf), "%s", rf_preset_specs[i]);
+    for (tok = strtok_r(buf, " ", &save); tok; tok = strtok_r(NULL, " ", &save)) {
+        rf_element_t e;
+        if (rf_parse_element(tok, &e) != 0 || rf_ladder_add(ladder, &e) != 0) return -1;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------- 频率网格
+
+void rf_freq_linspace(double f1, double f2, size_t n, double *freq) {
+    size_t i;
+    if (n == 1) {
+        freq[0] = f1;
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        freq[i] = f1 + (f2 - f1) * (double)i / (double)(n - 1);
+    }
+}
+
+void rf_freq_logspace(double f1, double f2, size_t n, double *freq) {
+    double r;
+    size_t i;
+    if (n == 1) {
+        freq[0] = f1;
+        return;
+    }
+    r = log(f2 / f1);
+    for (i = 0; i < n; i++) {
+        freq[i] = f1 * exp(r * (double)i / (double)(n - 1));
+    }
+}
+
+// ---------------------------------------------------------------- 扫频
+
+// 一个块内的ABCD矩阵（结构数组）
+typedef struct {
+    double a_re[RF_BLOCK], a_im[RF_BLOCK];
+    double b_re[RF_BLOCK], b_im[RF_BLOCK];
+    double c_re[RF_BLOCK], c_im[RF_BLOCK];
+    double d_re[RF_BLOCK], d_im[RF_BLOCK];
+    double x_re[RF_BLOCK], x_im[RF_BLOCK]; // 当前元件的Z（串联）或Y（并联）
+} rf_block_t;
+
+// 有损电感的串联阻抗：dcr + ωL/Q + jωL
+static inline void inductor_z(const rf_element_t *e, double w, double *re, double *im) {
+    double x = w * e->l;
+    *re = e->dcr_l + (e->q_l > 0 ? x / e->q_l : 0.0);
+    *im = x;
+}
+
+// 有损电容的串联阻抗：esr + 1/(ωCQ) - j/(ωC)
+static inline void capacitor_z(const rf_element_t *e, double w, double *re, double *im) {
+    double x = 1.0 / (w * e->c);
+    *re = e->esr_c + (e->q_c > 0 ? x / e->q_c : 0.0);
+    *im = -x;
+}
+
+static inline void add_reciprocal(double re, double im, double *acc_re, double *acc_im) {
+    double m = re * re + im * im;
+    *acc_re += re / m;
+    *acc_im -= im / m;
+}
+
+// 单个频点的元件阻抗（串联支路）或导纳（并联支路）
+static inline void immittance_at(const rf_element_t *e, double w, double *out_re, double *out_im) {
+    double re = 0.0, im = 0.0, zr, zi;
+
+    if (e->placement == RF_SERIES) {
+        re = e->r;
+        if (e->l > 0) {
+            inductor_z(e, w, &zr, &zi);
+            re += zr;
+            im += zi;
+        }
+        if (e->c > 0) {
+            capacitor_z(e, w, &zr, &zi);
+            re += zr;
+            im += zi;
+        }
+    } else {
+        if (e->r > 0) re = 1.0 / e->r;
+        if (e->l > 0) {
+            inductor_z(e, w, &zr, &zi);
+            add_reciprocal(zr, zi, &re, &im);
+        }
+        if (e->c > 0) {
+            capacitor_z(e, w, &zr, &zi);
+            add_reciprocal(zr, zi, &re, &im);
+        }
+    }
+    *out_re = re;
+    *out_im = im;
+}
+
+void rf_element_immittance(const rf_element_t *e, double freq, double *re, double *im) {
+    immittance_at(e, 2.0 * RF_PI * freq, re, im);
+}
+
+// 计算块内每个频点的元件阻抗/导纳
+static void element_immittance(const rf_element_t *e, const double *freq, size_t n, rf_block_t *b) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        immittance_at(e, 2.0 * RF_PI * freq[i], &b->x_re[i], &b->x_im[i]);
+    }
+}
+
+// M = M * [1 Z; 0 1]：B += A·Z，D += C·Z
+// 蒙特卡洛样本：同一频点，第i路为元件值乘以m[i]后的样本。
+// 与immittance_at()同样的计算顺序，分支提到循环外，每个循环都可以向量化
+static void element_immittance_scaled(const rf_element_t *e, double w, const double *m, size_t n, rf_block_t *b) {
+    double kq_l = e->q_l > 0 ? 1.0 / e->q_l : 0.0;
+    double kq_c = e->q_c > 0 ? 1.0 / e->q_c : 0.0;
+    int series = e->placement == RF_SERIES;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        b->x_re[i] = series ? e->r * m[i] : 0.0;
+        b->x_im[i] = 0.0;
+    }
+    if (!series && e->r > 0) {
+        for (i = 0; i < n; i++) b->x_re[i] = 1.0 / (e->r * m[i]);
+    }
+    if (e->l > 0) {
+        for (i = 0; i < n; i++) {
+            double x = w * (e->l * m[i]);
+            double zr = e->dcr_l + x * kq_l;
+            if (series) {
+                b->x_re[i] += zr;
+                b->x_im[i] += x;
+            } else {
+                double d = zr * zr + x * x;
+                b->x_re[i] += zr / d;
+                b->x_im[i] -= x / d;
+            }
+        }
+    }
+    if (e->c > 0) {
+        for (i = 0; i < n; i++) {
+            double x = 1.0 / (w * (e->c * m[i]));
+            double zr = e->esr_c + x * kq_c;
+            if (series) {
+                b->x_re[i] += zr;
+                b->x_im[i] -= x;
+            } else {
+                double d = zr * zr + x * x;
+                b->x_re[i] += zr / d;
+                b->x_im[i] += x / d;
+            }
+        }
+    }
+}
+
+static void cascade_series(rf_block_t *b, size_t n) {
+    size_t i;
+    for (i = 0; i < n; i++) {
+        double zr = b->x_re[i], zi = b->x_im[i];
+        b->b_re[i] += b->a_re[i] * zr - b->a_im[i] * zi;
+        b->b_im[i] += b->a_re[i] * zi + b->a_im[i] * zr;
+        b->d_re[i] += b->c_re[i] * zr - b->c_im[i] * zi;
+        b->d_im[i] += b->c_re[i] * zi + b->c_im[i] * zr;
+    }
+}
+
+// M = M * [1 0; Y 1]：A += B·Y，C += D·Y
+static void cascade_shunt(rf_block_t *b, size_t n) {
+    size_t i;
+    for (i = 0; i < n; i++) {
+        double yr = b->x_re[i], yi = b->x_im[i];
+        b->a_re[i] += b->b_re[i] * yr - b->b_im[i] * yi;
+        b->a_im[i] += b->b_re[i] * yi + b->b_im[i] * yr;
+        b->c_re[i] += b->d_re[i] * yr - b->d_im[i] * yi;
+        b->c_im[i] += b->d_re[i] * yi + b->d_im[i] * yr;
+    }
+}
+
+// ABCD转S参数（实数参考阻抗rs/rl）
+static void abcd_to_s(const rf_block_t *b, size_t n, double rs, double rl, size_t off, rf_sparams_t *out) {
+    double k = 2.0 * sqrt(rs * rl);
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        // den = A·Rl + B + C·Rs·Rl + D·Rs
+        double ar = b->a_re[i] * rl, ai = b->a_im[i] * rl;
+        double cr = b->c_re[i] * rs * rl, ci = b->c_im[i] * rs * rl;
+        double dr = b->d_re[i] * rs, di = b->d_im[i] * rs;
+        double den_r = ar + b->b_re[i] + cr + dr;
+        double den_i = ai + b->b_im[i] + ci + di;
+        double m = 1.0 / (den_r * den_r + den_i * den_i);
+        double n11_r = ar + b->b_re[i] - cr - dr, n11_i = ai + b->b_im[i] - ci - di;
+        double n22_r = -ar + b->b_re[i] - cr + dr, n22_i = -ai + b->b_im[i] - ci + di;
+
+        out->s11_re[off + i] = (n11_r * den_r + n11_i * den_i) * m;
+        out->s11_im[off + i] = (n11_i * den_r - n11_r * den_i) * m;
+        out->s22_re[off + i] = (n22_r * den_r + n22_i * den_i) * m;
+        out->s22_im[off + i] = (n22_i * den_r - n22_r * den_i) * m;
+        out->s21_re[off + i] = k * den_r * m;
+        out->s21_im[off + i] = -k * den_i * m;
+    }
+}
+
+static void block_identity(rf_block_t *b, size_t n) {
+    size_t i;
+    for (i = 0; i < n; i++) {
+        b->a_re[i] = 1.0;
+        b->a_im[i] = 0.0;
+        b->b_re[i] = 0.0;
+        b->b_im[i] = 0.0;
+        b->c_re[i] = 0.0;
+        b->c_im[i] = 0.0;
+        b->d_re[i] = 1.0;
+        b->d_im[i] = 0.0;
+    }
+}
+
+void rf_ladder_sweep(const rf_ladder_t *ladder, const double *freq, size_t n,
+                     double rs, double rl, rf_sparams_t *out) {
+    rf_block_t *b = (rf_block_t *)malloc(sizeof(rf_block_t));
+    size_t off;
+
+    if (!b) return;
+    for (off = 0; off < n; off += RF_BLOCK) {
+        size_t len = (n - off < RF_BLOCK) ? n - off : RF_BLOCK;
+        int k;
+
+        block_identity(b, len);
+        for (k = 0; k < ladder->count; k++) {
+            element_immittance(&ladder->e[k], freq + off, len, b);
+            if (ladder->e[k].placement == RF_SERIES) {
+                cascade_series(b, len);
+            } else {
+                cascade_shunt(b, len);
+            }
+        }
+        abcd_to_s(b, len, rs, rl, off, out);
+    }
+    free(b);
+}
+
+void rf_ladder_sweep_samples(const rf_ladder_t *ladder, const double *mult, size_t n,
+                             double freq, double rs, double rl, rf_sparams_t *out) {
+    rf_block_t *b = (rf_block_t *)malloc(sizeof(rf_block_t));
+    double w = 2.0 * RF_PI * freq;
+    size_t off;
+
+    if (!b) return;
+    for (off = 0; off < n; off += RF_BLOCK) {
+        size_t len = (n - off < RF_BLOCK) ? n - off : RF_BLOCK;
+        int k;
+
+        block_identity(b, len);
+        for (k = 0; k < ladder->count; k++) {
+            element_immittance_scaled(&ladder->e[k], w, mult + (size_t)k * n + off, len, b);
+            if (ladder->e[k].placement == RF_SERIES) {
+                cascade_series(b, len);
+            } else {
+                cascade_shunt(b, len);
+            }
+        }
+        abcd_to_s(b, len, rs, rl, off, out);
+    }
+    free(b);
+}
+
+void rf_group_delay(const double *freq, const double *s21_re, const double *s21_im,
+                    size_t n, double *gd) {
+    size_t i;
+
+    if (n < 2) {
+        if (n == 1) gd[0] = 0.0;
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        size_t lo = (i == 0) ? 0 : i - 1;
+        size_t hi = (i == n - 1) ? n - 1 : i + 1;
+        // arg(S21[hi]·conj(S21[lo]))，不需要相位展开
+        double re = s21_re[hi] * s21_re[lo] + s21_im[hi] * s21_im[lo];
+        double im = s21_im[hi] * s21_re[lo] - s21_re[hi] * s21_im[lo];
+        gd[i] = -atan2(im, re) / (2.0 * RF_PI * (freq[hi] - freq[lo]));
+    }
+}
+
+// ---------------------------------------------------------------- 时域仿真
+
+int rf_tran_init(rf_tran_t *t, const rf_ladder_t *ladder, double rs, double rl, double h, double f_ref) {
+    double d[RF_TRAN_MAX];
+    double w = 2.0 * RF_PI * f_ref;
+    int node = 0; // 当前节点电压的下标
+    int k, i;
+
+    if (ladder->count > RF_MAX_ELEMENTS || rs <= 0 || rl <= 0 || h <= 0) return -1;
+    memset(t, 0, sizeof(*t));
+    memset(d, 0, sizeof(d));
+    t->h = h;
+    t->rs = rs;
+    t->elements = ladder->count;
+    d[0] = 1.0 / rs;
+
+    for (k = 0; k < ladder->count; k++) {
+        const rf_element_t *el = &ladder->e[k];
+        if (el->placement == RF_SERIES) {
+            // 支路方程 V_a - V_b - Z·I = 历史项，与两端节点KCL中的±I对称
+            double z = el->r;
+            int cur = node + 1;
+            if (el->l > 0) {
+                t->gl[k] = 2.0 * el->l / h;
+                z += t->gl[k] + el->dcr_l + (el->q_l > 0 ? w * el->l / el->q_l : 0.0);
+            }
+            if (el->c > 0) {
+                t->gc[k] = h / (2.0 * el->c);
+                z += t->gc[k] + el->esr_c + (el->q_c > 0 ? 1.0 / (w * el->c * el->q_c) : 0.0);
+            }
+            d[cur] = -z;
+            t->e[cur] = 1.0;      // 与V_a
+            t->e[cur + 1] = -1.0; // V_b与I
+            t->index[k] = cur;
+            t->series[k] = 1;
+            node = cur + 1;
+        } else {
+            // 并联：G = 1/R + h/2L + 2C/h，串联损耗电阻按X^2折算为并联电导
+            double g = el->r > 0 ? 1.0 / el->r : 0.0;
+            if (el->l > 0) {
+                double x = w * el->l;
+                t->gl[k] = h / (2.0 * el->l);
+                g += t->gl[k] + (el->dcr_l + (el->q_l > 0 ? x / el->q_l : 0.0)) / (x * x);
+            }
+            if (el->c > 0) {
+                double x = 1.0 / (w * el->c);
+                t->gc[k] = 2.0 * el->c / h;
+                g += t->gc[k] + (el->esr_c + (el->q_c > 0 ? x / el->q_c : 0.0)) / (x * x);
+            }
+            d[node] += g;
+            t->index[k] = node;
+        }
+    }
+    d[node] += 1.0 / rl;
+    t->n = node + 1;
+
+    // 对称三对角LDL（Thomas）分解；上对角与下对角相同
+    t->inv_d[0] = 1.0 / d[0];
+    for (i = 1; i < t->n; i++) {
+        t->c[i - 1] = t->e[i] * t->inv_d[i - 1];
+        d[i] -= t->e[i] * t->c[i - 1];
+        if (d[i] == 0) return -1;
+        t->inv_d[i] = 1.0 / d[i];
+    }
+    return 0;
+}
+
+void rf_tran_reset(rf_tran_t *t) {
+    memset(t->sl, 0, sizeof(t->sl));
+    memset(t->sc, 0, sizeof(t->sc));
+    memset(t->x_prev, 0, sizeof(t->x_prev));
+}
+
+double rf_tran_step(rf_tran_t *t, double vs) {
+    double b[RF_TRAN_MAX];
+    double *x = t->x_prev;
+    int n = t->n;
+    int k, i;
+
+    memset(b, 0, (size_t)n * sizeof(double));
+    b[0] = vs / t->rs;
+    // 伴随模型的历史项
+    for (k = 0; k < t->elements; k++) {
+        int j = t->index[k];
+        double xp = x[j];
+        if (t->series[k]) {
+            // vL = gl·I + hl, hl = -(gl·I' + vL')；vC = gc·I + hc, hc = gc·I' + vC'
+            double hist = 0;
+            if (t->gl[k] > 0) hist -= t->gl[k] * xp + t->sl[k];
+            if (t->gc[k] > 0) hist += t->gc[k] * xp + t->sc[k];
+            b[j] = hist;
+        } else {
+            // iL = gl·V + jl, jl = gl·V' + iL'；iC = gc·V + jc, jc = -(gc·V' + iC')
+            double j0 = 0;
+            if (t->gl[k] > 0) j0 += t->gl[k] * xp + t->sl[k];
+            if (t->gc[k] > 0) j0 -= t->gc[k] * xp + t->sc[k];
+            b[j] -= j0;
+        }
+    }
+    // 前代、回代
+    for (i = 1; i < n; i++) b[i] -= t->c[i - 1] * b[i - 1];
+    b[n - 1] *= t->inv_d[n - 1];
+    for (i = n - 2; i >= 0; i--) b[i] = b[i] * t->inv_d[i] - t->c[i] * b[i + 1];
+
+    // 更新储能元件状态
+    for (k = 0; k < t->elements; k++) {
+        int j = t->index[k];
+        double xn = b[j], xp = x[j];
+        if (t->series[k]) {
+            if (t->gl[k] > 0) t->sl[k] = t->gl[k] * (xn - xp) - t->sl[k];
+            if (t->gc[k] > 0) t->sc[k] = t->gc[k] * (xn + xp) + t->sc[k];
+        } else {
+            if (t->gl[k] > 0) t->sl[k] = t->gl[k] * (xn + xp) + t->sl[k];
+            if (t->gc[k] > 0) t->sc[k] = t->gc[k] * (xn - xp) - t->sc[k];
+        }
+    }
+    memcpy(x, b, (size_t)n * sizeof(double));
+    return x[n - 1];
+}
+
+// ---------------------------------------------------------------- 辅助函数
+
+int rf_sparams_alloc(rf_sparams_t *s, size_t n) {
+    double *p = (double *)calloc(n > 0 ? n * 6 : 1, sizeof(double));
+    if (!p) return -1;
+    s->s11_re = p;
+    s->s11_im = p + n;
+    s->s21_re = p + 2 * n;
+    s->s21_im = p + 3 * n;
+    s->s22_re = p + 4 * n;
+    s->s22_im = p + 5 * n;
+    return 0;
+}
+
+void rf_sparams_free(rf_sparams_t *s) {
+    free(s->s11_re);
+    memset(s, 0, sizeof(*s));
+}
+
+double rf_db(double re, double im) {
+    double p = re * re + im * im;
+    return p > 0 ? 10.0 * log10(p) : -400.0;
+}
+
+double rf_deg(double re, double im) {
+    return atan2(im, re) * 180.0 / RF_PI;
+}
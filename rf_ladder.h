@@ -0,0 +1,134 @@
+#ifndef RF_LADDER_H
+#define RF_LADDER_H
+
+/*
+ * rf_ladder.h - LC梯形网络的ABCD级联仿真（替代RF.m中的RF Toolbox）
+ *
+ * 每个元件对应RF.m里的一个rfckt.seriesrlc/rfckt.shuntrlc：
+ *   串联支路：R、L、C串联后接在信号通路上，Z = R + jωL + 1/(jωC)
+ *   并联支路：R、L、C并联后接地，            Y = 1/R + 1/(jωL) + jωC
+ * 值为0表示该部分不存在（串联支路中C=0按短路处理，并联支路中R/L=0按开路处理）。
+ *
+ * 元件损耗：电感和电容各自带有固定串联电阻（电感DCR、电容ESR）和Q值，
+ * 总串联损耗 = 固定电阻 + |X|/Q，Q为0表示不计该项。
+ *
+ * 扫频按频率分块（RF_BLOCK点），块内ABCD矩阵以结构数组存放，
+ * 内层循环只有实数乘加，编译器可以按频率方向向量化。
+ */
+
+#include <stddef.h>
+
+#define RF_MAX_ELEMENTS 32
+#define RF_BLOCK 256
+
+typedef enum {
+    RF_SERIES = 0, // 串联支路
+    RF_SHUNT = 1   // 并联接地支路
+} rf_placement_t;
+
+typedef struct {
+    rf_placement_t placement;
+    double r;     // 欧姆
+    double l;     // 亨
+    double c;     // 法
+    double q_l;   // 电感Q值，0为理想
+    double q_c;   // 电容Q值，0为理想
+    double dcr_l; // 电感直流电阻（欧姆）
+    double esr_c; // 电容等效串联电阻（欧姆）
+} rf_element_t;
+
+typedef struct {
+    int count;
+    rf_element_t e[RF_MAX_ELEMENTS];
+} rf_ladder_t;
+
+// 扫频结果，各数组长度为频点数，由调用者分配（或用rf_sparams_alloc）
+typedef struct {
+    double *s11_re, *s11_im;
+    double *s21_re, *s21_im;
+    double *s22_re, *s22_im;
+} rf_sparams_t;
+
+// 解析带SI后缀的数值：680p、1.5u、1n、15e6、10M，成功返回0
+int rf_parse_value(const char *s, double *v);
+
+// 解析一个元件描述，如"PC=680p"、"SL=1.5u,q=80,dcr=0.05"，成功返回0。
+// 首字符S/P为串联/并联，其后为R/L/C=值；逗号后可跟q、ql、qc、dcr、esr
+int rf_parse_element(const char *s, rf_element_t *e);
+
+// 向梯形网络末尾追加元件，满了返回-1
+int rf_ladder_add(rf_ladder_t *ladder, const rf_element_t *e);
+
+// 元件描述写入buf（格式与rf_parse_element相同），返回写入长度
+int rf_format_element(const rf_element_t *e, char *buf, size_t size);
+
+// 把所有L/C的Q值设为给定值（仅替换原来为0的项）
+void rf_ladder_default_q(rf_ladder_t *ladder, double q_l, double q_c);
+
+// 内置参考电路（RF.m中的三组配置）："7mhz"、"10mhz"、"10mhz-test"
+int rf_ladder_preset(const char *name, rf_ladder_t *ladder);
+extern const char *const rf_preset_names[];
+
+// 线性或对数频率网格
+void rf_freq_linspace(double f1, double f2, size_t n, double *freq);
+void rf_freq_logspace(double f1, double f2, size_t n, double *freq);
+
+// 扫频：源阻抗rs、负载阻抗rl（均为实数）下的S11/S21/S22
+void rf_ladder_sweep(const rf_ladder_t *ladder, const double *freq, size_t n,
+                     double rs, double rl, rf_sparams_t *out);
+
+// 同一拓扑n个样本在单个频点的S参数（蒙特卡洛用），块内按样本方向向量化。
+// mult[k*n + s]为第k个元件在样本s中的数值倍率（同时作用于该支路的R/L/C），
+// 固定的DCR/ESR不随倍率变化，|X|/Q项随元件值变化
+void rf_ladder_sweep_samples(const rf_ladder_t *ladder, const double *mult, size_t n,
+                             double freq, double rs, double rl, rf_sparams_t *out);
+
+// 单个频点下元件的阻抗Z（串联支路）或导纳Y（并联支路），供优化器等逐点计算使用
+void rf_element_immittance(const rf_element_t *e, double freq, double *re, double *im);
+
+// 由S21相位对频率中心差分得到群时延（秒），两端用单边差分
+void rf_group_delay(const double *freq, const double *s21_re, const double *s21_im,
+                    size_t n, double *gd);
+
+/*
+ * 时域仿真：梯形积分（trapezoidal）伴随模型。
+ * 未知量按 V0, I1, V1, I2, V2 ... 排列（节点电压与串联支路电流交替），
+ * 系数矩阵为对称三对角且步长固定时不变，rf_tran_init()分解一次，
+ * 每步只做一次前代回代，代价与元件数成正比。
+ * Q值/DCR/ESR引起的损耗在f_ref处折算为固定的串联电阻（串联支路）或
+ * 并联电导（并联支路），只在f_ref附近准确。
+ */
+#define RF_TRAN_MAX (2 * RF_MAX_ELEMENTS + 1)
+
+typedef struct {
+    int n;                    // 未知量个数
+    int elements;
+    double h;                 // 步长（秒）
+    double rs;
+    double c[RF_TRAN_MAX];    // 三对角分解后的上对角
+    double inv_d[RF_TRAN_MAX]; // 分解后主对角的倒数
+    double e[RF_TRAN_MAX];    // 原下对角（x[i]与x[i-1]的耦合）
+    // 每个元件的伴随模型参数与状态
+    int index[RF_MAX_ELEMENTS];        // 串联：电流未知量下标；并联：节点电压下标
+    int series[RF_MAX_ELEMENTS];
+    double gl[RF_MAX_ELEMENTS], gc[RF_MAX_ELEMENTS]; // 串联：2L/h、h/2C；并联：h/2L、2C/h
+    double sl[RF_MAX_ELEMENTS], sc[RF_MAX_ELEMENTS]; // 电感/电容的状态（串联为电压，并联为电流）
+    double x_prev[RF_TRAN_MAX];
+} rf_tran_t;
+
+// 建立时域模型：源阻抗rs、负载rl、步长h，损耗按f_ref折算。失败返回-1
+int rf_tran_init(rf_tran_t *t, const rf_ladder_t *ladder, double rs, double rl, double h, double f_ref);
+// 清零所有储能元件状态
+void rf_tran_reset(rf_tran_t *t);
+// 前进一步：vs为该时刻源电动势，返回负载电压
+double rf_tran_step(rf_tran_t *t, double vs);
+
+int rf_sparams_alloc(rf_sparams_t *s, size_t n);
+void rf_sparams_free(rf_sparams_t *s);
+
+// |x|的dB值（20log10），x=0时返回-400
+double rf_db(double re, double im);
+// 相位（度）
+double rf_deg(double re, double im);
+
+#endif
@@ -0,0 +1,669 @@
+/*
+ * rf_optimize.c - 各WSPR频段低通滤波器的E系列元件并行优化
+ *
+ * 对3~7阶pi型（首元件并联电容）和T型（首元件串联电感）梯形网络，
+ * 在E12/E24标准值中做分支定界搜索，评价指标：
+ *   loss  WSPR频率f0处的插入损耗（dB，越小越好）
+ *   rej   2f0、3f0处抑制的较小者（dB，越大越好）
+ *   rl    f0处的回波损耗（dB，越大越好）
+ * 每个频段输出元件数、loss、rej、rl四个目标上的Pareto最优设计。
+ *
+ * 搜索空间：每个位置的候选值取Butterworth/Chebyshev原型在截止频率
+ * 1.1f0~1.6f0范围内理想值的包络（上下各放宽15%）中的标准值。
+ * 定界：ABCD级联中S21的分母可写成 den = x·y，x为前缀行向量
+ * [1 Rs]·M前缀，y为后缀列向量 M后缀·[Rl 1]'。|den| <= |x|·|y|，而
+ * |y|不超过后缀各位置候选元件矩阵2-范数最大值之积，由此得到前缀
+ * 在2f0/3f0处能达到的抑制上界，低于--min-rej的分支直接剪掉。
+ * 后一半元件的所有组合预先算成y并按|y(2f0)|降序排好（中间相遇），
+ * 前缀走到中点后顺序扫描该表，|x|·|y|低于门限即停止。
+ *
+ * 编译：
+ *   gcc -O3 -o rf_optimize rf_optimize.c rf_ladder.c rf_synth.c -lm -lpthread
+ *
+ * 用法：
+ *   rf_optimize [-j 线程数] [-e 12|24] [--orders 3-7] [--band Hz]...
+ *               [--min-rej dB] [--max-loss dB] [--min-rl dB] [--ql Q] [--qc Q]
+ *               [--z0 欧姆] [-o out.csv]
+ *
+ * 不指定--band时优化全部WSPR频段。CSV列：
+ *   band_hz,elements,topology,parts,loss_db,rej2_db,rej3_db,rl_db
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "rf_ladder.h"
+#include "rf_synth.h"
+
+#define MAX_ORDER 7
+#define MAX_CAND 64
+#define MAX_BANDS 32
+#define MAX_THREADS 256
+#define NFREQ 3 // f0、2f0、3f0
+
+static const double wspr_bands[] = {
+    137500, 475700, 1838100, 3570100, 5288700, 7040100, 10140200,
+    14097100, 18106100, 21096100, 24926100, 28126100, 50294500,
+};
+#define WSPR_BAND_COUNT (sizeof(wspr_bands) / sizeof(wspr_bands[0]))
+
+static const double e12[] = {1.0, 1.2, 1.5, 1.8, 2.2, 2.7, 3.3, 3.9, 4.7, 5.6, 6.8, 8.2};
+static const double e24[] = {1.0, 1.1, 1.2, 1.3, 1.5, 1.6, 1.8, 2.0, 2.2, 2.4, 2.7, 3.0,
+                             3.3, 3.6, 3.9, 4.3, 4.7, 5.1, 5.6, 6.2, 6.8, 7.5, 8.2, 9.1};
+
+typedef struct {
+    double re, im;
+} cpx_t;
+
+static inline cpx_t cmul(cpx_t a, cpx_t b) {
+    cpx_t r = {a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re};
+    return r;
+}
+
+static inline cpx_t cadd(cpx_t a, cpx_t b) {
+    cpx_t r = {a.re + b.re, a.im + b.im};
+    return r;
+}
+
+static inline double cabs2(cpx_t a) {
+    return a.re * a.re + a.im * a.im;
+}
+
+// 行向量(a, b)，右乘元件矩阵
+typedef struct {
+    cpx_t a, b;
+} rowvec_t;
+
+static inline rowvec_t apply(rowvec_t x, int shunt, cpx_t z) {
+    rowvec_t r = x;
+    if (shunt) {
+        r.a = cadd(x.a, cmul(x.b, z)); // [1 0; Y 1]
+    } else {
+        r.b = cadd(cmul(x.a, z), x.b); // [1 Z; 0 1]
+    }
+    return r;
+}
+
+// 预先枚举的后缀：y = M后缀·[Rl 1]'在三个频点的列向量
+typedef struct {
+    cpx_t y0a, y0b, y2a, y2b, y3a, y3b;
+    double n2, n3; // |y2|^2、|y3|^2
+    uint8_t choice[MAX_ORDER];
+} suffix_t;
+
+// 一个频段、一种阶数和拓扑的搜索问题
+typedef struct {
+    int band;
+    int order;
+    int first_shunt;
+    int ncand[MAX_ORDER];
+    double value[MAX_ORDER][MAX_CAND];
+    cpx_t imm[MAX_ORDER][MAX_CAND][NFREQ];
+    double suffix_norm[MAX_ORDER + 1][NFREQ]; // 位置k..order-1能得到的|y|上界
+    int split;                                 // 位置split起的元件由后缀表提供
+    suffix_t *suffix;                          // 按n2从大到小排序
+    size_t nsuffix;
+} problem_t;
+
+typedef struct {
+    int band;
+    int order;
+    int first_shunt;
+    double value[MAX_ORDER];
+    double loss, rej2, rej3, rl;
+} design_t;
+
+typedef struct {
+    design_t *d;
+    size_t count, cap;
+} front_t;
+
+typedef struct {
+    int problem;
+    int first; // 首元件候选下标
+} task_t;
+
+static struct {
+    double rs, rl;
+    double q_l, q_c;
+    double min_rej, max_loss, min_rl;
+    // 门限的线性形式：|den|^2上下限和|S11|^2上限
+    double rej_lin, loss_lin, rl_lin;
+} cfg = {50, 50, 100, 500, 30, 1.0, 10, 0, 0, 0};
+
+static problem_t *problems;
+static int problem_count;
+static task_t *tasks;
+static int task_count;
+static int next_task;
+static front_t fronts[MAX_BANDS];
+static pthread_mutex_t front_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long long total_nodes, total_leaves, total_pruned;
+
+// ---------------------------------------------------------------- Pareto前沿
+
+// 比较前先按0.01dB/0.1dB量化，避免前沿被数值噪声撑大
+static void design_key(const design_t *d, long k[4]) {
+    k[0] = d->order;
+    k[1] = lround(d->loss * 100);
+    k[2] = -lround((d->rej2 < d->rej3 ? d->rej2 : d->rej3) * 10);
+    k[3] = -lround(d->rl * 10);
+}
+
+// a支配b：各目标都不差（键值越小越好）
+static int dominates(const long a[4], const long b[4]) {
+    int i;
+    for (i = 0; i < 4; i++) {
+        if (a[i] > b[i]) return 0;
+    }
+    return 1;
+}
+
+static void front_insert(front_t *f, const design_t *d) {
+    long kd[4], ke[4];
+    size_t i, j;
+
+    design_key(d, kd);
+    for (i = 0; i < f->count; i++) {
+        design_key(&f->d[i], ke);
+        if (dominates(ke, kd)) return;
+    }
+    // 删除被新设计支配的项
+    for (i = 0, j = 0; i < f->count; i++) {
+        design_key(&f->d[i], ke);
+        if (!dominates(kd, ke)) f->d[j++] = f->d[i];
+    }
+    f->count = j;
+    if (f->count == f->cap) {
+        f->cap = f->cap ? f->cap * 2 : 16;
+        f->d = (design_t *)realloc(f->d, f->cap * sizeof(design_t));
+    }
+    f->d[f->count++] = *d;
+}
+
+// ---------------------------------------------------------------- 问题构造
+
+static rf_element_t make_element(int shunt, double v) {
+    rf_element_t e;
+    memset(&e, 0, sizeof(e));
+    if (shunt) {
+        e.placement = RF_SHUNT;
+        e.c = v;
+        e.q_c = cfg.q_c;
+    } else {
+        e.placement = RF_SERIES;
+        e.l = v;
+        e.q_l = cfg.q_l;
+    }
+    return e;
+}
+
+static int position_shunt(const problem_t *p, int k) {
+    return p->first_shunt ? (k % 2 == 0) : (k % 2 == 1);
+}
+
+// 原型族在截止1.1f0~1.6f0时第k个元件理想值的范围
+static void ideal_range(const problem_t *p, double f0, int k, double *lo, double *hi) {
+    static const double ripples[] = {0.01, 0.05, 0.1, 0.2, 0.5};
+    static const double cut[] = {1.1, 1.6};
+    double g[RF_MAX_ELEMENTS + 2];
+    int shunt = position_shunt(p, k);
+    size_t r, c;
+
+    *lo = 1e30;
+    *hi = 0;
+    for (r = 0; r <= sizeof(ripples) / sizeof(ripples[0]); r++) {
+        // r为最后一项时取Butterworth；偶数阶切比雪夫不是等端接，不参与
+        int type = (r == sizeof(ripples) / sizeof(ripples[0])) ? RF_FTR_BUTTERWORTH : RF_FTR_CHEBYSHEV;
+        if (type == RF_FTR_CHEBYSHEV && p->order % 2 == 0) continue;
+        rf_prototype_g(type, p->order, type == RF_FTR_CHEBYSHEV ? ripples[r] : 0, g);
+        for (c = 0; c < 2; c++) {
+            double wc = 2 * M_PI * f0 * cut[c];
+            double v = shunt ? g[k + 1] / (cfg.rs * wc) : g[k + 1] * cfg.rs / wc;
+            if (v < *lo) *lo = v;
+            if (v > *hi) *hi = v;
+        }
+    }
+    *lo *= 0.85;
+    *hi *= 1.15;
+}
+
+// 标准值取3位有效数字，去掉series[i]*decade的浮点误差
+static double round_sig(double v) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.3g", v);
+    return strtod(buf, NULL);
+}
+
+// 2x2矩阵[1 z; 0 1]或[1 0; z 1]的2-范数
+static double element_norm(cpx_t z) {
+    double m = sqrt(cabs2(z));
+    return (m + sqrt(m * m + 4)) / 2;
+}
+
+// 列向量(a; b)左乘元件矩阵
+static inline void apply_col(cpx_t *a, cpx_t *b, int shunt, cpx_t z) {
+    if (shunt) {
+        *b = cadd(cmul(z, *a), *b); // [1 0; Y 1]
+    } else {
+        *a = cadd(*a, cmul(z, *b)); // [1 Z; 0 1]
+    }
+}
+
+static void suffix_recurse(problem_t *p, int k, suffix_t *cur) {
+    int shunt, i;
+
+    if (k < p->split) {
+        cur->n2 = cabs2(cur->y2a) + cabs2(cur->y2b);
+        cur->n3 = cabs2(cur->y3a) + cabs2(cur->y3b);
+        p->suffix[p->nsuffix++] = *cur;
+        return;
+    }
+    shunt = position_shunt(p, k);
+    for (i = 0; i < p->ncand[k]; i++) {
+        suffix_t next = *cur;
+        apply_col(&next.y0a, &next.y0b, shunt, p->imm[k][i][0]);
+        apply_col(&next.y2a, &next.y2b, shunt, p->imm[k][i][1]);
+        apply_col(&next.y3a, &next.y3b, shunt, p->imm[k][i][2]);
+        next.choice[k] = (uint8_t)i;
+        suffix_recurse(p, k - 1, &next);
+    }
+}
+
+static int suffix_cmp(const void *a, const void *b) {
+    double x = ((const suffix_t *)a)->n2, y = ((const suffix_t *)b)->n2;
+    return (x < y) - (x > y);
+}
+
+static void build_suffixes(problem_t *p) {
+    suffix_t q;
+    size_t total = 1;
+    int k;
+
+    for (k = p->split; k < p->order; k++) total *= (size_t)p->ncand[k];
+    p->suffix = (suffix_t *)malloc(total * sizeof(suffix_t));
+    p->nsuffix = 0;
+    memset(&q, 0, sizeof(q));
+    q.y0a.re = q.y2a.re = q.y3a.re = cfg.rl;
+    q.y0b.re = q.y2b.re = q.y3b.re = 1;
+    suffix_recurse(p, p->order - 1, &q);
+    qsort(p->suffix, p->nsuffix, sizeof(suffix_t), suffix_cmp);
+}
+
+static void build_problem(problem_t *p, int band, int order, int first_shunt,
+                          const double *series, int series_len) {
+    double f0 = wspr_bands[band];
+    double freq[NFREQ] = {f0, 2 * f0, 3 * f0};
+    int k, h;
+
+    memset(p, 0, sizeof(*p));
+    p->band = band;
+    p->order = order;
+    p->first_shunt = first_shunt;
+
+    for (k = 0; k < order; k++) {
+        double lo, hi, decade;
+        int shunt = position_shunt(p, k);
+        ideal_range(p, f0, k, &lo, &hi);
+        for (decade = pow(10, floor(log10(lo))); decade <= hi; decade *= 10) {
+            int i;
+            for (i = 0; i < series_len; i++) {
+                double v = round_sig(series[i] * decade);
+                if (v < lo || v > hi || p->ncand[k] >= MAX_CAND) continue;
+                p->value[k][p->ncand[k]] = v;
+                for (h = 0; h < NFREQ; h++) {
+                    rf_element_t e = make_element(shunt, v);
+                    rf_element_immittance(&e, freq[h], &p->imm[k][p->ncand[k]][h].re,
+                                          &p->imm[k][p->ncand[k]][h].im);
+                }
+                p->ncand[k]++;
+            }
+        }
+    }
+
+    // 后半段预先枚举成表（中间相遇），前半段做分支定界
+    p->split = order - order / 2;
+    build_suffixes(p);
+
+    for (h = 0; h < NFREQ; h++) {
+        double best = 0;
+        size_t j;
+        for (j = 0; j < p->nsuffix; j++) {
+            double n = h == 1 ? p->suffix[j].n2 : h == 2 ? p->suffix[j].n3 : 0;
+            if (n > best) best = n;
+        }
+        p->suffix_norm[p->split][h] = sqrt(best);
+        for (k = p->split - 1; k >= 0; k--) {
+            int i;
+            best = 0;
+            for (i = 0; i < p->ncand[k]; i++) {
+                double n = element_norm(p->imm[k][i][h]);
+                if (n > best) best = n;
+            }
+            p->suffix_norm[k][h] = p->suffix_norm[k + 1][h] * best;
+        }
+    }
+}
+
+// ---------------------------------------------------------------- 分支定界
+
+typedef struct {
+    const problem_t *p;
+    front_t *front;
+    int choice[MAX_ORDER];
+    unsigned long long nodes, leaves, pruned;
+} search_t;
+
+static inline double dot2(cpx_t xa, cpx_t xb, cpx_t ya, cpx_t yb) {
+    return cabs2(cadd(cmul(xa, ya), cmul(xb, yb)));
+}
+
+// 前缀确定后扫描后缀表：den = x·y。后缀按|y2|降序排列，
+// |x2|^2·|y2|^2低于抑制门限后其余后缀都不可能满足，直接结束
+static void scan_suffixes(search_t *s, rowvec_t u, rowvec_t v, rowvec_t x2, rowvec_t x3) {
+    const problem_t *p = s->p;
+    double k2 = 4 * cfg.rs * cfg.rl;
+    double thr2 = cfg.rej_lin / (cabs2(x2.a) + cabs2(x2.b));
+    double thr3 = cfg.rej_lin / (cabs2(x3.a) + cabs2(x3.b));
+    size_t i;
+
+    for (i = 0; i < p->nsuffix && p->suffix[i].n2 >= thr2; i++) {
+        const suffix_t *y = &p->suffix[i];
+        double den0, num0, den2, den3;
+        design_t d;
+        int k;
+
+        s->leaves++;
+        if (y->n3 < thr3) continue;
+        // 先在线性域判断门限，只有合格的设计才取对数
+        den2 = dot2(x2.a, x2.b, y->y2a, y->y2b);
+        if (den2 < cfg.rej_lin) continue;
+        den3 = dot2(x3.a, x3.b, y->y3a, y->y3b);
+        if (den3 < cfg.rej_lin) continue;
+        den0 = dot2(u.a, u.b, y->y0a, y->y0b);
+        if (den0 > cfg.loss_lin) continue;
+        num0 = dot2(v.a, v.b, y->y0a, y->y0b);
+        if (num0 > den0 * cfg.rl_lin) continue;
+
+        d.loss = 10 * log10(den0 / k2);
+        d.rl = -10 * log10(num0 / den0);
+        d.rej2 = 10 * log10(den2 / k2);
+        d.rej3 = 10 * log10(den3 / k2);
+        d.band = p->band;
+        d.order = p->order;
+        d.first_shunt = p->first_shunt;
+        for (k = 0; k < p->order; k++) {
+            d.value[k] = p->value[k][k < p->split ? s->choice[k] : y->choice[k]];
+        }
+        front_insert(s->front, &d);
+    }
+    s->pruned += p->nsuffix - i;
+}
+
+// u、v为f0处[1 Rs]·M、[1 -Rs]·M，x2、x3为2f0、3f0处[1 Rs]·M
+static void search(search_t *s, int k, rowvec_t u, rowvec_t v, rowvec_t x2, rowvec_t x3) {
+    const problem_t *p = s->p;
+    int shunt = position_shunt(p, k);
+    int i;
+
+    for (i = 0; i < p->ncand[k]; i++) {
+        const cpx_t *z = p->imm[k][i];
+        rowvec_t nx2 = apply(x2, shunt, z[1]);
+        rowvec_t nx3 = apply(x3, shunt, z[2]);
+
+        s->nodes++;
+        // 后缀再好也达不到抑制要求则剪枝（比较平方值）
+        if (cabs2(nx2.a) + cabs2(nx2.b) < cfg.rej_lin / (p->suffix_norm[k + 1][1] * p->suffix_norm[k + 1][1]) ||
+            cabs2(nx3.a) + cabs2(nx3.b) < cfg.rej_lin / (p->suffix_norm[k + 1][2] * p->suffix_norm[k + 1][2])) {
+            s->pruned++;
+            continue;
+        }
+        s->choice[k] = i;
+        if (k + 1 == p->split) {
+            scan_suffixes(s, apply(u, shunt, z[0]), apply(v, shunt, z[0]), nx2, nx3);
+        } else {
+            search(s, k + 1, apply(u, shunt, z[0]), apply(v, shunt, z[0]), nx2, nx3);
+        }
+    }
+}
+
+static void run_task(const task_t *t, front_t *local) {
+    const problem_t *p = &problems[t->problem];
+    search_t s;
+    rowvec_t u = {{1, 0}, {cfg.rs, 0}};
+    rowvec_t v = {{1, 0}, {-cfg.rs, 0}};
+    int shunt = position_shunt(p, 0);
+    const cpx_t *z = p->imm[0][t->first];
+
+    memset(&s, 0, sizeof(s));
+    s.p = p;
+    s.front = local;
+    s.choice[0] = t->first;
+    s.nodes = 1;
+    if (p->split == 1) {
+        scan_suffixes(&s, apply(u, shunt, z[0]), apply(v, shunt, z[0]), apply(u, shunt, z[1]), apply(u, shunt, z[2]));
+    } else {
+        search(&s, 1, apply(u, shunt, z[0]), apply(v, shunt, z[0]), apply(u, shunt, z[1]), apply(u, shunt, z[2]));
+    }
+
+    pthread_mutex_lock(&front_lock);
+    total_nodes += s.nodes;
+    total_leaves += s.leaves;
+    total_pruned += s.pruned;
+    pthread_mutex_unlock(&front_lock);
+}
+
+static void *worker(void *arg) {
+    front_t local;
+    (void)arg;
+
+    for (;;) {
+        int i = __atomic_fetch_add(&next_task, 1, __ATOMIC_RELAXED);
+        size_t k;
+        if (i >= task_count) break;
+        memset(&local, 0, sizeof(local));
+        run_task(&tasks[i], &local);
+        // 任务结束后把局部前沿并入频段前沿
+        if (local.count) {
+            pthread_mutex_lock(&front_lock);
+            for (k = 0; k < local.count; k++) {
+                front_insert(&fronts[local.d[k].band], &local.d[k]);
+            }
+            pthread_mutex_unlock(&front_lock);
+        }
+        free(local.d);
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------- 输出
+
+static int design_cmp(const void *a, const void *b) {
+    const design_t *x = (const design_t *)a, *y = (const design_t *)b;
+    if (x->order != y->order) return x->order - y->order;
+    return (x->loss > y->loss) - (x->loss < y->loss);
+}
+
+static void format_design(const design_t *d, char *buf, size_t size) {
+    size_t n = 0;
+    int k;
+    for (k = 0; k < d->order && n < size; k++) {
+        int shunt = d->first_shunt ? (k % 2 == 0) : (k % 2 == 1);
+        rf_element_t e;
+        memset(&e, 0, sizeof(e));
+        e.placement = shunt ? RF_SHUNT : RF_SERIES;
+        if (shunt) e.c = d->value[k];
+        else e.l = d->value[k];
+        if (k) buf[n++] = ' ';
+        n += (size_t)rf_format_element(&e, buf + n, size - n);
+    }
+    if (n >= size) buf[size - 1] = 0;
+}
+
+// 用扫频函数按同样的Q值评估RF.m中的手选电路，便于对比
+static void report_preset(const char *name, double f0) {
+    rf_ladder_t ladder;
+    rf_sparams_t s;
+    double freq[NFREQ] = {f0, 2 * f0, 3 * f0};
+
+    if (rf_ladder_preset(name, &ladder) != 0 || rf_sparams_alloc(&s, NFREQ) != 0) return;
+    rf_ladder_default_q(&ladder, cfg.q_l, cfg.q_c);
+    rf_ladder_sweep(&ladder, freq, NFREQ, cfg.rs, cfg.rl, &s);
+    fprintf(stderr, "  RF.m %-10s loss %.3f dB  rej2 %.1f dB  rej3 %.1f dB  rl %.1f dB\n", name,
+            -rf_db(s.s21_re[0], s.s21_im[0]), -rf_db(s.s21_re[1], s.s21_im[1]),
+            -rf_db(s.s21_re[2], s.s21_im[2]), -rf_db(s.s11_re[0], s.s11_im[0]));
+    rf_sparams_free(&s);
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int parse_orders(const char *s, int *lo, int *hi) {
+    if (sscanf(s, "%d-%d", lo, hi) == 2) return 0;
+    if (sscanf(s, "%d", lo) == 1) {
+        *hi = *lo;
+        return 0;
+    }
+    return -1;
+}
+
+int main(int argc, char **argv) {
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int order_lo = 3, order_hi = MAX_ORDER, eseries = 12, bad_args = 0;
+    int band_sel[WSPR_BAND_COUNT];
+    int band_any = 0;
+    const char *out_path = NULL;
+    const double *series;
+    int series_len;
+    pthread_t th[MAX_THREADS];
+    FILE *out = stdout;
+    double t0, t1;
+    int a, b, o, t, i;
+
+    memset(band_sel, 0, sizeof(band_sel));
+    for (a = 1; a < argc; a++) {
+        double v;
+        if (strcmp(argv[a], "-j") == 0 && a + 1 < argc) {
+            threads = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-e") == 0 && a + 1 < argc) {
+            eseries = atoi(argv[++a]);
+            if (eseries != 12 && eseries != 24) bad_args = 1;
+        } else if (strcmp(argv[a], "--orders") == 0 && a + 1 < argc) {
+            if (parse_orders(argv[++a], &order_lo, &order_hi) != 0) bad_args = 1;
+        } else if (strcmp(argv[a], "--band") == 0 && a + 1 < argc) {
+            size_t k;
+            int found = 0;
+            if (rf_parse_value(argv[++a], &v) != 0) v = 0;
+            // 按最近的WSPR频段匹配，允许写7M、14.097M等
+            for (k = 0; k < WSPR_BAND_COUNT; k++) {
+                if (fabs(wspr_bands[k] - v) < 0.05 * wspr_bands[k]) {
+                    band_sel[k] = found = band_any = 1;
+                }
+            }
+            if (!found) bad_args = 1;
+        } else if (strcmp(argv[a], "--min-rej") == 0 && a + 1 < argc) {
+            cfg.min_rej = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--max-loss") == 0 && a + 1 < argc) {
+            cfg.max_loss = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--min-rl") == 0 && a + 1 < argc) {
+            cfg.min_rl = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--ql") == 0 && a + 1 < argc) {
+            cfg.q_l = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--qc") == 0 && a + 1 < argc) {
+            cfg.q_c = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--z0") == 0 && a + 1 < argc) {
+            cfg.rs = cfg.rl = atof(argv[++a]);
+        } else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+            out_path = argv[++a];
+        } else {
+            bad_args = 1;
+        }
+    }
+    if (bad_args || order_lo < 2 || order_hi > MAX_ORDER || order_lo > order_hi || cfg.rs <= 0) {
+        fprintf(stderr, "用法: %s [-j 线程数] [-e 12|24] [--orders 3-7] [--band Hz]... [--min-rej dB]\n"
+                        "          [--max-loss dB] [--min-rl dB] [--ql Q] [--qc Q] [--z0 欧姆] [-o out.csv]\n",
+                argv[0]);
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    series = eseries == 24 ? e24 : e12;
+    series_len = eseries == 24 ? (int)(sizeof(e24) / sizeof(e24[0])) : (int)(sizeof(e12) / sizeof(e12[0]));
+    cfg.rej_lin = 4 * cfg.rs * cfg.rl * pow(10, cfg.min_rej / 10);
+    cfg.loss_lin = 4 * cfg.rs * cfg.rl * pow(10, cfg.max_loss / 10);
+    cfg.rl_lin = pow(10, -cfg.min_rl / 10);
+
+    t0 = now_sec();
+
+    // 每个（频段、阶数、拓扑）一个问题，每个首元件候选一个任务
+    problems = (problem_t *)calloc(WSPR_BAND_COUNT * MAX_ORDER * 2, sizeof(problem_t));
+    for (b = 0; b < (int)WSPR_BAND_COUNT; b++) {
+        if (band_any && !band_sel[b]) continue;
+        for (o = order_lo; o <= order_hi; o++) {
+            for (t = 1; t >= 0; t--) {
+                build_problem(&problems[problem_count], b, o, t, series, series_len);
+                task_count += problems[problem_count].ncand[0];
+                problem_count++;
+            }
+        }
+    }
+    tasks = (task_t *)calloc((size_t)task_count, sizeof(task_t));
+    task_count = 0;
+    for (i = 0; i < problem_count; i++) {
+        int c;
+        for (c = 0; c < problems[i].ncand[0]; c++) {
+            tasks[task_count].problem = i;
+            tasks[task_count].first = c;
+            task_count++;
+        }
+    }
+
+    for (i = 0; i < threads; i++) pthread_create(&th[i], NULL, worker, NULL);
+    for (i = 0; i < threads; i++) pthread_join(th[i], NULL);
+    t1 = now_sec();
+
+    if (out_path) {
+        out = fopen(out_path, "w");
+        if (!out) {
+            perror(out_path);
+            return 1;
+        }
+    }
+    fprintf(out, "band_hz,elements,topology,parts,loss_db,rej2_db,rej3_db,rl_db\n");
+    for (b = 0; b < (int)WSPR_BAND_COUNT; b++) {
+        front_t *f = &fronts[b];
+        size_t k;
+        if (band_any && !band_sel[b]) continue;
+        qsort(f->d, f->count, sizeof(design_t), design_cmp);
+        for (k = 0; k < f->count; k++) {
+            char parts[256];
+            const design_t *d = &f->d[k];
+            format_design(d, parts, sizeof(parts));
+            fprintf(out, "%.0f,%d,%s,%s,%.3f,%.2f,%.2f,%.2f\n", wspr_bands[b], d->order,
+                    d->first_shunt ? "pi" : "tee", parts, d->loss, d->rej2, d->rej3, d->rl);
+        }
+        fprintf(stderr, "%9.4f MHz: %zu 个Pareto设计\n", wspr_bands[b] / 1e6, f->count);
+        if (wspr_bands[b] == 7040100) report_preset("7mhz", wspr_bands[b]);
+        if (wspr_bands[b] == 10140200) {
+            report_preset("10mhz", wspr_bands[b]);
+            report_preset("10mhz-test", wspr_bands[b]);
+        }
+        free(f->d);
+    }
+    if (out != stdout) fclose(out);
+
+    fprintf(stderr, "E%d，%d 个子问题，%d 线程，%llu 节点（剪枝 %llu），%llu 个完整设计，%.2f 秒\n",
+            eseries, problem_count, threads, total_nodes, total_pruned, total_leaves, t1 - t0);
+    for (i = 0; i < problem_count; i++) free(problems[i].suffix);
+    free(tasks);
+    free(problems);
+    return 0;
+}
@@ -0,0 +1,340 @@
+/*
+ * rf_sim.c - LC低通滤波器S参数仿真命令行工具（RF.m的C版本）
+ *
+ * 用ABCD矩阵级联计算梯形网络的S11/S21/S22和群时延，输出CSV，
+ * 不依赖MATLAB RF Toolbox。RF.m中的三组配置作为内置参考电路，
+ * 也可以直接读取FilterSolutions工程文件（如Filter1.ftr）综合出电路。
+ * 矢网测得的.s2p文件可代替电路参与扫频（插值到扫频网格），
+ * 仿真结果也可以写成Touchstone文件交给其他软件。
+ *
+ * 编译：
+ *   gcc -O3 -o rf_sim rf_sim.c rf_ladder.c rf_synth.c rf_touchstone.c -lm
+ *
+ * 用法：
+ *   rf_sim [选项] [元件...]
+ *     --preset 名称       使用内置电路：7mhz、10mhz、10mhz-test
+ *     --ftr 文件          按.ftr中的类型/阶数/截止/纹波综合电路；扫频范围、源/负载
+ *                         阻抗和默认Q值也取自文件，命令行显式给出的选项优先
+ *     --f1 Hz --f2 Hz     扫频范围（默认1M~30M，与RF.m相同）
+ *     -n 点数             频点数（默认1000）
+ *     --log               对数频率网格（默认线性）
+ *     --z0 欧姆           源和负载阻抗（默认50）
+ *     --rs 欧姆 --rl 欧姆 分别指定源/负载阻抗
+ *     --ql Q --qc Q       未单独指定Q值的电感/电容使用的Q值（默认理想元件）
+ *     --s2p 文件          使用测量数据代替电路，扫频范围默认取文件的频率范围；
+ *                         首次读取后生成"<文件>.rfc"缓存，之后直接映射
+ *     --interp 方式       测量数据插值：mp（dB幅度/相位，默认）、ri、rational
+ *     -o 文件             CSV输出文件（默认或"-"为stdout）；扩展名为.s2p时写Touchstone
+ *     --ts-format 格式    Touchstone数据格式：ri（默认）、ma、db
+ *     --ts-v2             写Touchstone 2.0（默认1.x）
+ *
+ * 元件格式：首字符S（串联）或P（并联接地），其后为逗号分隔的键值：
+ *   R/L/C=值、q/ql/qc=Q值、dcr=电感直流电阻、esr=电容ESR，值可带SI后缀。
+ *   例：rf_sim PC=330p SL=680n,ql=80 PC=330p,esr=0.1
+ *
+ * CSV列：freq_hz,s21_db,s21_deg,s11_db,s11_deg,s22_db,gd_ns
+ * -3dB截止频率（相邻频点间插值）、通带内最差S11和耗时输出到stderr。
+ * 通带取到-3dB点以下最后一个S11反射零点（纹波带上沿），最差S11为其中各纹波峰值，
+ * 峰值用相邻三点抛物线插值，不随频点数变化；没有反射零点的单调响应（如Butterworth）
+ * 改取S21≥-1dB的频段。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+#include "rf_ladder.h"
+#include "rf_synth.h"
+#include "rf_touchstone.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char *prog) {
+    int i;
+    fprintf(stderr, "用法: %s [--preset 名称 | --ftr 文件 | --s2p 文件] [--f1 Hz] [--f2 Hz] [-n 点数] [--log]\n"
+                    "          [--z0|--rs|--rl 欧姆] [--ql Q] [--qc Q] [--interp mp|ri|rational]\n"
+                    "          [-o out.csv|out.s2p] [--ts-format ri|ma|db] [--ts-v2] [元件...]\n"
+                    "内置电路:", prog);
+    for (i = 0; rf_preset_names[i]; i++) fprintf(stderr, " %s", rf_preset_names[i]);
+    fprintf(stderr, "\n");
+}
+
+// y在[i-1, i]之间穿过level的位置（0~1）
+static double cross_at(const double *y, size_t i, double level) {
+    return y[i] == y[i - 1] ? 0 : (level - y[i - 1]) / (y[i] - y[i - 1]);
+}
+
+// i-1、i、i+1三点抛物线的顶点值
+static double parabola_peak(const double *y, size_t i) {
+    double d = y[i - 1] - 2 * y[i] + y[i + 1];
+    if (d >= 0) return y[i];
+    return y[i] - (y[i + 1] - y[i - 1]) * (y[i + 1] - y[i - 1]) / (8 * d);
+}
+
+/*
+ * 通带最差S11：s21/s11为dB，i3为第一个S21低于-3dB的频点（没有则为n）。
+ * 返回1时通带为到*edge处反射零点的纹波带，返回0时为S21≥-1dB的频段（上沿*edge）。
+ * 纹波带内平均每个纹波不足4个频点时*coarse置1，峰值可能漏掉
+ */
+static int passband_s11(const double *freq, const double *s21, const double *s11, size_t n, size_t i3,
+                        double *edge, double *worst, int *coarse) {
+    size_t i, zero = 0, zeros = 0, i1;
+    double t;
+
+    for (i = 1; i < i3 && i + 1 < n; i++) {
+        if (s11[i] < s11[i - 1] && s11[i] <= s11[i + 1]) {
+            zero = i;
+            zeros++;
+        }
+    }
+    *coarse = zero > 0 && zero < 4 * (zeros + 1);
+    *worst = s11[0];
+    if (zero > 0) {
+        for (i = 1; i < zero; i++) {
+            if (s11[i] > s11[i - 1] && s11[i] >= s11[i + 1]) {
+                double v = parabola_peak(s11, i);
+                if (v > *worst) *worst = v;
+            }
+        }
+        *edge = freq[zero];
+        return 1;
+    }
+    for (i1 = 0; i1 < n && s21[i1] >= -1.0; i1++) {
+        if (s11[i1] > *worst) *worst = s11[i1];
+    }
+    *edge = freq[i1 < n ? i1 : n - 1];
+    if (i1 > 0 && i1 < n) {
+        t = cross_at(s21, i1, -1.0);
+        *edge = freq[i1 - 1] + t * (freq[i1] - freq[i1 - 1]);
+        if (s11[i1 - 1] + t * (s11[i1] - s11[i1 - 1]) > *worst) *worst = s11[i1 - 1] + t * (s11[i1] - s11[i1 - 1]);
+    }
+    return 0;
+}
+
+// 需要数值参数的选项：解析失败返回-1
+static int value_arg(int argc, char **argv, int *i, double *v) {
+    if (*i + 1 >= argc) return -1;
+    return rf_parse_value(argv[++(*i)], v);
+}
+
+int main(int argc, char **argv) {
+    rf_ladder_t ladder;
+    rf_sparams_t s;
+    const char *out_path = NULL, *ftr_path = NULL, *s2p_path = NULL;
+    rf_s2p_t meas;
+    rf_interp_t interp = RF_INTERP_MAGPHASE;
+    rf_ts_format_t ts_format = RF_TS_RI;
+    int ts_version = 1;
+    double f1 = 1e6, f2 = 30e6, rs = 50, rl = 50, q_l = 0, q_c = 0, npts = 1000;
+    double *freq, *gd, *s21, *s11;
+    double t0, t1, f3db = 0, edge, worst_s11;
+    int use_log = 0, bad_args = 0;
+    int set_f1 = 0, set_f2 = 0, set_rs = 0, set_rl = 0, set_ql = 0, set_qc = 0;
+    size_t n, i, i3;
+    int a, k, ripple, coarse;
+    FILE *out = stdout;
+
+    ladder.count = 0;
+    for (a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--preset") == 0 && a + 1 < argc) {
+            if (rf_ladder_preset(argv[++a], &ladder) != 0) {
+                fprintf(stderr, "未知电路: %s\n", argv[a]);
+                bad_args = 1;
+            }
+        } else if (strcmp(argv[a], "--ftr") == 0 && a + 1 < argc) {
+            ftr_path = argv[++a];
+        } else if (strcmp(argv[a], "--s2p") == 0 && a + 1 < argc) {
+            s2p_path = argv[++a];
+        } else if (strcmp(argv[a], "--interp") == 0 && a + 1 < argc) {
+            if (rf_parse_interp(argv[++a], &interp) != 0) {
+                fprintf(stderr, "未知插值方式: %s\n", argv[a]);
+                bad_args = 1;
+            }
+        } else if (strcmp(argv[a], "--ts-format") == 0 && a + 1 < argc) {
+            if (rf_parse_ts_format(argv[++a], &ts_format) != 0) {
+                fprintf(stderr, "未知Touchstone格式: %s\n", argv[a]);
+                bad_args = 1;
+            }
+        } else if (strcmp(argv[a], "--ts-v2") == 0) {
+            ts_version = 2;
+        } else if (strcmp(argv[a], "--f1") == 0) {
+            bad_args |= value_arg(argc, argv, &a, &f1) != 0;
+            set_f1 = 1;
+        } else if (strcmp(argv[a], "--f2") == 0) {
+            bad_args |= value_arg(argc, argv, &a, &f2) != 0;
+            set_f2 = 1;
+        } else if (strcmp(argv[a], "-n") == 0) {
+            bad_args |= value_arg(argc, argv, &a, &npts) != 0;
+        } else if (strcmp(argv[a], "--log") == 0) {
+            use_log = 1;
+        } else if (strcmp(argv[a], "--z0") == 0) {
+            bad_args |= value_arg(argc, argv, &a, &rs) != 0;
+            rl = rs;
+            set_rs = set_rl = 1;
+        } else if (strcmp(argv[a], "--rs") == 0) {
+            bad_args |= value_arg(argc, argv, &a, &rs) != 0;
+            set_rs = 1;
+        } else if (strcmp(argv[a], "--rl") == 0) {
+            bad_args |= value_arg(argc, argv, &a, &rl) != 0;
+            set_rl = 1;
+        } else if (strcmp(argv[a], "--ql") == 0) {
+            bad_args |= value_arg(argc, argv, &a, &q_l) != 0;
+            set_ql = 1;
+        } else if (strcmp(argv[a], "--qc") == 0) {
+            bad_args |= value_arg(argc, argv, &a, &q_c) != 0;
+            set_qc = 1;
+        } else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+            out_path = argv[++a];
+        } else {
+            rf_element_t e;
+            if (rf_parse_element(argv[a], &e) != 0 || rf_ladder_add(&ladder, &e) != 0) {
+                fprintf(stderr, "无法解析元件: %s\n", argv[a]);
+                bad_args = 1;
+            }
+        }
+    }
+    if (ftr_path && !bad_args) {
+        rf_filter_spec_t spec;
+        double rl_req;
+        if (rf_ftr_load(ftr_path, &spec) != 0) {
+            fprintf(stderr, "%s: 无法读取滤波器工程文件\n", ftr_path);
+            return 1;
+        }
+        if (set_rs) spec.rs = rs;
+        if (set_ql) spec.q_l = q_l;
+        if (set_qc) spec.q_c = q_c;
+        if (rf_synth_ladder(&spec, &ladder, &rl_req) != 0) {
+            fprintf(stderr, "%s: 不支持的滤波器（FilterType=%d FilterClass=%d Order=%d），"
+                            "目前支持Butterworth/Chebyshev低通\n",
+                    ftr_path, spec.filter_type, spec.filter_class, spec.order);
+            return 1;
+        }
+        if (!set_f1) f1 = spec.fmin;
+        if (!set_f2) f2 = spec.fmax;
+        rs = spec.rs;
+        if (!set_rl) rl = spec.rl;
+        if (fabs(rl_req - rl) > 0.01 * rl) {
+            fprintf(stderr, "注意：原型要求负载 %.3f 欧姆，当前负载 %.3f 欧姆\n", rl_req, rl);
+        }
+        fprintf(stderr, "%s: %s %d阶，截止 %.6g Hz", ftr_path,
+                spec.filter_type == RF_FTR_CHEBYSHEV ? "Chebyshev" : "Butterworth", spec.order, spec.f1);
+        if (spec.filter_type == RF_FTR_CHEBYSHEV) fprintf(stderr, "，纹波 %.3g dB", spec.ripple_db);
+        fprintf(stderr, "\n");
+    }
+    if (s2p_path && !bad_args) {
+        char err[128];
+        if (ladder.count > 0 || ftr_path) {
+            fprintf(stderr, "--s2p不能与电路同时使用\n");
+            return 2;
+        }
+        t0 = now_sec();
+        if (rf_s2p_open_cached(s2p_path, &meas, err, sizeof(err)) != 0) {
+            fprintf(stderr, "%s: %s\n", s2p_path, err);
+            return 1;
+        }
+        t1 = now_sec();
+        if (!set_f1) f1 = meas.freq[0];
+        if (!set_f2) f2 = meas.freq[meas.n - 1];
+        if (!set_rs && !set_rl) rs = rl = meas.z0;
+        fprintf(stderr, "%s: %zu 点，%.6g~%.6g Hz，Z0 %g 欧姆，%s %.3f ms\n", s2p_path, meas.n, meas.freq[0],
+                meas.freq[meas.n - 1], meas.z0, meas.map_len ? "映射缓存" : "解析", (t1 - t0) * 1e3);
+        if (f1 < meas.freq[0] || f2 > meas.freq[meas.n - 1]) {
+            fprintf(stderr, "注意：扫频范围超出测量范围，范围外取端点值\n");
+        }
+    }
+    if (bad_args || (ladder.count == 0 && !s2p_path) || npts < 1 || f1 <= 0 || f2 < f1 || rs <= 0 || rl <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    rf_ladder_default_q(&ladder, q_l, q_c);
+
+    n = (size_t)npts;
+    freq = (double *)malloc(n * sizeof(double));
+    gd = (double *)malloc(n * sizeof(double));
+    s21 = (double *)malloc(n * sizeof(double));
+    s11 = (double *)malloc(n * sizeof(double));
+    if (!freq || !gd || !s21 || !s11 || rf_sparams_alloc(&s, n) != 0) {
+        fprintf(stderr, "内存不足\n");
+        return 1;
+    }
+    if (use_log) {
+        rf_freq_logspace(f1, f2, n, freq);
+    } else {
+        rf_freq_linspace(f1, f2, n, freq);
+    }
+
+    t0 = now_sec();
+    if (s2p_path) {
+        rf_s2p_eval_sparams(&meas, interp, freq, n, &s);
+    } else {
+        rf_ladder_sweep(&ladder, freq, n, rs, rl, &s);
+    }
+    rf_group_delay(freq, s.s21_re, s.s21_im, n, gd);
+    t1 = now_sec();
+
+    if (out_path && strlen(out_path) > 4 && strcasecmp(out_path + strlen(out_path) - 4, ".s2p") == 0) {
+        if (rf_s2p_write(out_path, freq, n, &s, rs, ts_version, ts_format) != 0) {
+            perror(out_path);
+            return 1;
+        }
+        out = NULL;
+    } else if (out_path && strcmp(out_path, "-") != 0) {
+        out = fopen(out_path, "w");
+        if (!out) {
+            perror(out_path);
+            return 1;
+        }
+    }
+    if (out) fprintf(out, "freq_hz,s21_db,s21_deg,s11_db,s11_deg,s22_db,gd_ns\n");
+    i3 = n;
+    for (i = 0; i < n; i++) {
+        s21[i] = rf_db(s.s21_re[i], s.s21_im[i]);
+        s11[i] = rf_db(s.s11_re[i], s.s11_im[i]);
+        if (out) fprintf(out, "%.6f,%.6f,%.4f,%.6f,%.4f,%.6f,%.6f\n", freq[i],
+                s21[i], rf_deg(s.s21_re[i], s.s21_im[i]),
+                s11[i], rf_deg(s.s11_re[i], s.s11_im[i]),
+                rf_db(s.s22_re[i], s.s22_im[i]), gd[i] * 1e9);
+        if (i3 == n && s21[i] < -3.0) i3 = i;
+    }
+    if (out && out != stdout) fclose(out);
+    if (i3 < n) {
+        f3db = i3 ? freq[i3 - 1] + cross_at(s21, i3, -3.0) * (freq[i3] - freq[i3 - 1]) : freq[0];
+    }
+    ripple = passband_s11(freq, s21, s11, n, i3, &edge, &worst_s11, &coarse);
+
+    if (!s2p_path) {
+        for (k = 0; k < ladder.count; k++) {
+            char buf[128];
+            rf_format_element(&ladder.e[k], buf, sizeof(buf));
+            fprintf(stderr, "%s%s", k ? " " : "电路: ", buf);
+        }
+        fprintf(stderr, "\n");
+    }
+    if (f3db > 0) {
+        fprintf(stderr, "-3dB截止 %.4f MHz，", f3db / 1e6);
+    } else {
+        fprintf(stderr, "扫频范围内无-3dB点，");
+    }
+    fprintf(stderr, "通带最差S11 %.2f dB（%s %.4f MHz）\n", worst_s11, ripple ? "纹波带至反射零点" : "无纹波，S21≥-1dB至",
+            edge / 1e6);
+    if (coarse) fprintf(stderr, "注意：纹波带内频点过少，最差S11可能偏小，请增大-n\n");
+    if (s2p_path) {
+        fprintf(stderr, "%zu 点，测量数据插值，%.3f ms\n", n, (t1 - t0) * 1e3);
+    } else {
+        fprintf(stderr, "%zu 点，%d 元件，%.3f ms\n", n, ladder.count, (t1 - t0) * 1e3);
+    }
+
+    if (s2p_path) rf_s2p_free(&meas);
+    rf_sparams_free(&s);
+    free(freq);
+    free(gd);
+    free(s21);
+    free(s11);
+    return 0;
+}
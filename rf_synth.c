@@ -0,0 +1,251 @@
+/*
+ * rf_synth.c - .ftr读取与Butterworth/Chebyshev梯形网络综合，见rf_synth.h
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rf_synth.h"
+
+#define RF_PI 3.14159265358979323846
+
+// ---------------------------------------------------------------- .ftr解析
+
+typedef enum { FTR_INT, FTR_DOUBLE, FTR_Q } ftr_kind_t;
+
+typedef struct {
+    const char *key;
+    ftr_kind_t kind;
+    size_t offset;
+} ftr_key_t;
+
+#define FTR_FIELD(key, kind, field) {key, kind, offsetof(rf_filter_spec_t, field)}
+
+static const ftr_key_t ftr_keys[] = {
+    FTR_FIELD("FilterType", FTR_INT, filter_type),
+    FTR_FIELD("FilterClass", FTR_INT, filter_class),
+    FTR_FIELD("Order", FTR_INT, order),
+    FTR_FIELD("F1val", FTR_DOUBLE, f1),
+    FTR_FIELD("Ripple", FTR_DOUBLE, ripple_db),
+    FTR_FIELD("StandardCut", FTR_INT, standard_cut),
+    FTR_FIELD("CutOffAtten", FTR_DOUBLE, cutoff_atten_db),
+    FTR_FIELD("GenResis", FTR_DOUBLE, rs),
+    FTR_FIELD("LoadResis", FTR_DOUBLE, rl),
+    FTR_FIELD("MinFreq", FTR_DOUBLE, fmin),
+    FTR_FIELD("MaxFreq", FTR_DOUBLE, fmax),
+    FTR_FIELD("Fshunt", FTR_INT, first_shunt),
+    FTR_FIELD("Lqdef", FTR_Q, q_l),
+    FTR_FIELD("Cqdef", FTR_Q, q_c),
+    FTR_FIELD("Lrsdef", FTR_DOUBLE, dcr_l),
+    FTR_FIELD("Crsdef", FTR_DOUBLE, esr_c),
+};
+#define FTR_KEY_COUNT (sizeof(ftr_keys) / sizeof(ftr_keys[0]))
+
+static void ftr_defaults(rf_filter_spec_t *spec) {
+    memset(spec, 0, sizeof(*spec));
+    spec->filter_type = RF_FTR_BUTTERWORTH;
+    spec->order = 3;
+    spec->standard_cut = 1;
+    spec->cutoff_atten_db = 3.0103;
+    spec->rs = 50;
+    spec->rl = 50;
+    spec->fmin = 0.1e6;
+    spec->fmax = 30e6;
+    spec->first_shunt = 1;
+}
+
+// 值可能带单位或尾随空格（如"50 Ohms"），strtod只取数字部分；"Inf"由strtod识别
+static void ftr_store(rf_filter_spec_t *spec, const ftr_key_t *k, const char *v, size_t len) {
+    char buf[64];
+    char *p = (char *)spec + k->offset;
+    double x;
+
+    if (len >= sizeof(buf)) len = sizeof(buf) - 1;
+    memcpy(buf, v, len);
+    buf[len] = 0;
+    x = strtod(buf, NULL);
+    switch (k->kind) {
+    case FTR_INT:
+        *(int *)p = (int)x;
+        break;
+    case FTR_DOUBLE:
+        *(double *)p = x;
+        break;
+    case FTR_Q:
+        *(double *)p = isinf(x) ? 0.0 : x;
+        break;
+    }
+}
+
+int rf_ftr_parse(const char *text, size_t len, rf_filter_spec_t *spec) {
+    const char *p = text;
+    const char *end = text + len;
+    int found = 0;
+
+    ftr_defaults(spec);
+    while (p < end) {
+        const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+        const char *e = nl ? nl : end;
+        const char *eq = (const char *)memchr(p, '=', (size_t)(e - p));
+        const char *ve = e;
+        size_t i;
+
+        if (ve > p && ve[-1] == '\r') ve--;
+        if (eq) {
+            size_t klen = (size_t)(eq - p);
+            for (i = 0; i < FTR_KEY_COUNT; i++) {
+                if (strlen(ftr_keys[i].key) == klen && memcmp(ftr_keys[i].key, p, klen) == 0) {
+                    ftr_store(spec, &ftr_keys[i], eq + 1, (size_t)(ve - eq - 1));
+                    found++;
+                    break;
+                }
+            }
+        }
+        p = e + 1;
+    }
+    // 至少要有阶数和截止频率才算有效的工程文件
+    return (found > 0 && spec->order > 0 && spec->f1 > 0) ? 0 : -1;
+}
+
+int rf_ftr_load(const char *path, rf_filter_spec_t *spec) {
+    FILE *f = fopen(path, "rb");
+    char *buf;
+    long n;
+    int ret;
+
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buf = (char *)malloc(n > 0 ? (size_t)n : 1);
+    if (!buf) {
+        fclose(f);
+        return -1;
+    }
+    n = (long)fread(buf, 1, (size_t)n, f);
+    fclose(f);
+    ret = rf_ftr_parse(buf, (size_t)n, spec);
+    free(buf);
+    return ret;
+}
+
+// ---------------------------------------------------------------- 原型综合
+
+int rf_prototype_g(int type, int order, double ripple_db, double *g) {
+    int k;
+
+    if (order < 1 || order > RF_MAX_ELEMENTS) return -1;
+    g[0] = 1.0;
+    if (type == RF_FTR_BUTTERWORTH) {
+        for (k = 1; k <= order; k++) {
+            g[k] = 2.0 * sin((2 * k - 1) * RF_PI / (2 * order));
+        }
+        g[order + 1] = 1.0;
+        return 0;
+    }
+    if (type == RF_FTR_CHEBYSHEV) {
+        // Matthaei/Young/Jones的切比雪夫g值公式
+        double beta, gamma, a_prev, b_prev;
+        if (ripple_db <= 0) return -1;
+        beta = log(1.0 / tanh(ripple_db * log(10.0) / 40.0));
+        gamma = sinh(beta / (2 * order));
+        a_prev = sin(RF_PI / (2 * order));
+        g[1] = 2.0 * a_prev / gamma;
+        for (k = 2; k <= order; k++) {
+            double a = sin((2 * k - 1) * RF_PI / (2 * order));
+            double s = sin((k - 1) * RF_PI / order);
+            b_prev = gamma * gamma + s * s;
+            g[k] = 4.0 * a_prev * a / (b_prev * g[k - 1]);
+            a_prev = a;
+        }
+        if (order % 2) {
+            g[order + 1] = 1.0;
+        } else {
+            double t = 1.0 / tanh(beta / 4);
+            g[order + 1] = t * t;
+        }
+        return 0;
+    }
+    return -1;
+}
+
+// 原型截止频率（纹波带边或3dB点）与F1val的比值：F1 = 比值 * 原型截止
+static double cutoff_ratio(const rf_filter_spec_t *spec) {
+    double a = spec->cutoff_atten_db;
+    int n = spec->order;
+
+    if (spec->filter_type == RF_FTR_CHEBYSHEV) {
+        double eps2 = pow(10.0, spec->ripple_db / 10.0) - 1.0;
+        double x;
+        if (spec->standard_cut || a <= spec->ripple_db) return 1.0;
+        x = sqrt((pow(10.0, a / 10.0) - 1.0) / eps2);
+        return cosh(acosh(x) / n);
+    }
+    // Butterworth原型的g值对应3.0103dB点
+    if (a <= 0) return 1.0;
+    return pow(pow(10.0, a / 10.0) - 1.0, 1.0 / (2 * n));
+}
+
+int rf_synth_ladder(const rf_filter_spec_t *spec, rf_ladder_t *ladder, double *rl_out) {
+    double g[RF_MAX_ELEMENTS + 2];
+    double r0 = spec->rs;
+    double wc;
+    int k;
+
+    if (spec->filter_class != 0 || r0 <= 0) return -1;
+    if (rf_prototype_g(spec->filter_type, spec->order, spec->ripple_db, g) != 0) return -1;
+
+    wc = 2.0 * RF_PI * spec->f1 / cutoff_ratio(spec);
+    ladder->count = 0;
+    for (k = 1; k <= spec->order; k++) {
+        rf_element_t e;
+        // 首元件并联时奇数位为并联电容，否则奇数位为串联电感
+        int shunt = spec->first_shunt ? (k % 2 == 1) : (k % 2 == 0);
+
+        memset(&e, 0, sizeof(e));
+        if (shunt) {
+            e.placement = RF_SHUNT;
+            e.c = g[k] / (r0 * wc);
+            e.q_c = spec->q_c;
+            e.esr_c = spec->esr_c;
+        } else {
+            e.placement = RF_SERIES;
+            e.l = g[k] * r0 / wc;
+            e.q_l = spec->q_l;
+            e.dcr_l = spec->dcr_l;
+        }
+        rf_ladder_add(ladder, &e);
+    }
+
+    // g[n+1]：最后元件为并联电容时是负载电阻，为串联电感时是负载电导
+    if (rl_out) {
+        int last_shunt = spec->first_shunt ? (spec->order % 2 == 1) : (spec->order % 2 == 0);
+        *rl_out = last_shunt ? r0 * g[spec->order + 1] : r0 / g[spec->order + 1];
+    }
+    return 0;
+}
+
+int rf_band_filter(double f0, double cutoff_ratio, double z0, rf_ladder_t *ladder, const char **name) {
+    rf_filter_spec_t spec;
+
+    if (f0 == 7040100) {
+        if (name) *name = "RF.m 7mhz";
+        return rf_ladder_preset("7mhz", ladder);
+    }
+    if (f0 == 10140200) {
+        if (name) *name = "RF.m 10mhz";
+        return rf_ladder_preset("10mhz", ladder);
+    }
+    memset(&spec, 0, sizeof(spec));
+    spec.filter_type = RF_FTR_CHEBYSHEV;
+    spec.order = 7;
+    spec.ripple_db = 0.3;
+    spec.standard_cut = 1;
+    spec.f1 = cutoff_ratio * f0;
+    spec.rs = spec.rl = z0;
+    spec.first_shunt = 1;
+    if (name) *name = "cheb7";
+    return rf_synth_ladder(&spec, ladder, NULL);
+}
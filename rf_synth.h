@@ -0,0 +1,51 @@
+#ifndef RF_SYNTH_H
+#define RF_SYNTH_H
+
+/*
+ * rf_synth.h - FilterSolutions工程文件（.ftr）读取与LC低通原型综合
+ *
+ * .ftr为逐行key=value文本（Filter1.ftr为CRLF换行）。这里只取综合与
+ * 扫频需要的键，其余忽略。综合结果直接是rf_ladder_t，可交给
+ * rf_ladder_sweep()，滤波器参数和仿真电路不再需要手工抄写。
+ */
+
+#include "rf_ladder.h"
+
+// FilterSolutions的FilterType编号（Gaussian=0、Bessel=1起排）
+#define RF_FTR_BUTTERWORTH 2
+#define RF_FTR_CHEBYSHEV 4
+
+typedef struct {
+    int filter_type;        // FilterType
+    int filter_class;       // FilterClass，0为低通
+    int order;              // Order
+    double f1;              // F1val，截止频率（Hz）
+    double ripple_db;       // Ripple，切比雪夫通带纹波
+    int standard_cut;       // StandardCut=1时切比雪夫的F1为纹波带边，否则为CutOffAtten点
+    double cutoff_atten_db; // CutOffAtten
+    double rs;              // GenResis
+    double rl;              // LoadResis
+    double fmin, fmax;      // MinFreq、MaxFreq，扫频范围
+    int first_shunt;        // Fshunt=1：首元件为并联电容（最少电感）
+    double q_l, q_c;        // Lqdef、Cqdef，Inf按理想元件处理（0）
+    double dcr_l, esr_c;    // Lrsdef、Crsdef
+} rf_filter_spec_t;
+
+// 解析.ftr文本（长度len，不要求以0结尾），缺失的键保留默认值。成功返回0
+int rf_ftr_parse(const char *text, size_t len, rf_filter_spec_t *spec);
+// 读取并解析.ftr文件，失败返回-1
+int rf_ftr_load(const char *path, rf_filter_spec_t *spec);
+
+// 归一化低通原型g值：g[0]=1（源），g[1..n]为元件，g[n+1]为负载。成功返回0
+int rf_prototype_g(int type, int order, double ripple_db, double *g);
+
+// 按spec综合梯形网络。*rl_out为原型要求的负载电阻（偶数阶切比雪夫不等于源电阻）。
+// 不支持的类型/阶数返回-1
+int rf_synth_ladder(const rf_filter_spec_t *spec, rf_ladder_t *ladder, double *rl_out);
+
+// WSPR频段的默认低通：40m、30m取RF.m中的7mhz、10mhz电路，其余频段综合
+// Filter1.ftr同类型（7阶0.3dB切比雪夫、首元件并联）截止为cutoff_ratio·f0的参考电路。
+// *name为电路说明（可为NULL）。失败返回-1
+int rf_band_filter(double f0, double cutoff_ratio, double z0, rf_ladder_t *ladder, const char **name);
+
+#endif
@@ -0,0 +1,585 @@
+/*
+ * rf_touchstone.c - Touchstone .s2p读写、mmap缓存与插值，见rf_touchstone.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "rf_touchstone.h"
+
+#define RF_PI 3.14159265358979323846
+#define RATIONAL_WINDOW 8
+#define RATIONAL_ORDER 3
+
+// 每个参数4个数组（re、im、dB、相位），加上频率共17个
+#define S2P_ARRAYS (1 + 4 * 4)
+
+// 缓存文件头，64字节，后接S2P_ARRAYS*n个double
+typedef struct {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint64_t n;
+    double z0;
+    uint64_t src_size;
+    int64_t src_mtime;
+    int64_t src_mtime_ns;
+    uint64_t reserved;
+} s2p_cache_header_t;
+
+#define CACHE_MAGIC "RFS2PC\0\0"
+#define CACHE_BYTE_ORDER 0x01020304u
+#define CACHE_VERSION 1u
+
+static void set_err(char *err, size_t size, const char *msg) {
+    if (err && size) snprintf(err, size, "%s", msg);
+}
+
+// 把块中的各数组指针挂到s上
+static void s2p_bind(rf_s2p_t *s, double *block, size_t n) {
+    int p;
+    s->freq = block;
+    for (p = 0; p < 4; p++) {
+        s->re[p] = block + (1 + 4 * p) * n;
+        s->im[p] = block + (2 + 4 * p) * n;
+        s->mag_db[p] = block + (3 + 4 * p) * n;
+        s->phase[p] = block + (4 + 4 * p) * n;
+    }
+}
+
+// 由re/im计算dB幅度和展开相位
+static void s2p_derive(double *block, size_t n) {
+    int p;
+    size_t i;
+
+    for (p = 0; p < 4; p++) {
+        const double *re = block + (1 + 4 * p) * n;
+        const double *im = block + (2 + 4 * p) * n;
+        double *db = block + (3 + 4 * p) * n;
+        double *ph = block + (4 + 4 * p) * n;
+        double prev = 0, offset = 0;
+        for (i = 0; i < n; i++) {
+            double a = atan2(im[i], re[i]);
+            db[i] = rf_db(re[i], im[i]);
+            if (i > 0) {
+                double d = a + offset - prev;
+                while (d > RF_PI) {
+                    offset -= 2 * RF_PI;
+                    d -= 2 * RF_PI;
+                }
+                while (d < -RF_PI) {
+                    offset += 2 * RF_PI;
+                    d += 2 * RF_PI;
+                }
+            }
+            ph[i] = a + offset;
+            prev = ph[i];
+        }
+    }
+}
+
+// ---------------------------------------------------------------- 解析
+
+typedef struct {
+    const char *p, *end;
+} cursor_t;
+
+// 取下一行（去掉'!'之后的注释和行尾），返回0表示没有更多行
+static int next_line(cursor_t *c, const char **line, size_t *len) {
+    const char *nl, *bang;
+    if (c->p >= c->end) return 0;
+    nl = (const char *)memchr(c->p, '\n', (size_t)(c->end - c->p));
+    if (!nl) nl = c->end;
+    *line = c->p;
+    bang = (const char *)memchr(c->p, '!', (size_t)(nl - c->p));
+    *len = (size_t)((bang ? bang : nl) - c->p);
+    while (*len > 0 && isspace((unsigned char)(*line)[*len - 1])) (*len)--;
+    while (*len > 0 && isspace((unsigned char)**line)) {
+        (*line)++;
+        (*len)--;
+    }
+    c->p = nl + 1;
+    return 1;
+}
+
+static int word_eq(const char *w, size_t len, const char *s) {
+    return strlen(s) == len && strncasecmp(w, s, len) == 0;
+}
+
+typedef struct {
+    double unit;
+    rf_ts_format_t fmt;
+    double z0;
+    int order_21_12; // v1及v2 "21_12"：S11 S21 S12 S22
+} options_t;
+
+static int parse_option_line(const char *line, size_t len, options_t *o) {
+    char buf[256];
+    char *tok, *save;
+    int want_r = 0;
+
+    if (len >= sizeof(buf)) len = sizeof(buf) - 1;
+    memcpy(buf, line + 1, len - 1);
+    buf[len - 1] = 0;
+    for (tok = strtok_r(buf, " \t\r", &save); tok; tok = strtok_r(NULL, " \t\r", &save)) {
+        size_t l = strlen(tok);
+        if (want_r) {
+            o->z0 = atof(tok);
+            want_r = 0;
+        } else if (word_eq(tok, l, "HZ")) {
+            o->unit = 1;
+        } else if (word_eq(tok, l, "KHZ")) {
+            o->unit = 1e3;
+        } else if (word_eq(tok, l, "MHZ")) {
+            o->unit = 1e6;
+        } else if (word_eq(tok, l, "GHZ")) {
+            o->unit = 1e9;
+        } else if (word_eq(tok, l, "S")) {
+            // 只支持S参数
+        } else if (word_eq(tok, l, "Y") || word_eq(tok, l, "Z") || word_eq(tok, l, "H") || word_eq(tok, l, "G")) {
+            return -1;
+        } else if (word_eq(tok, l, "RI")) {
+            o->fmt = RF_TS_RI;
+        } else if (word_eq(tok, l, "MA")) {
+            o->fmt = RF_TS_MA;
+        } else if (word_eq(tok, l, "DB")) {
+            o->fmt = RF_TS_DB;
+        } else if (word_eq(tok, l, "R")) {
+            want_r = 1;
+        }
+    }
+    return 0;
+}
+
+static void pair_to_ri(rf_ts_format_t fmt, double a, double b, double *re, double *im) {
+    double mag, ang = b * RF_PI / 180.0;
+    switch (fmt) {
+    case RF_TS_RI:
+        *re = a;
+        *im = b;
+        return;
+    case RF_TS_MA:
+        mag = a;
+        break;
+    default:
+        mag = pow(10.0, a / 20.0);
+        break;
+    }
+    *re = mag * cos(ang);
+    *im = mag * sin(ang);
+}
+
+int rf_s2p_parse(const char *text, size_t len, rf_s2p_t *s, char *err, size_t err_size) {
+    options_t opt = {1e9, RF_TS_MA, 50, 1};
+    cursor_t c;
+    const char *line;
+    size_t line_len;
+    double vals[9];
+    int nv = 0, version = 1, in_data = 0, seen_option = 0;
+    size_t cap = 0, n = 0;
+    double *rows = NULL; // 每个频点9个值：f与4对(re,im)，按S11 S21 S12 S22
+    double *block;
+    int p;
+    size_t i;
+
+    memset(s, 0, sizeof(*s));
+    c.p = text;
+    c.end = text + len;
+    while (next_line(&c, &line, &line_len)) {
+        const char *q, *qe;
+        if (line_len == 0) continue;
+        if (line[0] == '#') {
+            if (!seen_option && parse_option_line(line, line_len, &opt) != 0) {
+                set_err(err, err_size, "只支持S参数");
+                free(rows);
+                return -1;
+            }
+            seen_option = 1;
+            if (version == 1) in_data = 1;
+            continue;
+        }
+        if (line[0] == '[') {
+            const char *kw_end = (const char *)memchr(line, ']', line_len);
+            const char *arg;
+            size_t kw_len;
+            if (!kw_end) continue;
+            kw_len = (size_t)(kw_end - line + 1);
+            arg = kw_end + 1;
+            while (arg < line + line_len && isspace((unsigned char)*arg)) arg++;
+            if (word_eq(line, kw_len, "[Version]")) {
+                version = 2;
+                in_data = 0;
+            } else if (word_eq(line, kw_len, "[Number of Ports]")) {
+                if (atoi(arg) != 2) {
+                    set_err(err, err_size, "只支持2端口");
+                    free(rows);
+                    return -1;
+                }
+            } else if (word_eq(line, kw_len, "[Two-Port Data Order]")) {
+                opt.order_21_12 = strncmp(arg, "21_12", 5) == 0;
+            } else if (word_eq(line, kw_len, "[Reference]")) {
+                if (arg < line + line_len) opt.z0 = atof(arg);
+            } else if (word_eq(line, kw_len, "[Network Data]")) {
+                in_data = 1;
+            } else if (word_eq(line, kw_len, "[Noise Data]") || word_eq(line, kw_len, "[End]")) {
+                break;
+            }
+            continue;
+        }
+        if (!in_data) continue;
+
+        // 数值可以跨行，按9个一组（f + 4对）
+        q = line;
+        qe = line + line_len;
+        while (q < qe) {
+            char *next;
+            double v = strtod(q, &next);
+            if (next == q) {
+                set_err(err, err_size, "数据行中有无法解析的内容");
+                free(rows);
+                return -1;
+            }
+            q = next;
+            while (q < qe && isspace((unsigned char)*q)) q++;
+            vals[nv++] = v;
+            if (nv < 9) continue;
+            nv = 0;
+            // v1的噪声参数紧跟在S参数之后，以频率不再递增为界
+            if (n > 0 && vals[0] * opt.unit <= rows[(n - 1) * 9]) goto done;
+            if (n == cap) {
+                double *r;
+                cap = cap ? cap * 2 : 256;
+                r = (double *)realloc(rows, cap * 9 * sizeof(double));
+                if (!r) {
+                    free(rows);
+                    set_err(err, err_size, "内存不足");
+                    return -1;
+                }
+                rows = r;
+            }
+            rows[n * 9] = vals[0] * opt.unit;
+            for (p = 0; p < 4; p++) {
+                // 文件中第k对对应的参数
+                static const int order_12_21[4] = {RF_S11, RF_S12, RF_S21, RF_S22};
+                int dst = opt.order_21_12 ? p : order_12_21[p];
+                pair_to_ri(opt.fmt, vals[1 + 2 * p], vals[2 + 2 * p], &rows[n * 9 + 1 + 2 * dst],
+                           &rows[n * 9 + 2 + 2 * dst]);
+            }
+            n++;
+        }
+    }
+done:
+    if (n == 0) {
+        free(rows);
+        set_err(err, err_size, "没有S参数数据");
+        return -1;
+    }
+    block = (double *)malloc(S2P_ARRAYS * n * sizeof(double));
+    if (!block) {
+        free(rows);
+        set_err(err, err_size, "内存不足");
+        return -1;
+    }
+    for (i = 0; i < n; i++) {
+        block[i] = rows[i * 9];
+        for (p = 0; p < 4; p++) {
+            block[(1 + 4 * p) * n + i] = rows[i * 9 + 1 + 2 * p];
+            block[(2 + 4 * p) * n + i] = rows[i * 9 + 2 + 2 * p];
+        }
+    }
+    free(rows);
+    s2p_derive(block, n);
+    s->n = n;
+    s->z0 = opt.z0;
+    s->base = block;
+    s2p_bind(s, block, n);
+    return 0;
+}
+
+int rf_s2p_load(const char *path, rf_s2p_t *s, char *err, size_t err_size) {
+    struct stat st;
+    void *map;
+    int fd = open(path, O_RDONLY);
+    int ret;
+
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        if (fd >= 0) close(fd);
+        set_err(err, err_size, "无法读取文件");
+        return -1;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        set_err(err, err_size, "mmap失败");
+        return -1;
+    }
+    ret = rf_s2p_parse((const char *)map, (size_t)st.st_size, s, err, err_size);
+    munmap(map, (size_t)st.st_size);
+    return ret;
+}
+
+void rf_s2p_free(rf_s2p_t *s) {
+    if (s->map_len) {
+        munmap(s->base, s->map_len);
+    } else {
+        free(s->base);
+    }
+    memset(s, 0, sizeof(*s));
+}
+
+// ---------------------------------------------------------------- 缓存
+
+static int cache_write(const char *cache_path, const rf_s2p_t *s, const struct stat *src) {
+    s2p_cache_header_t h;
+    char tmp[4096 + 32];
+    FILE *f;
+    int ok;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CACHE_MAGIC, sizeof(h.magic));
+    h.byte_order = CACHE_BYTE_ORDER;
+    h.version = CACHE_VERSION;
+    h.n = s->n;
+    h.z0 = s->z0;
+    h.src_size = (uint64_t)src->st_size;
+    h.src_mtime = (int64_t)src->st_mtim.tv_sec;
+    h.src_mtime_ns = (int64_t)src->st_mtim.tv_nsec;
+
+    // 先写临时文件再改名，其他进程不会映射到写了一半的缓存
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", cache_path, (long)getpid());
+    f = fopen(tmp, "wb");
+    if (!f) return -1;
+    ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+         fwrite(s->base, sizeof(double), S2P_ARRAYS * s->n, f) == S2P_ARRAYS * s->n;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp, cache_path) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+// 映射有效的缓存，无效返回-1
+static int cache_map(const char *cache_path, const struct stat *src, rf_s2p_t *s) {
+    struct stat st;
+    const s2p_cache_header_t *h;
+    void *map;
+    int fd = open(cache_path, O_RDONLY);
+
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(s2p_cache_header_t)) {
+        close(fd);
+        return -1;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    h = (const s2p_cache_header_t *)map;
+    if (memcmp(h->magic, CACHE_MAGIC, sizeof(h->magic)) != 0 || h->byte_order != CACHE_BYTE_ORDER ||
+        h->version != CACHE_VERSION || h->src_size != (uint64_t)src->st_size ||
+        h->src_mtime != (int64_t)src->st_mtim.tv_sec || h->src_mtime_ns != (int64_t)src->st_mtim.tv_nsec ||
+        h->n == 0 || (size_t)st.st_size != sizeof(*h) + S2P_ARRAYS * h->n * sizeof(double)) {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    memset(s, 0, sizeof(*s));
+    s->n = (size_t)h->n;
+    s->z0 = h->z0;
+    s->base = map;
+    s->map_len = (size_t)st.st_size;
+    s2p_bind(s, (double *)((char *)map + sizeof(*h)), s->n);
+    return 0;
+}
+
+int rf_s2p_open_cached(const char *path, rf_s2p_t *s, char *err, size_t err_size) {
+    char cache_path[4096];
+    struct stat src;
+
+    if (stat(path, &src) != 0) {
+        set_err(err, err_size, "无法读取文件");
+        return -1;
+    }
+    snprintf(cache_path, sizeof(cache_path), "%s.rfc", path);
+    if (cache_map(cache_path, &src, s) == 0) return 0;
+    if (rf_s2p_load(path, s, err, err_size) != 0) return -1;
+    // 缓存写不了（如只读目录）不影响本次使用
+    cache_write(cache_path, s, &src);
+    return 0;
+}
+
+// ---------------------------------------------------------------- 插值
+
+// Floater-Hormann重心有理插值，节点x[0..m-1]
+static void rational_eval(const double *x, const double *re, const double *im, int m, double f,
+                          double *out_re, double *out_im) {
+    double num_re = 0, num_im = 0, den = 0;
+    int d = m - 1 < RATIONAL_ORDER ? m - 1 : RATIONAL_ORDER;
+    int k, i, j;
+
+    for (k = 0; k < m; k++) {
+        double w = 0, t;
+        if (f == x[k]) {
+            *out_re = re[k];
+            *out_im = im[k];
+            return;
+        }
+        for (i = k - d; i <= k; i++) {
+            double prod = 1;
+            if (i < 0 || i + d >= m) continue;
+            for (j = i; j <= i + d; j++) {
+                if (j != k) prod /= fabs(x[k] - x[j]);
+            }
+            w += prod;
+        }
+        if ((k - d) % 2) w = -w;
+        t = w / (f - x[k]);
+        num_re += t * re[k];
+        num_im += t * im[k];
+        den += t;
+    }
+    *out_re = num_re / den;
+    *out_im = num_im / den;
+}
+
+void rf_s2p_eval(const rf_s2p_t *s, rf_sparam_t p, rf_interp_t mode, const double *freq, size_t n,
+                 double *re, double *im) {
+    const double *x = s->freq;
+    size_t lo = 0, i;
+
+    for (i = 0; i < n; i++) {
+        double f = freq[i];
+        double t;
+
+        if (f <= x[0] || s->n == 1) {
+            re[i] = s->re[p][0];
+            im[i] = s->im[p][0];
+            continue;
+        }
+        if (f >= x[s->n - 1]) {
+            re[i] = s->re[p][s->n - 1];
+            im[i] = s->im[p][s->n - 1];
+            continue;
+        }
+        // 升序输入：区间只向前推进；乱序时退回二分
+        if (f < x[lo]) {
+            size_t a = 0, b = s->n - 1;
+            while (b - a > 1) {
+                size_t m = (a + b) / 2;
+                if (x[m] <= f) a = m; else b = m;
+            }
+            lo = a;
+        }
+        while (x[lo + 1] < f) lo++;
+        t = (f - x[lo]) / (x[lo + 1] - x[lo]);
+
+        switch (mode) {
+        case RF_INTERP_RI:
+            re[i] = s->re[p][lo] + t * (s->re[p][lo + 1] - s->re[p][lo]);
+            im[i] = s->im[p][lo] + t * (s->im[p][lo + 1] - s->im[p][lo]);
+            break;
+        case RF_INTERP_MAGPHASE: {
+            double db = s->mag_db[p][lo] + t * (s->mag_db[p][lo + 1] - s->mag_db[p][lo]);
+            double ph = s->phase[p][lo] + t * (s->phase[p][lo + 1] - s->phase[p][lo]);
+            double mag = pow(10.0, db / 20.0);
+            re[i] = mag * cos(ph);
+            im[i] = mag * sin(ph);
+            break;
+        }
+        case RF_INTERP_RATIONAL: {
+            // 以所在区间为中心取RATIONAL_WINDOW个节点
+            size_t first = lo + 1 >= RATIONAL_WINDOW / 2 ? lo + 1 - RATIONAL_WINDOW / 2 : 0;
+            int m = RATIONAL_WINDOW;
+            if (first + (size_t)m > s->n) first = s->n > (size_t)m ? s->n - (size_t)m : 0;
+            if ((size_t)m > s->n) m = (int)s->n;
+            rational_eval(x + first, s->re[p] + first, s->im[p] + first, m, f, &re[i], &im[i]);
+            break;
+        }
+        }
+    }
+}
+
+void rf_s2p_eval_sparams(const rf_s2p_t *s, rf_interp_t mode, const double *freq, size_t n, rf_sparams_t *out) {
+    rf_s2p_eval(s, RF_S11, mode, freq, n, out->s11_re, out->s11_im);
+    rf_s2p_eval(s, RF_S21, mode, freq, n, out->s21_re, out->s21_im);
+    rf_s2p_eval(s, RF_S22, mode, freq, n, out->s22_re, out->s22_im);
+}
+
+// ---------------------------------------------------------------- 写出
+
+static void write_pair(FILE *f, rf_ts_format_t fmt, double re, double im) {
+    switch (fmt) {
+    case RF_TS_RI:
+        fprintf(f, " %.9e %.9e", re, im);
+        break;
+    case RF_TS_MA:
+        fprintf(f, " %.9e %.6f", sqrt(re * re + im * im), rf_deg(re, im));
+        break;
+    case RF_TS_DB:
+        fprintf(f, " %.6f %.6f", rf_db(re, im), rf_deg(re, im));
+        break;
+    }
+}
+
+int rf_s2p_write(const char *path, const double *freq, size_t n, const rf_sparams_t *sp, double z0,
+                 int version, rf_ts_format_t fmt) {
+    static const char *const fmt_name[] = {"RI", "MA", "DB"};
+    FILE *f = fopen(path, "w");
+    size_t i;
+
+    if (!f) return -1;
+    fprintf(f, "! rf_ladder simulation\n");
+    if (version == 2) {
+        fprintf(f, "[Version] 2.0\n");
+        fprintf(f, "# Hz S %s R %g\n", fmt_name[fmt], z0);
+        fprintf(f, "[Number of Ports] 2\n");
+        fprintf(f, "[Two-Port Data Order] 21_12\n");
+        fprintf(f, "[Number of Frequencies] %zu\n", n);
+        fprintf(f, "[Network Data]\n");
+    } else {
+        fprintf(f, "# Hz S %s R %g\n", fmt_name[fmt], z0);
+    }
+    for (i = 0; i < n; i++) {
+        fprintf(f, "%.6f", freq[i]);
+        write_pair(f, fmt, sp->s11_re[i], sp->s11_im[i]);
+        write_pair(f, fmt, sp->s21_re[i], sp->s21_im[i]);
+        write_pair(f, fmt, sp->s21_re[i], sp->s21_im[i]);
+        write_pair(f, fmt, sp->s22_re[i], sp->s22_im[i]);
+        fprintf(f, "\n");
+    }
+    if (version == 2) fprintf(f, "[End]\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+int rf_parse_interp(const char *s, rf_interp_t *mode) {
+    if (strcmp(s, "ri") == 0) {
+        *mode = RF_INTERP_RI;
+    } else if (strcmp(s, "mp") == 0) {
+        *mode = RF_INTERP_MAGPHASE;
+    } else if (strcmp(s, "rational") == 0) {
+        *mode = RF_INTERP_RATIONAL;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int rf_parse_ts_format(const char *s, rf_ts_format_t *fmt) {
+    if (strcmp(s, "ri") == 0) {
+        *fmt = RF_TS_RI;
+    } else if (strcmp(s, "ma") == 0) {
+        *fmt = RF_TS_MA;
+    } else if (strcmp(s, "db") == 0) {
+        *fmt = RF_TS_DB;
+    } else {
+        return -1;
+    }
+    return 0;
+}
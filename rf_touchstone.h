@@ -0,0 +1,65 @@
+#ifndef RF_TOUCHSTONE_H
+#define RF_TOUCHSTONE_H
+
+/*
+ * rf_touchstone.h - Touchstone .s2p（v1/v2）读写、二进制缓存与插值
+ *
+ * 矢网测得的滤波器板数据读入后，与rf_ladder仿真结果一样可在任意频点
+ * 求S参数，供rf_sim、rf_harmonics、rf_yield等工具直接使用。
+ *
+ * 数据以一整块double存放：freq[n]，随后S11、S21、S12、S22各自的
+ * re、im、幅度dB、展开相位（弧度）。幅度/相位在载入时算好，插值时不再
+ * 调用log/atan2。rf_s2p_open_cached()把这一块连同文件头写到"<文件>.rfc"，
+ * 之后直接mmap只读映射，不再解析文本；源文件大小或修改时间变化时自动重建。
+ */
+
+#include <stddef.h>
+#include "rf_ladder.h"
+
+typedef enum { RF_S11 = 0, RF_S21 = 1, RF_S12 = 2, RF_S22 = 3 } rf_sparam_t;
+
+typedef enum {
+    RF_INTERP_RI = 0,       // 实部/虚部线性插值
+    RF_INTERP_MAGPHASE = 1, // dB幅度与展开相位线性插值（默认，适合陡峭的阻带）
+    RF_INTERP_RATIONAL = 2  // 邻近8点的Floater-Hormann重心有理插值（3阶）
+} rf_interp_t;
+
+typedef enum { RF_TS_RI = 0, RF_TS_MA = 1, RF_TS_DB = 2 } rf_ts_format_t;
+
+typedef struct {
+    size_t n;
+    double z0;
+    const double *freq; // Hz，升序
+    const double *re[4], *im[4];
+    const double *mag_db[4], *phase[4];
+    // 存储：malloc的块或mmap的缓存文件
+    void *base;
+    size_t map_len; // 非0表示mmap
+} rf_s2p_t;
+
+// 解析Touchstone文本（长度len）。只支持2端口S参数；v1数据后跟的噪声参数被忽略。
+// 失败返回-1，并在err（可为NULL）中写入原因
+int rf_s2p_parse(const char *text, size_t len, rf_s2p_t *s, char *err, size_t err_size);
+// 读取.s2p文件
+int rf_s2p_load(const char *path, rf_s2p_t *s, char *err, size_t err_size);
+// 优先映射"<path>.rfc"缓存，缓存缺失或过期时解析源文件并重写缓存
+int rf_s2p_open_cached(const char *path, rf_s2p_t *s, char *err, size_t err_size);
+void rf_s2p_free(rf_s2p_t *s);
+
+// 在n个频点上求参数p。频率须升序（按顺序推进区间，不用逐点二分）；
+// 超出测量范围的频点取端点值
+void rf_s2p_eval(const rf_s2p_t *s, rf_sparam_t p, rf_interp_t mode, const double *freq, size_t n,
+                 double *re, double *im);
+// 把四个参数一起求出，写入rf_sparams_t（S12不单独保存，与S21相同的互易网络可忽略）
+void rf_s2p_eval_sparams(const rf_s2p_t *s, rf_interp_t mode, const double *freq, size_t n, rf_sparams_t *out);
+
+// 把扫频结果写成Touchstone（version为1或2）。rf_sparams_t不含S12，按互易网络写S21。
+// 成功返回0
+int rf_s2p_write(const char *path, const double *freq, size_t n, const rf_sparams_t *sp, double z0,
+                 int version, rf_ts_format_t fmt);
+
+// "ri"/"mp"/"rational"、"ri"/"ma"/"db"的解析，失败返回-1
+int rf_parse_interp(const char *s, rf_interp_t *mode);
+int rf_parse_ts_format(const char *s, rf_ts_format_t *fmt);
+
+#endif
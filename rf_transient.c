@@ -0,0 +1,559 @@
+/*
+ * rf_transient.c - WSPR换音经输出低通滤波器的时域瞬态与占用带宽分析
+ *
+ * app.c的encode()每个符号直接改写Si5351频率（相位连续、频率阶跃）。
+ * 本工具对每个频段、每条消息做两部分计算：
+ *
+ * 1. 载波级时域仿真：用rf_tran_*（梯形积分、三对角求解）把Si5351方波
+ *    （限带到spc/4次谐波，避免混叠）送入滤波器，对消息中每一次换音
+ *    仿真换音前后--cycles个载波周期，逐周期求负载电压的RMS包络，
+ *    给出换音引起的包络最大偏差（dB）和恢复到--settle以内所需时间。
+ *    换音前的包络起伏作为数值噪底一并给出。
+ * 2. 整条消息的频谱：以375Hz（每符号256点）生成相位连续的复基带信号，
+ *    Hann窗Welch平均得到功率谱，乘以滤波器在载波±187Hz内的|S21|^2，
+ *    给出99%占用带宽和±3/±10/±50Hz以外的功率（dBc）。
+ *
+ * 每个（频段、消息）为一个任务，由线程池并行处理。
+ *
+ * 编译：
+ *   gcc -O3 -I. -o rf_transient rf_transient.c rf_ladder.c rf_synth.c encode.c nhash.c -lm -lpthread
+ *
+ * 用法：
+ *   rf_transient [-j 线程数] [--band Hz]... [--msg "CALL LOC DBM"]... [--spc N] [--cycles N]
+ *                [--settle 相对值] [--cutoff 倍数] [--ql Q] [--qc Q] [--z0 欧姆]
+ *                [--preset 名称 | 元件...] [-o spectrum.csv] [--check]
+ *
+ * 不指定--msg时使用app.c中的消息（BI1TPH ON80 10）。--check只验证时域引擎：
+ * 用正弦激励仿真到稳态，与rf_ladder_sweep()的|S21|比较。
+ * 频谱CSV列：band_hz,message,offset_hz,psd_db,psd_filtered_db（相对总功率）
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "encode.h"
+#include "rf_ladder.h"
+#include "rf_synth.h"
+
+#define MAX_THREADS 256
+#define MAX_MESSAGES 32
+#define SYMBOLS 162
+#define RF_PI 3.14159265358979323846
+// WSPR符号周期与音调间隔
+#define SYMBOL_TIME (8192.0 / 12000.0)
+#define TONE_SPACING (12000.0 / 8192.0)
+// 基带：每符号256点（375Hz），Welch分段4096点、重叠一半
+#define BB_SPS 256
+#define BB_RATE (BB_SPS / SYMBOL_TIME)
+#define SEG 4096
+#define ENV_AVG 16 // 求参考包络时平均的周期数
+
+static const double wspr_bands[] = {
+    137500, 475700, 1838100, 3570100, 5288700, 7040100, 10140200,
+    14097100, 18106100, 21096100, 24926100, 28126100, 50294500,
+};
+#define WSPR_BAND_COUNT (sizeof(wspr_bands) / sizeof(wspr_bands[0]))
+
+typedef struct {
+    char call[16];
+    char loc[8];
+    int dbm;
+} message_t;
+
+typedef struct {
+    int band, msg;
+    // 时域结果
+    int switches;
+    double floor_db;    // 换音前包络起伏（数值噪底）
+    double peak_db;     // 换音后包络最大偏差
+    double settle_us;   // 最慢的一次恢复时间
+    // 频谱结果
+    double obw, obw_filtered; // 99%占用带宽（Hz）
+    double out3, out10, out50; // 滤波后±3/±10/±50Hz以外的功率（dBc）
+    float psd[SEG], psd_f[SEG];
+} task_t;
+
+static struct {
+    int spc;        // 每载波周期的时域步数
+    int cycles;     // 换音前后各仿真的周期数
+    double settle;  // 恢复判据：包络相对偏差
+    double cutoff;
+    double rs, rl;
+    double q_l, q_c;
+} cfg = {64, 256, 1e-6, 1.25, 50, 50, 100, 500};
+
+static message_t messages[MAX_MESSAGES];
+static int message_count;
+static rf_ladder_t band_ladder[WSPR_BAND_COUNT];
+static const char *band_filter_name[WSPR_BAND_COUNT];
+static task_t *tasks;
+static int task_count;
+static int next_task;
+
+// ---------------------------------------------------------------- 方波激励
+
+// 限带方波：只保留低于spc/4的奇次谐波（更高次谐波在滤波器后已低于-100dB，
+// 由rf_harmonics单独评估）。直接采样理想方波时，步长与周期不成整数比会把
+// 高次谐波混叠到基波附近，形成比滤波器瞬态还大的包络拍频。
+// sin(nθ)用 s(n+2) = 2cos(2θ)·s(n) - s(n-2) 递推
+static inline double square_bl(double u, int nmax) {
+    double th = 2.0 * RF_PI * u;
+    double s1 = sin(th), c2 = 2.0 * cos(2.0 * th);
+    double prev = -s1, cur = s1, acc = s1;
+    int n;
+
+    for (n = 3; n <= nmax; n += 2) {
+        double next = c2 * cur - prev;
+        prev = cur;
+        cur = next;
+        acc += cur / n;
+    }
+    return acc * (4.0 / RF_PI);
+}
+
+// ---------------------------------------------------------------- 载波级瞬态
+
+static double mean(const double *x, int n) {
+    double acc = 0;
+    int i;
+    for (i = 0; i < n; i++) acc += x[i];
+    return acc / n;
+}
+
+static void run_transients(task_t *t, const uint8_t *symbols) {
+    double f_band = wspr_bands[t->band];
+    double h = 1.0 / (f_band * cfg.spc);
+    double *rms = (double *)malloc((size_t)2 * cfg.cycles * sizeof(double));
+    double *wsum = (double *)malloc((size_t)2 * cfg.cycles * sizeof(double));
+    double phase = 0; // 符号起点的载波相位（周期的小数部分）
+    double floor_dev = 0, peak_dev = 0, settle = 0;
+    rf_tran_t tr;
+    int k;
+
+    t->switches = 0;
+    if (!rms || !wsum || rf_tran_init(&tr, &band_ladder[t->band], cfg.rs, cfg.rl, h, f_band) != 0) {
+        free(rms);
+        free(wsum);
+        return;
+    }
+    for (k = 1; k < SYMBOLS; k++) {
+        double f_old = f_band + symbols[k - 1] * TONE_SPACING;
+        double f_new = f_band + symbols[k] * TONE_SPACING;
+        double a, ref_old, ref_new;
+        int c, last = -1;
+
+        // 相位连续：累加上一个符号的周期数（只保留小数部分）
+        phase += f_old * SYMBOL_TIME;
+        phase -= floor(phase);
+        if (symbols[k] == symbols[k - 1]) continue;
+        t->switches++;
+
+        // 从换音前整cycles个周期开始，零初始状态；前段足够让滤波器进入稳态。
+        // a为距窗口起点的激励相位（周期），a = cycles处换音
+        rf_tran_reset(&tr);
+        memset(rms, 0, (size_t)2 * cfg.cycles * sizeof(double));
+        memset(wsum, 0, (size_t)2 * cfg.cycles * sizeof(double));
+        for (a = 0; a < 2 * cfg.cycles;) {
+            double b = a + (a < cfg.cycles ? f_old : f_new) * h;
+            double v = rf_tran_step(&tr, square_bl(phase + b, cfg.spc / 4));
+            c = (int)a;
+            // 按激励的真实周期逐周期求RMS：跨周期边界的一步按相位比例拆分，
+            // 避免步长与周期不成整数比带来的包络起伏
+            if (b > c + 1) {
+                double w = (c + 1 - a) / (b - a);
+                rms[c] += w * v * v;
+                wsum[c] += w;
+                if (c + 1 < 2 * cfg.cycles) {
+                    rms[c + 1] += (1 - w) * v * v;
+                    wsum[c + 1] += 1 - w;
+                }
+            } else {
+                rms[c] += v * v;
+                wsum[c] += 1;
+            }
+            a = b;
+        }
+        for (c = 0; c < 2 * cfg.cycles; c++) rms[c] = wsum[c] > 0 ? sqrt(rms[c] / wsum[c]) : 0;
+        ref_old = mean(rms + cfg.cycles - ENV_AVG, ENV_AVG);
+        ref_new = mean(rms + 2 * cfg.cycles - ENV_AVG, ENV_AVG);
+        // 噪底：换音前后半段（滤波器已稳定）的起伏
+        for (c = cfg.cycles / 2; c < cfg.cycles; c++) {
+            double d = fabs(rms[c] / ref_old - 1.0);
+            if (d > floor_dev) floor_dev = d;
+        }
+        for (c = cfg.cycles; c < 2 * cfg.cycles; c++) {
+            double d = fabs(rms[c] / ref_new - 1.0);
+            if (d > peak_dev) peak_dev = d;
+            if (d > cfg.settle) last = c - cfg.cycles;
+        }
+        if ((last + 1) / f_new > settle) settle = (last + 1) / f_new;
+    }
+    t->floor_db = 20.0 * log10(1.0 + floor_dev);
+    t->peak_db = 20.0 * log10(1.0 + peak_dev);
+    t->settle_us = settle * 1e6;
+    free(rms);
+    free(wsum);
+}
+
+// ---------------------------------------------------------------- 基带频谱
+
+// 原位基2 FFT
+static void fft(double *re, double *im, int n) {
+    int i, j, len;
+
+    for (i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            double t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+    for (len = 2; len <= n; len <<= 1) {
+        double ang = -2.0 * RF_PI / len;
+        double wr = cos(ang), wi = sin(ang);
+        for (i = 0; i < n; i += len) {
+            double cr = 1.0, ci = 0.0;
+            for (j = 0; j < len / 2; j++) {
+                double *ar = &re[i + j], *ai = &im[i + j];
+                double *br = &re[i + j + len / 2], *bi = &im[i + j + len / 2];
+                double tr = *br * cr - *bi * ci, ti = *br * ci + *bi * cr;
+                double nr;
+                *br = *ar - tr;
+                *bi = *ai - ti;
+                *ar += tr;
+                *ai += ti;
+                nr = cr * wr - ci * wi;
+                ci = cr * wi + ci * wr;
+                cr = nr;
+            }
+        }
+    }
+}
+
+// 功率谱中心化后，从两端各累计(1-frac)/2得到占用带宽
+static double occupied_bw(const double *p, double frac) {
+    double total = 0, acc;
+    int lo, hi;
+
+    for (lo = 0; lo < SEG; lo++) total += p[lo];
+    for (lo = 0, acc = 0; lo < SEG && acc + p[lo] < total * (1 - frac) / 2; lo++) acc += p[lo];
+    for (hi = SEG - 1, acc = 0; hi >= 0 && acc + p[hi] < total * (1 - frac) / 2; hi--) acc += p[hi];
+    return (hi - lo + 1) * BB_RATE / SEG;
+}
+
+// |offset| > hz 的功率占比（dB）
+static double power_outside(const double *p, double hz) {
+    double total = 0, out = 0;
+    int i;
+    for (i = 0; i < SEG; i++) {
+        double off = (i - SEG / 2) * BB_RATE / SEG;
+        total += p[i];
+        if (fabs(off) > hz) out += p[i];
+    }
+    return out > 0 ? 10.0 * log10(out / total) : -400.0;
+}
+
+static void run_spectrum(task_t *t, const uint8_t *symbols) {
+    int n = SYMBOLS * BB_SPS;
+    double *sig_re = (double *)malloc((size_t)n * sizeof(double));
+    double *sig_im = (double *)malloc((size_t)n * sizeof(double));
+    double *re = (double *)malloc(SEG * sizeof(double));
+    double *im = (double *)malloc(SEG * sizeof(double));
+    double *psd = (double *)calloc(SEG, sizeof(double));
+    double *psd_f = (double *)malloc(SEG * sizeof(double));
+    double *freq = (double *)malloc(SEG * sizeof(double));
+    double f_center = wspr_bands[t->band] + 1.5 * TONE_SPACING;
+    double phase = 0, total = 0, total_f = 0;
+    rf_sparams_t s;
+    int i, off, segs = 0;
+
+    if (!sig_re || !sig_im || !re || !im || !psd || !psd_f || !freq || rf_sparams_alloc(&s, SEG) != 0) goto done;
+
+    // 相位连续的4-FSK复基带，以四个音调的中心为0Hz
+    for (i = 0; i < n; i++) {
+        double f = (symbols[i / BB_SPS] - 1.5) * TONE_SPACING;
+        sig_re[i] = cos(phase);
+        sig_im[i] = sin(phase);
+        phase += 2.0 * RF_PI * f / BB_RATE;
+        if (phase > RF_PI) phase -= 2.0 * RF_PI;
+        if (phase < -RF_PI) phase += 2.0 * RF_PI;
+    }
+    for (off = 0; off + SEG <= n; off += SEG / 2) {
+        for (i = 0; i < SEG; i++) {
+            double w = 0.5 - 0.5 * cos(2.0 * RF_PI * i / SEG);
+            re[i] = sig_re[off + i] * w;
+            im[i] = sig_im[off + i] * w;
+        }
+        fft(re, im, SEG);
+        // 中心化：下标SEG/2对应0Hz
+        for (i = 0; i < SEG; i++) {
+            int b = (i + SEG / 2) % SEG;
+            psd[i] += re[b] * re[b] + im[b] * im[b];
+        }
+        segs++;
+    }
+
+    for (i = 0; i < SEG; i++) freq[i] = f_center + (i - SEG / 2) * BB_RATE / SEG;
+    rf_ladder_sweep(&band_ladder[t->band], freq, SEG, cfg.rs, cfg.rl, &s);
+    for (i = 0; i < SEG; i++) {
+        psd[i] /= segs;
+        psd_f[i] = psd[i] * (s.s21_re[i] * s.s21_re[i] + s.s21_im[i] * s.s21_im[i]);
+        total += psd[i];
+        total_f += psd_f[i];
+    }
+    for (i = 0; i < SEG; i++) {
+        t->psd[i] = (float)(psd[i] > 0 ? 10.0 * log10(psd[i] / total) : -400.0);
+        // 滤波后的谱仍以滤波前总功率为基准，能看到滤波器的插损
+        t->psd_f[i] = (float)(psd_f[i] > 0 ? 10.0 * log10(psd_f[i] / total) : -400.0);
+    }
+    t->obw = occupied_bw(psd, 0.99);
+    t->obw_filtered = occupied_bw(psd_f, 0.99);
+    t->out3 = power_outside(psd_f, 3.0);
+    t->out10 = power_outside(psd_f, 10.0);
+    t->out50 = power_outside(psd_f, 50.0);
+    rf_sparams_free(&s);
+    (void)total_f;
+
+done:
+    free(sig_re);
+    free(sig_im);
+    free(re);
+    free(im);
+    free(psd);
+    free(psd_f);
+    free(freq);
+}
+
+static void run_task(task_t *t) {
+    const message_t *m = &messages[t->msg];
+    uint8_t symbols[SYMBOLS];
+
+    wspr_encode(m->call, m->loc, (int8_t)m->dbm, symbols);
+    run_transients(t, symbols);
+    run_spectrum(t, symbols);
+}
+
+static void *worker(void *arg) {
+    (void)arg;
+    for (;;) {
+        int i = __atomic_fetch_add(&next_task, 1, __ATOMIC_RELAXED);
+        if (i >= task_count) break;
+        run_task(&tasks[i]);
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------- 引擎校验
+
+// 正弦激励仿真到稳态，用最后若干周期的相关求幅度，与频域|S21|比较
+static double check_band(int b) {
+    static const double mult[] = {0.5, 0.9, 1.0, 1.2, 2.0, 3.0};
+    double f0 = wspr_bands[b];
+    double worst = 0;
+    size_t m;
+
+    for (m = 0; m < sizeof(mult) / sizeof(mult[0]); m++) {
+        double f = f0 * mult[m];
+        double h = 1.0 / (f * cfg.spc);
+        int settle = 4000 * cfg.spc, meas = 200 * cfg.spc;
+        double acc_c = 0, acc_s = 0, sim_db, ref_db;
+        rf_tran_t tr;
+        rf_sparams_t s;
+        int i;
+
+        if (rf_tran_init(&tr, &band_ladder[b], cfg.rs, cfg.rl, h, f) != 0 || rf_sparams_alloc(&s, 1) != 0) continue;
+        for (i = 0; i < settle + meas; i++) {
+            double w = 2.0 * RF_PI * i / cfg.spc;
+            double v = rf_tran_step(&tr, sin(w));
+            if (i >= settle) {
+                acc_c += v * cos(w);
+                acc_s += v * sin(w);
+            }
+        }
+        // S21 = 2·V_L/V_s·sqrt(Rs/Rl)
+        sim_db = 20.0 * log10(2.0 * sqrt(acc_c * acc_c + acc_s * acc_s) * 2.0 / meas * sqrt(cfg.rs / cfg.rl));
+        rf_ladder_sweep(&band_ladder[b], &f, 1, cfg.rs, cfg.rl, &s);
+        ref_db = rf_db(s.s21_re[0], s.s21_im[0]);
+        printf("  %8.4f MHz  时域 %9.3f dB  频域 %9.3f dB  差 %+.4f dB\n", f / 1e6, sim_db, ref_db, sim_db - ref_db);
+        if (fabs(sim_db - ref_db) > worst) worst = fabs(sim_db - ref_db);
+        rf_sparams_free(&s);
+    }
+    return worst;
+}
+
+// ---------------------------------------------------------------- 命令行
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int add_message(const char *s) {
+    message_t *m;
+    if (message_count >= MAX_MESSAGES) return -1;
+    m = &messages[message_count];
+    if (sscanf(s, "%15s %7s %d", m->call, m->loc, &m->dbm) != 3) return -1;
+    message_count++;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int band_sel[WSPR_BAND_COUNT];
+    int band_any = 0, bad_args = 0, check = 0;
+    const char *out_path = NULL;
+    const char *preset = NULL;
+    rf_ladder_t custom;
+    pthread_t th[MAX_THREADS];
+    double t0, t1;
+    size_t b;
+    int a, i;
+
+    memset(band_sel, 0, sizeof(band_sel));
+    custom.count = 0;
+    for (a = 1; a < argc; a++) {
+        double v;
+        if (strcmp(argv[a], "-j") == 0 && a + 1 < argc) {
+            threads = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--band") == 0 && a + 1 < argc) {
+            int found = 0;
+            if (rf_parse_value(argv[++a], &v) != 0) v = 0;
+            // 按最近的WSPR频段匹配，允许写7M、14.097M等
+            for (b = 0; b < WSPR_BAND_COUNT; b++) {
+                if (fabs(wspr_bands[b] - v) < 0.05 * wspr_bands[b]) {
+                    band_sel[b] = found = band_any = 1;
+                }
+            }
+            if (!found) bad_args = 1;
+        } else if (strcmp(argv[a], "--msg") == 0 && a + 1 < argc) {
+            if (add_message(argv[++a]) != 0) bad_args = 1;
+        } else if (strcmp(argv[a], "--spc") == 0 && a + 1 < argc) {
+            cfg.spc = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--cycles") == 0 && a + 1 < argc) {
+            cfg.cycles = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--settle") == 0 && a + 1 < argc) {
+            cfg.settle = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--cutoff") == 0 && a + 1 < argc) {
+            cfg.cutoff = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--ql") == 0 && a + 1 < argc) {
+            cfg.q_l = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--qc") == 0 && a + 1 < argc) {
+            cfg.q_c = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--z0") == 0 && a + 1 < argc) {
+            cfg.rs = cfg.rl = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--preset") == 0 && a + 1 < argc) {
+            preset = argv[++a];
+        } else if (strcmp(argv[a], "--check") == 0) {
+            check = 1;
+        } else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+            out_path = argv[++a];
+        } else {
+            rf_element_t e;
+            if (rf_parse_element(argv[a], &e) != 0 || rf_ladder_add(&custom, &e) != 0) bad_args = 1;
+        }
+    }
+    if (bad_args || cfg.spc < 8 || cfg.cycles < 4 * ENV_AVG || cfg.settle <= 0 || cfg.cutoff <= 0 || cfg.rs <= 0) {
+        fprintf(stderr, "用法: %s [-j 线程数] [--band Hz]... [--msg \"CALL LOC DBM\"]... [--spc N] [--cycles N]\n"
+                        "          [--settle 相对值] [--cutoff 倍数] [--ql Q] [--qc Q] [--z0 欧姆]\n"
+                        "          [--preset 名称 | 元件...] [-o spectrum.csv] [--check]\n",
+                argv[0]);
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (message_count == 0) add_message("BI1TPH ON80 10");
+
+    for (b = 0; b < WSPR_BAND_COUNT; b++) {
+        rf_ladder_t *l = &band_ladder[b];
+        int ret = 0;
+        if (preset) {
+            ret = rf_ladder_preset(preset, l);
+            band_filter_name[b] = preset;
+        } else if (custom.count) {
+            *l = custom;
+            band_filter_name[b] = "custom";
+        } else {
+            ret = rf_band_filter(wspr_bands[b], cfg.cutoff, cfg.rs, l, &band_filter_name[b]);
+        }
+        if (ret != 0) {
+            fprintf(stderr, "无法建立滤波器: %s\n", preset ? preset : "?");
+            return 1;
+        }
+        rf_ladder_default_q(l, cfg.q_l, cfg.q_c);
+    }
+
+    if (check) {
+        double worst = 0;
+        for (b = 0; b < WSPR_BAND_COUNT; b++) {
+            double d;
+            if (band_any && !band_sel[b]) continue;
+            printf("%.4f MHz（%s）\n", wspr_bands[b] / 1e6, band_filter_name[b]);
+            d = check_band((int)b);
+            if (d > worst) worst = d;
+        }
+        printf("时域与频域|S21|最大差 %.4f dB\n", worst);
+        return 0;
+    }
+
+    tasks = (task_t *)calloc(WSPR_BAND_COUNT * (size_t)message_count, sizeof(task_t));
+    if (!tasks) return 1;
+    for (b = 0; b < WSPR_BAND_COUNT; b++) {
+        if (band_any && !band_sel[b]) continue;
+        for (i = 0; i < message_count; i++) {
+            tasks[task_count].band = (int)b;
+            tasks[task_count].msg = i;
+            task_count++;
+        }
+    }
+
+    t0 = now_sec();
+    for (i = 0; i < threads; i++) pthread_create(&th[i], NULL, worker, NULL);
+    for (i = 0; i < threads; i++) pthread_join(th[i], NULL);
+    t1 = now_sec();
+
+    printf("%10s  %-11s %-20s %4s %9s %9s %9s %8s %8s %7s %7s %7s\n", "频段MHz", "滤波器", "消息", "换音",
+           "噪底dB", "瞬态dB", "恢复us", "OBW Hz", "滤波后", ">3Hz", ">10Hz", ">50Hz");
+    for (i = 0; i < task_count; i++) {
+        const task_t *t = &tasks[i];
+        char msg[40];
+        snprintf(msg, sizeof(msg), "%s %s %d", messages[t->msg].call, messages[t->msg].loc, messages[t->msg].dbm);
+        printf("%10.4f  %-11s %-20s %4d %9.2e %9.2e %9.2f %8.3f %8.3f %7.1f %7.1f %7.1f\n", wspr_bands[t->band] / 1e6,
+               band_filter_name[t->band], msg, t->switches, t->floor_db, t->peak_db, t->settle_us, t->obw,
+               t->obw_filtered, t->out3, t->out10, t->out50);
+    }
+
+    if (out_path) {
+        FILE *out = fopen(out_path, "w");
+        if (!out) {
+            perror(out_path);
+            return 1;
+        }
+        fprintf(out, "band_hz,message,offset_hz,psd_db,psd_filtered_db\n");
+        for (i = 0; i < task_count; i++) {
+            const task_t *t = &tasks[i];
+            int k;
+            for (k = 0; k < SEG; k++) {
+                fprintf(out, "%.0f,%s %s %d,%.4f,%.2f,%.2f\n", wspr_bands[t->band], messages[t->msg].call,
+                        messages[t->msg].loc, messages[t->msg].dbm, (k - SEG / 2) * BB_RATE / SEG, t->psd[k],
+                        t->psd_f[k]);
+            }
+        }
+        fclose(out);
+    }
+
+    fprintf(stderr, "%d 个任务（频段×消息），%d 线程，%.2f 秒\n", task_count, threads, t1 - t0);
+    free(tasks);
+    return 0;
+}
@@ -0,0 +1,589 @@
+/*
+ * rf_yield.c - LC低通滤波器元件容差的蒙特卡洛良率分析
+ *
+ * 对RF.m中的各频段滤波器（或命令行/.ftr给出的电路），按元件容差随机抽取
+ * 大量样本，统计：
+ *   良率      f0处插损、2f0/3f0处谐波抑制（及可选的回波损耗）同时达标的比例
+ *   包络      扫频范围内每个频点所有样本S21的最小/最大值（最坏情况包络）
+ *   灵敏度    标称值下各元件变化1%引起的loss/rej2/rej3变化（dB/%），
+ *             以及蒙特卡洛中各元件偏差与最差裕量的相关系数
+ *   实测对比  --s2p给出做好的滤波器板的矢网数据时，按同样的指标判定实测板，
+ *             并统计实测S21落在蒙特卡洛包络之外的频点（超出说明不只是元件容差）
+ *
+ * 样本按CHUNK个一组作为任务分给线程，组内用rf_ladder_sweep_samples()
+ * 沿样本方向向量化计算。每组的随机数种子只由--seed、滤波器序号和组号
+ * 决定，结果与线程数无关。
+ *
+ * 编译：
+ *   gcc -O3 -o rf_yield rf_yield.c rf_ladder.c rf_synth.c rf_touchstone.c -lm -lpthread
+ *
+ * 用法：
+ *   rf_yield [-j 线程数] [-n 样本数] [--seed N] [--tol %] [--tol-l %] [--tol-c %]
+ *            [--tol-r %] [--gauss] [--max-loss dB] [--min-rej dB] [--min-rl dB]
+ *            [--ql Q] [--qc Q] [--z0 欧姆] [--f1 Hz] [--f2 Hz] [--points N]
+ *            [--preset 名称]... [--ftr 文件 --f0 Hz] [--f0 Hz 元件...] [--s2p 文件]
+ *            [--interp mp|ri|rational] [-o envelope.csv]
+ *
+ * 不指定电路时分析RF.m的全部内置电路（7mhz按7.0401MHz、10mhz/10mhz-test按
+ * 10.1402MHz）。容差默认按均匀分布；--gauss时按正态分布、容差为3σ并截断。
+ * 包络CSV列：filter,freq_hz,nominal_db,min_db,max_db（--s2p时另有measured_db）
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "rf_ladder.h"
+#include "rf_synth.h"
+#include "rf_touchstone.h"
+
+#define MAX_THREADS 256
+#define MAX_FILTERS 16
+#define CHUNK 4096
+#define MAX_POINTS 4096
+
+typedef struct {
+    const char *name;
+    rf_ladder_t ladder;
+    double f0;
+    double tol[RF_MAX_ELEMENTS]; // 各元件的相对容差
+} filter_t;
+
+// 每个滤波器的统计量，线程内累加后合并
+typedef struct {
+    unsigned long long samples, pass;
+    unsigned long long fail_loss, fail_rej2, fail_rej3, fail_rl;
+    double env_min[MAX_POINTS], env_max[MAX_POINTS]; // |S21|^2
+    double sy, syy;                                  // 最差裕量（dB）
+    double sx[RF_MAX_ELEMENTS], sxx[RF_MAX_ELEMENTS], sxy[RF_MAX_ELEMENTS];
+    double worst_margin;
+    double worst_mult[RF_MAX_ELEMENTS];
+} stats_t;
+
+static struct {
+    double rs, rl;
+    double q_l, q_c;
+    double max_loss, min_rej, min_rl; // min_rl为0时不检查回波损耗
+    double f1, f2;
+    int points;
+    int gauss;
+    unsigned long long samples;
+    unsigned long long seed;
+} cfg = {50, 50, 100, 500, 2.0, 40, 0, 1e6, 30e6, 100, 0, 100000, 1};
+
+static filter_t filters[MAX_FILTERS];
+static int filter_count;
+static const char *s2p_path;
+static rf_s2p_t meas;
+static rf_interp_t interp = RF_INTERP_MAGPHASE;
+static double meas_db[MAX_POINTS]; // 实测S21插值到grid上
+static double grid[MAX_POINTS];
+static stats_t *totals;
+static pthread_mutex_t totals_lock = PTHREAD_MUTEX_INITIALIZER;
+static int next_task;
+static int chunks_per_filter;
+
+// ---------------------------------------------------------------- 随机数
+
+static inline uint64_t splitmix64(uint64_t *s) {
+    uint64_t z = (*s += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// (0,1)开区间均匀分布
+static inline double uniform01(uint64_t *s) {
+    return ((splitmix64(s) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+// 一组样本的元件倍率：mult[k*n + i]
+static void draw_multipliers(const filter_t *f, uint64_t seed, double *mult, size_t n) {
+    uint64_t s = seed;
+    int k;
+    size_t i;
+
+    for (k = 0; k < f->ladder.count; k++) {
+        double tol = f->tol[k];
+        double *m = mult + (size_t)k * n;
+        if (!cfg.gauss) {
+            for (i = 0; i < n; i++) m[i] = 1.0 + tol * (2.0 * uniform01(&s) - 1.0);
+            continue;
+        }
+        // Box-Muller，一次得到两个正态样本；超出±3σ（即容差）的截断到边界
+        for (i = 0; i < n; i += 2) {
+            double r = sqrt(-2.0 * log(uniform01(&s)));
+            double t = 2.0 * 3.14159265358979323846 * uniform01(&s);
+            double g[2];
+            int j;
+            g[0] = r * cos(t);
+            g[1] = r * sin(t);
+            for (j = 0; j < 2 && i + j < n; j++) {
+                double x = g[j] / 3.0;
+                if (x > 1.0) x = 1.0;
+                if (x < -1.0) x = -1.0;
+                m[i + j] = 1.0 + tol * x;
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------- 单组评估
+
+typedef struct {
+    double mult[RF_MAX_ELEMENTS * CHUNK];
+    double loss[CHUNK], rej2[CHUNK], rej3[CHUNK], rl[CHUNK];
+    rf_sparams_t sp;
+    stats_t *stats; // 每个滤波器一份
+} worker_ctx_t;
+
+static inline double mag2(double re, double im) {
+    return re * re + im * im;
+}
+
+static void run_chunk(worker_ctx_t *w, int fi, int chunk) {
+    const filter_t *f = &filters[fi];
+    stats_t *st = &w->stats[fi];
+    unsigned long long first = (unsigned long long)chunk * CHUNK;
+    size_t n = (size_t)((cfg.samples - first < CHUNK) ? cfg.samples - first : CHUNK);
+    uint64_t seed = cfg.seed * 0x2545f4914f6cdd1dULL + ((uint64_t)fi << 40) + (uint64_t)chunk;
+    size_t i;
+    int p, k;
+
+    draw_multipliers(f, seed, w->mult, n);
+
+    rf_ladder_sweep_samples(&f->ladder, w->mult, n, f->f0, cfg.rs, cfg.rl, &w->sp);
+    for (i = 0; i < n; i++) {
+        w->loss[i] = -10.0 * log10(mag2(w->sp.s21_re[i], w->sp.s21_im[i]));
+        w->rl[i] = -10.0 * log10(mag2(w->sp.s11_re[i], w->sp.s11_im[i]));
+    }
+    rf_ladder_sweep_samples(&f->ladder, w->mult, n, 2 * f->f0, cfg.rs, cfg.rl, &w->sp);
+    for (i = 0; i < n; i++) w->rej2[i] = -10.0 * log10(mag2(w->sp.s21_re[i], w->sp.s21_im[i]));
+    rf_ladder_sweep_samples(&f->ladder, w->mult, n, 3 * f->f0, cfg.rs, cfg.rl, &w->sp);
+    for (i = 0; i < n; i++) w->rej3[i] = -10.0 * log10(mag2(w->sp.s21_re[i], w->sp.s21_im[i]));
+
+    // 最坏情况包络只需比较|S21|^2，不取对数
+    for (p = 0; p < cfg.points; p++) {
+        double lo = st->env_min[p], hi = st->env_max[p];
+        rf_ladder_sweep_samples(&f->ladder, w->mult, n, grid[p], cfg.rs, cfg.rl, &w->sp);
+        for (i = 0; i < n; i++) {
+            double m = mag2(w->sp.s21_re[i], w->sp.s21_im[i]);
+            lo = m < lo ? m : lo;
+            hi = m > hi ? m : hi;
+        }
+        st->env_min[p] = lo;
+        st->env_max[p] = hi;
+    }
+
+    for (i = 0; i < n; i++) {
+        // 裕量：各项指标距门限的最小距离，>=0为合格
+        double margin = cfg.max_loss - w->loss[i];
+        int ok = 1;
+        if (w->loss[i] > cfg.max_loss) st->fail_loss++, ok = 0;
+        if (w->rej2[i] < cfg.min_rej) st->fail_rej2++, ok = 0;
+        if (w->rej3[i] < cfg.min_rej) st->fail_rej3++, ok = 0;
+        if (w->rej2[i] - cfg.min_rej < margin) margin = w->rej2[i] - cfg.min_rej;
+        if (w->rej3[i] - cfg.min_rej < margin) margin = w->rej3[i] - cfg.min_rej;
+        if (cfg.min_rl > 0) {
+            if (w->rl[i] < cfg.min_rl) st->fail_rl++, ok = 0;
+            if (w->rl[i] - cfg.min_rl < margin) margin = w->rl[i] - cfg.min_rl;
+        }
+        st->pass += ok;
+        st->sy += margin;
+        st->syy += margin * margin;
+        for (k = 0; k < f->ladder.count; k++) {
+            double x = w->mult[(size_t)k * n + i] - 1.0;
+            st->sx[k] += x;
+            st->sxx[k] += x * x;
+            st->sxy[k] += x * margin;
+        }
+        if (margin < st->worst_margin) {
+            st->worst_margin = margin;
+            for (k = 0; k < f->ladder.count; k++) st->worst_mult[k] = w->mult[(size_t)k * n + i];
+        }
+    }
+    st->samples += n;
+}
+
+static void stats_init(stats_t *st) {
+    int p;
+    memset(st, 0, sizeof(*st));
+    st->worst_margin = HUGE_VAL;
+    for (p = 0; p < MAX_POINTS; p++) {
+        st->env_min[p] = HUGE_VAL;
+        st->env_max[p] = 0;
+    }
+}
+
+static void stats_merge(stats_t *dst, const stats_t *src) {
+    int k, p;
+
+    dst->samples += src->samples;
+    dst->pass += src->pass;
+    dst->fail_loss += src->fail_loss;
+    dst->fail_rej2 += src->fail_rej2;
+    dst->fail_rej3 += src->fail_rej3;
+    dst->fail_rl += src->fail_rl;
+    dst->sy += src->sy;
+    dst->syy += src->syy;
+    for (k = 0; k < RF_MAX_ELEMENTS; k++) {
+        dst->sx[k] += src->sx[k];
+        dst->sxx[k] += src->sxx[k];
+        dst->sxy[k] += src->sxy[k];
+    }
+    for (p = 0; p < cfg.points; p++) {
+        if (src->env_min[p] < dst->env_min[p]) dst->env_min[p] = src->env_min[p];
+        if (src->env_max[p] > dst->env_max[p]) dst->env_max[p] = src->env_max[p];
+    }
+    if (src->worst_margin < dst->worst_margin) {
+        dst->worst_margin = src->worst_margin;
+        memcpy(dst->worst_mult, src->worst_mult, sizeof(dst->worst_mult));
+    }
+}
+
+static void *worker(void *arg) {
+    worker_ctx_t *w = (worker_ctx_t *)malloc(sizeof(worker_ctx_t));
+    int task_count = filter_count * chunks_per_filter;
+    int i;
+    (void)arg;
+
+    if (!w) return NULL;
+    w->stats = (stats_t *)malloc((size_t)filter_count * sizeof(stats_t));
+    if (!w->stats || rf_sparams_alloc(&w->sp, CHUNK) != 0) {
+        free(w->stats);
+        free(w);
+        return NULL;
+    }
+    for (i = 0; i < filter_count; i++) stats_init(&w->stats[i]);
+    for (;;) {
+        int t = __atomic_fetch_add(&next_task, 1, __ATOMIC_RELAXED);
+        if (t >= task_count) break;
+        run_chunk(w, t / chunks_per_filter, t % chunks_per_filter);
+    }
+    // 线程结束时合并一次
+    pthread_mutex_lock(&totals_lock);
+    for (i = 0; i < filter_count; i++) stats_merge(&totals[i], &w->stats[i]);
+    pthread_mutex_unlock(&totals_lock);
+    rf_sparams_free(&w->sp);
+    free(w->stats);
+    free(w);
+    return NULL;
+}
+
+// ---------------------------------------------------------------- 报告
+
+// 标称值下loss/rej2/rej3/rl，mult为NULL时全部取1
+static void nominal_metrics(const filter_t *f, const double *mult, size_t n, double *out) {
+    rf_sparams_t s;
+    double ones[RF_MAX_ELEMENTS];
+    double freq[3];
+    size_t i;
+    int h, k;
+
+    freq[0] = f->f0;
+    freq[1] = 2 * f->f0;
+    freq[2] = 3 * f->f0;
+    for (k = 0; k < RF_MAX_ELEMENTS; k++) ones[k] = 1.0;
+    if (!mult) {
+        mult = ones;
+        n = 1;
+    }
+    if (rf_sparams_alloc(&s, n) != 0) return;
+    for (h = 0; h < 3; h++) {
+        rf_ladder_sweep_samples(&f->ladder, mult, n, freq[h], cfg.rs, cfg.rl, &s);
+        for (i = 0; i < n; i++) {
+            out[i * 4 + h] = -rf_db(s.s21_re[i], s.s21_im[i]);
+            if (h == 0) out[i * 4 + 3] = -rf_db(s.s11_re[i], s.s11_im[i]);
+        }
+    }
+    rf_sparams_free(&s);
+}
+
+// 实测板：f0/2f0/3f0处的指标，以及grid上超出蒙特卡洛包络的频点
+static void report_measured(const filter_t *f, const stats_t *st) {
+    double freq[3] = {f->f0, 2 * f->f0, 3 * f->f0};
+    double re[3], im[3], s11_re[1], s11_im[1];
+    double loss, rej2, rej3, rl, worst = 0, worst_f = 0;
+    int p, outside = 0, ok;
+
+    rf_s2p_eval(&meas, RF_S21, interp, freq, 3, re, im);
+    rf_s2p_eval(&meas, RF_S11, interp, freq, 1, s11_re, s11_im);
+    loss = -rf_db(re[0], im[0]);
+    rej2 = -rf_db(re[1], im[1]);
+    rej3 = -rf_db(re[2], im[2]);
+    rl = -rf_db(s11_re[0], s11_im[0]);
+    ok = loss <= cfg.max_loss && rej2 >= cfg.min_rej && rej3 >= cfg.min_rej && (cfg.min_rl <= 0 || rl >= cfg.min_rl);
+    for (p = 0; p < cfg.points; p++) {
+        double lo = 10.0 * log10(st->env_min[p]), hi = 10.0 * log10(st->env_max[p]);
+        double d = meas_db[p] < lo ? lo - meas_db[p] : meas_db[p] > hi ? meas_db[p] - hi : 0;
+        if (d > 0) outside++;
+        if (d > worst) {
+            worst = d;
+            worst_f = grid[p];
+        }
+    }
+    printf("  实测: loss %.3f dB  rej2 %.1f dB  rej3 %.1f dB  rl %.1f dB  %s\n", loss, rej2, rej3, rl,
+           ok ? "合格" : "不合格");
+    if (outside) {
+        printf("  实测S21有 %d/%d 个频点在包络外，最大超出 %.2f dB（%.4f MHz）\n", outside, cfg.points, worst,
+               worst_f / 1e6);
+    } else {
+        printf("  实测S21全部落在包络内\n");
+    }
+}
+
+static void report(const filter_t *f, const stats_t *st) {
+    int count = f->ladder.count;
+    double nom[4];
+    double *mult = (double *)malloc((size_t)count * 2 * count * sizeof(double));
+    double *fd = (double *)malloc((size_t)2 * count * 4 * sizeof(double));
+    double n = (double)st->samples;
+    double var_y = st->syy / n - (st->sy / n) * (st->sy / n);
+    int k, j;
+
+    if (!mult || !fd) {
+        free(mult);
+        free(fd);
+        return;
+    }
+    nominal_metrics(f, NULL, 1, nom);
+
+    // 灵敏度：每个元件±1%各一个样本，共2*count路一起算
+    for (j = 0; j < 2 * count; j++) {
+        for (k = 0; k < count; k++) {
+            mult[(size_t)k * 2 * count + j] = (k == j / 2) ? (j % 2 ? 0.99 : 1.01) : 1.0;
+        }
+    }
+    nominal_metrics(f, mult, (size_t)2 * count, fd);
+
+    printf("%s  f0 %.4f MHz  %llu 样本  良率 %.3f%%\n", f->name, f->f0 / 1e6, st->samples,
+           100.0 * st->pass / n);
+    printf("  标称: loss %.3f dB  rej2 %.1f dB  rej3 %.1f dB  rl %.1f dB\n", nom[0], nom[1], nom[2], nom[3]);
+    printf("  不合格: loss>%.2fdB %.3f%%  rej2<%.0fdB %.3f%%  rej3<%.0fdB %.3f%%", cfg.max_loss,
+           100.0 * st->fail_loss / n, cfg.min_rej, 100.0 * st->fail_rej2 / n, cfg.min_rej,
+           100.0 * st->fail_rej3 / n);
+    if (cfg.min_rl > 0) printf("  rl<%.0fdB %.3f%%", cfg.min_rl, 100.0 * st->fail_rl / n);
+    printf("\n  最差样本裕量 %.2f dB\n", st->worst_margin);
+    if (s2p_path) report_measured(f, st);
+    printf("  %-4s %-22s %6s %9s %9s %9s %7s %8s\n", "#", "元件", "容差", "loss/%", "rej2/%", "rej3/%",
+           "相关", "最差");
+    for (k = 0; k < count; k++) {
+        char buf[96];
+        double d[3];
+        double var_x = st->sxx[k] / n - (st->sx[k] / n) * (st->sx[k] / n);
+        double cov = st->sxy[k] / n - (st->sx[k] / n) * (st->sy / n);
+        double corr = (var_x > 0 && var_y > 0) ? cov / sqrt(var_x * var_y) : 0;
+        int h;
+        for (h = 0; h < 3; h++) d[h] = (fd[(2 * k) * 4 + h] - fd[(2 * k + 1) * 4 + h]) / 2.0;
+        rf_format_element(&f->ladder.e[k], buf, sizeof(buf));
+        printf("  %-4d %-22s %5.1f%% %+9.4f %+9.3f %+9.3f %+7.3f %+7.2f%%\n", k + 1, buf, 100 * f->tol[k],
+               d[0], d[1], d[2], corr, 100 * (st->worst_mult[k] - 1));
+    }
+    free(mult);
+    free(fd);
+}
+
+// ---------------------------------------------------------------- 命令行
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static filter_t *add_filter(const char *name, double f0) {
+    filter_t *f;
+    if (filter_count >= MAX_FILTERS) return NULL;
+    f = &filters[filter_count++];
+    memset(f, 0, sizeof(*f));
+    f->name = name;
+    f->f0 = f0;
+    return f;
+}
+
+// 内置电路对应的WSPR频率
+static double preset_f0(const char *name) {
+    return strcmp(name, "7mhz") == 0 ? 7040100 : 10140200;
+}
+
+int main(int argc, char **argv) {
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    double tol_l = 0.05, tol_c = 0.05, tol_r = 0.05, f0 = 0;
+    const char *out_path = NULL;
+    const char *ftr_path = NULL;
+    const char *presets[MAX_FILTERS];
+    int preset_count = 0;
+    rf_ladder_t custom;
+    pthread_t th[MAX_THREADS];
+    double t0, t1;
+    int a, i, k, bad_args = 0;
+
+    custom.count = 0;
+    for (a = 1; a < argc; a++) {
+        double v;
+        if (strcmp(argv[a], "-j") == 0 && a + 1 < argc) {
+            threads = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-n") == 0 && a + 1 < argc) {
+            if (rf_parse_value(argv[++a], &v) != 0 || v < 1) bad_args = 1;
+            cfg.samples = (unsigned long long)v;
+        } else if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc) {
+            cfg.seed = strtoull(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "--tol") == 0 && a + 1 < argc) {
+            tol_l = tol_c = tol_r = atof(argv[++a]) / 100;
+        } else if (strcmp(argv[a], "--tol-l") == 0 && a + 1 < argc) {
+            tol_l = atof(argv[++a]) / 100;
+        } else if (strcmp(argv[a], "--tol-c") == 0 && a + 1 < argc) {
+            tol_c = atof(argv[++a]) / 100;
+        } else if (strcmp(argv[a], "--tol-r") == 0 && a + 1 < argc) {
+            tol_r = atof(argv[++a]) / 100;
+        } else if (strcmp(argv[a], "--gauss") == 0) {
+            cfg.gauss = 1;
+        } else if (strcmp(argv[a], "--max-loss") == 0 && a + 1 < argc) {
+            cfg.max_loss = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--min-rej") == 0 && a + 1 < argc) {
+            cfg.min_rej = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--min-rl") == 0 && a + 1 < argc) {
+            cfg.min_rl = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--ql") == 0 && a + 1 < argc) {
+            cfg.q_l = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--qc") == 0 && a + 1 < argc) {
+            cfg.q_c = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--z0") == 0 && a + 1 < argc) {
+            cfg.rs = cfg.rl = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--f1") == 0 && a + 1 < argc) {
+            if (rf_parse_value(argv[++a], &cfg.f1) != 0) bad_args = 1;
+        } else if (strcmp(argv[a], "--f2") == 0 && a + 1 < argc) {
+            if (rf_parse_value(argv[++a], &cfg.f2) != 0) bad_args = 1;
+        } else if (strcmp(argv[a], "--points") == 0 && a + 1 < argc) {
+            cfg.points = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--f0") == 0 && a + 1 < argc) {
+            if (rf_parse_value(argv[++a], &f0) != 0) bad_args = 1;
+        } else if (strcmp(argv[a], "--preset") == 0 && a + 1 < argc) {
+            if (preset_count < MAX_FILTERS) presets[preset_count++] = argv[++a];
+        } else if (strcmp(argv[a], "--ftr") == 0 && a + 1 < argc) {
+            ftr_path = argv[++a];
+        } else if (strcmp(argv[a], "--s2p") == 0 && a + 1 < argc) {
+            s2p_path = argv[++a];
+        } else if (strcmp(argv[a], "--interp") == 0 && a + 1 < argc) {
+            if (rf_parse_interp(argv[++a], &interp) != 0) bad_args = 1;
+        } else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+            out_path = argv[++a];
+        } else {
+            rf_element_t e;
+            if (rf_parse_element(argv[a], &e) != 0 || rf_ladder_add(&custom, &e) != 0) bad_args = 1;
+        }
+    }
+    if (bad_args || cfg.points < 2 || cfg.points > MAX_POINTS || cfg.rs <= 0 ||
+        ((custom.count || ftr_path) && f0 <= 0)) {
+        fprintf(stderr, "用法: %s [-j 线程数] [-n 样本数] [--seed N] [--tol %%] [--tol-l %%] [--tol-c %%] [--tol-r %%]\n"
+                        "          [--gauss] [--max-loss dB] [--min-rej dB] [--min-rl dB] [--ql Q] [--qc Q]\n"
+                        "          [--z0 欧姆] [--f1 Hz] [--f2 Hz] [--points N] [--preset 名称]...\n"
+                        "          [--ftr 文件 --f0 Hz] [--f0 Hz 元件...] [--s2p 文件] [--interp mp|ri|rational]\n"
+                        "          [-o envelope.csv]\n"
+                        "自定义电路（元件或--ftr）需要用--f0给出工作频率\n",
+                argv[0]);
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    for (i = 0; i < preset_count; i++) {
+        filter_t *f = add_filter(presets[i], preset_f0(presets[i]));
+        if (!f || rf_ladder_preset(presets[i], &f->ladder) != 0) {
+            fprintf(stderr, "未知电路: %s\n", presets[i]);
+            return 2;
+        }
+    }
+    if (ftr_path) {
+        rf_filter_spec_t spec;
+        filter_t *f = add_filter(ftr_path, f0);
+        if (!f || rf_ftr_load(ftr_path, &spec) != 0 || rf_synth_ladder(&spec, &f->ladder, NULL) != 0) {
+            fprintf(stderr, "%s: 无法读取或综合\n", ftr_path);
+            return 1;
+        }
+    }
+    if (custom.count) {
+        filter_t *f = add_filter("custom", f0);
+        if (f) f->ladder = custom;
+    }
+    if (filter_count == 0) {
+        for (i = 0; rf_preset_names[i]; i++) {
+            filter_t *f = add_filter(rf_preset_names[i], preset_f0(rf_preset_names[i]));
+            rf_ladder_preset(rf_preset_names[i], &f->ladder);
+        }
+    }
+    for (i = 0; i < filter_count; i++) {
+        filter_t *f = &filters[i];
+        rf_ladder_default_q(&f->ladder, cfg.q_l, cfg.q_c);
+        // 每条支路按其中的主要元件取容差：电感优先，其次电容
+        for (k = 0; k < f->ladder.count; k++) {
+            const rf_element_t *e = &f->ladder.e[k];
+            f->tol[k] = e->l > 0 ? tol_l : e->c > 0 ? tol_c : tol_r;
+        }
+    }
+    rf_freq_linspace(cfg.f1, cfg.f2, (size_t)cfg.points, grid);
+    if (s2p_path) {
+        char err[128];
+        double re[MAX_POINTS], im[MAX_POINTS];
+        int p;
+        if (rf_s2p_open_cached(s2p_path, &meas, err, sizeof(err)) != 0) {
+            fprintf(stderr, "%s: %s\n", s2p_path, err);
+            return 1;
+        }
+        if (cfg.f1 < meas.freq[0] || cfg.f2 > meas.freq[meas.n - 1]) {
+            fprintf(stderr, "注意：%s 测量范围 %.6g~%.6g Hz，范围外取端点值\n", s2p_path, meas.freq[0],
+                    meas.freq[meas.n - 1]);
+        }
+        rf_s2p_eval(&meas, RF_S21, interp, grid, (size_t)cfg.points, re, im);
+        for (p = 0; p < cfg.points; p++) meas_db[p] = rf_db(re[p], im[p]);
+    }
+
+    totals = (stats_t *)malloc((size_t)filter_count * sizeof(stats_t));
+    if (!totals) return 1;
+    for (i = 0; i < filter_count; i++) stats_init(&totals[i]);
+    chunks_per_filter = (int)((cfg.samples + CHUNK - 1) / CHUNK);
+
+    t0 = now_sec();
+    for (i = 0; i < threads; i++) pthread_create(&th[i], NULL, worker, NULL);
+    for (i = 0; i < threads; i++) pthread_join(th[i], NULL);
+    t1 = now_sec();
+
+    for (i = 0; i < filter_count; i++) {
+        if (i) printf("\n");
+        report(&filters[i], &totals[i]);
+    }
+
+    if (out_path) {
+        FILE *out = fopen(out_path, "w");
+        if (!out) {
+            perror(out_path);
+            return 1;
+        }
+        fprintf(out, "filter,freq_hz,nominal_db,min_db,max_db%s\n", s2p_path ? ",measured_db" : "");
+        for (i = 0; i < filter_count; i++) {
+            rf_sparams_t s;
+            int p;
+            if (rf_sparams_alloc(&s, (size_t)cfg.points) != 0) break;
+            rf_ladder_sweep(&filters[i].ladder, grid, (size_t)cfg.points, cfg.rs, cfg.rl, &s);
+            for (p = 0; p < cfg.points; p++) {
+                fprintf(out, "%s,%.0f,%.4f,%.4f,%.4f", filters[i].name, grid[p],
+                        rf_db(s.s21_re[p], s.s21_im[p]), 10.0 * log10(totals[i].env_min[p]),
+                        10.0 * log10(totals[i].env_max[p]));
+                if (s2p_path) fprintf(out, ",%.4f", meas_db[p]);
+                fprintf(out, "\n");
+            }
+            rf_sparams_free(&s);
+        }
+        fclose(out);
+    }
+
+    fprintf(stderr, "%d 个电路 × %llu 样本，%d 频点，%d 线程，%.2f 秒（%.2f M样本/秒）\n", filter_count,
+            cfg.samples, cfg.points + 3, threads, t1 - t0, filter_count * (double)cfg.samples / (t1 - t0) / 1e6);
+    free(totals);
+    if (s2p_path) rf_s2p_free(&meas);
+    return 0;
+}
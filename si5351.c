@@ -1,16 +1,18 @@
 // vim: set ai et ts=4 sw=4:
 
-// 针对你的MCU进行更改
-#include "stm32f1xx_hal.h"
+#include <stdint.h>
+
+// I2C访问经由可替换的传输层（见si5351_transport.c）：固件默认使用阻塞HAL传输，
+// 主机端定义SI5351_MOCK时使用模拟传输。主机端工具（表格生成等）只定义
+// SI5351_NO_HAL时自行提供si5351_write()，不经过队列。
+#if !defined(SI5351_NO_HAL) || defined(SI5351_MOCK)
+#define SI5351_QUEUED
+#endif
 
 #include <si5351.h>
-#define SI5351_ADDRESS 0x60
-#define I2C_HANDLE hi2c1
-extern I2C_HandleTypeDef I2C_HANDLE;
 
 // 私有函数声明。
 void si5351_writeBulk(uint8_t baseaddr, int32_t P1, int32_t P2, int32_t P3, uint8_t divBy4, si5351RDiv_t rdiv);
-void si5351_write(uint8_t reg, uint8_t value);
 
 // 详见 http://www.silabs.com/Support%20Documents/TechnicalDocs/AN619.pdf
 enum {
@@ -128,19 +130,13 @@ void si5351_Init(int32_t correction) {
 
 // 设置指定PLL的倍频参数
 void si5351_SetupPLL(si5351PLL_t pll, si5351PLLConfig_t* conf) {
-    int32_t P1, P2, P3;
-    int32_t mult = conf->mult;
-    int32_t num = conf->num;
-    int32_t denom = conf->denom;
+    uint8_t regs[SI5351_BULK_REGS];
 
-    P1 = 128 * mult + (128 * num)/denom - 512;
-    // P2 = 128 * num - denom * ((128 * num)/denom);
-    P2 = (128 * num) % denom;
-    P3 = denom;
+    si5351_PLLRegs(conf, regs);
 
     // 获取PLL寄存器的基地址
-    uint8_t baseaddr = (pll == SI5351_PLL_A ? 26 : 34);
-    si5351_writeBulk(baseaddr, P1, P2, P3, 0, 0);
+    uint8_t baseaddr = (pll == SI5351_PLL_A ? SI5351_PLLA_BASE : SI5351_PLLB_BASE);
+    si5351_writeRegs(baseaddr, regs);
 
     // 复位两个PLL
     si5351_write(SI5351_REGISTER_177_PLL_RESET, (1<<7) | (1<<5) );
@@ -151,9 +147,7 @@ void si5351_SetupPLL(si5351PLL_t pll, si5351PLLConfig_t* conf) {
 int si5351_SetupOutput(uint8_t output, si5351PLL_t pllSource, si5351DriveStrength_t driveStrength, si5351OutputConfig_t* conf, uint8_t phaseOffset) {
     int32_t div = conf->div;
     int32_t num = conf->num;
-    int32_t denom = conf->denom;
-    uint8_t divBy4 = 0;
-    int32_t P1, P2, P3;
+    uint8_t regs[SI5351_BULK_REGS];
 
     if(output > 2) {
         return 1;
@@ -164,18 +158,7 @@ int si5351_SetupOutput(uint8_t output, si5351PLL_t pllSource, si5351DriveStrengt
         return 2;
     }
 
-    if(div == 4) {
-        // 特殊DIVBY4情况，详见AN619 4.1.3
-        P1 = 0;
-        P2 = 0;
-        P3 = 1;
-        divBy4 = 0x3;
-    } else {
-        P1 = 128 * div + ((128 * num)/denom) - 512;
-        // P2 = 128 * num - denom * (128 * num)/denom;
-        P2 = (128 * num) % denom;
-        P3 = denom;
-    }
+    si5351_OutputRegs(conf, regs);
 
     // 获取对应通道的寄存器地址
     uint8_t baseaddr = 0;
@@ -199,21 +182,64 @@ int si5351_SetupOutput(uint8_t output, si5351PLL_t pllSource, si5351DriveStrengt
         break;
     }
 
+    si5351_write(clkControlRegister, si5351_ClkControl(pllSource, driveStrength, conf));
+    si5351_writeRegs(baseaddr, regs);
+    si5351_write(phaseOffsetRegister, (phaseOffset & 0x7F));
+
+    return 0;
+}
+
+// 计算CLKx控制寄存器（16~18）的取值。
+uint8_t si5351_ClkControl(si5351PLL_t pllSource, si5351DriveStrength_t driveStrength, const si5351OutputConfig_t* conf) {
     uint8_t clkControl = 0x0C | driveStrength; // 时钟不反相，输出使能
     if(pllSource == SI5351_PLL_B) {
         clkControl |= (1 << 5); // 使用PLLB
     }
 
-    if((conf->allowIntegerMode) && ((num == 0)||(div == 4))) {
+    if((conf->allowIntegerMode) && ((conf->num == 0)||(conf->div == 4))) {
         // 使用整数模式
         clkControl |= (1 << 6);
     }
+    return clkControl;
+}
 
-    si5351_write(clkControlRegister, clkControl);
-    si5351_writeBulk(baseaddr, P1, P2, P3, divBy4, conf->rdiv);
-    si5351_write(phaseOffsetRegister, (phaseOffset & 0x7F));
+// 计算PLL的8字节寄存器映像（寄存器26~33或34~41）。
+void si5351_PLLRegs(const si5351PLLConfig_t* conf, uint8_t* regs) {
+    int32_t P1, P2, P3;
+    int32_t mult = conf->mult;
+    int32_t num = conf->num;
+    int32_t denom = conf->denom;
 
-    return 0;
+    P1 = 128 * mult + (128 * num)/denom - 512;
+    // P2 = 128 * num - denom * ((128 * num)/denom);
+    P2 = (128 * num) % denom;
+    P3 = denom;
+
+    si5351_PackRegs(P1, P2, P3, 0, 0, regs);
+}
+
+// 计算MultiSynth的8字节寄存器映像（寄存器42~49、50~57或58~65）。
+void si5351_OutputRegs(const si5351OutputConfig_t* conf, uint8_t* regs) {
+    int32_t div = conf->div;
+    int32_t num = conf->num;
+    int32_t denom = conf->denom;
+    uint8_t divBy4 = 0;
+    int32_t P1, P2, P3;
+
+    if(div == 4) {
+        // 特殊DIVBY4情况，详见AN619 4.1.3
+        P1 = 0;
+        P2 = 0;
+        P3 = 1;
+        divBy4 = 0x3;
+    } else {
+        P1 = 128 * div + ((128 * num)/denom) - 512;
+        // P2 = 128 * num - denom * (128 * num)/denom;
+        P2 = (128 * num) % denom;
+        P3 = denom;
+    }
+
+    si5351_PackRegs(P1, P2, P3, divBy4, conf->rdiv, regs);
 }
 
 // 计算给定Fclk（范围8_000~160_000_000）下的PLL、MS和RDiv参数。
@@ -283,6 +309,97 @@ void si5351_Calc(int32_t Fclk, si5351PLLConfig_t* pll_conf, si5351OutputConfig_t
     out_conf->denom = z;
 }
 
+const uint8_t si5351_ToneMults[SI5351_TONE_MULTS] = {36, 35, 34, 33, 32, 31, 30, 29, 28, 27, 26, 25, 24};
+
+uint64_t si5351_ToneCenti(uint64_t FclkCenti, uint8_t k) {
+    return FclkCenti + (k * SI5351_TONE_SPACING_NUM + SI5351_TONE_SPACING_DEN / 2) / SI5351_TONE_SPACING_DEN;
+}
+
+// 把MultiSynth输出抬到60MHz以下的最高处：音调在128·MS上的跨度约为128·MS·Δf/F，
+// 分频比越小越不容易跨过P1的整数边界。上限按600MHz PLL、MS>=8取75MHz
+int si5351_ToneRDiv(uint64_t FclkCenti) {
+    int rdiv = SI5351_R_DIV_1;
+    if(FclkCenti > 7500000000ULL) {
+        return -1;
+    }
+    while(rdiv < SI5351_R_DIV_128 && (FclkCenti << (rdiv + 1)) <= 6000000000ULL) {
+        rdiv++;
+    }
+    return rdiv;
+}
+
+// MultiSynth输出频率（含R分频倍数），并应用校正
+static uint64_t toneMSFreq(uint64_t FclkCenti, uint8_t rdiv) {
+    int64_t f = (int64_t)(FclkCenti << rdiv);
+    return (uint64_t)(f - (f * si5351Correction) / 100000000LL);
+}
+
+uint64_t si5351_ToneX(const si5351PLLConfig_t* pll_conf, uint64_t FclkCenti, uint8_t rdiv) {
+    const uint64_t Fxtal = 25000000ULL;
+    uint64_t F = toneMSFreq(FclkCenti, rdiv);
+    if(pll_conf->num == 0) {
+        uint64_t num = 128ULL * SI5351_TONE_P3 * Fxtal * (uint64_t)pll_conf->mult * 100ULL;
+        return (num + F / 2) / F;
+    }
+    // 均为正数，+0.5取整即四舍五入（不依赖libm）
+    return (uint64_t)(128.0 * SI5351_TONE_P3 * Fxtal *
+                      (pll_conf->mult + (double)pll_conf->num / pll_conf->denom) * 100.0 / F + 0.5);
+}
+
+void si5351_TonePLL(uint64_t FclkCenti, uint8_t rdiv, si5351PLLConfig_t* pll_conf) {
+    const double Fxtal = 25000000.0;
+    double F = (double)toneMSFreq(FclkCenti, rdiv);
+    double ms128 = 128.0 * Fxtal * 36 * 100.0 / F;
+    double mult = ((double)(uint64_t)ms128 - 0.25) * F / (128.0 * 100.0 * Fxtal);
+    pll_conf->mult = (int32_t)mult;
+    pll_conf->num = (int32_t)((mult - pll_conf->mult) * SI5351_TONE_P3 + 0.5);
+    pll_conf->denom = SI5351_TONE_P3;
+}
+
+void si5351_ToneRegs(uint64_t X, uint8_t rdiv, uint8_t* regs) {
+    si5351_PackRegs((int32_t)(X / SI5351_TONE_P3) - 512, (int32_t)(X % SI5351_TONE_P3), SI5351_TONE_P3, 0,
+                    (si5351RDiv_t)rdiv, regs);
+}
+
+int si5351_ToneTable(uint64_t FclkCenti, uint8_t tones, si5351DriveStrength_t driveStrength, uint8_t* pllRegs,
+                     uint8_t toneRegs[][SI5351_BULK_REGS], uint8_t* clkControl) {
+    si5351PLLConfig_t pll_conf = {si5351_ToneMults[0], 0, 1};
+    int rdiv = si5351_ToneRDiv(si5351_ToneCenti(FclkCenti, tones - 1));
+    uint64_t X = 0;
+    uint8_t k;
+
+    if(tones == 0 || rdiv < 0 || FclkCenti < 400000ULL) {
+        return -1;
+    }
+    for(k = 0; k < tones; k++) {
+        X = si5351_ToneX(&pll_conf, si5351_ToneCenti(FclkCenti, k), (uint8_t)rdiv);
+        si5351_ToneRegs(X, (uint8_t)rdiv, toneRegs[k]);
+    }
+    si5351OutputConfig_t out_conf = {0, (int32_t)(X / (128 * (uint64_t)SI5351_TONE_P3)), 0, 1, (si5351RDiv_t)rdiv};
+    si5351_PLLRegs(&pll_conf, pllRegs);
+    *clkControl = si5351_ClkControl(SI5351_PLL_A, driveStrength, &out_conf);
+    return 0;
+}
+
+// 8字节映像中的a + b/c = (P1 + 512 + P2/P3) / 128，布局见si5351_PackRegs()
+double si5351_RegsRatio(const uint8_t* regs) {
+    if(((regs[2] >> 2) & 0x3) == 0x3) {
+        return 4.0;
+    }
+    uint32_t P1 = ((uint32_t)(regs[2] & 0x03) << 16) | ((uint32_t)regs[3] << 8) | regs[4];
+    uint32_t P2 = ((uint32_t)(regs[5] & 0x0F) << 16) | ((uint32_t)regs[6] << 8) | regs[7];
+    uint32_t P3 = ((uint32_t)(regs[5] & 0xF0) << 12) | ((uint32_t)regs[0] << 8) | regs[1];
+    return (P1 + 512 + (double)P2 / P3) / 128.0;
+}
+
+uint32_t si5351_RegsRDiv(const uint8_t* msRegs) {
+    return 1U << ((msRegs[2] >> 4) & 0x7);
+}
+
+double si5351_RegsFreq(const uint8_t* pllRegs, const uint8_t* msRegs) {
+    return 25000000.0 * si5351_RegsRatio(pllRegs) / si5351_RegsRatio(msRegs) / si5351_RegsRDiv(msRegs);
+}
+
 // si5351_CalcIQ()用于寻找能在两个通道间产生90°相移的PLL和MS参数，
 // 若分别为这两个通道传入0和(uint8_t)out_conf.div作为phaseOffset即可。
 // 两通道需使用同一PLL。Fclk范围1.4MHz~100MHz，假设`correction`正确，实际频率误差小于4Hz。
@@ -349,27 +466,246 @@ void si5351_EnableOutputs(uint8_t enabled) {
     si5351_write(SI5351_REGISTER_3_OUTPUT_ENABLE_CONTROL, ~enabled);
 }
 
-// 通过I2C写入8位寄存器值。
+#ifdef SI5351_QUEUED
+/*
+ * 写寄存器队列。每段为一次I2C连续写（寄存器地址自动递增），相邻地址的写入
+ * 自动并入同一段。批处理期间只入队，si5351_BatchCommit()后由传输层逐段发送：
+ * 同步传输在start()内完成，异步传输在中断中调用si5351_TransferDone()推进。
+ * 批处理打开前会等待上一批发送完毕，因此入队与中断推进不会同时修改队列。
+ */
+#define SI5351_QUEUE_LEN 16
+#define SI5351_SEGMENT_MAX 24 // MultiSynth0~2（寄存器42~65）可作为一段写入
+
+typedef struct {
+    uint8_t reg;
+    uint8_t len;
+    uint8_t data[SI5351_SEGMENT_MAX];
+} si5351Segment_t;
+
+static si5351Segment_t queue[SI5351_QUEUE_LEN];
+static volatile uint8_t queueHead, queueCount;
+static volatile uint8_t queueRunning;
+static volatile uint8_t inStart, donePending;
+static volatile si5351I2CStatus_t queueStatus;
+static uint8_t batchOpen;
+static uint32_t segmentStart;
+static si5351DoneCallback_t doneCallback;
+static void* doneContext;
+
+#ifdef SI5351_MOCK
+static const si5351Transport_t* transport = &si5351_TransportMock;
+#else
+static const si5351Transport_t* transport = &si5351_TransportBlocking;
+#endif
+
+void si5351_SetTransport(const si5351Transport_t* t) {
+    si5351_Wait();
+    transport = t;
+}
+
+// 结束当前批：出错时丢弃剩余的段
+static void queueFinish(si5351I2CStatus_t status) {
+    si5351DoneCallback_t cb = doneCallback;
+    queueStatus = status;
+    queueCount = 0;
+    queueHead = 0;
+    queueRunning = 0;
+    doneCallback = 0;
+    if(cb) {
+        cb(status, doneContext);
+    }
+}
+
+// 依次启动队首的段；同步传输在start()里就已完成，直接继续下一段
+static void queueRun(void) {
+    while(queueRunning && queueCount) {
+        si5351Segment_t* seg = &queue[queueHead];
+        int ret;
+        donePending = 0;
+        inStart = 1;
+        segmentStart = transport->millis();
+        ret = transport->start(seg->reg, seg->data, seg->len);
+        inStart = 0;
+        if(ret != 0) {
+            queueFinish(SI5351_I2C_ERROR);
+            return;
+        }
+        if(!donePending) {
+            return; // 异步：等待中断
+        }
+        queueHead = (queueHead + 1) % SI5351_QUEUE_LEN;
+        if(--queueCount == 0) {
+            queueFinish(SI5351_I2C_OK);
+        }
+    }
+}
+
+// 传输层在一段写完（或出错）时调用，可在中断中调用
+void si5351_TransferDone(si5351I2CStatus_t status) {
+    if(!queueRunning) {
+        return;
+    }
+    if(status != SI5351_I2C_OK) {
+        queueFinish(status);
+        return;
+    }
+    if(inStart) {
+        donePending = 1;
+        return;
+    }
+    queueHead = (queueHead + 1) % SI5351_QUEUE_LEN;
+    if(--queueCount == 0) {
+        queueFinish(SI5351_I2C_OK);
+        return;
+    }
+    queueRun();
+}
+
+// 入队，与队尾的段地址相邻且未满时直接追加。队满返回1
+static int queueAppend(uint8_t reg, const uint8_t* data, uint8_t len) {
+    while(len) {
+        si5351Segment_t* tail = queueCount ? &queue[(queueHead + queueCount - 1) % SI5351_QUEUE_LEN] : 0;
+        if(tail && (uint8_t)(tail->reg + tail->len) == reg && tail->len < SI5351_SEGMENT_MAX) {
+            tail->data[tail->len++] = *data++;
+            reg++;
+            len--;
+            continue;
+        }
+        if(queueCount == SI5351_QUEUE_LEN) {
+            return 1;
+        }
+        tail = &queue[(queueHead + queueCount) % SI5351_QUEUE_LEN];
+        tail->reg = reg;
+        tail->len = 0;
+        queueCount++;
+    }
+    return 0;
+}
+
+// 检查超时：当前段超过SI5351_I2C_TIMEOUT_MS仍未完成时中止传输并结束本批。
+// 返回SI5351_I2C_BUSY或上一批的结果。异步使用时应在主循环中定期调用
+si5351I2CStatus_t si5351_Poll(void) {
+    if(queueRunning && (uint32_t)(transport->millis() - segmentStart) > SI5351_I2C_TIMEOUT_MS) {
+        transport->abort();
+        if(queueRunning) {
+            queueFinish(SI5351_I2C_TIMEOUT);
+        }
+    }
+    return queueRunning ? SI5351_I2C_BUSY : queueStatus;
+}
+
+// 等待当前批发送完毕（有超时），返回其结果
+si5351I2CStatus_t si5351_Wait(void) {
+    si5351I2CStatus_t status;
+    while((status = si5351_Poll()) == SI5351_I2C_BUSY) { }
+    return status;
+}
+
+// 打开批处理：之后的写寄存器调用只入队。先等待上一批完成并返回其结果
+si5351I2CStatus_t si5351_BatchBegin(void) {
+    si5351I2CStatus_t status = si5351_Wait();
+    queueStatus = SI5351_I2C_OK;
+    batchOpen = 1;
+    return status;
+}
+
+// 提交批处理并立即返回：done（可为空）在整批完成或出错时调用，可能在中断中。
+// 同步传输下返回时已发送完毕。入队时队满则整批丢弃，返回SI5351_I2C_FULL
+si5351I2CStatus_t si5351_BatchCommit(si5351DoneCallback_t done, void* ctx) {
+    batchOpen = 0;
+    doneContext = ctx;
+    if(queueStatus != SI5351_I2C_OK || queueCount == 0) {
+        si5351I2CStatus_t status = queueStatus;
+        doneCallback = done;
+        queueFinish(status);
+        return status;
+    }
+    doneCallback = done;
+    queueRunning = 1;
+    queueRun();
+    return queueRunning ? SI5351_I2C_BUSY : queueStatus;
+}
+
+// 写入len个连续寄存器。批处理中只入队，否则作为单独一批发送并等待完成。成功返回0
+int si5351_writeBurst(uint8_t reg, const uint8_t* data, uint8_t len) {
+    if(batchOpen) {
+        if(queueAppend(reg, data, len) != 0) {
+            queueStatus = SI5351_I2C_FULL;
+            return 1;
+        }
+        return 0;
+    }
+    si5351_BatchBegin();
+    if(queueAppend(reg, data, len) != 0) {
+        queueStatus = SI5351_I2C_FULL;
+    }
+    si5351_BatchCommit(0, 0);
+    return si5351_Wait() == SI5351_I2C_OK ? 0 : 1;
+}
+
+// 写入8位寄存器值。
 void si5351_write(uint8_t reg, uint8_t value) {
-    while (HAL_I2C_IsDeviceReady(&I2C_HANDLE, (uint16_t)(SI5351_ADDRESS<<1), 3, HAL_MAX_DELAY) != HAL_OK) { }
+    si5351_writeBurst(reg, &value, 1);
+}
+#else
+// 主机端工具：逐个交给自行提供的si5351_write()，批处理接口直接完成
+int si5351_writeBurst(uint8_t reg, const uint8_t* data, uint8_t len) {
+    uint8_t i;
+    for(i = 0; i < len; i++) {
+        si5351_write(reg + i, data[i]);
+    }
+    return 0;
+}
+
+si5351I2CStatus_t si5351_BatchBegin(void) {
+    return SI5351_I2C_OK;
+}
+
+si5351I2CStatus_t si5351_BatchCommit(si5351DoneCallback_t done, void* ctx) {
+    if(done) {
+        done(SI5351_I2C_OK, ctx);
+    }
+    return SI5351_I2C_OK;
+}
+
+si5351I2CStatus_t si5351_Poll(void) {
+    return SI5351_I2C_OK;
+}
+
+si5351I2CStatus_t si5351_Wait(void) {
+    return SI5351_I2C_OK;
+}
+#endif
+
+// 把P1/P2/P3、DIVBY4和R分频打包为8字节寄存器映像，布局见AN619。
+void si5351_PackRegs(int32_t P1, int32_t P2, int32_t P3, uint8_t divBy4, si5351RDiv_t rdiv, uint8_t* regs) {
+    regs[0] = (P3 >> 8) & 0xFF;
+    regs[1] = P3 & 0xFF;
+    regs[2] = ((P1 >> 16) & 0x3) | ((divBy4 & 0x3) << 2) | ((rdiv & 0x7) << 4);
+    regs[3] = (P1 >> 8) & 0xFF;
+    regs[4] = P1 & 0xFF;
+    regs[5] = ((P3 >> 12) & 0xF0) | ((P2 >> 16) & 0xF);
+    regs[6] = (P2 >> 8) & 0xFF;
+    regs[7] = P2 & 0xFF;
+}
+
+// 写入一组预先计算好的8字节寄存器映像（PLL或MultiSynth）。
+void si5351_writeRegs(uint8_t baseaddr, const uint8_t* regs) {
+    si5351_writeBurst(baseaddr, regs, SI5351_BULK_REGS);
+}
 
-    HAL_I2C_Mem_Write(&I2C_HANDLE,                  // I2C句柄
-                      (uint8_t)(SI5351_ADDRESS<<1), // I2C地址，左对齐
-                      (uint8_t)reg,                 // 寄存器地址
-                      I2C_MEMADD_SIZE_8BIT,         // si5351使用8位寄存器地址
-                      (uint8_t*)(&value),           // 要写入的数据
-                      1,                            // 写入字节数
-                      HAL_MAX_DELAY);               // 超时时间
+void si5351_StartOutput(si5351PLL_t pll, const uint8_t* pllRegs, uint8_t output, const uint8_t* msRegs,
+                        uint8_t clkControl) {
+    si5351_writeRegs(pll == SI5351_PLL_A ? SI5351_PLLA_BASE : SI5351_PLLB_BASE, pllRegs);
+    si5351_write(SI5351_PLL_RESET, SI5351_PLL_RESET_AB);
+    si5351_writeRegs(SI5351_MS_BASE(output), msRegs);
+    si5351_write(SI5351_CLK_CONTROL(output), clkControl);
+    si5351_EnableOutputs(1 << output);
 }
 
 // _SetupPLL和_SetupOutput的通用写寄存器代码
 void si5351_writeBulk(uint8_t baseaddr, int32_t P1, int32_t P2, int32_t P3, uint8_t divBy4, si5351RDiv_t rdiv) {
-    si5351_write(baseaddr,   (P3 >> 8) & 0xFF);
-    si5351_write(baseaddr+1, P3 & 0xFF);
-    si5351_write(baseaddr+2, ((P1 >> 16) & 0x3) | ((divBy4 & 0x3) << 2) | ((rdiv & 0x7) << 4));
-    si5351_write(baseaddr+3, (P1 >> 8) & 0xFF);
-    si5351_write(baseaddr+4, P1 & 0xFF);
-    si5351_write(baseaddr+5, ((P3 >> 12) & 0xF0) | ((P2 >> 16) & 0xF));
-    si5351_write(baseaddr+6, (P2 >> 8) & 0xFF);
-    si5351_write(baseaddr+7, P2 & 0xFF);
+    uint8_t regs[SI5351_BULK_REGS];
+    si5351_PackRegs(P1, P2, P3, divBy4, rdiv, regs);
+    si5351_writeRegs(baseaddr, regs);
 }
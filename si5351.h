@@ -2,6 +2,20 @@
 #ifndef _SI5351_H_
 #define _SI5351_H_
 
+#include <stdint.h>
+
+// PLL/MultiSynth参数寄存器组的长度及PLL寄存器基地址
+#define SI5351_BULK_REGS 8
+#define SI5351_PLLA_BASE 26
+#define SI5351_PLLB_BASE 34
+
+// 按寄存器映像写入时用到的地址和取值（AN619），o为输出序号0~5
+#define SI5351_MS_BASE(o)       (42 + SI5351_BULK_REGS * (o)) // CLKo的MultiSynth参数
+#define SI5351_CLK_CONTROL(o)   (16 + (o))                    // CLKo控制
+#define SI5351_CLK_POWER_DOWN   0x80                          // CLKo控制：关断
+#define SI5351_PLL_RESET        177
+#define SI5351_PLL_RESET_AB     ((1 << 7) | (1 << 5))         // 同时复位PLLA和PLLB
+
 // PLL选择枚举
 typedef enum {
     SI5351_PLL_A = 0,
@@ -76,7 +90,133 @@ void si5351_Calc(int32_t Fclk, si5351PLLConfig_t* pll_conf, si5351OutputConfig_t
  */
 void si5351_CalcIQ(int32_t Fclk, si5351PLLConfig_t* pll_conf, si5351OutputConfig_t* out_conf);
 
+/*
+ * 多音调的MultiSynth计算（wspr_ramp.c、wspr_multi.c使用）。P3固定为SI5351_TONE_P3，
+ * X = 128·P3·Fpll/F = P3·(P1+512) + P2，相邻音调只有P2不同（P1相同时）。
+ *   si5351_ToneRDiv()  把MultiSynth输出抬到60MHz以下最高处的R分频，超过75MHz返回-1
+ *   si5351_ToneX()     频率FclkCenti（0.01Hz，乘以2^rdiv并应用校正后）在给定PLL下的X
+ *   si5351_TonePLL()   略低于900MHz的小数PLL，使FclkCenti的128·MS落在P1区间的3/4处，
+ *                      用于F与25MHz成简单倍数、整数PLL下音调总跨P1边界的情况
+ *   si5351_ToneRegs()  X与R分频打包为8字节MultiSynth寄存器映像
+ */
+#define SI5351_TONE_P3 0xFFFFF
+
+// WSPR音调间隔为12000/8192 Hz，这里以0.01Hz为单位
+#define SI5351_TONE_SPACING_NUM 1200000ULL
+#define SI5351_TONE_SPACING_DEN 8192ULL
+// 音调k的频率（0.01Hz，四舍五入）
+uint64_t si5351_ToneCenti(uint64_t FclkCenti, uint8_t k);
+
+// 多音调方案依次尝试的PLL整数倍频（900MHz往下到600MHz）
+#define SI5351_TONE_MULTS 13
+extern const uint8_t si5351_ToneMults[SI5351_TONE_MULTS];
+
+int si5351_ToneRDiv(uint64_t FclkCenti);
+uint64_t si5351_ToneX(const si5351PLLConfig_t* pll_conf, uint64_t FclkCenti, uint8_t rdiv);
+void si5351_TonePLL(uint64_t FclkCenti, uint8_t rdiv, si5351PLLConfig_t* pll_conf);
+void si5351_ToneRegs(uint64_t X, uint8_t rdiv, uint8_t* regs);
+
+/*
+ * 单路输出的WSPR音调表格：PLLA固定为900MHz整数倍频，音调k为si5351_ToneCenti(FclkCenti, k)，
+ * 由上面的si5351_Tone*()求出各音调的MultiSynth映像（共用PLL和R分频）。写出PLL寄存器映像、
+ * tones个MultiSynth映像和CLK控制寄存器的值。支持4kHz~75MHz，超出范围返回-1
+ */
+int si5351_ToneTable(uint64_t FclkCenti, uint8_t tones, si5351DriveStrength_t driveStrength, uint8_t* pllRegs,
+                     uint8_t toneRegs[][SI5351_BULK_REGS], uint8_t* clkControl);
+
+/*
+ * 寄存器映像解码，用于独立校验表格：
+ *   si5351_RegsRatio()  PLL倍频或MultiSynth分频比a + b/c（DIVBY4时为4）
+ *   si5351_RegsRDiv()   MultiSynth映像中的R分频倍数（1~128）
+ *   si5351_RegsFreq()   输出频率（Hz），按25MHz晶振、未应用校正
+ */
+double si5351_RegsRatio(const uint8_t* regs);
+uint32_t si5351_RegsRDiv(const uint8_t* msRegs);
+double si5351_RegsFreq(const uint8_t* pllRegs, const uint8_t* msRegs);
+
 void si5351_SetupPLL(si5351PLL_t pll, si5351PLLConfig_t* conf);
 int si5351_SetupOutput(uint8_t output, si5351PLL_t pllSource, si5351DriveStrength_t driveStength, si5351OutputConfig_t* conf, uint8_t phaseOffset);
 
+/*
+ * 寄存器映像接口：只做计算、不访问I2C，供预计算表格（见wspr_tablegen.c）
+ * 和固件按表发射使用。regs长度为SI5351_BULK_REGS。
+ */
+void si5351_PLLRegs(const si5351PLLConfig_t* conf, uint8_t* regs);
+void si5351_OutputRegs(const si5351OutputConfig_t* conf, uint8_t* regs);
+uint8_t si5351_ClkControl(si5351PLL_t pllSource, si5351DriveStrength_t driveStrength, const si5351OutputConfig_t* conf);
+void si5351_PackRegs(int32_t P1, int32_t P2, int32_t P3, uint8_t divBy4, si5351RDiv_t rdiv, uint8_t* regs);
+void si5351_writeRegs(uint8_t baseaddr, const uint8_t* regs);
+// 按预先算好的映像启动一路输出：写PLL寄存器并复位PLL，写CLKx的MultiSynth和控制寄存器，只使能该输出
+void si5351_StartOutput(si5351PLL_t pll, const uint8_t* pllRegs, uint8_t output, const uint8_t* msRegs,
+                        uint8_t clkControl);
+void si5351_write(uint8_t reg, uint8_t value);
+// 一次I2C事务连续写入寄存器reg起的len个字节，成功返回0
+int si5351_writeBurst(uint8_t reg, const uint8_t* data, uint8_t len);
+
+/*
+ * I2C传输层。所有寄存器写入先进入队列（相邻地址合并为一次连续写），
+ * 再交给可替换的传输实现发送，见si5351_transport.c：
+ *   si5351_TransportBlocking  HAL阻塞写，有超时（固件默认）
+ *   si5351_TransportIT        HAL中断写
+ *   si5351_TransportDMA       HAL DMA写
+ *   si5351_TransportMock      主机端模拟（定义SI5351_MOCK时为默认）
+ *
+ * 不打开批处理时每次写寄存器立即发送并等待完成，与原来的阻塞行为一致。
+ * 需要不阻塞时把一组配置放进批处理：
+ *   si5351_BatchBegin();
+ *   si5351_SetupPLL(SI5351_PLL_A, &pll_conf);
+ *   si5351_SetupOutput(0, SI5351_PLL_A, drive, &out_conf, 0);
+ *   si5351_EnableOutputs(1 << 0);
+ *   si5351_BatchCommit(done, ctx);   // 立即返回，完成后调用done
+ * 异步传输下需在主循环中调用si5351_Poll()检查超时。
+ */
+#ifndef SI5351_I2C_TIMEOUT_MS
+#define SI5351_I2C_TIMEOUT_MS 10
+#endif
+
+typedef enum {
+    SI5351_I2C_OK = 0,
+    SI5351_I2C_BUSY,    // 正在发送
+    SI5351_I2C_ERROR,   // NACK或总线错误
+    SI5351_I2C_TIMEOUT, // 超过SI5351_I2C_TIMEOUT_MS未完成
+    SI5351_I2C_FULL,    // 批处理超出队列容量，整批未发送
+} si5351I2CStatus_t;
+
+typedef void (*si5351DoneCallback_t)(si5351I2CStatus_t status, void* ctx);
+
+typedef struct {
+    // 开始一次连续写；成功启动返回0。完成时（同步实现在返回前）调用si5351_TransferDone()
+    int (*start)(uint8_t reg, const uint8_t* data, uint8_t len);
+    // 超时时中止正在进行的传输
+    void (*abort)(void);
+    // 毫秒计时
+    uint32_t (*millis)(void);
+} si5351Transport_t;
+
+extern const si5351Transport_t si5351_TransportBlocking;
+extern const si5351Transport_t si5351_TransportIT;
+extern const si5351Transport_t si5351_TransportDMA;
+extern const si5351Transport_t si5351_TransportMock;
+
+void si5351_SetTransport(const si5351Transport_t* transport);
+si5351I2CStatus_t si5351_BatchBegin(void);
+si5351I2CStatus_t si5351_BatchCommit(si5351DoneCallback_t done, void* ctx);
+si5351I2CStatus_t si5351_Poll(void);
+si5351I2CStatus_t si5351_Wait(void);
+void si5351_TransferDone(si5351I2CStatus_t status);
+
+#ifdef SI5351_MOCK
+// 模拟传输：寄存器映像与统计
+extern uint8_t si5351_MockRegs[256];
+extern uint32_t si5351_MockTransfers, si5351_MockBytes;
+// 最近一次完成的传输的起始寄存器和字节数
+extern uint8_t si5351_MockLastReg, si5351_MockLastLen;
+// async为1时传输挂起，直到si5351_MockComplete()；failAfter>=0时第failAfter次传输NACK
+void si5351_MockConfigure(uint8_t async, int32_t failAfter);
+// 完成挂起的传输，没有挂起的传输时返回0
+int si5351_MockComplete(void);
+#endif
+
+extern int32_t si5351Correction;
+
 #endif
@@ -0,0 +1,158 @@
+// vim: set ai et ts=4 sw=4:
+
+/*
+ * si5351.c的I2C传输实现：HAL阻塞、中断、DMA三种，以及主机端模拟。
+ * 选择方法见si5351.h，用si5351_SetTransport()切换。
+ *
+ * 中断/DMA传输需要HAL的I2C完成/错误回调，本文件定义了
+ * HAL_I2C_MemTxCpltCallback和HAL_I2C_ErrorCallback；若工程中已有这两个回调，
+ * 定义SI5351_NO_HAL_CALLBACKS并在自己的回调里调用si5351_TransferDone()。
+ * 超时后用HAL_I2C_DeInit()/HAL_I2C_Init()复位I2C，需要HAL_I2C_MspInit()能重新配置引脚、DMA和中断
+ * （CubeMX生成的代码即如此）。
+ *
+ * 模拟传输的检查见wspr_i2c.c（wspr_i2c --check）。
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <si5351.h>
+
+#define SI5351_ADDRESS 0x60
+
+#ifndef SI5351_NO_HAL
+// 针对你的MCU进行更改
+#include "stm32f1xx_hal.h"
+#define I2C_HANDLE hi2c1
+extern I2C_HandleTypeDef I2C_HANDLE;
+
+static uint32_t halMillis(void) {
+    return HAL_GetTick();
+}
+
+// 超时后恢复总线。HAL_I2C_Master_Abort_IT只对Master_Transmit/Receive_IT有效，对Mem_Write_IT/DMA
+// 不起作用，因此先停掉DMA，再反初始化并重新初始化I2C（软件复位外设、清除BUSY和HAL状态，
+// 并关闭中断），之后迟到的完成回调不会推进下一批
+static void halRecover(void) {
+    if(I2C_HANDLE.hdmatx && HAL_I2C_GetState(&I2C_HANDLE) != HAL_I2C_STATE_READY) {
+        HAL_DMA_Abort(I2C_HANDLE.hdmatx);
+    }
+    HAL_I2C_DeInit(&I2C_HANDLE);
+    HAL_I2C_Init(&I2C_HANDLE);
+}
+
+static void halAbort(void) {
+    halRecover();
+}
+
+static void blockingAbort(void) {
+}
+
+// 阻塞：HAL_I2C_Mem_Write在超时内完成后直接报告结果，超时后恢复总线
+static int blockingStart(uint8_t reg, const uint8_t* data, uint8_t len) {
+    HAL_StatusTypeDef ret = HAL_I2C_Mem_Write(&I2C_HANDLE, (uint16_t)(SI5351_ADDRESS<<1), reg, I2C_MEMADD_SIZE_8BIT,
+                                              (uint8_t*)data, len, SI5351_I2C_TIMEOUT_MS);
+    if(ret == HAL_TIMEOUT) {
+        halRecover();
+    }
+    si5351_TransferDone(ret == HAL_OK ? SI5351_I2C_OK : ret == HAL_TIMEOUT ? SI5351_I2C_TIMEOUT : SI5351_I2C_ERROR);
+    return 0;
+}
+
+static int itStart(uint8_t reg, const uint8_t* data, uint8_t len) {
+    return HAL_I2C_Mem_Write_IT(&I2C_HANDLE, (uint16_t)(SI5351_ADDRESS<<1), reg, I2C_MEMADD_SIZE_8BIT,
+                                (uint8_t*)data, len) == HAL_OK ? 0 : 1;
+}
+
+// DMA直接读取队列中的数据，数据在本段完成前不会被修改
+static int dmaStart(uint8_t reg, const uint8_t* data, uint8_t len) {
+    return HAL_I2C_Mem_Write_DMA(&I2C_HANDLE, (uint16_t)(SI5351_ADDRESS<<1), reg, I2C_MEMADD_SIZE_8BIT,
+                                 (uint8_t*)data, len) == HAL_OK ? 0 : 1;
+}
+
+const si5351Transport_t si5351_TransportBlocking = {blockingStart, blockingAbort, halMillis};
+const si5351Transport_t si5351_TransportIT = {itStart, halAbort, halMillis};
+const si5351Transport_t si5351_TransportDMA = {dmaStart, halAbort, halMillis};
+
+#ifndef SI5351_NO_HAL_CALLBACKS
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef* hi2c) {
+    if(hi2c == &I2C_HANDLE) {
+        si5351_TransferDone(SI5351_I2C_OK);
+    }
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef* hi2c) {
+    if(hi2c == &I2C_HANDLE) {
+        si5351_TransferDone(SI5351_I2C_ERROR);
+    }
+}
+#endif
+
+#elif defined(SI5351_MOCK)
+
+uint8_t si5351_MockRegs[256];
+uint32_t si5351_MockTransfers, si5351_MockBytes;
+uint8_t si5351_MockLastReg, si5351_MockLastLen;
+
+static uint8_t mockAsync;
+static int32_t mockFailAfter = -1;
+static uint32_t mockClock;
+static struct {
+    uint8_t active;
+    uint8_t reg;
+    uint8_t len;
+    const uint8_t* data;
+} mockPending;
+
+void si5351_MockConfigure(uint8_t async, int32_t failAfter) {
+    mockAsync = async;
+    mockFailAfter = failAfter;
+}
+
+// 每次读取前进1ms，主机上轮询等待也会按调用次数超时
+static uint32_t mockMillis(void) {
+    return mockClock++;
+}
+
+static void mockApply(uint8_t reg, const uint8_t* data, uint8_t len) {
+    memcpy(&si5351_MockRegs[reg], data, len);
+    si5351_MockLastReg = reg;
+    si5351_MockLastLen = len;
+    si5351_MockTransfers++;
+    si5351_MockBytes += len;
+}
+
+static int mockStart(uint8_t reg, const uint8_t* data, uint8_t len) {
+    if(mockFailAfter >= 0 && si5351_MockTransfers == (uint32_t)mockFailAfter) {
+        mockFailAfter = -1;
+        si5351_TransferDone(SI5351_I2C_ERROR);
+        return 0;
+    }
+    if(mockAsync) {
+        mockPending.active = 1;
+        mockPending.reg = reg;
+        mockPending.len = len;
+        mockPending.data = data;
+        return 0;
+    }
+    mockApply(reg, data, len);
+    si5351_TransferDone(SI5351_I2C_OK);
+    return 0;
+}
+
+static void mockAbort(void) {
+    mockPending.active = 0;
+}
+
+int si5351_MockComplete(void) {
+    if(!mockPending.active) {
+        return 0;
+    }
+    mockPending.active = 0;
+    mockApply(mockPending.reg, mockPending.data, mockPending.len);
+    si5351_TransferDone(SI5351_I2C_OK);
+    return 1;
+}
+
+const si5351Transport_t si5351_TransportMock = {mockStart, mockAbort, mockMillis};
+
+#endif
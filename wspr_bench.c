@@ -0,0 +1,886 @@
+/*
+ * wspr_bench.c - 编码器与Si5351计算函数的微基准测试和回归门限
+ *
+ * 覆盖 wspr_encode、wspr_message_prep、wspr_bit_packing、convolve、
+ * wspr_interleave、wspr_merge_sync_vector、nhash_、si5351_Calc、si5351_CalcIQ，
+ * 以及wspr_mode.h通用流程下的WSPR和JT9编码。
+ * 消息相关的函数按语料分别计时：普通呼号、复合前缀、复合后缀、哈希呼号。
+ *
+ * 编译（目标名wspr_bench）：
+ *   gcc -O2 -DSI5351_NO_HAL -I. -o wspr_bench wspr_bench.c encode.c nhash.c si5351.c wspr_mode.c -lpthread
+ *
+ * 用法：
+ *   wspr_bench                          输出JSON到stdout
+ *   wspr_bench --compare base.json [-t 10]
+ *                                       与基线比较，ns/op增加超过t%（默认10）的项
+ *                                       标记为REGRESSION，存在回归时返回1
+ *   wspr_bench --check [N]              差分校验：用N条（默认200000）随机消息覆盖
+ *                                       wspr_bit_packing_r()的每个分支，比对
+ *                                       wspr_pack50()/wspr_convolve50()及wspr_encode()，
+ *                                       通用流程的WSPR模式与wspr_encode()比对，JT9模式
+ *                                       与基于convolve()的逐字节参考实现比对
+ *   wspr_bench --stack                  各入口函数在全部语料上的最坏栈用量
+ *
+ * 用 -DWSPR_ENCODE_SMALL 编译时 wspr_encode 走低RAM路径，可直接对比两种构建。
+ *
+ * 每项输出ns/op、cycles/op（x86上为TSC周期，其他平台为0）和栈用量。
+ * 栈用量的测法：在预先填充特征字节的独立线程栈上运行一次被测函数，
+ * 扫描被改写的深度，再减去空函数的基准深度。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#include "encode.h"
+#include "nhash.h"
+#include "si5351.h"
+#include "wspr_mode.h"
+
+#define MAX_RESULTS 64
+#define MIN_RUN_NS 20000000.0 // 每轮至少20ms
+#define RUNS 5
+#define PROBE_STACK_SIZE (64 * 1024)
+#define STACK_PATTERN 0xA5
+
+typedef struct {
+    const char *name;
+    const char *call;
+    const char *loc;
+    int8_t dbm;
+} corpus_entry_t;
+
+static const corpus_entry_t corpus[] = {
+    {"plain", "BI1TPH", "ON80", 10},
+    {"prefix", "PJ4/K1ABC", "FN42", 37},
+    {"suffix", "K1ABC/7", "FN42", 20},
+    {"hashed", "<BI1TPH>", "ON80AB", 10},
+};
+#define CORPUS_COUNT (sizeof(corpus) / sizeof(corpus[0]))
+
+static const int32_t bands[] = {
+    137500, 475700, 1838100, 3570100, 5288700, 7040100, 10140200,
+    14097100, 18106100, 21096100, 24926100, 28126100, 50294500,
+};
+#define BAND_COUNT (sizeof(bands) / sizeof(bands[0]))
+
+typedef struct {
+    char name[48];
+    double ns_per_op;
+    double cycles_per_op;
+    long stack_bytes;
+} bench_result_t;
+
+static bench_result_t results[MAX_RESULTS];
+static int result_count;
+
+// 防止被测调用被优化掉
+static volatile uint32_t sink;
+
+void si5351_write(uint8_t reg, uint8_t value) {
+    sink += reg ^ value;
+}
+
+typedef void (*bench_fn_t)(const void *arg);
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint64_t now_cycles(void) {
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// ---------------------------------------------------------------- 栈用量测量
+
+typedef struct {
+    bench_fn_t fn;
+    const void *arg;
+} probe_arg_t;
+
+static void *probe_thread(void *p) {
+    probe_arg_t *a = (probe_arg_t *)p;
+    if (a->fn) {
+        a->fn(a->arg);
+    }
+    return NULL;
+}
+
+// 返回在填充过特征字节的线程栈上运行fn所改写的深度（字节）
+static long stack_depth(bench_fn_t fn, const void *arg) {
+    static uint8_t stack[PROBE_STACK_SIZE] __attribute__((aligned(64)));
+    pthread_attr_t attr;
+    pthread_t th;
+    probe_arg_t a = {fn, arg};
+    long i;
+
+    memset(stack, STACK_PATTERN, sizeof(stack));
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack, sizeof(stack));
+    if (pthread_create(&th, &attr, probe_thread, &a) != 0) {
+        pthread_attr_destroy(&attr);
+        return -1;
+    }
+    pthread_join(th, NULL);
+    pthread_attr_destroy(&attr);
+
+    // 栈向下增长：从底部向上找第一个被改写的字节
+    for (i = 0; i < PROBE_STACK_SIZE; i++) {
+        if (stack[i] != STACK_PATTERN) break;
+    }
+    return PROBE_STACK_SIZE - i;
+}
+
+static long stack_usage(bench_fn_t fn, const void *arg) {
+    long base = stack_depth(NULL, NULL);
+    long used = stack_depth(fn, arg);
+    if (base < 0 || used < 0) return -1;
+    return used > base ? used - base : 0;
+}
+
+// ---------------------------------------------------------------- 计时
+
+static void run_bench(const char *name, bench_fn_t fn, const void *arg) {
+    bench_result_t *r;
+    double best_ns = 0, best_cycles = 0;
+    long iters = 1;
+    int run;
+
+    if (result_count >= MAX_RESULTS) return;
+    r = &results[result_count++];
+    snprintf(r->name, sizeof(r->name), "%s", name);
+
+    // 先确定迭代次数，使每轮不少于MIN_RUN_NS
+    for (;;) {
+        double t0 = now_ns();
+        long i;
+        for (i = 0; i < iters; i++) fn(arg);
+        if (now_ns() - t0 >= MIN_RUN_NS) break;
+        iters *= 2;
+    }
+
+    for (run = 0; run < RUNS; run++) {
+        double t0 = now_ns();
+        uint64_t c0 = now_cycles();
+        long i;
+        for (i = 0; i < iters; i++) fn(arg);
+        uint64_t c1 = now_cycles();
+        double ns = (now_ns() - t0) / iters;
+        double cycles = (double)(c1 - c0) / iters;
+        if (run == 0 || ns < best_ns) {
+            best_ns = ns;
+            best_cycles = cycles;
+        }
+    }
+
+    r->ns_per_op = best_ns;
+    r->cycles_per_op = best_cycles;
+    r->stack_bytes = stack_usage(fn, arg);
+}
+
+// ---------------------------------------------------------------- 被测函数
+
+static uint8_t bits[WSPR_BIT_COUNT];
+static uint8_t message[WSPR_MESSAGE_BYTE_SIZE];
+// 输出缓冲区放在静态区，栈用量只反映被测函数本身
+static uint8_t out_symbols[WSPR_SYMBOL_COUNT];
+
+static void b_encode(const void *arg) {
+    const corpus_entry_t *e = (const corpus_entry_t *)arg;
+    wspr_encode(e->call, e->loc, e->dbm, out_symbols);
+    sink += out_symbols[0];
+}
+
+static void b_encode_inplace(const void *arg) {
+    const corpus_entry_t *e = (const corpus_entry_t *)arg;
+    wspr_encode_inplace(e->call, e->loc, e->dbm, out_symbols);
+    sink += out_symbols[0];
+}
+
+static void prep(const corpus_entry_t *e) {
+    char call[13];
+    char loc[7];
+    strncpy(call, e->call, 12);
+    call[12] = 0;
+    strncpy(loc, e->loc, 6);
+    loc[6] = 0;
+    wspr_message_prep(call, loc, e->dbm);
+}
+
+static void b_message_prep(const void *arg) {
+    prep((const corpus_entry_t *)arg);
+}
+
+static void b_bit_packing(const void *arg) {
+    (void)arg;
+    wspr_bit_packing(message);
+    sink += message[0];
+}
+
+static wspr_message_t corpus_msg[CORPUS_COUNT];
+static uint64_t message_word;
+
+static void b_pack50(const void *arg) {
+    message_word = wspr_pack50((const wspr_message_t *)arg);
+    sink += (uint32_t)message_word;
+}
+
+static void b_convolve50(const void *arg) {
+    (void)arg;
+    wspr_convolve50(message_word, bits);
+    sink += bits[0];
+}
+
+static wspr_plane_t plane_bits, plane_interleaved;
+
+static void b_encode_plane(const void *arg) {
+    const corpus_entry_t *e = (const corpus_entry_t *)arg;
+    wspr_encode_plane(e->call, e->loc, e->dbm, &plane_interleaved);
+    sink += (uint32_t)plane_interleaved.w[0];
+}
+
+static void b_convolve_plane(const void *arg) {
+    (void)arg;
+    wspr_convolve_plane(message_word, &plane_bits);
+    sink += (uint32_t)plane_bits.w[0];
+}
+
+static void b_interleave_plane(const void *arg) {
+    (void)arg;
+    wspr_interleave_plane(&plane_bits, &plane_interleaved);
+    sink += (uint32_t)plane_interleaved.w[0];
+}
+
+static void b_convolve_interleave_plane(const void *arg) {
+    (void)arg;
+    wspr_convolve_interleave_plane(message_word, &plane_interleaved);
+    sink += (uint32_t)plane_interleaved.w[0];
+}
+
+static void b_plane_to_symbols(const void *arg) {
+    (void)arg;
+    wspr_plane_to_symbols(&plane_interleaved, out_symbols);
+    sink += out_symbols[0];
+}
+
+static void b_convolve(const void *arg) {
+    (void)arg;
+    convolve(message, bits, WSPR_MESSAGE_BYTE_SIZE, WSPR_BIT_COUNT);
+    sink += bits[0];
+}
+
+static void b_interleave(const void *arg) {
+    (void)arg;
+    wspr_interleave(bits);
+    sink += bits[0];
+}
+
+static void b_merge_sync_vector(const void *arg) {
+    (void)arg;
+    wspr_merge_sync_vector(bits, out_symbols);
+    sink += out_symbols[0];
+}
+
+// 与corpus逐条对应的文本消息
+static const char *const corpus_text[CORPUS_COUNT] = {
+    "BI1TPH ON80 10",
+    "PJ4/K1ABC FN42 37",
+    "K1ABC/7 FN42 20",
+    "<BI1TPH> ON80AB 10",
+};
+
+static void b_mode_wspr(const void *arg) {
+    const corpus_entry_t *e = (const corpus_entry_t *)arg;
+    wspr_mode_encode_wspr(corpus_text[e - corpus], out_symbols);
+    sink += out_symbols[0];
+}
+
+static uint8_t jt9_symbols[JT9_SYMBOL_COUNT];
+
+static void b_mode_jt9(const void *arg) {
+    wspr_mode_encode_jt9((const char *)arg, jt9_symbols);
+    sink += jt9_symbols[0];
+}
+
+static void b_message_prep_r(const void *arg) {
+    const corpus_entry_t *e = (const corpus_entry_t *)arg;
+    wspr_message_t msg;
+    char call[13];
+    char loc[7];
+    strncpy(call, e->call, 12);
+    call[12] = 0;
+    strncpy(loc, e->loc, 6);
+    loc[6] = 0;
+    wspr_message_prep_r(&msg, call, loc, e->dbm);
+    sink += (uint8_t)msg.power;
+}
+
+static void b_nhash(const void *arg) {
+    const char *call = (const char *)arg;
+    int len = (int)strlen(call);
+    uint32_t init_val = 146;
+    sink += nhash_(call, &len, &init_val);
+}
+
+static void b_si5351_calc(const void *arg) {
+    si5351PLLConfig_t pll_conf;
+    si5351OutputConfig_t out_conf;
+    size_t i;
+    (void)arg;
+    for (i = 0; i < BAND_COUNT; i++) {
+        si5351_Calc(bands[i], &pll_conf, &out_conf);
+        sink += out_conf.num;
+    }
+}
+
+static void b_si5351_calc_iq(const void *arg) {
+    si5351PLLConfig_t pll_conf;
+    si5351OutputConfig_t out_conf;
+    size_t i;
+    (void)arg;
+    for (i = 0; i < BAND_COUNT; i++) {
+        si5351_CalcIQ(bands[i], &pll_conf, &out_conf);
+        sink += pll_conf.num;
+    }
+}
+
+static void run_all(void) {
+    char name[48];
+    size_t i;
+
+    for (i = 0; i < CORPUS_COUNT; i++) {
+        snprintf(name, sizeof(name), "wspr_encode/%s", corpus[i].name);
+        run_bench(name, b_encode, &corpus[i]);
+    }
+    for (i = 0; i < CORPUS_COUNT; i++) {
+        snprintf(name, sizeof(name), "wspr_encode_plane/%s", corpus[i].name);
+        run_bench(name, b_encode_plane, &corpus[i]);
+    }
+    for (i = 0; i < CORPUS_COUNT; i++) {
+        snprintf(name, sizeof(name), "wspr_encode_inplace/%s", corpus[i].name);
+        run_bench(name, b_encode_inplace, &corpus[i]);
+    }
+    for (i = 0; i < CORPUS_COUNT; i++) {
+        snprintf(name, sizeof(name), "wspr_mode_encode_wspr/%s", corpus[i].name);
+        run_bench(name, b_mode_wspr, &corpus[i]);
+    }
+    run_bench("wspr_mode_encode_jt9/cq", b_mode_jt9, "CQ BI1TPH ON80");
+    run_bench("wspr_mode_encode_jt9/report", b_mode_jt9, "K1ABC BI1TPH R-15");
+    for (i = 0; i < CORPUS_COUNT; i++) {
+        snprintf(name, sizeof(name), "wspr_message_prep/%s", corpus[i].name);
+        run_bench(name, b_message_prep, &corpus[i]);
+    }
+    for (i = 0; i < CORPUS_COUNT; i++) {
+        prep(&corpus[i]);
+        snprintf(name, sizeof(name), "wspr_bit_packing/%s", corpus[i].name);
+        run_bench(name, b_bit_packing, NULL);
+    }
+
+    for (i = 0; i < CORPUS_COUNT; i++) {
+        char call[13], loc[7];
+        strncpy(call, corpus[i].call, 12);
+        call[12] = 0;
+        strncpy(loc, corpus[i].loc, 6);
+        loc[6] = 0;
+        wspr_message_prep_r(&corpus_msg[i], call, loc, corpus[i].dbm);
+        snprintf(name, sizeof(name), "wspr_pack50/%s", corpus[i].name);
+        run_bench(name, b_pack50, &corpus_msg[i]);
+    }
+
+    prep(&corpus[0]);
+    wspr_bit_packing(message);
+    message_word = wspr_pack50(&corpus_msg[0]);
+    run_bench("convolve", b_convolve, NULL);
+    run_bench("wspr_convolve50", b_convolve50, NULL);
+    run_bench("wspr_convolve_plane", b_convolve_plane, NULL);
+    run_bench("wspr_interleave_plane", b_interleave_plane, NULL);
+    run_bench("wspr_convolve_interleave_plane", b_convolve_interleave_plane, NULL);
+    run_bench("wspr_plane_to_symbols", b_plane_to_symbols, NULL);
+    run_bench("wspr_interleave", b_interleave, NULL);
+    run_bench("wspr_merge_sync_vector", b_merge_sync_vector, NULL);
+    run_bench("nhash_", b_nhash, "BI1TPH");
+    // si5351的两项为遍历全部WSPR频段一次的耗时
+    run_bench("si5351_Calc/all_bands", b_si5351_calc, NULL);
+    run_bench("si5351_CalcIQ/all_bands", b_si5351_calc_iq, NULL);
+}
+
+// ---------------------------------------------------------------- 差分校验
+
+static uint32_t rng_state = 12345;
+
+static uint32_t rnd(uint32_t n) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state % n;
+}
+
+static char rnd_char(const char *set) {
+    return set[rnd((uint32_t)strlen(set))];
+}
+
+// 按模板生成呼号，覆盖类型1、前缀、单字符后缀、两位后缀、哈希以及任意字符
+static void random_call(char *call) {
+    static const char *alpha = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    static const char *digit = "0123456789";
+    static const char *any = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789/<> -.";
+    char base[8];
+    int i, n = 0;
+
+    // 基本呼号：1~2位前缀 + 数字 + 1~3个字母
+    base[n++] = rnd_char(rnd(3) ? alpha : digit);
+    if (rnd(2)) base[n++] = rnd_char(alpha);
+    base[n++] = rnd_char(digit);
+    for (i = rnd(3) + 1; i > 0; i--) base[n++] = rnd_char(alpha);
+    base[n] = 0;
+
+    switch (rnd(7)) {
+    case 0:
+    case 1:
+        strcpy(call, base);
+        break;
+    case 2: {
+        char prefix[4];
+        int len = (int)rnd(3) + 1;
+        for (i = 0; i < len; i++) prefix[i] = rnd_char(rnd(2) ? alpha : digit);
+        prefix[len] = 0;
+        snprintf(call, 13, "%s/%s", prefix, base);
+        break;
+    }
+    case 3:
+        snprintf(call, 13, "%s/%c", base, rnd_char(rnd(2) ? alpha : digit));
+        break;
+    case 4:
+        snprintf(call, 13, "%s/%c%c", base, rnd_char(digit), rnd_char(digit));
+        break;
+    case 5:
+        snprintf(call, 13, "<%s>", base);
+        break;
+    default:
+        n = (int)rnd(13);
+        for (i = 0; i < n; i++) call[i] = rnd_char(any);
+        call[n] = 0;
+        break;
+    }
+}
+
+static void random_loc(char *loc) {
+    static const char *field = "ABCDEFGHIJKLMNOPQR";
+    static const char *sub = "abcdefghijklmnopqrstuvwxABCDEFGHIJKLMNOPQRSTUVWX";
+    int r = (int)rnd(8);
+    loc[0] = rnd_char(field);
+    loc[1] = rnd_char(field);
+    loc[2] = (char)('0' + rnd(10));
+    loc[3] = (char)('0' + rnd(10));
+    loc[4] = 0;
+    if (r < 4) {
+        loc[4] = rnd_char(sub);
+        loc[5] = rnd_char(sub);
+        loc[6] = 0;
+    } else if (r == 4) {
+        // 非法网格，检验回退到AA00AA
+        loc[rnd(4)] = 'z';
+    }
+}
+
+// 原分支实现对部分畸形输入会越界写（如4字符以上前缀、缺少'>'的哈希呼号），
+// 这些输入不参与比对
+static int legacy_defined(const wspr_message_t *msg) {
+    const char *call = msg->callsign;
+    const char *slash = strchr(call, '/');
+    if (call[0] == '<') {
+        return strchr(call, '>') != NULL;
+    }
+    if (slash) {
+        int pos = (int)(slash - call);
+        int suffix = (pos + 2 >= 12 || call[pos + 2] == ' ' || call[pos + 3] == ' ' || pos + 3 >= 12);
+        return suffix ? pos <= 7 : pos <= 4;
+    }
+    return 1;
+}
+
+// 比对统一打包器与原分支实现，返回不一致条数
+static long check(long count) {
+    long i, errors = 0, skipped = 0;
+
+    for (i = 0; i < count; i++) {
+        char call[13], loc[7], call_copy[13], loc_copy[7];
+        int8_t dbm = (int8_t)((int)rnd(100) - 40);
+        wspr_message_t msg, legacy;
+        uint8_t c[WSPR_MESSAGE_BYTE_SIZE], w[WSPR_MESSAGE_BYTE_SIZE];
+        uint8_t s_legacy[WSPR_BIT_COUNT], s_new[WSPR_BIT_COUNT];
+        uint8_t sym_legacy[WSPR_SYMBOL_COUNT], sym_new[WSPR_SYMBOL_COUNT], sym_small[WSPR_SYMBOL_COUNT];
+        uint8_t packed[(WSPR_SYMBOL_COUNT + 3) / 4];
+        wspr_plane_t plane, plane_d, plane_fused;
+        uint64_t word;
+        int k, conv_ok, plane_ok;
+
+        memset(call, 0, sizeof(call));
+        memset(loc, 0, sizeof(loc));
+        random_call(call);
+        random_loc(loc);
+
+        memcpy(call_copy, call, sizeof(call));
+        memcpy(loc_copy, loc, sizeof(loc));
+        wspr_message_prep_r(&msg, call_copy, loc_copy, dbm);
+        if (!legacy_defined(&msg)) {
+            skipped++;
+            continue;
+        }
+        legacy = msg;
+
+        wspr_bit_packing_r(&legacy, c);
+        word = wspr_pack50(&msg);
+        memset(w, 0, sizeof(w));
+        for (k = 0; k < 50; k++) {
+            w[k >> 3] |= (uint8_t)(((word >> (49 - k)) & 1) << (7 - (k & 7)));
+        }
+
+        convolve(c, s_legacy, WSPR_MESSAGE_BYTE_SIZE, WSPR_BIT_COUNT);
+        wspr_convolve50(word, s_new);
+        conv_ok = memcmp(s_legacy, s_new, sizeof(s_new)) == 0;
+
+        // 比特平面路径：逐级与字节路径比对
+        wspr_convolve_plane(word, &plane);
+        wspr_interleave_plane(&plane, &plane_d);
+        wspr_convolve_interleave_plane(word, &plane_fused);
+        plane_ok = memcmp(&plane_d, &plane_fused, sizeof(plane_d)) == 0;
+        for (k = 0; k < WSPR_BIT_COUNT; k++) {
+            plane_ok &= WSPR_PLANE_BIT(&plane, k) == s_legacy[k];
+        }
+        wspr_interleave(s_legacy);
+        for (k = 0; k < WSPR_BIT_COUNT; k++) {
+            plane_ok &= WSPR_PLANE_BIT(&plane_d, k) == s_legacy[k];
+        }
+        wspr_plane_to_packed(&plane_d, packed);
+        wspr_merge_sync_vector(s_legacy, sym_legacy);
+        wspr_encode(call, loc, dbm, sym_new);
+        wspr_encode_inplace(call, loc, dbm, sym_small);
+        plane_ok &= memcmp(sym_small, sym_new, sizeof(sym_new)) == 0;
+
+        // 通用流程：只比对能按空格切分的消息
+        if (call[0] && loc[0] && !strchr(call, ' ') && !strchr(loc, ' ')) {
+            char text[32];
+            snprintf(text, sizeof(text), "%s %s %d", call, loc, dbm);
+            plane_ok &= wspr_mode_encode_wspr(text, sym_small) == 0 &&
+                        memcmp(sym_small, sym_new, sizeof(sym_new)) == 0;
+        }
+
+        for (k = 0; k < WSPR_SYMBOL_COUNT; k++) {
+            plane_ok &= ((packed[k >> 2] >> ((k & 3) * 2)) & 3) == sym_new[k];
+        }
+
+        if (memcmp(c, w, sizeof(c)) != 0 || !conv_ok || !plane_ok ||
+            memcmp(sym_legacy, sym_new, sizeof(sym_new)) != 0) {
+            if (errors < 10) {
+                fprintf(stderr, "不一致: \"%s\" \"%s\" %d\n", call, loc, dbm);
+            }
+            errors++;
+        }
+    }
+    printf("差分校验: %ld 条消息（%ld 条畸形输入跳过），%ld 条不一致\n", count, skipped, errors);
+    return errors;
+}
+
+// JT9参考实现：6字符呼号（第3位为数字）的28比特编码
+static uint32_t jt9_ref_call(const char *call) {
+    char c[7] = "      ";
+    uint32_t n;
+    int i;
+    memcpy(c + (isdigit((unsigned char)call[2]) ? 0 : 1), call, strlen(call));
+    n = isdigit((unsigned char)c[0]) ? (uint32_t)(c[0] - '0') : c[0] == ' ' ? 36u : (uint32_t)(c[0] - 'A' + 10);
+    n = n * 36 + (isdigit((unsigned char)c[1]) ? (uint32_t)(c[1] - '0') : (uint32_t)(c[1] - 'A' + 10));
+    n = n * 10 + (uint32_t)(c[2] - '0');
+    for (i = 3; i < 6; i++) n = n * 27 + (c[i] == ' ' ? 26u : (uint32_t)(c[i] - 'A'));
+    return n;
+}
+
+// 按gen9的步骤逐字节编码：72比特+尾零打成13字节，convolve()，8位比特反转交织，
+// 每3比特一个符号，Gray码加1，插入同步符号
+static void jt9_ref_encode(uint32_t nc1, uint32_t nc2, uint32_t ng, uint8_t *symbols) {
+    static const uint8_t sync_pos[16] = {1, 2, 5, 10, 16, 23, 33, 35, 51, 52, 55, 60, 66, 73, 83, 85};
+    uint8_t c[13], s[JT9_BIT_COUNT + 1], d[JT9_BIT_COUNT + 1], is_sync[JT9_SYMBOL_COUNT];
+    int i, k = 0, bit = 0;
+
+    memset(c, 0, sizeof(c));
+    for (i = 0; i < 72; i++) {
+        uint32_t b = i < 28 ? (nc1 >> (27 - i)) & 1 : i < 56 ? (nc2 >> (55 - i)) & 1 : (ng >> (71 - i)) & 1;
+        c[i >> 3] |= (uint8_t)(b << (7 - (i & 7)));
+    }
+    convolve(c, s, sizeof(c), JT9_BIT_COUNT);
+    for (i = 0; i < 256; i++) {
+        int r = 0, b;
+        for (b = 0; b < 8; b++) r |= ((i >> b) & 1) << (7 - b);
+        if (r < JT9_BIT_COUNT) d[r] = s[k++];
+    }
+    d[JT9_BIT_COUNT] = 0;
+    memset(is_sync, 0, sizeof(is_sync));
+    for (i = 0; i < 16; i++) is_sync[sync_pos[i] - 1] = 1;
+    for (i = 0; i < JT9_SYMBOL_COUNT; i++) {
+        int v;
+        if (is_sync[i]) {
+            symbols[i] = 0;
+            continue;
+        }
+        v = d[bit] * 4 + d[bit + 1] * 2 + d[bit + 2];
+        bit += 3;
+        symbols[i] = (uint8_t)((v ^ (v >> 1)) + 1);
+    }
+}
+
+// 随机标准消息比对JT9模式与参考实现，返回不一致条数
+static long check_jt9(long count) {
+    static const char *alpha = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    static const char *digit = "0123456789";
+    long i, errors = 0;
+
+    for (i = 0; i < count; i++) {
+        char calls[2][8], grid[8], text[32];
+        uint32_t nc[2], ng;
+        uint8_t sym[JT9_SYMBOL_COUNT], ref[JT9_SYMBOL_COUNT];
+        int k, j, n, r;
+
+        for (k = 0; k < 2; k++) {
+            n = 0;
+            calls[k][n++] = rnd_char(rnd(3) ? alpha : digit);
+            if (rnd(2)) calls[k][n++] = rnd_char(alpha);
+            calls[k][n++] = rnd_char(digit);
+            for (j = (int)rnd(3) + 1; j > 0; j--) calls[k][n++] = rnd_char(alpha);
+            calls[k][n] = 0;
+            nc[k] = jt9_ref_call(calls[k]);
+        }
+        r = (int)rnd(4);
+        if (r == 1) {
+            strcpy(calls[0], "CQ");
+            nc[0] = 262177560u + 1;
+        } else if (r == 2) {
+            strcpy(calls[0], rnd(2) ? "QRZ" : "DE");
+            nc[0] = calls[0][0] == 'Q' ? 262177560u + 2 : 267796945u;
+        }
+
+        r = (int)rnd(8);
+        n = (int)rnd(30) + 1;
+        if (r < 3) {
+            grid[0] = rnd_char("ABCDEFGHIJKLMNOPQR");
+            grid[1] = rnd_char("ABCDEFGHIJKLMNOPQR");
+            grid[2] = rnd_char(digit);
+            grid[3] = rnd_char(digit);
+            grid[4] = 0;
+            ng = (uint32_t)((179 - 10 * (grid[0] - 'A') - (grid[2] - '0')) * 180 + 10 * (grid[1] - 'A') + (grid[3] - '0'));
+        } else if (r == 3) {
+            snprintf(grid, sizeof(grid), "-%02d", n);
+            ng = 32400u + 1 + (uint32_t)n;
+        } else if (r == 4) {
+            snprintf(grid, sizeof(grid), "R-%02d", n);
+            ng = 32400u + 31 + (uint32_t)n;
+        } else if (r == 5) {
+            static const char *words[3] = {"RO", "RRR", "73"};
+            k = (int)rnd(3);
+            strcpy(grid, words[k]);
+            ng = 32400u + 62 + (uint32_t)k;
+        } else {
+            grid[0] = 0;
+            ng = 32400u + 1;
+        }
+
+        snprintf(text, sizeof(text), "%s %s %s", calls[0], calls[1], grid);
+        jt9_ref_encode(nc[0], nc[1], ng, ref);
+        if (wspr_mode_encode_jt9(text, sym) != 0 || memcmp(sym, ref, sizeof(ref)) != 0) {
+            if (errors < 10) {
+                fprintf(stderr, "JT9不一致: \"%s\"\n", text);
+            }
+            errors++;
+        }
+    }
+    printf("JT9校验: %ld 条消息，%ld 条不一致\n", count, errors);
+    return errors;
+}
+
+// ---------------------------------------------------------------- 栈用量报告
+
+enum { ARG_NONE, ARG_CORPUS, ARG_MESSAGE };
+
+typedef struct {
+    const char *name;
+    bench_fn_t fn;
+    int arg;
+} stack_entry_t;
+
+// 对外入口函数；阶段函数的输入按每条语料重新准备，取所有语料中的最大值
+static const stack_entry_t stack_entries[] = {
+    {"wspr_encode", b_encode, ARG_CORPUS},
+    {"wspr_encode_inplace", b_encode_inplace, ARG_CORPUS},
+    {"wspr_encode_plane", b_encode_plane, ARG_CORPUS},
+    {"wspr_mode_encode_wspr", b_mode_wspr, ARG_CORPUS},
+    {"wspr_message_prep_r", b_message_prep_r, ARG_CORPUS},
+    {"wspr_message_prep", b_message_prep, ARG_CORPUS},
+    {"wspr_bit_packing", b_bit_packing, ARG_NONE},
+    {"wspr_pack50", b_pack50, ARG_MESSAGE},
+    {"convolve", b_convolve, ARG_NONE},
+    {"wspr_convolve50", b_convolve50, ARG_NONE},
+    {"wspr_convolve_plane", b_convolve_plane, ARG_NONE},
+    {"wspr_interleave_plane", b_interleave_plane, ARG_NONE},
+    {"wspr_convolve_interleave_plane", b_convolve_interleave_plane, ARG_NONE},
+    {"wspr_plane_to_symbols", b_plane_to_symbols, ARG_NONE},
+    {"wspr_interleave", b_interleave, ARG_NONE},
+    {"wspr_merge_sync_vector", b_merge_sync_vector, ARG_NONE},
+};
+#define STACK_ENTRY_COUNT (sizeof(stack_entries) / sizeof(stack_entries[0]))
+
+static void stack_report(void) {
+    size_t e, i;
+
+    printf("%-32s %12s\n", "entry", "stack bytes");
+    for (e = 0; e < STACK_ENTRY_COUNT; e++) {
+        long worst = 0;
+        for (i = 0; i < CORPUS_COUNT; i++) {
+            const void *arg = NULL;
+            char call[13], loc[7];
+            long used;
+
+            strncpy(call, corpus[i].call, 12);
+            call[12] = 0;
+            strncpy(loc, corpus[i].loc, 6);
+            loc[6] = 0;
+            wspr_message_prep_r(&corpus_msg[i], call, loc, corpus[i].dbm);
+            prep(&corpus[i]);
+            wspr_bit_packing(message);
+            convolve(message, bits, WSPR_MESSAGE_BYTE_SIZE, WSPR_BIT_COUNT);
+            message_word = wspr_pack50(&corpus_msg[i]);
+            wspr_convolve_plane(message_word, &plane_bits);
+            wspr_convolve_interleave_plane(message_word, &plane_interleaved);
+
+            if (stack_entries[e].arg == ARG_CORPUS) arg = &corpus[i];
+            else if (stack_entries[e].arg == ARG_MESSAGE) arg = &corpus_msg[i];
+            used = stack_usage(stack_entries[e].fn, arg);
+            if (used > worst) worst = used;
+        }
+        printf("%-32s %12ld\n", stack_entries[e].name, worst);
+    }
+}
+
+// ---------------------------------------------------------------- 输出与比较
+
+static void print_json(FILE *out) {
+    int i;
+    fprintf(out, "{\n  \"benchmarks\": [\n");
+    for (i = 0; i < result_count; i++) {
+        fprintf(out, "    {\"name\": \"%s\", \"ns_per_op\": %.2f, \"cycles_per_op\": %.1f, \"stack_bytes\": %ld}%s\n",
+                results[i].name, results[i].ns_per_op, results[i].cycles_per_op, results[i].stack_bytes,
+                i + 1 < result_count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+// 在基线文件中查找同名项的ns/op，找不到返回负数。基线即本程序输出的JSON。
+static double baseline_ns(const char *text, const char *name) {
+    char key[80];
+    const char *p;
+    snprintf(key, sizeof(key), "\"name\": \"%.47s\"", name);
+    p = strstr(text, key);
+    if (!p) return -1;
+    p = strstr(p, "\"ns_per_op\":");
+    if (!p) return -1;
+    return strtod(p + strlen("\"ns_per_op\":"), NULL);
+}
+
+static char *read_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    char *buf;
+    long n;
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buf = (char *)malloc((size_t)n + 1);
+    if (buf) {
+        n = (long)fread(buf, 1, (size_t)n, f);
+        buf[n] = 0;
+    }
+    fclose(f);
+    return buf;
+}
+
+static int compare(const char *path, double threshold) {
+    char *text = read_file(path);
+    int regressions = 0;
+    int i;
+
+    if (!text) return 2;
+    printf("%-32s %12s %12s %8s\n", "name", "base ns/op", "ns/op", "delta");
+    for (i = 0; i < result_count; i++) {
+        double base = baseline_ns(text, results[i].name);
+        double delta;
+        if (base <= 0) {
+            printf("%-32s %12s %12.2f %8s  NEW\n", results[i].name, "-", results[i].ns_per_op, "-");
+            continue;
+        }
+        delta = (results[i].ns_per_op - base) / base * 100.0;
+        printf("%-32s %12.2f %12.2f %+7.1f%%%s\n", results[i].name, base, results[i].ns_per_op, delta,
+               delta > threshold ? "  REGRESSION" : "");
+        if (delta > threshold) regressions++;
+    }
+    free(text);
+    if (regressions) {
+        printf("%d项超过%.1f%%回归门限\n", regressions, threshold);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *baseline = NULL;
+    double threshold = 10.0;
+    long check_count = 0;
+    int stack_only = 0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--check") == 0) {
+            check_count = (i + 1 < argc && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '9') ? atol(argv[++i]) : 200000;
+        } else if (strcmp(argv[i], "--stack") == 0) {
+            stack_only = 1;
+        } else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "用法: %s [--compare baseline.json [-t 百分比]] | --check [N] | --stack\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (check_count > 0) {
+        long errors = check(check_count);
+        errors += check_jt9(check_count);
+        return errors ? 1 : 0;
+    }
+    if (stack_only) {
+        stack_report();
+        return 0;
+    }
+
+    run_all();
+    if (baseline) {
+        return compare(baseline, threshold);
+    }
+    print_json(stdout);
+    return 0;
+}
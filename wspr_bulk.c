@@ -0,0 +1,343 @@
+/*
+ * wspr_bulk.c - 并行批量WSPR编码命令行工具
+ *
+ * 内存映射读取CSV/TSV（每行：呼号,网格,功率dBm），按行边界切成若干块，
+ * 由线程池并行解析并调用可重入的wspr_encode_plane()，把定长记录直接写入
+ * 内存映射的输出文件。第i个数据行对应输出文件中第i条记录。
+ *
+ * 编译：
+ *   gcc -O2 -I. -o wspr_bulk wspr_bulk.c encode.c nhash.c -lpthread
+ *   gcc -O2 -DWSPR_TRACE -I. -o wspr_bulk wspr_bulk.c encode.c nhash.c wspr_trace.c -lpthread
+ *     （结束时把各编码阶段的周期统计输出到stderr，见wspr_trace.h）
+ *
+ * 用法：
+ *   wspr_bulk [-j 线程数] [-f bytes|packed] [--skip-header] input.csv output.bin
+ *
+ * 输出格式：
+ *   bytes   每条记录162字节，每字节一个符号（0~3）
+ *   packed  每条记录41字节，每字节4个符号、低位在前（与wspr_table.h相同）
+ *
+ * 字段分隔符可为逗号、制表符或空格；空行和'#'开头的行被忽略。
+ * 无法解析的行（包括功率不在-30~60dBm内的行）输出全零记录并计入错误数。吞吐量（行/秒）输出到stderr。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "encode.h"
+#include "wspr_trace.h"
+
+#define CHUNKS_PER_THREAD 8
+#define MAX_THREADS 256
+#define PACKED_RECORD_SIZE ((WSPR_SYMBOL_COUNT + 3) / 4)
+
+// wspr_message_prep_r()接受的功率范围（dBm），范围内的值取到不大于它的有效档位
+#define MIN_DBM (-30)
+#define MAX_DBM 60
+
+typedef struct {
+    const char *begin;
+    const char *end;
+    uint64_t first_row; // 本块第一行的全局行号（第二遍使用）
+    uint64_t rows;      // 本块数据行数（第一遍统计）
+    uint64_t errors;
+} chunk_t;
+
+typedef struct {
+    chunk_t *chunks;
+    int chunk_count;
+    int next;           // 下一个待处理块，原子递增
+    int pass;           // 1: 统计行数，2: 解析并编码
+    int packed;
+    size_t stride;
+    uint8_t *out;
+} job_t;
+
+static int is_data_line(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p < end && *p != '#';
+}
+
+static const char *line_end(const char *p, const char *end) {
+    const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+    return nl ? nl : end;
+}
+
+static uint64_t count_rows(const char *p, const char *end) {
+    uint64_t rows = 0;
+    while (p < end) {
+        const char *e = line_end(p, end);
+        if (is_data_line(p, e)) rows++;
+        p = e + 1;
+    }
+    return rows;
+}
+
+// 取下一个字段，返回字段长度；*p移动到分隔符之后
+static size_t next_field(const char **p, const char *end, const char **field) {
+    const char *s = *p;
+    const char *f;
+    while (s < end && (*s == ' ' || *s == '\t')) s++;
+    f = s;
+    while (s < end && *s != ',' && *s != '\t' && *s != ' ' && *s != '\r') s++;
+    *field = f;
+    *p = s;
+    while (*p < end && (**p == ' ' || **p == '\t' || **p == ',' || **p == '\r')) {
+        (*p)++;
+        if ((*p)[-1] == ',') break;
+    }
+    return (size_t)(s - f);
+}
+
+// 解析一行并编码到rec，成功返回0
+static int encode_line(const char *p, const char *end, int packed, uint8_t *rec) {
+    const char *f;
+    size_t len;
+    char call[13];
+    char loc[7];
+    char num[8];
+    wspr_plane_t plane;
+    char *num_end;
+    long dbm;
+
+    len = next_field(&p, end, &f);
+    if (len == 0 || len > 12) return 1;
+    memcpy(call, f, len);
+    call[len] = 0;
+
+    len = next_field(&p, end, &f);
+    if (len == 0 || len > 6) return 1;
+    memcpy(loc, f, len);
+    loc[len] = 0;
+
+    len = next_field(&p, end, &f);
+    if (len == 0 || len >= sizeof(num)) return 1;
+    memcpy(num, f, len);
+    num[len] = 0;
+    dbm = strtol(num, &num_end, 10);
+    if (*num_end != 0 || dbm < MIN_DBM || dbm > MAX_DBM) return 1;
+
+    // 比特平面直接展开为目标格式，不经过中间符号数组
+    wspr_encode_plane(call, loc, (int8_t)dbm, &plane);
+    if (packed) {
+        wspr_plane_to_packed(&plane, rec);
+    } else {
+        wspr_plane_to_symbols(&plane, rec);
+    }
+    return 0;
+}
+
+static void process_chunk(job_t *job, chunk_t *c) {
+    const char *p = c->begin;
+    uint64_t row = c->first_row;
+
+    while (p < c->end) {
+        const char *e = line_end(p, c->end);
+        if (is_data_line(p, e)) {
+            uint8_t *rec = job->out + row * job->stride;
+            if (encode_line(p, e, job->packed, rec) != 0) {
+                memset(rec, 0, job->stride);
+                c->errors++;
+            }
+            row++;
+        }
+        p = e + 1;
+    }
+}
+
+static void *worker(void *arg) {
+    job_t *job = (job_t *)arg;
+    for (;;) {
+        int i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (i >= job->chunk_count) break;
+        if (job->pass == 1) {
+            job->chunks[i].rows = count_rows(job->chunks[i].begin, job->chunks[i].end);
+        } else {
+            process_chunk(job, &job->chunks[i]);
+        }
+    }
+    return NULL;
+}
+
+// 线程创建失败时由调用线程接着取块，已创建的线程照常工作
+static void run_pass(job_t *job, int pass, int threads) {
+    pthread_t th[MAX_THREADS];
+    int i, started = 0;
+
+    job->pass = pass;
+    job->next = 0;
+    for (i = 0; i < threads; i++) {
+        int rc = pthread_create(&th[started], NULL, worker, job);
+        if (rc != 0) {
+            fprintf(stderr, "pthread_create: %s，改用%d个线程\n", strerror(rc), started + 1);
+            break;
+        }
+        started++;
+    }
+    if (started < threads) {
+        worker(job);
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(th[i], NULL);
+    }
+}
+
+// 按行边界把[data, data+size)切成count块
+static void split_chunks(const char *data, size_t size, chunk_t *chunks, int count) {
+    const char *end = data + size;
+    const char *p = data;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        const char *e = (i == count - 1) ? end : data + size * (size_t)(i + 1) / (size_t)count;
+        if (e < p) e = p;
+        if (e < end) {
+            e = line_end(e, end);
+            if (e < end) e++;
+        }
+        chunks[i].begin = p;
+        chunks[i].end = e;
+        chunks[i].rows = 0;
+        chunks[i].errors = 0;
+        p = e;
+    }
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+    const char *in_path = NULL, *out_path = NULL;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int packed = 0, skip_header = 0, bad_args = 0;
+    struct stat st;
+    const char *data;
+    chunk_t *chunks;
+    job_t job;
+    uint64_t rows = 0, errors = 0;
+    size_t out_size;
+    double t0, t1;
+    int in_fd, out_fd, i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "packed") == 0) packed = 1;
+            else if (strcmp(argv[i], "bytes") == 0) packed = 0;
+            else bad_args = 1;
+        } else if (strcmp(argv[i], "--skip-header") == 0) {
+            skip_header = 1;
+        } else if (!in_path) {
+            in_path = argv[i];
+        } else if (!out_path) {
+            out_path = argv[i];
+        } else {
+            bad_args = 1;
+        }
+    }
+    if (bad_args || !in_path || !out_path) {
+        fprintf(stderr, "用法: %s [-j 线程数] [-f bytes|packed] [--skip-header] input.csv output.bin\n", argv[0]);
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    in_fd = open(in_path, O_RDONLY);
+    if (in_fd < 0 || fstat(in_fd, &st) != 0) {
+        perror(in_path);
+        return 1;
+    }
+    if (st.st_size == 0) {
+        fprintf(stderr, "%s: 空文件\n", in_path);
+        return 1;
+    }
+    data = (const char *)mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, in_fd, 0);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    madvise((void *)data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    t0 = now_sec();
+
+    // 跳过表头
+    {
+        const char *begin = data;
+        size_t size = (size_t)st.st_size;
+        if (skip_header) {
+            const char *e = line_end(begin, data + size);
+            begin = (e < data + size) ? e + 1 : e;
+            size = (size_t)(data + st.st_size - begin);
+        }
+        job.chunk_count = threads * CHUNKS_PER_THREAD;
+        chunks = (chunk_t *)calloc((size_t)job.chunk_count, sizeof(chunk_t));
+        if (!chunks) {
+            perror("calloc");
+            return 1;
+        }
+        split_chunks(begin, size, chunks, job.chunk_count);
+    }
+    job.chunks = chunks;
+    job.packed = packed;
+    job.stride = packed ? PACKED_RECORD_SIZE : WSPR_SYMBOL_COUNT;
+    job.out = NULL;
+
+    // 第一遍：并行统计每块行数，前缀和得到每块的起始记录号
+    run_pass(&job, 1, threads);
+    for (i = 0; i < job.chunk_count; i++) {
+        chunks[i].first_row = rows;
+        rows += chunks[i].rows;
+    }
+
+    out_size = (size_t)rows * job.stride;
+    out_fd = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0 || ftruncate(out_fd, (off_t)out_size) != 0) {
+        perror(out_path);
+        return 1;
+    }
+    if (out_size > 0) {
+        job.out = (uint8_t *)mmap(NULL, out_size, PROT_READ | PROT_WRITE, MAP_SHARED, out_fd, 0);
+        if (job.out == MAP_FAILED) {
+            perror("mmap");
+            return 1;
+        }
+
+        // 第二遍：并行解析、编码并写入
+        run_pass(&job, 2, threads);
+        munmap(job.out, out_size);
+    }
+    close(out_fd);
+
+    t1 = now_sec();
+    munmap((void *)data, (size_t)st.st_size);
+    close(in_fd);
+
+    for (i = 0; i < job.chunk_count; i++) {
+        errors += chunks[i].errors;
+    }
+    free(chunks);
+
+    fprintf(stderr, "%llu 行，%llu 行错误，%d 线程，%.3f 秒，%.0f 行/秒（%.1f 百万行/分钟）\n",
+            (unsigned long long)rows, (unsigned long long)errors, threads, t1 - t0,
+            rows / (t1 - t0), rows / (t1 - t0) * 60.0 / 1e6);
+#ifdef WSPR_TRACE
+    {
+        char report[2048];
+        wspr_trace_dump(report, sizeof(report));
+        fputs(report, stderr);
+    }
+#endif
+    return errors ? 3 : 0;
+}
@@ -0,0 +1,969 @@
+/*
+ * wspr_daemon.c - 主机端多信标控制守护进程
+ *
+ * 每个Si5351信标原本各自运行app.c里的整套流程（编码消息、计算频率方案、
+ * 逐符号重新设置频率）。守护进程把这部分工作集中到主机上：每个发射周期为
+ * 每个信标准备一帧寄存器数据（PLL寄存器、CLK控制、四个音调的MultiSynth
+ * 寄存器映像和41字节打包符号，与wspr_table.h的表格相同），经可替换的传输层
+ * 推送给信标，信标只需按符号查表写寄存器。
+ *
+ * 共享缓存：
+ *   消息缓存  键为（呼号, 网格, 功率），值为打包符号（wspr_message_table_t）
+ *   方案缓存  键为（频率, 校正值, 驱动强度），值为寄存器方案（wspr_band_table_t）
+ * 上百个信标共用少数消息、频段和校正值时，每种组合只计算一次。同一个键被
+ * 多个线程同时未命中时只有一个线程计算，其余线程等待结果。
+ * 寄存器方案由si5351_ToneTable()计算（PLLA 900MHz，各音调共用PLL和R分频，
+ * 4kHz~75MHz，超出范围的频段在读配置时报错）。它使用全局校正值si5351Correction，
+ * 方案计算在一把锁内进行；命中时不经过这把锁。
+ *
+ * 调度：每个周期为每个信标生成一个任务，轮流放入各工作线程的双端队列。
+ * 线程从自己队列尾部取任务，空了就从其他线程队列头部窃取。
+ *
+ * 传输层（--transport）：
+ *   null             丢弃，只计数（测准备开销）
+ *   unix:/路径       向本地数据报套接字发送，测试用的信标替身
+ *   udp:主机:端口    每帧一个UDP数据报
+ * 另一个进程用--listen unix:/路径或--listen udp:端口接收并校验帧。
+ *
+ * 编译：
+ *   gcc -O2 -DSI5351_NO_HAL -I. -o wspr_daemon wspr_daemon.c encode.c nhash.c si5351.c -lpthread
+ *
+ * 用法：
+ *   wspr_daemon [-j 线程数] [--transport 传输] [--cycles N] [--realtime] [--lead 秒]
+ *               [--stats 每信标.csv] (fleet.cfg | --synthetic N)
+ *   wspr_daemon --listen unix:/路径|udp:端口 [--frames N]
+ *   wspr_daemon --check [--synthetic N]   # 经socketpair收发并逐帧校验：符号与直接编码比对，
+ *                                         # 寄存器映像解码回频率与各音调频率比对
+ *
+ * 配置文件为key=value格式（同wspr_tablegen），'#'开头为注释：
+ *   drive=3                                      # si5351DriveStrength_t，0~3
+ *   beacon=BI1TPH ON80 10 970 7040100,14097100   # 呼号 网格 功率(-30~60 dBm) 校正值 频段列表
+ * 第k个周期信标使用频段列表中的第k % n个频段（跳频）。
+ *
+ * 默认各周期连续运行（压测）；--realtime时在每个偶数分钟前--lead秒（默认1）准备
+ * 并推送，帧中的周期号为UTC时间/120。每周期的准备延迟分位数、缓存命中率和
+ * 每信标的延迟统计输出到stderr和--stats文件。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include "encode.h"
+#include "si5351.h"
+#include "wspr_table.h"
+
+#define MAX_THREADS 256
+#define MAX_BEACONS 4096
+#define MAX_BEACON_BANDS 16
+#define MAX_LINE 512
+#define CACHE_BUCKETS 4096
+// wspr_encode()接受的功率范围（dBm）
+#define MIN_DBM (-30)
+#define MAX_DBM 60
+
+// 帧校验时解码频率与理论音调频率的最大允许误差（同wspr_tablegen）
+#define TONE_TOLERANCE_HZ 0.05
+
+/*
+ * 帧格式（小端）：
+ *   0  'W''S''P''F'
+ *   4  uint16 信标序号
+ *   6  uint8  版本（1）
+ *   7  uint8  CLK控制寄存器
+ *   8  uint32 周期号
+ *   12 uint32 载波频率（Hz）
+ *   16 PLL寄存器[8]
+ *   24 音调寄存器[4][8]
+ *   56 打包符号[41]
+ */
+#define FRAME_MAGIC "WSPF"
+#define FRAME_VERSION 1
+#define FRAME_BYTES (56 + WSPR_TABLE_SYMBOL_BYTES)
+
+typedef struct {
+    char call[13];
+    char loc[7];
+    int8_t dbm;
+    int32_t correction;
+    int band_count;
+    uint32_t bands[MAX_BEACON_BANDS];
+    // 统计（同一信标每周期只有一个任务，周期之间有同步，不需要加锁）
+    uint64_t jobs;
+    double prep_sum, prep_max;   // 任务开始到帧推送完成
+    double ready_sum, ready_max; // 周期开始到帧推送完成
+} beacon_t;
+
+static struct {
+    int threads;
+    const char *transport;
+    uint64_t cycles;
+    int realtime;
+    double lead;
+    const char *stats_path;
+    int synthetic;
+    si5351DriveStrength_t drive;
+    const char *listen;
+    uint64_t frames;
+} cfg;
+
+static beacon_t beacons[MAX_BEACONS];
+static int beacon_count;
+
+// 不写硬件：守护进程只用si5351.c的计算和寄存器映像函数
+void si5351_write(uint8_t reg, uint8_t value) {
+    (void)reg;
+    (void)value;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* ---------- 消息与方案的计算（缓存未命中时，以及--check比对时） ---------- */
+
+static void build_message(const char *call, const char *loc, int8_t dbm, wspr_message_table_t *t) {
+    uint8_t symbols[WSPR_SYMBOL_COUNT];
+    int i;
+
+    wspr_encode(call, loc, dbm, symbols);
+    memset(t->symbols, 0, sizeof(t->symbols));
+    for (i = 0; i < WSPR_SYMBOL_COUNT; i++) {
+        t->symbols[i >> 2] |= (uint8_t)((symbols[i] & 0x03) << ((i & 3) * 2));
+    }
+    t->dbm = dbm;
+}
+
+static pthread_mutex_t calc_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// 频段超出si5351_ToneTable()的范围时返回-1（读配置时已检查）
+static int build_band(uint32_t freq, int32_t correction, si5351DriveStrength_t drive, wspr_band_table_t *t) {
+    int rc;
+
+    pthread_mutex_lock(&calc_lock);
+    si5351Correction = correction;
+    t->freq = freq;
+    rc = si5351_ToneTable((uint64_t)freq * 100, WSPR_TABLE_TONES, drive, t->pll_regs, t->tone_regs,
+                          &t->clk_control);
+    pthread_mutex_unlock(&calc_lock);
+    return rc;
+}
+
+/* ---------- 去重缓存 ---------- */
+
+typedef struct cache_entry {
+    struct cache_entry *next;
+    uint64_t hash;
+    char key[32];
+    int ready;
+    union {
+        wspr_message_table_t msg;
+        wspr_band_table_t band;
+    } v;
+} cache_entry_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t built;
+    cache_entry_t *buckets[CACHE_BUCKETS];
+    uint64_t hits, misses, waits, entries;
+} cache_t;
+
+static cache_t msg_cache = {.lock = PTHREAD_MUTEX_INITIALIZER, .built = PTHREAD_COND_INITIALIZER};
+static cache_t band_cache = {.lock = PTHREAD_MUTEX_INITIALIZER, .built = PTHREAD_COND_INITIALIZER};
+
+static uint64_t fnv1a(const char *s) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/*
+ * 查找键；未命中时插入一个未就绪的条目并返回它，*owner置1，由调用者计算后调用
+ * cache_publish()。其他线程遇到未就绪条目时等待。
+ */
+static cache_entry_t *cache_get(cache_t *c, const char *key, int *owner) {
+    uint64_t h = fnv1a(key);
+    cache_entry_t **slot = &c->buckets[h % CACHE_BUCKETS];
+    cache_entry_t *e;
+
+    *owner = 0;
+    pthread_mutex_lock(&c->lock);
+    for (e = *slot; e; e = e->next) {
+        if (e->hash == h && strcmp(e->key, key) == 0) break;
+    }
+    if (e) {
+        if (e->ready) {
+            c->hits++;
+        } else {
+            c->waits++;
+            while (!e->ready) pthread_cond_wait(&c->built, &c->lock);
+        }
+        pthread_mutex_unlock(&c->lock);
+        return e;
+    }
+    e = (cache_entry_t *)calloc(1, sizeof(*e));
+    if (!e) {
+        pthread_mutex_unlock(&c->lock);
+        return NULL;
+    }
+    e->hash = h;
+    snprintf(e->key, sizeof(e->key), "%s", key);
+    e->next = *slot;
+    *slot = e;
+    c->misses++;
+    c->entries++;
+    *owner = 1;
+    pthread_mutex_unlock(&c->lock);
+    return e;
+}
+
+static void cache_publish(cache_t *c, cache_entry_t *e) {
+    pthread_mutex_lock(&c->lock);
+    e->ready = 1;
+    pthread_cond_broadcast(&c->built);
+    pthread_mutex_unlock(&c->lock);
+}
+
+static const wspr_message_table_t *get_message(const beacon_t *b) {
+    char key[32];
+    int owner;
+    cache_entry_t *e;
+
+    snprintf(key, sizeof(key), "%s %s %d", b->call, b->loc, b->dbm);
+    e = cache_get(&msg_cache, key, &owner);
+    if (!e) return NULL;
+    if (owner) {
+        build_message(b->call, b->loc, b->dbm, &e->v.msg);
+        cache_publish(&msg_cache, e);
+    }
+    return &e->v.msg;
+}
+
+static const wspr_band_table_t *get_band(uint32_t freq, int32_t correction) {
+    char key[32];
+    int owner;
+    cache_entry_t *e;
+
+    snprintf(key, sizeof(key), "%lu %ld %d", (unsigned long)freq, (long)correction, (int)cfg.drive);
+    e = cache_get(&band_cache, key, &owner);
+    if (!e) return NULL;
+    if (owner) {
+        build_band(freq, correction, cfg.drive, &e->v.band);
+        cache_publish(&band_cache, e);
+    }
+    return &e->v.band;
+}
+
+/* ---------- 帧与传输层 ---------- */
+
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void frame_pack(uint8_t *f, uint16_t beacon, uint32_t cycle, const wspr_message_table_t *m,
+                       const wspr_band_table_t *b) {
+    memcpy(f, FRAME_MAGIC, 4);
+    f[4] = (uint8_t)beacon;
+    f[5] = (uint8_t)(beacon >> 8);
+    f[6] = FRAME_VERSION;
+    f[7] = b->clk_control;
+    put32(f + 8, cycle);
+    put32(f + 12, b->freq);
+    memcpy(f + 16, b->pll_regs, SI5351_BULK_REGS);
+    memcpy(f + 24, b->tone_regs, sizeof(b->tone_regs));
+    memcpy(f + 56, m->symbols, WSPR_TABLE_SYMBOL_BYTES);
+}
+
+typedef struct {
+    const char *name;
+    // 打开传输，arg为冒号后的部分；成功返回0
+    int (*open)(const char *arg);
+    // 发送一帧，可被多个线程同时调用；成功返回0
+    int (*send)(uint16_t beacon, const uint8_t *frame, size_t len);
+    void (*close)(void);
+} transport_t;
+
+static int sock_fd = -1;
+static struct sockaddr_storage sock_addr;
+static socklen_t sock_addr_len;
+
+static int null_open(const char *arg) {
+    (void)arg;
+    return 0;
+}
+
+static int null_send(uint16_t beacon, const uint8_t *frame, size_t len) {
+    (void)beacon;
+    (void)frame;
+    (void)len;
+    return 0;
+}
+
+static void null_close(void) {
+}
+
+static int unix_open(const char *arg) {
+    struct sockaddr_un *a = (struct sockaddr_un *)&sock_addr;
+    if (!arg || strlen(arg) >= sizeof(a->sun_path)) return -1;
+    sock_fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (sock_fd < 0) return -1;
+    memset(a, 0, sizeof(*a));
+    a->sun_family = AF_UNIX;
+    strcpy(a->sun_path, arg);
+    sock_addr_len = sizeof(*a);
+    return 0;
+}
+
+static int udp_open(const char *arg) {
+    char host[256];
+    const char *colon = arg ? strrchr(arg, ':') : NULL;
+    struct addrinfo hints, *res;
+    size_t n;
+
+    if (!colon || (n = (size_t)(colon - arg)) >= sizeof(host)) return -1;
+    memcpy(host, arg, n);
+    host[n] = 0;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, colon + 1, &hints, &res) != 0) return -1;
+    sock_fd = socket(res->ai_family, SOCK_DGRAM, 0);
+    if (sock_fd >= 0) {
+        memcpy(&sock_addr, res->ai_addr, res->ai_addrlen);
+        sock_addr_len = (socklen_t)res->ai_addrlen;
+    }
+    freeaddrinfo(res);
+    return sock_fd < 0 ? -1 : 0;
+}
+
+// 数据报套接字：sendto()本身线程安全，对端暂时满时重试
+static int sock_send(uint16_t beacon, const uint8_t *frame, size_t len) {
+    (void)beacon;
+    for (;;) {
+        ssize_t r = sock_addr_len ? sendto(sock_fd, frame, len, 0, (struct sockaddr *)&sock_addr, sock_addr_len)
+                                  : send(sock_fd, frame, len, 0);
+        if (r == (ssize_t)len) return 0;
+        if (r < 0 && (errno == EAGAIN || errno == ENOBUFS || errno == EINTR)) {
+            usleep(100);
+            continue;
+        }
+        return -1;
+    }
+}
+
+static void sock_close(void) {
+    if (sock_fd >= 0) close(sock_fd);
+    sock_fd = -1;
+}
+
+static const transport_t transports[] = {
+    {"null", null_open, null_send, null_close},
+    {"unix", unix_open, sock_send, sock_close},
+    {"udp", udp_open, sock_send, sock_close},
+};
+
+// --check用：已连接的socketpair一端
+static int pair_open(const char *arg) {
+    (void)arg;
+    sock_addr_len = 0;
+    return 0;
+}
+
+static const transport_t pair_transport = {"pair", pair_open, sock_send, sock_close};
+
+static const transport_t *transport;
+static uint64_t send_errors;
+
+/* ---------- 工作窃取线程池 ---------- */
+
+typedef struct {
+    pthread_mutex_t lock;
+    int *items;      // 信标序号
+    int head, tail;  // [head, tail)为待处理任务
+} deque_t;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t start, finished;
+    uint64_t generation;
+    int pending;
+    int active;      // 已领取本代、还在访问队列的线程数
+    int quit;
+    uint32_t cycle;
+    double cycle_start;
+    deque_t q[MAX_THREADS];
+    uint64_t steals;
+    double *prep;    // 本周期每个信标的准备延迟，供分位数
+} pool;
+
+// 自己的队列从尾部取
+static int deque_pop(deque_t *d) {
+    int v = -1;
+    pthread_mutex_lock(&d->lock);
+    if (d->tail > d->head) v = d->items[--d->tail];
+    pthread_mutex_unlock(&d->lock);
+    return v;
+}
+
+// 窃取从头部取，与队列主人的取向相反
+static int deque_steal(deque_t *d) {
+    int v = -1;
+    pthread_mutex_lock(&d->lock);
+    if (d->tail > d->head) v = d->items[d->head++];
+    pthread_mutex_unlock(&d->lock);
+    return v;
+}
+
+static void run_job(int idx) {
+    beacon_t *b = &beacons[idx];
+    double t0 = now_sec(), t1;
+    const wspr_message_table_t *m = get_message(b);
+    const wspr_band_table_t *band = get_band(b->bands[pool.cycle % b->band_count], b->correction);
+    uint8_t frame[FRAME_BYTES];
+
+    if (!m || !band) {
+        __atomic_fetch_add(&send_errors, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    frame_pack(frame, (uint16_t)idx, pool.cycle, m, band);
+    if (transport->send((uint16_t)idx, frame, sizeof(frame)) != 0) {
+        __atomic_fetch_add(&send_errors, 1, __ATOMIC_RELAXED);
+    }
+    t1 = now_sec();
+    b->jobs++;
+    b->prep_sum += t1 - t0;
+    if (t1 - t0 > b->prep_max) b->prep_max = t1 - t0;
+    b->ready_sum += t1 - pool.cycle_start;
+    if (t1 - pool.cycle_start > b->ready_max) b->ready_max = t1 - pool.cycle_start;
+    pool.prep[idx] = t1 - t0;
+}
+
+static void *worker(void *arg) {
+    int self = (int)(intptr_t)arg;
+    uint64_t seen = 0;
+
+    for (;;) {
+        int idx, i, done = 0;
+
+        pthread_mutex_lock(&pool.lock);
+        while (pool.generation == seen && !pool.quit) pthread_cond_wait(&pool.start, &pool.lock);
+        if (pool.quit) {
+            pthread_mutex_unlock(&pool.lock);
+            return NULL;
+        }
+        seen = pool.generation;
+        pool.active++;
+        pthread_mutex_unlock(&pool.lock);
+
+        for (;;) {
+            idx = deque_pop(&pool.q[self]);
+            for (i = 1; idx < 0 && i < cfg.threads; i++) {
+                idx = deque_steal(&pool.q[(self + i) % cfg.threads]);
+                if (idx >= 0) __atomic_fetch_add(&pool.steals, 1, __ATOMIC_RELAXED);
+            }
+            if (idx < 0) break;
+            run_job(idx);
+            done++;
+        }
+
+        // 没取到任务的线程也要登记离开，之后才能重置队列
+        pthread_mutex_lock(&pool.lock);
+        pool.pending -= done;
+        pool.active--;
+        if (pool.pending == 0 || pool.active == 0) pthread_cond_signal(&pool.finished);
+        pthread_mutex_unlock(&pool.lock);
+    }
+}
+
+static int pool_init(void) {
+    int i;
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.start, NULL);
+    pthread_cond_init(&pool.finished, NULL);
+    pool.prep = (double *)calloc((size_t)beacon_count, sizeof(double));
+    if (!pool.prep) return -1;
+    for (i = 0; i < cfg.threads; i++) {
+        pthread_mutex_init(&pool.q[i].lock, NULL);
+        pool.q[i].items = (int *)malloc(sizeof(int) * (size_t)beacon_count);
+        if (!pool.q[i].items) return -1;
+    }
+    return 0;
+}
+
+// 分发一个周期的全部任务并等待完成
+static void pool_run_cycle(uint32_t cycle) {
+    int i;
+
+    pthread_mutex_lock(&pool.lock);
+    // 上一代醒得晚、没取到任务的线程可能还在扫描队列，等它们都登记离开
+    while (pool.active > 0) pthread_cond_wait(&pool.finished, &pool.lock);
+    // 此后线程须先持有pool.lock登记才能访问队列，填充期间队列只有本线程访问
+    pool.cycle = cycle;
+    pool.cycle_start = now_sec();
+    for (i = 0; i < cfg.threads; i++) {
+        pool.q[i].head = pool.q[i].tail = 0;
+    }
+    for (i = 0; i < beacon_count; i++) {
+        deque_t *d = &pool.q[i % cfg.threads];
+        d->items[d->tail++] = i;
+    }
+    pool.pending = beacon_count;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.start);
+    while (pool.pending > 0) pthread_cond_wait(&pool.finished, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+static void pool_stop(pthread_t *th) {
+    int i;
+    pthread_mutex_lock(&pool.lock);
+    pool.quit = 1;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+    for (i = 0; i < cfg.threads; i++) pthread_join(th[i], NULL);
+}
+
+/* ---------- 配置 ---------- */
+
+static char *trim(char *s) {
+    char *end;
+    while (*s == ' ' || *s == '\t') s++;
+    end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n')) end--;
+    *end = 0;
+    return s;
+}
+
+static int parse_beacon(char *val, beacon_t *b) {
+    char bands[MAX_LINE], *tok, *save;
+    int dbm;
+    long corr;
+
+    memset(b, 0, sizeof(*b));
+    if (sscanf(val, "%12s %6s %d %ld %511s", b->call, b->loc, &dbm, &corr, bands) != 5) return -1;
+    if (dbm < MIN_DBM || dbm > MAX_DBM) return -1;
+    b->dbm = (int8_t)dbm;
+    b->correction = (int32_t)corr;
+    for (tok = strtok_r(bands, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        if (b->band_count >= MAX_BEACON_BANDS) return -1;
+        b->bands[b->band_count++] = (uint32_t)strtoul(tok, NULL, 10);
+    }
+    return b->band_count ? 0 : -1;
+}
+
+static int load_config(const char *path) {
+    FILE *f = fopen(path, "r");
+    char line[MAX_LINE];
+    int lineno = 0;
+
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        char *key, *val, *eq, *hash;
+        lineno++;
+        hash = strchr(line, '#');
+        if (hash) *hash = 0;
+        key = trim(line);
+        if (*key == 0) continue;
+        eq = strchr(key, '=');
+        if (!eq) {
+            fprintf(stderr, "%s:%d: 缺少'='\n", path, lineno);
+            fclose(f);
+            return 1;
+        }
+        *eq = 0;
+        key = trim(key);
+        val = trim(eq + 1);
+
+        if (strcmp(key, "drive") == 0) {
+            char *end;
+            long drive = strtol(val, &end, 10);
+            if (end == val || *end != 0 || drive < SI5351_DRIVE_STRENGTH_2MA || drive > SI5351_DRIVE_STRENGTH_8MA) {
+                fprintf(stderr, "%s:%d: drive应为0~3（2/4/6/8mA）\n", path, lineno);
+                fclose(f);
+                return 1;
+            }
+            cfg.drive = (si5351DriveStrength_t)drive;
+        } else if (strcmp(key, "beacon") == 0) {
+            if (beacon_count >= MAX_BEACONS) {
+                fprintf(stderr, "%s:%d: 信标过多（最多%d个）\n", path, lineno, MAX_BEACONS);
+                fclose(f);
+                return 1;
+            }
+            beacon_t *b = &beacons[beacon_count];
+            wspr_band_table_t t;
+            int k;
+            if (parse_beacon(val, b) != 0) {
+                fprintf(stderr, "%s:%d: beacon格式应为\"呼号 网格 功率 校正值 频段[,频段...]\"，功率%d~%d dBm\n",
+                        path, lineno, MIN_DBM, MAX_DBM);
+                fclose(f);
+                return 1;
+            }
+            for (k = 0; k < b->band_count; k++) {
+                if (build_band(b->bands[k], b->correction, cfg.drive, &t) != 0) {
+                    fprintf(stderr, "%s:%d: 不支持的频段%lu Hz（Si5351音调表支持4kHz~75MHz）\n", path, lineno,
+                            (unsigned long)b->bands[k]);
+                    fclose(f);
+                    return 1;
+                }
+            }
+            beacon_count++;
+        } else {
+            fprintf(stderr, "%s:%d: 未知的键\"%s\"\n", path, lineno, key);
+            fclose(f);
+            return 1;
+        }
+    }
+    fclose(f);
+    if (beacon_count == 0) {
+        fprintf(stderr, "%s: 至少需要一个beacon\n", path);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * 压测用的虚拟信标群：呼号各不相同，校正值取自16个已校准批次，
+ * 每个信标在常用WSPR频段中跳3个。频率为发射频率（USB拨号频率 + 1500Hz，WSPR子带中心）。
+ */
+static void make_synthetic(int n) {
+    static const uint32_t wspr_bands[] = {475700,   1838100,  3570100,  5288700,  7040100,  10140200,
+                                          14097100, 18106100, 21096100, 24926100, 28126100, 50294500};
+    static const int8_t powers[] = {10, 13, 17, 20, 23, 27, 30, 33, 37};
+    const int nb = (int)(sizeof(wspr_bands) / sizeof(wspr_bands[0]));
+    int i, k;
+
+    beacon_count = n;
+    for (i = 0; i < n; i++) {
+        beacon_t *b = &beacons[i];
+        memset(b, 0, sizeof(*b));
+        snprintf(b->call, sizeof(b->call), "B%c%d%c%c", 'A' + i % 26, i / 676 % 10, 'A' + i / 26 % 26,
+                 'A' + (i * 7) % 26);
+        snprintf(b->loc, sizeof(b->loc), "%c%c%d%d", 'A' + i % 18, 'A' + (i / 18) % 18, i % 10, (i / 10) % 10);
+        b->dbm = powers[i % 9];
+        b->correction = (i % 16) * 61 - 480;
+        b->band_count = 3;
+        for (k = 0; k < 3; k++) b->bands[k] = wspr_bands[(i + k * 5) % nb];
+    }
+}
+
+/* ---------- 接收端（--listen与--check） ---------- */
+
+/*
+ * 校验一帧，返回0表示通过。不重复方案计算：符号与直接编码的结果比对；
+ * 寄存器映像解码回频率（Fpll/MS/R，还原校正）与载波 + k·12000/8192 Hz比对，
+ * 并检查PLL、MS的取值范围和CLK控制寄存器（PLLA、MultiSynth输入、未关断、驱动强度）。
+ */
+static int verify_frame(const uint8_t *f, size_t len) {
+    wspr_message_table_t m;
+    uint16_t idx;
+    uint32_t cycle, freq;
+    const beacon_t *b;
+    double fpll;
+    int k;
+
+    if (len != FRAME_BYTES || memcmp(f, FRAME_MAGIC, 4) != 0 || f[6] != FRAME_VERSION) return -1;
+    idx = (uint16_t)(f[4] | (f[5] << 8));
+    cycle = get32(f + 8);
+    freq = get32(f + 12);
+    if (idx >= beacon_count) return -1;
+    b = &beacons[idx];
+    if (freq != b->bands[cycle % b->band_count] || (f[7] & 0xAF) != (0x0C | cfg.drive)) return -1;
+
+    fpll = 25e6 * si5351_RegsRatio(f + 16);
+    if (fpll < 600e6 || fpll > 900e6 + 1) return -1;
+    for (k = 0; k < WSPR_TABLE_TONES; k++) {
+        const uint8_t *ms_regs = f + 24 + k * SI5351_BULK_REGS;
+        double ms = si5351_RegsRatio(ms_regs);
+        double fo = fpll / ms / si5351_RegsRDiv(ms_regs) * 1e8 / (1e8 - b->correction);
+        double want = freq + k * 12000.0 / 8192.0;
+        if (ms < 8 || ms > 2048 || fo - want > TONE_TOLERANCE_HZ || want - fo > TONE_TOLERANCE_HZ) return -1;
+    }
+
+    build_message(b->call, b->loc, b->dbm, &m);
+    return memcmp(m.symbols, f + 56, WSPR_TABLE_SYMBOL_BYTES) == 0 ? 0 : -1;
+}
+
+typedef struct {
+    int fd;
+    uint64_t expect;
+    uint64_t frames, bad;
+} listener_t;
+
+static void *listen_thread(void *arg) {
+    listener_t *l = (listener_t *)arg;
+    uint8_t buf[FRAME_BYTES + 16];
+
+    while (l->expect == 0 || l->frames < l->expect) {
+        ssize_t r = recv(l->fd, buf, sizeof(buf), 0);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        l->frames++;
+        if (verify_frame(buf, (size_t)r) != 0) l->bad++;
+    }
+    return NULL;
+}
+
+static int open_listen_socket(const char *spec) {
+    int fd = -1;
+    if (strncmp(spec, "unix:", 5) == 0) {
+        struct sockaddr_un a;
+        if (strlen(spec + 5) >= sizeof(a.sun_path)) return -1;
+        memset(&a, 0, sizeof(a));
+        a.sun_family = AF_UNIX;
+        strcpy(a.sun_path, spec + 5);
+        unlink(a.sun_path);
+        fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if (fd >= 0 && bind(fd, (struct sockaddr *)&a, sizeof(a)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else if (strncmp(spec, "udp:", 4) == 0) {
+        struct sockaddr_in a;
+        memset(&a, 0, sizeof(a));
+        a.sin_family = AF_INET;
+        a.sin_port = htons((uint16_t)atoi(spec + 4));
+        a.sin_addr.s_addr = htonl(INADDR_ANY);
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd >= 0 && bind(fd, (struct sockaddr *)&a, sizeof(a)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    return fd;
+}
+
+/* ---------- 主流程 ---------- */
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// 等到下一个偶数分钟前cfg.lead秒，返回该发射周期号（UTC秒/120）
+static uint32_t wait_for_slot(void) {
+    struct timespec ts;
+    double now, slot;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    now = ts.tv_sec + ts.tv_nsec * 1e-9;
+    slot = (double)(((uint64_t)(now + cfg.lead) / 120 + 1) * 120);
+    if (slot - cfg.lead > now) usleep((useconds_t)((slot - cfg.lead - now) * 1e6));
+    return (uint32_t)(slot / 120);
+}
+
+static void cache_report(void) {
+    fprintf(stderr, "消息缓存: %llu 项，命中 %llu，未命中 %llu，等待 %llu\n",
+            (unsigned long long)msg_cache.entries, (unsigned long long)msg_cache.hits,
+            (unsigned long long)msg_cache.misses, (unsigned long long)msg_cache.waits);
+    fprintf(stderr, "方案缓存: %llu 项，命中 %llu，未命中 %llu，等待 %llu\n",
+            (unsigned long long)band_cache.entries, (unsigned long long)band_cache.hits,
+            (unsigned long long)band_cache.misses, (unsigned long long)band_cache.waits);
+}
+
+static int write_stats(const char *path) {
+    FILE *f = fopen(path, "w");
+    int i;
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    fprintf(f, "beacon,call,jobs,prep_avg_us,prep_max_us,ready_avg_us,ready_max_us\n");
+    for (i = 0; i < beacon_count; i++) {
+        const beacon_t *b = &beacons[i];
+        double n = b->jobs ? (double)b->jobs : 1.0;
+        fprintf(f, "%d,%s,%llu,%.2f,%.2f,%.2f,%.2f\n", i, b->call, (unsigned long long)b->jobs,
+                b->prep_sum / n * 1e6, b->prep_max * 1e6, b->ready_sum / n * 1e6, b->ready_max * 1e6);
+    }
+    fclose(f);
+    return 0;
+}
+
+static int run_daemon(void) {
+    pthread_t th[MAX_THREADS];
+    double *sorted = (double *)malloc(sizeof(double) * (size_t)beacon_count);
+    uint64_t c;
+    int i;
+
+    if (!sorted || pool_init() != 0) {
+        fprintf(stderr, "内存不足\n");
+        return 1;
+    }
+    for (i = 0; i < cfg.threads; i++) pthread_create(&th[i], NULL, worker, (void *)(intptr_t)i);
+
+    for (c = 0; cfg.cycles == 0 || c < cfg.cycles; c++) {
+        uint32_t cycle = cfg.realtime ? wait_for_slot() : (uint32_t)c;
+        double t0 = now_sec(), t1;
+        pool_run_cycle(cycle);
+        t1 = now_sec();
+        memcpy(sorted, pool.prep, sizeof(double) * (size_t)beacon_count);
+        qsort(sorted, (size_t)beacon_count, sizeof(double), cmp_double);
+        if (cfg.realtime || c < 3 || c + 1 == cfg.cycles) {
+            fprintf(stderr, "周期 %lu: %d 帧，%.2f ms，准备延迟 p50 %.1f us / p99 %.1f us / 最大 %.1f us\n",
+                    (unsigned long)cycle, beacon_count, (t1 - t0) * 1e3, sorted[beacon_count / 2] * 1e6,
+                    sorted[beacon_count * 99 / 100] * 1e6, sorted[beacon_count - 1] * 1e6);
+        }
+    }
+
+    pool_stop(th);
+    free(sorted);
+    cache_report();
+    fprintf(stderr, "窃取 %llu 次，发送失败 %llu 帧\n", (unsigned long long)pool.steals,
+            (unsigned long long)send_errors);
+    if (cfg.stats_path && write_stats(cfg.stats_path) != 0) return 1;
+    return send_errors ? 3 : 0;
+}
+
+static int self_check(void) {
+    int sv[2], rc;
+    pthread_t lt;
+    listener_t l;
+    int bufsize = 4 << 20;
+
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sv) != 0) {
+        perror("socketpair");
+        return 1;
+    }
+    setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+    sock_fd = sv[0];
+    transport = &pair_transport;
+    transport->open(NULL);
+    if (cfg.cycles == 0) cfg.cycles = 6;
+
+    memset(&l, 0, sizeof(l));
+    l.fd = sv[1];
+    l.expect = cfg.cycles * (uint64_t)beacon_count;
+    pthread_create(&lt, NULL, listen_thread, &l);
+    rc = run_daemon();
+    pthread_join(lt, NULL);
+    close(sv[1]);
+    transport->close();
+
+    printf("%llu 帧，%llu 帧校验失败 -> %s\n", (unsigned long long)l.frames, (unsigned long long)l.bad,
+           rc == 0 && l.bad == 0 ? "通过" : "失败");
+    return rc == 0 && l.bad == 0 ? 0 : 3;
+}
+
+static int run_listener(void) {
+    listener_t l;
+    int fd = open_listen_socket(cfg.listen);
+    if (fd < 0) {
+        fprintf(stderr, "无法监听 %s\n", cfg.listen);
+        return 1;
+    }
+    memset(&l, 0, sizeof(l));
+    l.fd = fd;
+    l.expect = cfg.frames;
+    listen_thread(&l);
+    close(fd);
+    fprintf(stderr, "收到 %llu 帧，%llu 帧校验失败\n", (unsigned long long)l.frames, (unsigned long long)l.bad);
+    return l.bad ? 3 : 0;
+}
+
+static const transport_t *find_transport(const char *spec, const char **arg) {
+    size_t i;
+    const char *colon = strchr(spec, ':');
+    size_t n = colon ? (size_t)(colon - spec) : strlen(spec);
+    *arg = colon ? colon + 1 : NULL;
+    for (i = 0; i < sizeof(transports) / sizeof(transports[0]); i++) {
+        if (strlen(transports[i].name) == n && strncmp(transports[i].name, spec, n) == 0) return &transports[i];
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    const char *config = NULL, *targ;
+    int bad_args = 0, check = 0, i, rc;
+
+    cfg.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    cfg.transport = "null";
+    cfg.lead = 1.0;
+    cfg.drive = SI5351_DRIVE_STRENGTH_8MA;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            cfg.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--transport") == 0 && i + 1 < argc) {
+            cfg.transport = argv[++i];
+        } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            cfg.cycles = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--realtime") == 0) {
+            cfg.realtime = 1;
+        } else if (strcmp(argv[i], "--lead") == 0 && i + 1 < argc) {
+            cfg.lead = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            cfg.stats_path = argv[++i];
+        } else if (strcmp(argv[i], "--synthetic") == 0 && i + 1 < argc) {
+            cfg.synthetic = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+            cfg.listen = argv[++i];
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            cfg.frames = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--check") == 0) {
+            check = 1;
+        } else if (argv[i][0] != '-' && !config) {
+            config = argv[i];
+        } else {
+            bad_args = 1;
+        }
+    }
+    if (check && !config && cfg.synthetic == 0) cfg.synthetic = 300;
+    if ((!config) == (cfg.synthetic == 0) || cfg.synthetic < 0 || cfg.synthetic > MAX_BEACONS || cfg.lead < 0.0) {
+        bad_args = 1;
+    }
+    if (bad_args) {
+        fprintf(stderr,
+                "用法: %s [-j 线程数] [--transport null|unix:/路径|udp:主机:端口] [--cycles N]\n"
+                "          [--realtime] [--lead 秒] [--stats 每信标.csv] (fleet.cfg | --synthetic N)\n"
+                "       %s --listen unix:/路径|udp:端口 [--frames N] (fleet.cfg | --synthetic N)\n"
+                "       %s --check [--synthetic N]\n",
+                argv[0], argv[0], argv[0]);
+        return 2;
+    }
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.threads > MAX_THREADS) cfg.threads = MAX_THREADS;
+
+    if (config) {
+        if (load_config(config) != 0) return 1;
+    } else {
+        make_synthetic(cfg.synthetic);
+    }
+
+    if (cfg.listen) return run_listener();
+    if (check) return self_check();
+
+    transport = find_transport(cfg.transport, &targ);
+    if (!transport || transport->open(targ) != 0) {
+        fprintf(stderr, "无法打开传输 %s\n", cfg.transport);
+        return 1;
+    }
+    if (cfg.cycles == 0 && !cfg.realtime) cfg.cycles = 100;
+    fprintf(stderr, "%d 个信标，%d 线程，传输 %s\n", beacon_count, cfg.threads, transport->name);
+    rc = run_daemon();
+    transport->close();
+    return rc;
+}
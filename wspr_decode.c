@@ -0,0 +1,341 @@
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "wspr_decode.h"
+
+// 两个反馈多项式，与 convolve() 相同
+#define WSPR_POLY0 0xf2d05351u
+#define WSPR_POLY1 0xe4613c47u
+
+// 28 位呼号编码的上限：37*36*10*27*27*27
+#define WSPR_CALL_LIMIT 262177560u
+
+// 交织置换（与 encode.c 中 wspr_interleave_dest 相同）：交织后的第 src[i] 位是卷积输出的第 i 位
+static const uint8_t wspr_deinterleave_src[WSPR_BIT_COUNT] = {
+	0, 128, 64, 32, 160, 96, 16, 144, 80, 48, 112, 8, 136, 72, 40, 104, 24, 152,
+	88, 56, 120, 4, 132, 68, 36, 100, 20, 148, 84, 52, 116, 12, 140, 76, 44, 108,
+	28, 156, 92, 60, 124, 2, 130, 66, 34, 98, 18, 146, 82, 50, 114, 10, 138, 74,
+	42, 106, 26, 154, 90, 58, 122, 6, 134, 70, 38, 102, 22, 150, 86, 54, 118, 14,
+	142, 78, 46, 110, 30, 158, 94, 62, 126, 1, 129, 65, 33, 161, 97, 17, 145, 81,
+	49, 113, 9, 137, 73, 41, 105, 25, 153, 89, 57, 121, 5, 133, 69, 37, 101, 21,
+	149, 85, 53, 117, 13, 141, 77, 45, 109, 29, 157, 93, 61, 125, 3, 131, 67, 35,
+	99, 19, 147, 83, 51, 115, 11, 139, 75, 43, 107, 27, 155, 91, 59, 123, 7, 135,
+	71, 39, 103, 23, 151, 87, 55, 119, 15, 143, 79, 47, 111, 31, 159, 95, 63, 127,
+};
+
+/**
+ * @brief 解交织，wspr_interleave() 的逆运算。
+ *
+ * @param s 输入输出数组，长度为 WSPR_BIT_COUNT，可以是比特或软符号。
+ */
+void wspr_deinterleave(uint8_t *s)
+{
+	uint8_t d[WSPR_BIT_COUNT];
+	uint8_t i;
+
+	for (i = 0; i < WSPR_BIT_COUNT; i++)
+	{
+		d[i] = s[wspr_deinterleave_src[i]];
+	}
+	memcpy(s, d, WSPR_BIT_COUNT);
+}
+
+/**
+ * @brief 生成 Fano 译码的度量表。
+ *
+ * @param mt 输出的度量表。
+ * @param amp 软符号偏离 128 的幅度。
+ * @param sigma 软符号的噪声标准差。
+ *
+ * 度量为 log2(P(r|b) / P(r)) - 1/2（减去码率），乘以 WSPR_FANO_SCALE 取整。
+ * 1 + exp(d) 在 d 很大时按 d 近似，不会因为概率下溢得到 -inf。
+ */
+void wspr_fano_metrics(wspr_fano_metric_t *mt, double amp, double sigma)
+{
+	int r, b;
+
+	for (r = 0; r < 256; r++)
+	{
+		double x = r - 128.0;
+		// 两种假设下的对数似然（只差一个公共常数）
+		double l0 = -(x + amp) * (x + amp) / (2.0 * sigma * sigma);
+		double l1 = -(x - amp) * (x - amp) / (2.0 * sigma * sigma);
+		for (b = 0; b < 2; b++)
+		{
+			double d = b ? (l0 - l1) : (l1 - l0);
+			double lse = (d > 30.0) ? d : log1p(exp(d));
+			double m = (1.0 - lse / log(2.0) - 0.5) * WSPR_FANO_SCALE;
+			if (m < -100.0 * WSPR_FANO_SCALE)
+			{
+				m = -100.0 * WSPR_FANO_SCALE;
+			}
+			mt->m[b][r] = (int)lround(m);
+		}
+	}
+}
+
+// 编码器状态（最近 32 个输入比特）对应的两个输出比特：高位为多项式 0
+static uint8_t wspr_branch(uint32_t state)
+{
+	return (uint8_t)((__builtin_parity(state & WSPR_POLY0) << 1) | __builtin_parity(state & WSPR_POLY1));
+}
+
+/**
+ * @brief Fano 序列译码（K=32，r=1/2）。
+ *
+ * 沿码树前进，路径度量低于门限时回退尝试次优分支；前进和回退都走不通时
+ * 放宽门限。尾部 31 个比特已知为 0，只走 0 分支。节点数组在栈上（约 3KB）。
+ */
+int wspr_fano_decode(const uint8_t *s, const wspr_fano_metric_t *mt, int delta, uint32_t max_cycles,
+                     uint64_t *word, uint32_t *cycles, int32_t *metric)
+{
+	struct
+	{
+		uint64_t state;  // 到本节点为止的输入比特，低位为本节点的比特
+		int32_t gamma;   // 到本节点的路径度量
+		int32_t bm[4];   // 本节点四种输出比特组合的分支度量
+		int32_t tm[2];   // 最优、次优分支的度量
+		uint8_t i;       // 当前尝试的分支（0 最优，1 次优）
+	} node[WSPR_DECODE_BITS + 1], *np;
+	const int tail = WSPR_DECODE_BITS - 31;
+	int32_t t = 0;
+	uint32_t n;
+	uint8_t k, lsym;
+	int32_t m0, m1;
+
+	for (k = 0; k < WSPR_DECODE_BITS; k++)
+	{
+		uint8_t r0 = s[2 * k], r1 = s[2 * k + 1];
+		node[k].bm[0] = mt->m[0][r0] + mt->m[0][r1];
+		node[k].bm[1] = mt->m[0][r0] + mt->m[1][r1];
+		node[k].bm[2] = mt->m[1][r0] + mt->m[0][r1];
+		node[k].bm[3] = mt->m[1][r0] + mt->m[1][r1];
+	}
+
+	np = node;
+	np->state = 0;
+	np->gamma = 0;
+	lsym = wspr_branch(0);
+	m0 = np->bm[lsym];
+	m1 = np->bm[3 ^ lsym];
+	if (m0 > m1)
+	{
+		np->tm[0] = m0;
+		np->tm[1] = m1;
+	}
+	else
+	{
+		// 输入比特 1 更好：状态低位置 1 作为首选分支
+		np->tm[0] = m1;
+		np->tm[1] = m0;
+		np->state++;
+	}
+	np->i = 0;
+
+	for (n = 1; n <= max_cycles; n++)
+	{
+		int32_t ngamma = np->gamma + np->tm[np->i];
+		if (ngamma >= t)
+		{
+			// 首次到达该节点时收紧门限
+			if (np->gamma < t + delta)
+			{
+				while (ngamma >= t + delta)
+				{
+					t += delta;
+				}
+			}
+			np[1].gamma = ngamma;
+			np[1].state = np->state << 1;
+			if (++np == &node[WSPR_DECODE_BITS])
+			{
+				break;
+			}
+			lsym = wspr_branch((uint32_t)np->state);
+			if (np - node >= tail)
+			{
+				np->tm[0] = np->bm[lsym];
+			}
+			else
+			{
+				m0 = np->bm[lsym];
+				m1 = np->bm[3 ^ lsym];
+				if (m0 > m1)
+				{
+					np->tm[0] = m0;
+					np->tm[1] = m1;
+				}
+				else
+				{
+					np->tm[0] = m1;
+					np->tm[1] = m0;
+					np->state++;
+				}
+			}
+			np->i = 0;
+			continue;
+		}
+
+		// 无法前进：回退
+		for (;;)
+		{
+			if (np == node || np[-1].gamma < t)
+			{
+				// 也无法回退：放宽门限，从最优分支重新前进
+				t -= delta;
+				if (np->i != 0)
+				{
+					np->i = 0;
+					np->state ^= 1;
+				}
+				break;
+			}
+			if (--np - node < tail && np->i != 1)
+			{
+				// 尝试次优分支
+				np->i++;
+				np->state ^= 1;
+				break;
+			}
+		}
+	}
+
+	if (cycles)
+	{
+		*cycles = (n > max_cycles) ? max_cycles : n;
+	}
+	if (metric)
+	{
+		*metric = np->gamma;
+	}
+	if (n > max_cycles)
+	{
+		return -1;
+	}
+	*word = node[49].state & 0x3ffffffffffffULL;
+	return 0;
+}
+
+// 6 字符呼号格式（36/36/10/27/27/27 进制）展开为字符，返回 -1 表示超出范围
+static int wspr_unpack_call(uint32_t n, char *c)
+{
+	static const char alphabet[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ ";
+	uint8_t i;
+
+	if (n >= WSPR_CALL_LIMIT)
+	{
+		return -1;
+	}
+	for (i = 5; i >= 3; i--)
+	{
+		c[i] = alphabet[n % 27 + 10];
+		n /= 27;
+	}
+	c[2] = alphabet[n % 10];
+	n /= 10;
+	c[1] = alphabet[n % 36];
+	c[0] = alphabet[n / 36];
+	return 0;
+}
+
+// 去掉首尾空格后复制
+static void wspr_trim_copy(char *dst, const char *src, uint8_t len)
+{
+	while (len && src[0] == ' ')
+	{
+		src++;
+		len--;
+	}
+	while (len && src[len - 1] == ' ')
+	{
+		len--;
+	}
+	memcpy(dst, src, len);
+	dst[len] = 0;
+}
+
+/**
+ * @brief 解包 50 比特载荷，wspr_pack50() 的逆运算。
+ *
+ * 按功率字段区分类型（与 WSJT 相同）：|ntype| 的个位为 0、3、7 时为类型 1；
+ * 为负时为类型 3；否则为类型 2，个位减去附加值得到功率。类型 2 的两位数字
+ * 后缀超出 wspr_pack50() 的 22 比特，编码端已不可逆，这里只按前缀/单字符后缀解。
+ */
+int wspr_unpack50(uint64_t word, wspr_decoded_t *out)
+{
+	uint32_t n = (uint32_t)(word >> 22) & 0x0fffffff;
+	uint32_t m = (uint32_t)word & 0x3fffff;
+	int32_t ntype = (int32_t)(m & 127) - 64;
+	uint32_t ng = m >> 7;
+	uint8_t nu = (uint8_t)((ntype < 0 ? -ntype : ntype) % 10);
+	char c[6];
+
+	memset(out, 0, sizeof(*out));
+	if (wspr_unpack_call(n, c) != 0)
+	{
+		return -1;
+	}
+
+	if (nu == 0 || nu == 3 || nu == 7)
+	{
+		out->type = 1;
+		if (ng >= 32400)
+		{
+			return -1;
+		}
+		wspr_trim_copy(out->callsign, c, 6);
+		out->locator[0] = (char)('A' + (179 - ng / 180) / 10);
+		out->locator[1] = (char)('A' + (ng % 180) / 10);
+		out->locator[2] = (char)('0' + (179 - ng / 180) % 10);
+		out->locator[3] = (char)('0' + ng % 10);
+		out->power = (int8_t)ntype;
+	}
+	else if (ntype < 0)
+	{
+		// 类型 3：呼号字段是首字符移到末尾的 6 字符网格
+		out->type = 3;
+		out->locator[0] = c[5];
+		memcpy(out->locator + 1, c, 5);
+		out->hash = (uint16_t)(ng & 32767);
+		out->power = (int8_t)(-ntype - 1);
+	}
+	else
+	{
+		static const char alphabet[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ ";
+		uint8_t nadd = nu;
+		char base[7];
+		if (nu > 3) nadd = nu - 3;
+		if (nu > 7) nadd = nu - 7;
+		ng += 32768u * (nadd - 1);
+		out->type = 2;
+		out->power = (int8_t)(ntype - nadd);
+		wspr_trim_copy(base, c, 6);
+		if (ng < 60000)
+		{
+			// 前缀：3 个 37 进制字符
+			char p[3];
+			p[2] = alphabet[ng % 37];
+			p[1] = alphabet[(ng / 37) % 37];
+			p[0] = alphabet[ng / 1369 % 37];
+			wspr_trim_copy(out->callsign, p, 3);
+			strcat(out->callsign, "/");
+			strncat(out->callsign, base, 12 - strlen(out->callsign));
+		}
+		else
+		{
+			uint32_t nc = ng - 60000;
+			strcpy(out->callsign, base);
+			strcat(out->callsign, "/");
+			if (nc < 36)
+			{
+				out->callsign[strlen(out->callsign) + 1] = 0;
+				out->callsign[strlen(out->callsign)] = alphabet[nc];
+			}
+			else
+			{
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef WSPR_DECODE_H
+#define WSPR_DECODE_H
+
+#include <stdint.h>
+#include "encode.h"
+
+/*
+ * 接收端的逆流程：解交织、Fano序列译码、解包，与encode.c的
+ * wspr_interleave()、wspr_convolve50()、wspr_pack50()一一对应。
+ * 供wspr_sweep（往返校验）和wspr_snr（灵敏度仿真）使用，全部可重入。
+ *
+ * 软符号为0~255：越小越像比特0，越大越像比特1，128表示无信息。
+ */
+
+// 载荷50比特加31个尾零
+#define WSPR_DECODE_BITS 81
+
+// Fano译码的度量表缩放（理想接收时每个分支度量为+WSPR_FANO_SCALE）
+#define WSPR_FANO_SCALE 10
+
+typedef struct {
+	int m[2][256]; // m[b][r]：发送比特b、收到软符号r时的分支度量
+} wspr_fano_metric_t;
+
+// 解包结果
+typedef struct {
+	uint8_t type;       // 1：普通；2：带前缀/后缀；3：哈希呼号 + 6字符网格
+	char callsign[13];  // 类型3为空串
+	char locator[7];    // 类型2为空串
+	int8_t power;
+	uint16_t hash;      // 类型3的15比特呼号哈希
+} wspr_decoded_t;
+
+// 解交织：wspr_interleave()的逆，s为162个比特或软符号，原地处理
+void wspr_deinterleave(uint8_t *s);
+
+// 按高斯信道生成度量表：比特0/1的软符号均值为128∓amp，标准差sigma
+void wspr_fano_metrics(wspr_fano_metric_t *mt, double amp, double sigma);
+
+/*
+ * Fano序列译码。s为解交织后的162个软符号，delta为门限步长（通常取
+ * 3~6倍WSPR_FANO_SCALE），max_cycles为最多的前进/回退次数。
+ * 成功返回0并在*word写入50比特载荷；超过max_cycles返回-1。
+ * cycles、metric可为NULL，分别返回所用步数和路径度量。
+ */
+int wspr_fano_decode(const uint8_t *s, const wspr_fano_metric_t *mt, int delta, uint32_t max_cycles,
+                     uint64_t *word, uint32_t *cycles, int32_t *metric);
+
+// 解包wspr_pack50()的载荷。载荷无效（网格或功率超出范围）时返回-1
+int wspr_unpack50(uint64_t word, wspr_decoded_t *out);
+
+#endif
@@ -0,0 +1,451 @@
+// wspr_encode.hpp - encode.c的header-only C++17 constexpr版本
+//
+// 与encode.c逐步对应（消息预处理、比特打包、卷积、交织、合并同步向量），
+// 所有函数均为constexpr。固定消息可在编译期生成符号：
+//
+//   constexpr auto tx = wspr::encode("BI1TPH", "ON80", 10);
+//   constexpr auto tx_packed = wspr::encode<wspr::output::packed>("BI1TPH", "ON80", 10);
+//
+// 生成的表格是只读常量，运行时不占用周期和RAM（编译器把它放进Flash/.rodata）。
+// output::packed 的布局与wspr_table.h的WSPR_TABLE_SYMBOL()一致，每字节4个符号、低位在前。
+//
+// 文件末尾的static_assert用encode.c的黄金向量校验本实现；
+// 定义WSPR_CONSTEXPR_NO_SELF_CHECK可跳过。
+
+#ifndef WSPR_ENCODE_HPP
+#define WSPR_ENCODE_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace wspr {
+
+constexpr std::size_t bit_count = 162;
+constexpr std::size_t symbol_count = 162;
+constexpr std::size_t message_byte_size = 11;
+constexpr std::size_t packed_size = (symbol_count + 3) / 4;
+
+// 输出格式
+enum class output {
+    symbols, // std::array<uint8_t, 162>，每字节一个符号（0~3）
+    packed,  // std::array<uint8_t, 41>，每字节4个符号
+};
+
+namespace detail {
+
+constexpr bool is_digit(char c) { return c >= '0' && c <= '9'; }
+constexpr bool is_upper(char c) { return c >= 'A' && c <= 'Z'; }
+constexpr char to_upper(char c) { return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 32) : c; }
+
+constexpr std::size_t str_len(const char *s, std::size_t max)
+{
+    std::size_t n = 0;
+    while (n < max && s[n] != 0) n++;
+    return n;
+}
+
+// 等价于 strncpy(dst, src, n)
+template <std::size_t N>
+constexpr void copy_n(std::array<char, N> &dst, const char *src, std::size_t n, std::size_t at = 0)
+{
+    std::size_t i = 0;
+    for (; i < n && src[i] != 0; i++) dst[at + i] = src[i];
+    for (; i < n; i++) dst[at + i] = 0;
+}
+
+constexpr uint32_t rot(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+
+// nhash.c中nhash_()的逐字节版本（各对齐分支结果相同）
+constexpr uint32_t nhash(const char *key, std::size_t length, uint32_t initval)
+{
+    uint32_t a = 0xdeadbeef + static_cast<uint32_t>(length) + initval;
+    uint32_t b = a, c = a;
+    std::size_t k = 0;
+
+    auto byte = [&](std::size_t i) { return static_cast<uint32_t>(static_cast<uint8_t>(key[k + i])); };
+
+    while (length > 12) {
+        a += byte(0) + (byte(1) << 8) + (byte(2) << 16) + (byte(3) << 24);
+        b += byte(4) + (byte(5) << 8) + (byte(6) << 16) + (byte(7) << 24);
+        c += byte(8) + (byte(9) << 8) + (byte(10) << 16) + (byte(11) << 24);
+        a -= c; a ^= rot(c, 4);  c += b;
+        b -= a; b ^= rot(a, 6);  a += c;
+        c -= b; c ^= rot(b, 8);  b += a;
+        a -= c; a ^= rot(c, 16); c += b;
+        b -= a; b ^= rot(a, 19); a += c;
+        c -= b; c ^= rot(b, 4);  b += a;
+        length -= 12;
+        k += 12;
+    }
+    if (length == 0) return c;
+
+    for (std::size_t i = 0; i < length; i++) {
+        uint32_t v = byte(i) << ((i & 3) * 8);
+        if (i < 4) a += v;
+        else if (i < 8) b += v;
+        else c += v;
+    }
+
+    c ^= b; c -= rot(b, 14);
+    a ^= c; a -= rot(c, 11);
+    b ^= a; b -= rot(a, 25);
+    c ^= b; c -= rot(b, 16);
+    a ^= c; a -= rot(c, 4);
+    b ^= a; b -= rot(a, 14);
+    c ^= b; c -= rot(b, 24);
+    return c;
+}
+
+// 与encode.c中wspr_code()相同
+constexpr uint8_t code(char c)
+{
+    if (is_digit(c)) return static_cast<uint8_t>(c - 48);
+    if (is_upper(c)) return static_cast<uint8_t>(c - 55);
+    return 36;
+}
+
+// 第2位为数字、第3位为字母时前6个字符右移一位、首位补空格（与encode.c相同）。
+// 移位只涉及固定的前6个元素，不随N变化，两种实例化（12和7）都不会越界
+template <std::size_t N>
+constexpr void pad_callsign(std::array<char, N> &call)
+{
+    static_assert(N >= 6, "呼号缓冲区至少6个字符");
+    if (is_digit(call[1]) && is_upper(call[2])) {
+        const std::array<char, 6> shifted{{' ', call[0], call[1], call[2], call[3], call[4]}};
+        for (std::size_t i = 0; i < shifted.size(); i++) call[i] = shifted[i];
+    }
+}
+
+// 6字符呼号的28位编码（36/36/10/27/27/27）
+template <std::size_t N>
+constexpr uint32_t pack_call(const std::array<char, N> &c)
+{
+    uint32_t n = code(c[0]);
+    n = n * 36 + code(c[1]);
+    n = n * 10 + code(c[2]);
+    n = n * 27 + (code(c[3]) - 10u);
+    n = n * 27 + (code(c[4]) - 10u);
+    n = n * 27 + (code(c[5]) - 10u);
+    return n;
+}
+
+template <std::size_t N>
+constexpr void sanitize(std::array<char, N> &s, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; i++) {
+        s[i] = to_upper(s[i]);
+        if (!(is_digit(s[i]) || is_upper(s[i]))) s[i] = ' ';
+    }
+}
+
+} // namespace detail
+
+// 规范化后的消息，对应encode.c中的callsign/locator/power全局变量
+struct message {
+    std::array<char, 12> callsign{};
+    std::array<char, 7> locator{};
+    int8_t power = 0;
+};
+
+// 对应wspr_message_prep()
+constexpr message message_prep(const char *call, const char *loc, int8_t dbm)
+{
+    using namespace detail;
+    message msg{};
+
+    std::array<char, 13> call_{};
+    copy_n(call_, call, 12);
+    for (std::size_t i = 0; i < 12; i++) {
+        if (call_[i] != '/' && call_[i] != '<' && call_[i] != '>') {
+            call_[i] = to_upper(call_[i]);
+            if (!(is_digit(call_[i]) || is_upper(call_[i]))) call_[i] = ' ';
+        }
+    }
+    for (std::size_t i = 0; i < 12; i++) msg.callsign[i] = call_[i];
+
+    std::array<char, 7> loc_{};
+    copy_n(loc_, loc, 6);
+    constexpr std::array<char, 7> fallback{{'A', 'A', '0', '0', 'A', 'A', 0}};
+    std::size_t len = str_len(loc_.data(), 7);
+    if (len == 4 || len == 6) {
+        for (std::size_t i = 0; i <= 1; i++) {
+            loc_[i] = to_upper(loc_[i]);
+            if (loc_[i] < 'A' || loc_[i] > 'R') loc_ = fallback;
+        }
+        for (std::size_t i = 2; i <= 3; i++) {
+            if (!is_digit(loc_[i])) loc_ = fallback;
+        }
+    } else {
+        loc_ = fallback;
+    }
+    if (str_len(loc_.data(), 7) == 6) {
+        for (std::size_t i = 4; i <= 5; i++) {
+            loc_[i] = to_upper(loc_[i]);
+            if (loc_[i] < 'A' || loc_[i] > 'X') loc_ = fallback;
+        }
+    }
+    msg.locator = loc_;
+    msg.locator[6] = 0;
+
+    constexpr int8_t valid_dbm[] = {-30, -27, -23, -20, -17, -13, -10, -7, -3,
+                                    0, 3, 7, 10, 13, 17, 20, 23, 27, 30, 33, 37, 40,
+                                    43, 47, 50, 53, 57, 60};
+    constexpr std::size_t valid_count = sizeof(valid_dbm) / sizeof(valid_dbm[0]);
+    msg.power = valid_dbm[0];
+    for (std::size_t i = 0; i < valid_count; i++) {
+        if (dbm == valid_dbm[i]) msg.power = dbm;
+    }
+    for (std::size_t i = 1; i < valid_count; i++) {
+        if (dbm < valid_dbm[i] && dbm >= valid_dbm[i - 1]) msg.power = valid_dbm[i - 1];
+    }
+    return msg;
+}
+
+// 对应wspr_bit_packing()，返回11字节消息
+constexpr std::array<uint8_t, message_byte_size> bit_packing(message msg)
+{
+    using namespace detail;
+    const auto &cs = msg.callsign;
+    const int32_t power = msg.power;
+    uint32_t n = 0, m = 0;
+
+    std::size_t slash = 12;
+    for (std::size_t i = 0; i < 12; i++) {
+        if (cs[i] == '/') { slash = i; break; }
+    }
+
+    if (cs[0] == '<') {
+        // 类型 3 消息
+        std::size_t bracket = 1;
+        while (bracket < 12 && cs[bracket] != '>') bracket++;
+        uint32_t hash = nhash(cs.data() + 1, bracket - 1, 146) & 32767;
+
+        auto &l = msg.locator;
+        std::array<char, 6> rotated{{l[1], l[2], l[3], l[4], l[5], l[0]}};
+        n = pack_call(rotated);
+        m = (hash * 128) - static_cast<uint32_t>(power + 1) + 64;
+    } else if (slash == 12) {
+        // 类型 1 消息
+        std::array<char, 12> local = cs;
+        pad_callsign(local);
+        n = pack_call(local);
+
+        const auto &l = msg.locator;
+        m = static_cast<uint32_t>((179 - 10 * (l[0] - 'A') - (l[2] - '0')) * 180) +
+            static_cast<uint32_t>(10 * (l[1] - 'A')) + static_cast<uint32_t>(l[3] - '0');
+        m = (m * 128) + static_cast<uint32_t>(power) + 64;
+    } else {
+        // 类型 2 消息
+        auto at = [&](std::size_t i) { return i < 12 ? cs[i] : '\0'; };
+        std::array<char, 7> base{};
+
+        if (at(slash + 2) == ' ' || at(slash + 2) == 0) {
+            // 单字符后缀
+            copy_n(base, cs.data(), slash < 7 ? slash : 7);
+            sanitize(base, 7);
+            pad_callsign(base);
+            n = pack_call(base);
+
+            char x = at(slash + 1);
+            uint32_t v = is_digit(x) ? static_cast<uint32_t>(x - 48)
+                       : is_upper(x) ? static_cast<uint32_t>(x - 55) : 38u;
+            m = 60000 - 32768 + v;
+            m = (m * 128) + static_cast<uint32_t>(power) + 2 + 64;
+        } else if (at(slash + 3) == ' ' || at(slash + 3) == 0) {
+            // 两位数字后缀
+            copy_n(base, cs.data(), slash < 7 ? slash : 7);
+            sanitize(base, 6);
+            pad_callsign(base);
+            n = pack_call(base);
+
+            m = 10 * static_cast<uint32_t>(at(slash + 1) - 48) + static_cast<uint32_t>(at(slash + 2) - 48);
+            m = 60000 + 26 + m;
+            m = (m * 128) + static_cast<uint32_t>(power) + 2 + 64;
+        } else {
+            // 前缀
+            std::array<char, 4> prefix{};
+            copy_n(prefix, cs.data(), slash < 4 ? slash : 4);
+            std::size_t rest = 11 - slash;
+            for (std::size_t i = 0; i < 7; i++) base[i] = i < rest ? cs[slash + 1 + i] : '\0';
+            if (prefix[2] == ' ' || prefix[2] == 0) {
+                prefix[3] = 0;
+                prefix[2] = prefix[1];
+                prefix[1] = prefix[0];
+                prefix[0] = ' ';
+            }
+            sanitize(base, 6);
+            pad_callsign(base);
+            n = pack_call(base);
+
+            m = 0;
+            for (std::size_t i = 0; i < 3; i++) m = 37 * m + code(prefix[i]);
+            if (m >= 32768) {
+                m -= 32768;
+                m = (m * 128) + static_cast<uint32_t>(power) + 2 + 64;
+            } else {
+                m = (m * 128) + static_cast<uint32_t>(power) + 1 + 64;
+            }
+        }
+    }
+
+    std::array<uint8_t, message_byte_size> c{};
+    c[3] = static_cast<uint8_t>((n & 0x0f) << 4);
+    c[2] = static_cast<uint8_t>((n >> 4) & 0xff);
+    c[1] = static_cast<uint8_t>((n >> 12) & 0xff);
+    c[0] = static_cast<uint8_t>((n >> 20) & 0xff);
+    c[6] = static_cast<uint8_t>((m & 0x03) << 6);
+    c[5] = static_cast<uint8_t>((m >> 2) & 0xff);
+    c[4] = static_cast<uint8_t>((m >> 10) & 0xff);
+    c[3] |= static_cast<uint8_t>((m >> 18) & 0x0f);
+    c[3] |= static_cast<uint8_t>((m >> 26) & 0x0f);
+    return c;
+}
+
+// 对应convolve()，r=1/2、K=32卷积编码
+constexpr std::array<uint8_t, bit_count> convolve(const std::array<uint8_t, message_byte_size> &c)
+{
+    std::array<uint8_t, bit_count> s{};
+    uint32_t reg = 0;
+    std::size_t out = 0;
+
+    for (std::size_t i = 0; i < message_byte_size && out < bit_count; i++) {
+        for (int j = 7; j >= 0 && out < bit_count; j--) {
+            reg = (reg << 1) | ((c[i] >> j) & 1u);
+            uint32_t p0 = reg & 0xf2d05351u;
+            uint32_t p1 = reg & 0xe4613c47u;
+            uint8_t b0 = 0, b1 = 0;
+            for (int k = 0; k < 32; k++) {
+                b0 ^= static_cast<uint8_t>((p0 >> k) & 1u);
+                b1 ^= static_cast<uint8_t>((p1 >> k) & 1u);
+            }
+            s[out++] = b0;
+            s[out++] = b1;
+        }
+    }
+    return s;
+}
+
+// 对应wspr_interleave()，按8位比特反转序交织
+constexpr std::array<uint8_t, bit_count> interleave(const std::array<uint8_t, bit_count> &s)
+{
+    std::array<uint8_t, bit_count> d{};
+    std::size_t i = 0;
+
+    for (unsigned j = 0; j < 255 && i < bit_count; j++) {
+        unsigned rev = 0;
+        for (unsigned k = 0; k < 8; k++) {
+            if (j & (1u << k)) rev |= 1u << (7 - k);
+        }
+        if (rev < bit_count) d[rev] = s[i++];
+    }
+    return d;
+}
+
+// WSPR 协议的同步向量，与encode.c相同
+constexpr std::array<uint8_t, symbol_count> sync_vector{{
+    1, 1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 0, 0, 1, 0, 0,
+    1, 0, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 1, 0, 0,
+    0, 0, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 0, 1, 1, 0, 1,
+    0, 0, 0, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 0, 1, 0, 0, 1, 0,
+    1, 1, 0, 0, 0, 1, 1, 0, 1, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1,
+    0, 0, 1, 0, 0, 1, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 0, 1,
+    1, 1, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 0, 1, 0, 1, 1, 0, 0, 0, 1, 1, 0, 0, 0}};
+
+// 对应wspr_merge_sync_vector()
+constexpr std::array<uint8_t, symbol_count> merge_sync_vector(const std::array<uint8_t, bit_count> &g)
+{
+    std::array<uint8_t, symbol_count> symbols{};
+    for (std::size_t i = 0; i < symbol_count; i++) {
+        symbols[i] = static_cast<uint8_t>(sync_vector[i] + 2 * g[i]);
+    }
+    return symbols;
+}
+
+constexpr std::array<uint8_t, packed_size> pack_symbols(const std::array<uint8_t, symbol_count> &symbols)
+{
+    std::array<uint8_t, packed_size> p{};
+    for (std::size_t i = 0; i < symbol_count; i++) {
+        p[i >> 2] = static_cast<uint8_t>(p[i >> 2] | ((symbols[i] & 0x03) << ((i & 3) * 2)));
+    }
+    return p;
+}
+
+// 对应wspr_encode()，输出格式由模板参数决定
+template <output Out = output::symbols>
+constexpr auto encode(const char *call, const char *loc, int8_t dbm)
+{
+    auto symbols = merge_sync_vector(interleave(convolve(bit_packing(message_prep(call, loc, dbm)))));
+    if constexpr (Out == output::packed) {
+        return pack_symbols(symbols);
+    } else {
+        return symbols;
+    }
+}
+
+} // namespace wspr
+
+#ifndef WSPR_CONSTEXPR_NO_SELF_CHECK
+namespace wspr {
+namespace detail {
+
+template <std::size_t N>
+constexpr bool equal(const std::array<uint8_t, N> &a, const std::array<uint8_t, N> &b)
+{
+    for (std::size_t i = 0; i < N; i++) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+// encode.c输出的黄金向量
+constexpr std::array<uint8_t, symbol_count> golden_type1{{ // BI1TPH ON80 10
+    1,3,0,0,2,2,2,2,1,0,0,0,1,3,3,0,0,0,3,2,2,1,0,3,1,3,3,
+    0,2,0,0,2,2,2,1,0,2,1,2,3,0,2,2,2,0,0,3,0,3,3,0,2,1,3,
+    0,3,0,2,2,1,3,2,1,0,2,0,0,3,1,0,1,0,1,2,1,0,3,0,2,1,2,
+    2,1,2,1,1,2,0,0,3,1,0,1,2,1,2,2,0,1,2,0,2,2,0,3,0,2,3,
+    0,0,1,3,1,2,1,3,2,0,1,3,2,1,0,0,0,3,3,1,0,0,0,2,2,1,0,
+    1,0,2,3,1,0,0,2,2,2,2,2,1,3,0,1,0,1,1,2,0,0,3,1,2,0,2}};
+constexpr std::array<uint8_t, symbol_count> golden_prefix{{ // PJ4/K1ABC FN42 37
+    3,1,0,2,2,0,0,0,1,0,2,2,1,3,1,0,2,0,1,0,0,1,2,3,1,3,1,
+    2,2,0,2,2,0,2,3,0,0,3,0,3,2,2,0,2,2,0,1,0,1,3,0,0,3,1,
+    0,1,0,0,0,3,3,2,3,2,2,2,0,1,3,0,1,0,3,0,1,2,1,0,0,3,2,
+    0,3,2,1,1,2,2,0,3,3,2,3,0,3,0,2,2,3,0,2,2,0,2,1,0,2,3,
+    0,0,1,3,1,0,3,1,0,0,3,1,2,3,0,0,2,1,3,3,2,0,0,0,0,1,0,
+    1,2,0,1,1,2,2,2,2,2,2,2,1,3,2,3,2,3,1,0,2,0,1,1,0,2,2}};
+constexpr std::array<uint8_t, symbol_count> golden_suffix1{{ // K1ABC/7 FN42 20
+    3,3,0,2,2,0,0,2,1,0,2,0,1,3,1,2,2,2,1,2,0,1,2,3,1,3,3,
+    2,2,0,2,0,0,2,3,2,0,3,2,3,2,2,0,0,2,0,3,0,1,1,0,0,3,3,
+    0,1,0,2,0,1,3,2,3,0,2,0,0,1,3,2,3,0,3,2,1,2,1,0,0,1,2,
+    2,3,0,1,1,0,2,0,3,1,0,3,2,1,2,2,0,3,0,2,2,0,0,1,2,2,3,
+    0,0,1,1,1,0,3,1,0,0,1,3,2,1,0,2,2,1,1,1,2,2,0,0,0,3,0,
+    1,2,2,1,1,2,2,0,0,2,2,2,1,3,0,1,0,3,1,2,2,0,3,1,2,2,0}};
+constexpr std::array<uint8_t, symbol_count> golden_suffix2{{ // K1ABC/12 FN42 30
+    3,3,0,2,2,0,0,2,1,0,2,0,1,1,3,0,2,2,1,0,0,3,2,1,1,3,3,
+    0,2,0,2,0,0,2,3,0,0,3,2,1,2,0,0,2,2,2,1,0,1,3,0,2,3,3,
+    0,3,0,0,0,1,3,0,1,0,2,2,0,3,3,2,3,2,3,2,1,2,1,0,0,1,2,
+    2,3,2,1,3,0,0,0,3,1,0,3,0,3,0,2,0,3,2,2,0,0,0,1,2,2,1,
+    0,2,3,1,1,2,3,3,0,2,3,3,2,3,0,2,2,3,3,1,2,2,0,2,0,3,0,
+    1,2,2,1,3,2,0,2,0,2,0,2,1,3,2,1,0,3,3,2,2,0,3,1,0,2,0}};
+constexpr std::array<uint8_t, symbol_count> golden_hashed{{ // <BI1TPH> ON80AB 10
+    3,3,2,2,2,0,0,0,3,0,2,0,1,1,3,0,2,0,1,0,0,3,2,1,3,3,1,
+    2,0,0,0,0,2,2,3,2,2,1,2,3,2,2,0,0,0,2,3,2,1,3,2,0,3,3,
+    0,3,2,0,2,3,1,0,3,2,0,2,2,1,1,0,1,0,3,0,1,2,1,0,2,1,0,
+    0,1,0,1,1,0,0,0,3,3,0,3,2,3,2,2,0,3,0,2,2,0,0,3,2,0,3,
+    0,2,1,1,3,2,1,1,2,0,3,3,0,3,2,2,2,1,3,3,2,0,2,0,0,3,0,
+    3,2,2,3,3,0,2,2,0,2,0,2,3,1,2,3,2,3,1,2,2,0,3,1,2,0,2}};
+
+static_assert(equal(encode("BI1TPH", "ON80", 10), golden_type1), "Type 1 message mismatch");
+static_assert(equal(encode("PJ4/K1ABC", "FN42", 37), golden_prefix), "prefix message mismatch");
+static_assert(equal(encode("K1ABC/7", "FN42", 20), golden_suffix1), "single-char suffix mismatch");
+static_assert(equal(encode("K1ABC/12", "FN42", 30), golden_suffix2), "two-digit suffix mismatch");
+static_assert(equal(encode("<BI1TPH>", "ON80AB", 10), golden_hashed), "Type 3 message mismatch");
+static_assert(equal(encode<output::packed>("BI1TPH", "ON80", 10), pack_symbols(golden_type1)),
+              "packed output mismatch");
+
+} // namespace detail
+} // namespace wspr
+#endif
+
+#endif
@@ -0,0 +1,459 @@
+/*
+ * wspr_i2c.c - 主机端Si5351 I2C传输层检查工具
+ *
+ * 用si5351_transport.c的模拟传输（si5351_TransportMock）运行si5351.c的寄存器写入，
+ * 统计每种配置序列不批处理与批处理时的I2C传输次数和字节数，并比对两者写出的寄存器。
+ *
+ * 编译：
+ *   gcc -O2 -DSI5351_NO_HAL -DSI5351_MOCK -I. -o wspr_i2c wspr_i2c.c si5351.c si5351_transport.c wspr_ramp.c wspr_multi.c -lm
+ *
+ * 用法：
+ *   wspr_i2c [--freq Hz]     # 各配置序列的传输次数/字节数（CSV，输出到stdout）
+ *   wspr_i2c --check         # 逐项校验队列与传输层，不一致时返回3
+ *
+ * --check覆盖：
+ *   批处理    不批处理与批处理写出的寄存器映像逐字节相同，有相邻寄存器写入的序列
+ *             （si5351_Init()后接si5351_SetupCLK0()）批处理的传输次数更少
+ *   异步完成  提交后立即返回BUSY，每次si5351_MockComplete()完成一段，最后一段完成时回调一次
+ *   NACK      同步和异步下第n次传输出错时整批结束、丢弃剩余的段，下一批不受影响
+ *   超时      挂起的传输在SI5351_I2C_TIMEOUT_MS后由si5351_Poll()中止并报告TIMEOUT
+ *   队满      超过队列容量的批整批丢弃并报告FULL，不发送任何传输
+ *   换音过渡  wspr_ramp在各WSPR频段、两种形状和不同步数下：各音调解码回载波 + k·12000/8192 Hz，
+ *             过渡中每个定时器中断至多一次传输且只写P2（寄存器5~7），每步解码频率符合
+ *             过渡形状、单调，最后停在新音调
+ *   多输出    wspr_multi的三个输出各音调解码回各自载波 + k·12000/8192 Hz，一个符号长度的
+ *             音调序列中，有变化的符号边沿正好一次传输、不超过19字节，之后各输出频率正确
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "si5351.h"
+#include "wspr_ramp.h"
+#include "wspr_multi.h"
+
+// 解码频率与理论音调频率的最大允许误差（同wspr_tablegen）
+#define TONE_TOLERANCE_HZ 0.05
+
+// 换音过渡检查用的WSPR频段（Hz）
+static const uint32_t check_bands[] = {475700, 1838100, 3570100, 7040100, 10140200, 14097100, 28126100, 50294500};
+#define CHECK_BANDS (int)(sizeof(check_bands) / sizeof(check_bands[0]))
+
+// 多输出检查用的频率组合（Hz，0为不用）：单个输出、两端输出、三个不同或相同的频段，
+// 最后一组需要分出PLLB
+static const uint32_t multi_sets[][WSPR_MULTI_OUTPUTS] = {
+    {7040100, 14097100, 28126100}, {475700, 1838100, 3570100},    {10140200, 0, 50294500},
+    {0, 18106100, 0},              {1838100, 21096100, 50294500}, {14097100, 14097100, 14097100},
+    {137500, 12500000, 70000000},
+};
+#define MULTI_SETS (int)(sizeof(multi_sets) / sizeof(multi_sets[0]))
+// 两端输出都用上时一个符号边沿最多写寄存器47~65
+#define MULTI_MAX_BURST 19
+
+static struct {
+    int check;
+    int32_t freq;
+} cfg = {0, 14097100};
+
+// 配置序列，由run_sequence()逐次写入或放在一个批处理里提交
+typedef void (*sequence_fn)(void);
+
+static void seq_init_clk0(void) {
+    si5351_Init(0);
+    si5351_SetupCLK0(cfg.freq, SI5351_DRIVE_STRENGTH_8MA);
+    si5351_EnableOutputs(1 << 0);
+}
+
+static void seq_clk0_clk2(void) {
+    si5351_SetupCLK0(cfg.freq, SI5351_DRIVE_STRENGTH_8MA);
+    si5351_SetupCLK2(cfg.freq / 2, SI5351_DRIVE_STRENGTH_4MA);
+    si5351_EnableOutputs((1 << 0) | (1 << 2));
+}
+
+static void seq_tone_table(void) {
+    uint8_t pll[SI5351_BULK_REGS], tones[4][SI5351_BULK_REGS], clk;
+    uint8_t k;
+
+    if (si5351_ToneTable((uint64_t)cfg.freq * 100, 4, SI5351_DRIVE_STRENGTH_8MA, pll, tones, &clk) != 0) return;
+    si5351_StartOutput(SI5351_PLL_A, pll, 0, tones[0], clk);
+    for (k = 1; k < 4; k++) si5351_writeRegs(SI5351_MS_BASE(0), tones[k]);
+}
+
+// merges为1的序列有相邻寄存器的写入，批处理时应合并为更少的传输
+static const struct {
+    const char *name;
+    sequence_fn fn;
+    int merges;
+} sequences[] = {
+    {"init+clk0", seq_init_clk0, 1},
+    {"clk0+clk2", seq_clk0_clk2, 0},
+    {"tone_table", seq_tone_table, 0},
+};
+#define SEQUENCES (int)(sizeof(sequences) / sizeof(sequences[0]))
+
+typedef struct {
+    uint32_t transfers, bytes;
+    uint8_t regs[256];
+} run_t;
+
+static int done_calls;
+static si5351I2CStatus_t done_status;
+
+static void on_done(si5351I2CStatus_t status, void *ctx) {
+    (void)ctx;
+    done_calls++;
+    done_status = status;
+}
+
+static void mock_reset(uint8_t async, int32_t fail_after) {
+    while (si5351_MockComplete()) { }
+    si5351_Wait();
+    memset(si5351_MockRegs, 0, sizeof(si5351_MockRegs));
+    si5351_MockTransfers = 0;
+    si5351_MockBytes = 0;
+    si5351_MockConfigure(async, fail_after);
+    done_calls = 0;
+    done_status = SI5351_I2C_OK;
+}
+
+static void run_sequence(sequence_fn fn, int batched, run_t *r) {
+    mock_reset(0, -1);
+    if (batched) {
+        si5351_BatchBegin();
+        fn();
+        si5351_BatchCommit(0, 0);
+        si5351_Wait();
+    } else {
+        fn();
+    }
+    r->transfers = si5351_MockTransfers;
+    r->bytes = si5351_MockBytes;
+    memcpy(r->regs, si5351_MockRegs, sizeof(r->regs));
+}
+
+/* ---------- --check ---------- */
+
+static int failures;
+
+static void expect(int ok, const char *what) {
+    if (!ok) {
+        fprintf(stderr, "校验失败: %s\n", what);
+        failures++;
+    }
+}
+
+static void check_batching(void) {
+    int i;
+    for (i = 0; i < SEQUENCES; i++) {
+        run_t plain, batch;
+        char what[96];
+        run_sequence(sequences[i].fn, 0, &plain);
+        run_sequence(sequences[i].fn, 1, &batch);
+        snprintf(what, sizeof(what), "%s 批处理寄存器与逐次写入一致", sequences[i].name);
+        expect(memcmp(plain.regs, batch.regs, sizeof(plain.regs)) == 0, what);
+        snprintf(what, sizeof(what), "%s 批处理传输次数（%u/%u）", sequences[i].name, (unsigned)batch.transfers,
+                 (unsigned)plain.transfers);
+        expect((sequences[i].merges ? batch.transfers < plain.transfers : batch.transfers <= plain.transfers) &&
+                   batch.bytes == plain.bytes,
+               what);
+    }
+}
+
+static void check_async(void) {
+    run_t ref;
+    uint32_t steps = 0;
+    si5351I2CStatus_t st;
+
+    run_sequence(seq_init_clk0, 1, &ref);
+    mock_reset(1, -1);
+    si5351_BatchBegin();
+    seq_init_clk0();
+    st = si5351_BatchCommit(on_done, 0);
+    expect(st == SI5351_I2C_BUSY, "异步提交立即返回BUSY");
+    expect(si5351_MockTransfers == 0 && done_calls == 0, "异步提交时尚未发送");
+    while (si5351_MockComplete()) {
+        steps++;
+        expect(done_calls == (si5351_MockTransfers == ref.transfers), "最后一段完成时才回调");
+    }
+    expect(steps == ref.transfers, "每次MockComplete完成一段");
+    expect(done_calls == 1 && done_status == SI5351_I2C_OK, "异步整批完成回调一次且为OK");
+    expect(si5351_Poll() == SI5351_I2C_OK, "异步完成后Poll返回OK");
+    expect(memcmp(si5351_MockRegs, ref.regs, sizeof(ref.regs)) == 0, "异步写出的寄存器与同步一致");
+}
+
+static void check_nack(void) {
+    run_t ref;
+    si5351I2CStatus_t st;
+    uint8_t data[2] = {0x12, 0x34};
+
+    run_sequence(seq_init_clk0, 1, &ref);
+
+    // 同步：第2次传输NACK，之前的段已写入，之后的段丢弃
+    mock_reset(0, 2);
+    si5351_BatchBegin();
+    seq_init_clk0();
+    st = si5351_BatchCommit(on_done, 0);
+    expect(st == SI5351_I2C_ERROR && done_calls == 1 && done_status == SI5351_I2C_ERROR, "同步NACK报告ERROR");
+    expect(si5351_MockTransfers == 2, "同步NACK后丢弃剩余的段");
+    expect(si5351_Poll() == SI5351_I2C_ERROR, "NACK后Poll返回上一批的结果");
+
+    // 异步：第1次传输完成后，第2次NACK
+    mock_reset(1, 1);
+    si5351_BatchBegin();
+    seq_init_clk0();
+    st = si5351_BatchCommit(on_done, 0);
+    expect(st == SI5351_I2C_BUSY, "异步NACK前提交返回BUSY");
+    expect(si5351_MockComplete() == 1, "异步完成第一段");
+    expect(done_calls == 1 && done_status == SI5351_I2C_ERROR, "异步NACK回调ERROR");
+    expect(si5351_MockComplete() == 0 && si5351_MockTransfers == 1, "异步NACK后没有挂起的段");
+
+    // 不批处理的写入返回错误，之后恢复正常
+    mock_reset(0, 0);
+    expect(si5351_writeBurst(SI5351_MS_BASE(0), data, 2) == 1, "逐次写入NACK返回1");
+    expect(si5351_writeBurst(SI5351_MS_BASE(0), data, 2) == 0 && si5351_MockRegs[SI5351_MS_BASE(0) + 1] == 0x34,
+           "NACK后下一次写入正常");
+
+    // 出错后的下一批与参考一致
+    mock_reset(0, -1);
+    si5351_BatchBegin();
+    seq_init_clk0();
+    expect(si5351_BatchCommit(0, 0) == SI5351_I2C_OK && memcmp(si5351_MockRegs, ref.regs, sizeof(ref.regs)) == 0,
+           "NACK后的下一批正常");
+}
+
+static void check_timeout(void) {
+    si5351I2CStatus_t st;
+    int polls = 0;
+
+    mock_reset(1, -1);
+    si5351_BatchBegin();
+    seq_init_clk0();
+    si5351_BatchCommit(on_done, 0);
+    // 模拟时钟每次读取前进1ms
+    while ((st = si5351_Poll()) == SI5351_I2C_BUSY && polls < 1000) polls++;
+    expect(st == SI5351_I2C_TIMEOUT && done_calls == 1 && done_status == SI5351_I2C_TIMEOUT, "挂起的传输超时");
+    expect(polls >= SI5351_I2C_TIMEOUT_MS && polls < 2 * SI5351_I2C_TIMEOUT_MS + 2, "超时在SI5351_I2C_TIMEOUT_MS后报告");
+    expect(si5351_MockComplete() == 0 && si5351_MockTransfers == 0, "超时后挂起的传输已中止");
+    expect(si5351_BatchBegin() == SI5351_I2C_TIMEOUT, "下一批开始时返回上一批的TIMEOUT");
+    si5351_BatchCommit(0, 0);
+}
+
+static void check_full(void) {
+    uint8_t v = 0x5A;
+    int i;
+    si5351I2CStatus_t st;
+
+    // 每隔一个寄存器写一次，每次都是新的一段
+    mock_reset(0, -1);
+    si5351_BatchBegin();
+    for (i = 0; i < 40; i++) si5351_writeBurst((uint8_t)(100 + 2 * i), &v, 1);
+    st = si5351_BatchCommit(on_done, 0);
+    expect(st == SI5351_I2C_FULL && done_calls == 1 && done_status == SI5351_I2C_FULL, "超出队列容量报告FULL");
+    expect(si5351_MockTransfers == 0, "队满的批不发送");
+
+    // 相邻寄存器合并为一段，不受段数限制
+    mock_reset(0, -1);
+    si5351_BatchBegin();
+    for (i = 0; i < 40; i++) si5351_writeBurst((uint8_t)(100 + i), &v, 1);
+    st = si5351_BatchCommit(0, 0);
+    expect(st == SI5351_I2C_OK && si5351_MockBytes == 40 && si5351_MockTransfers < 40, "相邻寄存器合并");
+}
+
+// 过渡形状的理论值，与wspr_ramp.h中的定义相同
+static double ramp_weight(wspr_ramp_shape_t shape, double x) {
+    if (shape == WSPR_RAMP_GAUSSIAN) return 0.5 * (1.0 + erf(4.0 * (x - 0.5)) / erf(2.0));
+    return 0.5 * (1.0 - cos(M_PI * x));
+}
+
+// 一次换音：每个定时器中断至多一次传输，逐步解码频率并检查单调、只写P2、停在新音调
+static void check_ramp_switch(const wspr_ramp_t *r, wspr_ramp_shape_t shape, uint8_t from, uint8_t to,
+                              const double *f, const char *name) {
+    uint8_t base = SI5351_MS_BASE(r->output), t;
+    uint8_t writes = r->steps ? r->steps : 1;
+    int ok_count = 1, ok_p2 = 1, ok_freq = 1, ok_mono = 1;
+    double prev = f[from];
+    char what[128];
+
+    mock_reset(0, -1);
+    wspr_ramp_start(r, from);
+    for (t = 0; t < WSPR_RAMP_TICKS; t++) {
+        uint32_t n0 = si5351_MockTransfers;
+        double fs, want;
+
+        wspr_ramp_tick(r, from, to, t);
+        ok_count &= si5351_MockTransfers == n0 + (t < writes);
+        if (t >= writes) continue;
+        if (r->steps == 0) {
+            // 没有共用P1时直接跳变，写完整的MultiSynth寄存器
+            ok_p2 &= si5351_MockLastReg == base && si5351_MockLastLen == SI5351_BULK_REGS;
+            continue;
+        }
+        ok_p2 &= si5351_MockLastReg >= base + 5 && si5351_MockLastReg + si5351_MockLastLen == base + SI5351_BULK_REGS;
+        fs = si5351_RegsFreq(&si5351_MockRegs[SI5351_PLLA_BASE], &si5351_MockRegs[base]);
+        want = f[from] + ramp_weight(shape, (double)(t + 1) / r->steps) * (f[to] - f[from]);
+        ok_freq &= fabs(fs - want) <= TONE_TOLERANCE_HZ;
+        ok_mono &= to > from ? fs >= prev : fs <= prev;
+        prev = fs;
+    }
+    snprintf(what, sizeof(what), "%s 音调%u->%u 每个中断至多一次传输", name, from, to);
+    expect(ok_count, what);
+    snprintf(what, sizeof(what), "%s 音调%u->%u 每步只写P2（寄存器5~7）", name, from, to);
+    expect(ok_p2, what);
+    snprintf(what, sizeof(what), "%s 音调%u->%u 每步解码频率符合过渡形状", name, from, to);
+    expect(ok_freq, what);
+    snprintf(what, sizeof(what), "%s 音调%u->%u 频率单调", name, from, to);
+    expect(ok_mono, what);
+    snprintf(what, sizeof(what), "%s 音调%u->%u 停在新音调", name, from, to);
+    expect(memcmp(&si5351_MockRegs[base], r->tone_regs[to], SI5351_BULK_REGS) == 0, what);
+}
+
+static void check_ramp(void) {
+    static wspr_ramp_t r;
+    static const uint8_t steps[] = {1, 8, WSPR_RAMP_MAX_STEPS};
+    int b, shape, n;
+    uint8_t from, to, k;
+
+    for (b = 0; b < CHECK_BANDS; b++) {
+        for (shape = WSPR_RAMP_RAISED_COSINE; shape <= WSPR_RAMP_GAUSSIAN; shape++) {
+            for (n = 0; n < (int)sizeof(steps); n++) {
+                uint8_t out = (uint8_t)(b % 3);
+                double f[WSPR_RAMP_TONES];
+                char name[64], what[128];
+                int rc = wspr_ramp_plan(&r, (uint64_t)check_bands[b] * 100, out, SI5351_DRIVE_STRENGTH_8MA,
+                                        (wspr_ramp_shape_t)shape, steps[n]);
+
+                snprintf(name, sizeof(name), "ramp %lu Hz 形状%d %u步", (unsigned long)check_bands[b], shape, steps[n]);
+                snprintf(what, sizeof(what), "%s 规划", name);
+                expect(rc == 0 || (rc == 1 && r.steps == 0), what);
+                if (rc < 0) continue;
+                for (k = 0; k < WSPR_RAMP_TONES; k++) {
+                    double want = check_bands[b] + k * 12000.0 / 8192.0;
+                    f[k] = si5351_RegsFreq(r.pll_regs, r.tone_regs[k]);
+                    snprintf(what, sizeof(what), "%s 音调%u解码为%.4f Hz（应为%.4f Hz）", name, k, f[k], want);
+                    expect(fabs(f[k] - want) <= TONE_TOLERANCE_HZ, what);
+                }
+                for (from = 0; from < WSPR_RAMP_TONES; from++) {
+                    for (to = 0; to < WSPR_RAMP_TONES; to++) {
+                        if (from != to) check_ramp_switch(&r, (wspr_ramp_shape_t)shape, from, to, f, name);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// 模拟寄存器中各输出的频率是否为载波 + tones[o]·12000/8192 Hz
+static int multi_decodes(const wspr_multi_t *m, const uint32_t *carrier, const uint8_t *tones) {
+    uint8_t o;
+    for (o = 0; o < WSPR_MULTI_OUTPUTS; o++) {
+        const uint8_t *pll = &si5351_MockRegs[m->pll_of[o] == SI5351_PLL_B ? SI5351_PLLB_BASE : SI5351_PLLA_BASE];
+        double f;
+        if (!(m->enabled & (1 << o))) continue;
+        f = si5351_RegsFreq(pll, &si5351_MockRegs[SI5351_MS_BASE(o)]);
+        if (fabs(f - (carrier[o] + tones[o] * 12000.0 / 8192.0)) > TONE_TOLERANCE_HZ) return 0;
+    }
+    return 1;
+}
+
+static void check_multi(void) {
+    static wspr_multi_t m;
+    int s, i, rc;
+    uint8_t o, k;
+
+    for (s = 0; s < MULTI_SETS; s++) {
+        const uint32_t *carrier = multi_sets[s];
+        uint64_t centi[WSPR_MULTI_OUTPUTS];
+        uint8_t tones[WSPR_MULTI_OUTPUTS] = {0, 0, 0};
+        uint32_t seed = 12345;
+        int ok_transfer = 1, ok_burst = 1, ok_freq = 1;
+        char name[64], what[128];
+
+        for (o = 0; o < WSPR_MULTI_OUTPUTS; o++) centi[o] = (uint64_t)carrier[o] * 100;
+        snprintf(name, sizeof(name), "multi %lu/%lu/%lu Hz", (unsigned long)carrier[0], (unsigned long)carrier[1],
+                 (unsigned long)carrier[2]);
+        rc = wspr_multi_plan(&m, centi, SI5351_DRIVE_STRENGTH_8MA);
+        snprintf(what, sizeof(what), "%s 规划", name);
+        expect(rc == 0 || rc == 1, what);
+        if (rc < 0) continue;
+        for (o = 0; o < WSPR_MULTI_OUTPUTS; o++) {
+            if (!(m.enabled & (1 << o))) continue;
+            for (k = 0; k < WSPR_MULTI_TONES; k++) {
+                double f = si5351_RegsFreq(m.pll_regs[m.pll_of[o]], m.tone_regs[o][k]);
+                double want = carrier[o] + k * 12000.0 / 8192.0;
+                snprintf(what, sizeof(what), "%s CLK%u音调%u解码为%.4f Hz（应为%.4f Hz）", name, o, k, f, want);
+                expect(fabs(f - want) <= TONE_TOLERANCE_HZ, what);
+            }
+        }
+
+        mock_reset(0, -1);
+        wspr_multi_start(&m, tones);
+        snprintf(what, sizeof(what), "%s 启动后各输出为音调0", name);
+        expect(multi_decodes(&m, carrier, tones), what);
+
+        // 伪随机音调序列，一个符号的长度
+        for (i = 0; i < 162; i++) {
+            uint32_t n0 = si5351_MockTransfers;
+            int changed = 0;
+            uint8_t bytes;
+            for (o = 0; o < WSPR_MULTI_OUTPUTS; o++) {
+                uint8_t t;
+                seed = seed * 1103515245u + 12345u;
+                t = (uint8_t)((seed >> 16) & 3);
+                changed |= (m.enabled & (1 << o)) && t != tones[o];
+                tones[o] = t;
+            }
+            bytes = wspr_multi_symbol(&m, tones);
+            ok_transfer &= si5351_MockTransfers == n0 + (changed ? 1 : 0) && (!changed) == (bytes == 0);
+            ok_burst &= bytes <= MULTI_MAX_BURST && bytes <= m.max_burst && (!bytes || si5351_MockLastLen == bytes);
+            ok_freq &= multi_decodes(&m, carrier, tones);
+        }
+        snprintf(what, sizeof(what), "%s 有变化的符号边沿正好一次传输", name);
+        expect(ok_transfer, what);
+        snprintf(what, sizeof(what), "%s 每个符号边沿至多%d字节", name, MULTI_MAX_BURST);
+        expect(ok_burst, what);
+        snprintf(what, sizeof(what), "%s 每个符号后各输出解码为载波 + k·12000/8192 Hz", name);
+        expect(ok_freq, what);
+    }
+}
+
+static int self_check(void) {
+    si5351_SetTransport(&si5351_TransportMock);
+    check_batching();
+    check_async();
+    check_nack();
+    check_timeout();
+    check_full();
+    check_ramp();
+    check_multi();
+    printf("传输层校验: %d 项不一致 -> %s\n", failures, failures ? "失败" : "通过");
+    return failures ? 3 : 0;
+}
+
+int main(int argc, char **argv) {
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--check") == 0) {
+            cfg.check = 1;
+        } else if (strcmp(argv[i], "--freq") == 0 && i + 1 < argc) {
+            cfg.freq = (int32_t)strtol(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "用法: %s [--freq Hz] | --check\n", argv[0]);
+            return 2;
+        }
+    }
+    if (cfg.check) return self_check();
+
+    si5351_SetTransport(&si5351_TransportMock);
+    printf("sequence,plain_transfers,plain_bytes,batched_transfers,batched_bytes,same_regs\n");
+    for (i = 0; i < SEQUENCES; i++) {
+        run_t plain, batch;
+        run_sequence(sequences[i].fn, 0, &plain);
+        run_sequence(sequences[i].fn, 1, &batch);
+        printf("%s,%u,%u,%u,%u,%d\n", sequences[i].name, (unsigned)plain.transfers, (unsigned)plain.bytes,
+               (unsigned)batch.transfers, (unsigned)batch.bytes, memcmp(plain.regs, batch.regs, 256) == 0);
+    }
+    return 0;
+}
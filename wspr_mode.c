@@ -0,0 +1,364 @@
+#include <stdint.h>
+#include <string.h>
+#include "encode.h"
+#include "wspr_mode.h"
+
+// JT65/JT9 的 28 比特呼号空间之外的特殊字和网格空间之外的报告编码
+#define JT_NBASE 262177560u // 37*36*10*27*27*27
+#define JT_NGBASE 32400u    // 180*180
+
+#define JT_PLANE_BIT(w, i) ((uint8_t)(((w)[(i) >> 6] >> ((i) & 63)) & 1))
+
+/**
+ * @brief 取下一个以空格分隔的词。
+ *
+ * @param p 当前位置。
+ * @param out 输出缓冲区，长度为 max。
+ * @param max 缓冲区长度（含终止符）。
+ * @return const char* 词之后的位置；没有词或词过长时返回 NULL。
+ */
+static const char *wspr_mode_token(const char *p, char *out, uint8_t max)
+{
+	uint8_t n = 0;
+
+	while (*p == ' ' || *p == '\t')
+	{
+		p++;
+	}
+	while (*p && *p != ' ' && *p != '\t')
+	{
+		if (n + 1 >= max)
+		{
+			return NULL;
+		}
+		out[n++] = *p++;
+	}
+	out[n] = '\0';
+	return n ? p : NULL;
+}
+
+// 是否已到文本末尾（只剩空白）
+static uint8_t wspr_mode_at_end(const char *p)
+{
+	while (*p == ' ' || *p == '\t')
+	{
+		p++;
+	}
+	return *p == '\0';
+}
+
+// 转为大写
+static void wspr_mode_upper(char *s)
+{
+	for (; *s; s++)
+	{
+		if (*s >= 'a' && *s <= 'z')
+		{
+			*s = (char)(*s - 32);
+		}
+	}
+}
+
+// ---------------------------------------------------------------- WSPR
+
+/**
+ * @brief WSPR 打包："CALL LOC DBM" -> 50 比特载荷。
+ *
+ * 规范化和打包与 wspr_encode() 相同（wspr_message_prep_r() + wspr_pack50()）。
+ */
+static int wspr_pack_text(const char *text, uint64_t *p)
+{
+	char call[13];
+	char loc[7];
+	char num[5];
+	const char *d = num;
+	wspr_message_t msg;
+	int16_t dbm = 0;
+
+	// wspr_message_prep_r() 会读到终止符之后，与 wspr_encode() 的 strncpy() 一样补零
+	memset(call, 0, sizeof(call));
+	memset(loc, 0, sizeof(loc));
+	if (!(text = wspr_mode_token(text, call, sizeof(call))) || !(text = wspr_mode_token(text, loc, sizeof(loc))) ||
+		!(text = wspr_mode_token(text, num, sizeof(num))) || !wspr_mode_at_end(text))
+	{
+		return -1;
+	}
+	if (*d == '-')
+	{
+		d++;
+	}
+	if (!*d)
+	{
+		return -1;
+	}
+	for (; *d; d++)
+	{
+		if (*d < '0' || *d > '9')
+		{
+			return -1;
+		}
+		dbm = (int16_t)(dbm * 10 + (*d - '0'));
+	}
+	if (num[0] == '-')
+	{
+		dbm = (int16_t)-dbm;
+	}
+	if (dbm < -128 || dbm > 127)
+	{
+		return -1;
+	}
+
+	wspr_message_prep_r(&msg, call, loc, (int8_t)dbm);
+	p[0] = wspr_pack50(&msg);
+	return 0;
+}
+
+// 合并 WSPR 同步向量：符号 = 同步比特 + 2 * 信道比特
+static void wspr_map_sync(const uint64_t *plane, uint8_t *symbols)
+{
+	wspr_plane_t d = {{plane[0], plane[1], plane[2]}};
+
+	wspr_plane_to_symbols(&d, symbols);
+}
+
+const wspr_mode_t wspr_mode_wspr = {
+	"wspr", 50, WSPR_BIT_COUNT, WSPR_SYMBOL_COUNT, 4, wspr_interleave_dest, wspr_pack_text, wspr_map_sync,
+};
+
+WSPR_MODE_ENCODER(wspr_mode_encode_wspr, wspr_mode_wspr)
+
+// ---------------------------------------------------------------- JT9
+
+// 交织置换：与 WSPR 相同的 8 位比特反转，保留小于 206 的位置
+static const uint8_t jt9_interleave_dest[JT9_BIT_COUNT] = {
+	0, 128, 64, 192, 32, 160, 96, 16, 144, 80, 48, 176, 112, 8, 136, 72, 200, 40,
+	168, 104, 24, 152, 88, 56, 184, 120, 4, 132, 68, 196, 36, 164, 100, 20, 148, 84,
+	52, 180, 116, 12, 140, 76, 204, 44, 172, 108, 28, 156, 92, 60, 188, 124, 2, 130,
+	66, 194, 34, 162, 98, 18, 146, 82, 50, 178, 114, 10, 138, 74, 202, 42, 170, 106,
+	26, 154, 90, 58, 186, 122, 6, 134, 70, 198, 38, 166, 102, 22, 150, 86, 54, 182,
+	118, 14, 142, 78, 46, 174, 110, 30, 158, 94, 62, 190, 126, 1, 129, 65, 193, 33,
+	161, 97, 17, 145, 81, 49, 177, 113, 9, 137, 73, 201, 41, 169, 105, 25, 153, 89,
+	57, 185, 121, 5, 133, 69, 197, 37, 165, 101, 21, 149, 85, 53, 181, 117, 13, 141,
+	77, 205, 45, 173, 109, 29, 157, 93, 61, 189, 125, 3, 131, 67, 195, 35, 163, 99,
+	19, 147, 83, 51, 179, 115, 11, 139, 75, 203, 43, 171, 107, 27, 155, 91, 59, 187,
+	123, 7, 135, 71, 199, 39, 167, 103, 23, 151, 87, 55, 183, 119, 15, 143, 79, 47,
+	175, 111, 31, 159, 95, 63, 191, 127,
+};
+
+// 同步符号位置（第 1、2、5、10、16、23、33、35、51、52、55、60、66、73、83、85 个符号）
+static const uint64_t jt9_sync_plane[2] = {0x084c000500408213ULL, 0x0000000000140102ULL};
+
+/**
+ * @brief JT65/JT9 的 28 比特呼号编码。
+ *
+ * @param call 呼号（大写）。
+ * @return int32_t 编码值；不是第 2 或第 3 位为数字的标准呼号时返回 -1。
+ *
+ * 补齐为第 3 位是数字的 6 字符后按 37/36/10/27/27/27 进制展开，与 WSPR 类型 1 相同。
+ */
+static int32_t jt_pack_call(const char *call)
+{
+	char c[6] = {' ', ' ', ' ', ' ', ' ', ' '};
+	uint8_t len = 0;
+	uint8_t i, off;
+	uint32_t n = 0;
+
+	while (call[len] && len < 7)
+	{
+		len++;
+	}
+	if (len < 3 || len > 6)
+	{
+		return -1;
+	}
+	if (call[2] >= '0' && call[2] <= '9')
+	{
+		off = 0;
+	}
+	else if (call[1] >= '0' && call[1] <= '9' && len < 6)
+	{
+		off = 1;
+	}
+	else
+	{
+		return -1;
+	}
+	for (i = 0; i < len; i++)
+	{
+		c[i + off] = call[i];
+	}
+
+	for (i = 0; i < 6; i++)
+	{
+		char ch = c[i];
+		uint8_t digit = (ch >= '0' && ch <= '9');
+		uint8_t alpha = (ch >= 'A' && ch <= 'Z');
+
+		if (i == 0)
+		{
+			if (!digit && !alpha && ch != ' ')
+			{
+				return -1;
+			}
+			n = digit ? (uint32_t)(ch - '0') : alpha ? (uint32_t)(ch - 'A' + 10) : 36u;
+		}
+		else if (i == 1)
+		{
+			if (!digit && !alpha)
+			{
+				return -1;
+			}
+			n = n * 36u + (digit ? (uint32_t)(ch - '0') : (uint32_t)(ch - 'A' + 10));
+		}
+		else if (i == 2)
+		{
+			n = n * 10u + (uint32_t)(ch - '0');
+		}
+		else
+		{
+			if (!alpha && ch != ' ')
+			{
+				return -1;
+			}
+			n = n * 27u + (alpha ? (uint32_t)(ch - 'A') : 26u);
+		}
+	}
+	return (int32_t)n;
+}
+
+/**
+ * @brief JT65/JT9 的 16 比特网格/报告字段。
+ *
+ * @return int32_t 编码值，无法识别时返回 -1。网格与 WSPR 的 m 相同（180x180 的 1°x2° 方格），
+ *         报告 -NN 为 NGBASE+1+NN，R-NN 为 NGBASE+31+NN，RO/RRR/73 依次为 NGBASE+62~64。
+ */
+static int32_t jt_pack_grid(const char *g)
+{
+	const char *r = g;
+	uint8_t base = 1;
+	int32_t n;
+
+	if (g[0] >= 'A' && g[0] <= 'R' && g[1] >= 'A' && g[1] <= 'R' && g[2] >= '0' && g[2] <= '9' && g[3] >= '0' &&
+		g[3] <= '9' && g[4] == '\0')
+	{
+		return (179 - 10 * (g[0] - 'A') - (g[2] - '0')) * 180 + 10 * (g[1] - 'A') + (g[3] - '0');
+	}
+	if (g[0] == 'R' && g[1] == '-')
+	{
+		r = g + 1;
+		base = 31;
+	}
+	if (r[0] == '-' && r[1] >= '0' && r[1] <= '9' &&
+		(r[2] == '\0' || (r[2] >= '0' && r[2] <= '9' && r[3] == '\0')))
+	{
+		n = r[1] - '0';
+		if (r[2])
+		{
+			n = n * 10 + (r[2] - '0');
+		}
+		return (n >= 1 && n <= 30) ? (int32_t)(JT_NGBASE + base + n) : -1;
+	}
+	if (g[0] == 'R' && g[1] == 'O' && g[2] == '\0')
+	{
+		return JT_NGBASE + 62;
+	}
+	if (g[0] == 'R' && g[1] == 'R' && g[2] == 'R' && g[3] == '\0')
+	{
+		return JT_NGBASE + 63;
+	}
+	if (g[0] == '7' && g[1] == '3' && g[2] == '\0')
+	{
+		return JT_NGBASE + 64;
+	}
+	return -1;
+}
+
+/**
+ * @brief JT9 打包：标准消息 -> 72 比特载荷（28 比特呼号 1、28 比特呼号 2、16 比特网格/报告）。
+ */
+static int jt9_pack_text(const char *text, uint64_t *p)
+{
+	char w1[7], w2[7], w3[5];
+	int32_t nc1, nc2, ng;
+
+	if (!(text = wspr_mode_token(text, w1, sizeof(w1))) || !(text = wspr_mode_token(text, w2, sizeof(w2))))
+	{
+		return -1;
+	}
+	wspr_mode_upper(w1);
+	wspr_mode_upper(w2);
+	if (wspr_mode_at_end(text))
+	{
+		ng = JT_NGBASE + 1; // 无网格
+	}
+	else if (!(text = wspr_mode_token(text, w3, sizeof(w3))) || !wspr_mode_at_end(text))
+	{
+		return -1;
+	}
+	else
+	{
+		wspr_mode_upper(w3);
+		if ((ng = jt_pack_grid(w3)) < 0)
+		{
+			return -1;
+		}
+	}
+
+	if (w1[0] == 'C' && w1[1] == 'Q' && w1[2] == '\0')
+	{
+		nc1 = JT_NBASE + 1;
+	}
+	else if (w1[0] == 'Q' && w1[1] == 'R' && w1[2] == 'Z' && w1[3] == '\0')
+	{
+		nc1 = JT_NBASE + 2;
+	}
+	else if (w1[0] == 'D' && w1[1] == 'E' && w1[2] == '\0')
+	{
+		nc1 = 267796945;
+	}
+	else
+	{
+		nc1 = jt_pack_call(w1);
+	}
+	nc2 = jt_pack_call(w2);
+	if (nc1 < 0 || nc2 < 0)
+	{
+		return -1;
+	}
+
+	p[0] = ((uint64_t)nc1 << 36) | ((uint64_t)nc2 << 8) | ((uint32_t)ng >> 8);
+	p[1] = (uint32_t)ng & 0xff;
+	return 0;
+}
+
+/**
+ * @brief JT9 符号映射：信道比特补一个零后每 3 比特（高位在前）一个数据符号，
+ *        Gray 码后加 1 为音调，插入 16 个同步符号（音调 0）。
+ */
+static void jt9_map(const uint64_t *plane, uint8_t *symbols)
+{
+	uint16_t bit = 0;
+	uint8_t i;
+
+	for (i = 0; i < JT9_SYMBOL_COUNT; i++)
+	{
+		uint8_t v;
+
+		if ((jt9_sync_plane[i >> 6] >> (i & 63)) & 1)
+		{
+			symbols[i] = 0;
+			continue;
+		}
+		// 第 206 比特在平面中为 0，即补上的零
+		v = (uint8_t)((JT_PLANE_BIT(plane, bit) << 2) | (JT_PLANE_BIT(plane, bit + 1) << 1) |
+					  JT_PLANE_BIT(plane, bit + 2));
+		bit += 3;
+		symbols[i] = (uint8_t)((v ^ (v >> 1)) + 1);
+	}
+}
+
+const wspr_mode_t wspr_mode_jt9 = {
+	"jt9", JT9_PAYLOAD_BITS, JT9_BIT_COUNT, JT9_SYMBOL_COUNT, 9, jt9_interleave_dest, jt9_pack_text, jt9_map,
+};
+
+WSPR_MODE_ENCODER(wspr_mode_encode_jt9, wspr_mode_jt9)
@@ -0,0 +1,164 @@
+#ifndef WSPR_MODE_H
+#define WSPR_MODE_H
+
+#include <stdint.h>
+
+/*
+ * 共用 K=32、r=1/2 卷积码（多项式 0xf2d05351 / 0xe4613c47）的模式的通用编码流程：
+ *
+ *   打包（文本 -> 载荷） -> 卷积（共用内核） -> 比特反转交织 -> 同步/音调映射
+ *
+ * 每种模式是 wspr_mode.c 中定义、在此 extern 声明的 const wspr_mode_t，同一文件中的
+ * WSPR_MODE_ENCODER() 用它定义该模式的编码函数。wspr_mode_encode() 强制内联，描述符
+ * 对该文件可见，其中的比特数、交织表和各阶段函数指针在编译期折叠成常量和直接调用，
+ * 热路径上没有按模式的分支或间接调用。
+ *
+ * 信道比特以 uint64_t 平面传递：第 i 比特位于 w[i >> 6] 的第 (i & 63) 位，
+ * 与 encode.h 的 wspr_plane_t 相同。
+ *
+ * 已有模式（wspr_mode.c）：
+ *   wspr_mode_wspr  50 比特载荷，162 个信道比特，162 个 4FSK 符号（与 wspr_encode() 相同）
+ *   wspr_mode_jt9   72 比特载荷，206 个信道比特，85 个 9FSK 符号（16 个同步 + 69 个数据）
+ */
+
+#define WSPR_MODE_TAIL_BITS 31
+#define WSPR_MODE_PLANE_WORDS 4 // 最多 256 个信道比特
+
+#define JT9_PAYLOAD_BITS 72
+#define JT9_BIT_COUNT 206
+#define JT9_SYMBOL_COUNT 85
+#define JT9_DATA_SYMBOLS 69
+
+// 卷积编码器的冲激响应：第 2t、2t+1 位分别为两个反馈多项式的第 t 位
+#define WSPR_CONV_IMPULSE 0xfd2479021ba5312bULL
+
+#if defined(__GNUC__)
+#define WSPR_MODE_INLINE static inline __attribute__((always_inline))
+#else
+#define WSPR_MODE_INLINE static inline
+#endif
+
+typedef struct {
+	const char *name;
+	uint8_t payload_bits;           // 载荷比特数，不含尾零
+	uint16_t channel_bits;          // 2 * (payload_bits + WSPR_MODE_TAIL_BITS)
+	uint8_t symbol_count;
+	uint8_t tones;
+	const uint8_t *interleave_dest; // 卷积输出第 i 比特交织后的位置
+	// 文本消息打包为载荷：p[0] 为前 min(n, 64) 比特，p[1] 为其余比特，均高位在前、右对齐；
+	// 无法编码返回 -1
+	int (*pack)(const char *text, uint64_t *p);
+	// 交织后的信道比特平面 -> 音调（0 ~ tones-1）
+	void (*map)(const uint64_t *plane, uint8_t *symbols);
+} wspr_mode_t;
+
+extern const wspr_mode_t wspr_mode_wspr;
+extern const wspr_mode_t wspr_mode_jt9;
+
+// 各模式的编码入口，成功返回 0，消息无法编码返回 -1。可重入、线程安全。
+// WSPR："CALL LOC DBM"，规范化规则与 wspr_encode() 相同
+int wspr_mode_encode_wspr(const char *text, uint8_t *symbols);
+// JT9 标准消息："CALL1 CALL2 [GRID|-NN|R-NN|RO|RRR|73]"，CALL1 可为 CQ/QRZ/DE
+int wspr_mode_encode_jt9(const char *text, uint8_t *symbols);
+
+WSPR_MODE_INLINE uint8_t wspr_mode_ctz64(uint64_t w)
+{
+#if defined(__GNUC__)
+	return (uint8_t)__builtin_ctzll(w);
+#else
+	uint8_t n = 0;
+	while (!(w & 1))
+	{
+		w >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+/**
+ * @brief 共用卷积内核：把一段载荷比特的输出异或进信道平面。
+ *
+ * @param w 信道平面，须足够容纳 2 * (first + nbits + 31) 个比特且预先清零。
+ * @param chunk 载荷比特，低 nbits 位有效，高位在前。
+ * @param nbits 本段比特数（1~64）。
+ * @param first 本段第一个比特在整个载荷中的序号。
+ *
+ * 每个置位的输入比特贡献一份左移 2k 位的冲激响应（GF(2) 上的无进位乘法），
+ * 只遍历置位比特；尾零不产生贡献，因此输出自然以 62 个零结尾。
+ */
+WSPR_MODE_INLINE void wspr_mode_convolve(uint64_t *w, uint64_t chunk, uint8_t nbits, uint16_t first)
+{
+	if (nbits < 64)
+	{
+		chunk &= (1ULL << nbits) - 1;
+	}
+	while (chunk)
+	{
+		uint16_t sh = (uint16_t)(2 * (first + nbits - 1 - wspr_mode_ctz64(chunk)));
+		uint8_t r = sh & 63;
+		w[sh >> 6] ^= WSPR_CONV_IMPULSE << r;
+		if (r)
+		{
+			w[(sh >> 6) + 1] ^= WSPR_CONV_IMPULSE >> (64 - r);
+		}
+		chunk &= chunk - 1;
+	}
+}
+
+/**
+ * @brief 按交织表置换平面中的每个置位比特。
+ *
+ * @param s 未交织平面，共 n 个比特。
+ * @param d 输出平面，须预先清零。
+ * @param dest 交织表，卷积输出第 i 比特写到第 dest[i] 位。
+ * @param n 信道比特数。
+ */
+WSPR_MODE_INLINE void wspr_mode_interleave(const uint64_t *s, uint64_t *d, const uint8_t *dest, uint16_t n)
+{
+	uint8_t i;
+
+	for (i = 0; i < (n + 63) / 64; i++)
+	{
+		uint64_t w = s[i];
+		while (w)
+		{
+			uint8_t dst = dest[i * 64 + wspr_mode_ctz64(w)];
+			d[dst >> 6] |= 1ULL << (dst & 63);
+			w &= w - 1;
+		}
+	}
+}
+
+/**
+ * @brief 通用编码流程，mode 必须是编译期可见的常量描述符。
+ */
+WSPR_MODE_INLINE int wspr_mode_encode(const wspr_mode_t *mode, const char *text, uint8_t *symbols)
+{
+	uint64_t p[2] = {0, 0};
+	uint64_t s[WSPR_MODE_PLANE_WORDS] = {0, 0, 0, 0};
+	uint64_t d[WSPR_MODE_PLANE_WORDS] = {0, 0, 0, 0};
+	const uint8_t n = mode->payload_bits;
+
+	if (mode->pack(text, p) != 0)
+	{
+		return -1;
+	}
+	wspr_mode_convolve(s, p[0], (n < 64) ? n : 64, 0);
+	if (n > 64)
+	{
+		wspr_mode_convolve(s, p[1], (uint8_t)(n - 64), 64);
+	}
+	wspr_mode_interleave(s, d, mode->interleave_dest, mode->channel_bits);
+	mode->map(d, symbols);
+	return 0;
+}
+
+// 定义模式的编码函数：int fn(const char *text, uint8_t *symbols)
+#define WSPR_MODE_ENCODER(fn, mode)                    \
+	int fn(const char *text, uint8_t *symbols)         \
+	{                                                  \
+		return wspr_mode_encode(&(mode), text, symbols); \
+	}
+
+#endif
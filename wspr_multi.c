@@ -0,0 +1,205 @@
+// vim: set ai et ts=4 sw=4:
+
+#include <string.h>
+#include "wspr_multi.h"
+
+#define MULTI_P3 ((uint64_t)SI5351_TONE_P3)
+
+// 候选PLL：si5351_ToneMults的整数倍频，再加上每个输出各自的小数PLL
+#define MULTI_CANDIDATES (SI5351_TONE_MULTS + WSPR_MULTI_OUTPUTS)
+
+// 某个输出在某个候选PLL下的音调寄存器
+typedef struct {
+    uint8_t ok;     // MS在8~2048之间
+    uint8_t lo, hi; // 各音调间有差异的字节范围（寄存器0~7）
+} tone_fit_t;
+
+static void tone_regs(const si5351PLLConfig_t* pll, uint64_t FclkCenti, uint8_t rdiv,
+                      uint8_t regs[WSPR_MULTI_TONES][SI5351_BULK_REGS], uint8_t* ok) {
+    uint64_t X[WSPR_MULTI_TONES];
+    uint8_t k;
+
+    for(k = 0; k < WSPR_MULTI_TONES; k++) {
+        X[k] = si5351_ToneX(pll, si5351_ToneCenti(FclkCenti, k), rdiv);
+        si5351_ToneRegs(X[k], rdiv, regs[k]);
+    }
+    *ok = X[WSPR_MULTI_TONES - 1] > 128ULL * 8 * MULTI_P3 && X[0] / MULTI_P3 < 128ULL * 2048;
+}
+
+static tone_fit_t tone_fit(const si5351PLLConfig_t* pll, uint64_t FclkCenti, uint8_t rdiv) {
+    uint8_t regs[WSPR_MULTI_TONES][SI5351_BULK_REGS];
+    tone_fit_t fit = {0, SI5351_BULK_REGS, 0};
+    uint8_t j, k;
+
+    tone_regs(pll, FclkCenti, rdiv, regs, &fit.ok);
+    for(j = 0; j < SI5351_BULK_REGS; j++) {
+        for(k = 1; k < WSPR_MULTI_TONES; k++) {
+            if(regs[k][j] != regs[0][j]) {
+                if(j < fit.lo) fit.lo = j;
+                fit.hi = j;
+            }
+        }
+    }
+    return fit;
+}
+
+/*
+ * 在候选PLL中为PLLA、PLLB（可不用）选值并把各输出分到其中一个，依次比较：
+ * 最坏情况下符号边沿连续写的长度（从第一个输出的首个变化字节到最后一个输出的
+ * 末个变化字节）、各输出变化字节数之和、所用PLL个数。先遇到的（PLL频率较高的）优先。
+ */
+int wspr_multi_plan(wspr_multi_t* m, const uint64_t FclkCenti[WSPR_MULTI_OUTPUTS],
+                    si5351DriveStrength_t driveStrength) {
+    si5351PLLConfig_t cand[MULTI_CANDIDATES];
+    tone_fit_t fit[WSPR_MULTI_OUTPUTS][MULTI_CANDIDATES];
+    uint8_t rdiv[WSPR_MULTI_OUTPUTS] = {0};
+    uint8_t ncand = 0, first = WSPR_MULTI_OUTPUTS, last = 0;
+    uint8_t o, c, a, b, bi, mask;
+    int best_span = 0x7FFF, best_sum = 0, best_npll = 0;
+    uint8_t best_a = 0, best_b = 0, best_mask = 0;
+
+    memset(m, 0, sizeof(*m));
+    for(o = 0; o < WSPR_MULTI_OUTPUTS; o++) {
+        int r;
+        if(FclkCenti[o] == 0) continue;
+        r = si5351_ToneRDiv(FclkCenti[o]);
+        if(r < 0) {
+            return -1;
+        }
+        rdiv[o] = (uint8_t)r;
+        m->enabled |= 1 << o;
+        if(first == WSPR_MULTI_OUTPUTS) first = o;
+        last = o;
+    }
+    if(m->enabled == 0) {
+        return -1;
+    }
+
+    for(c = 0; c < SI5351_TONE_MULTS; c++) {
+        cand[ncand].mult = si5351_ToneMults[c];
+        cand[ncand].num = 0;
+        cand[ncand].denom = 1;
+        ncand++;
+    }
+    for(o = 0; o < WSPR_MULTI_OUTPUTS; o++) {
+        if(m->enabled & (1 << o)) {
+            si5351_TonePLL(FclkCenti[o], rdiv[o], &cand[ncand++]);
+        }
+    }
+    for(o = 0; o < WSPR_MULTI_OUTPUTS; o++) {
+        if(!(m->enabled & (1 << o))) continue;
+        for(c = 0; c < ncand; c++) {
+            fit[o][c] = tone_fit(&cand[c], FclkCenti[o], rdiv[o]);
+        }
+    }
+
+    // b == ncand表示不用PLLB（最先尝试）；mask为分到PLLB的输出
+    for(a = 0; a < ncand; a++) {
+        for(bi = 0; bi <= ncand; bi++) {
+            b = (bi == 0) ? ncand : bi - 1;
+            for(mask = 0; mask < (1 << WSPR_MULTI_OUTPUTS); mask++) {
+                int span, sum = 0, npll = (b == ncand) ? 1 : 2, ok = 1;
+                if((mask & ~m->enabled) || (b == ncand && mask) || (b != ncand && (mask == 0 || mask == m->enabled)) ||
+                   b == a) {
+                    continue;
+                }
+                for(o = 0; o < WSPR_MULTI_OUTPUTS && ok; o++) {
+                    const tone_fit_t* f = &fit[o][(mask & (1 << o)) ? b : a];
+                    if(!(m->enabled & (1 << o))) continue;
+                    ok = f->ok;
+                    sum += f->hi - f->lo + 1;
+                }
+                if(!ok) continue;
+                span = (8 * last + fit[last][(mask & (1 << last)) ? b : a].hi) -
+                       (8 * first + fit[first][(mask & (1 << first)) ? b : a].lo) + 1;
+                if(span < best_span || (span == best_span && (sum < best_sum ||
+                                                              (sum == best_sum && npll < best_npll)))) {
+                    best_span = span;
+                    best_sum = sum;
+                    best_npll = npll;
+                    best_a = a;
+                    best_b = b;
+                    best_mask = mask;
+                }
+            }
+        }
+    }
+    if(best_span == 0x7FFF) {
+        return -1;
+    }
+
+    m->pll[SI5351_PLL_A] = cand[best_a];
+    m->pll_used = 1 << SI5351_PLL_A;
+    si5351_PLLRegs(&m->pll[SI5351_PLL_A], m->pll_regs[SI5351_PLL_A]);
+    if(best_b != ncand) {
+        m->pll[SI5351_PLL_B] = cand[best_b];
+        m->pll_used |= 1 << SI5351_PLL_B;
+        si5351_PLLRegs(&m->pll[SI5351_PLL_B], m->pll_regs[SI5351_PLL_B]);
+    }
+    m->max_burst = (uint8_t)best_span;
+
+    int shared = 1;
+    for(o = 0; o < WSPR_MULTI_OUTPUTS; o++) {
+        si5351PLL_t pll = (best_mask & (1 << o)) ? SI5351_PLL_B : SI5351_PLL_A;
+        uint8_t ok;
+        if(!(m->enabled & (1 << o))) continue;
+        tone_regs(&m->pll[pll], FclkCenti[o], rdiv[o], m->tone_regs[o], &ok);
+        si5351OutputConfig_t out_conf = {0, 0, 0, 1, (si5351RDiv_t)rdiv[o]};
+        m->pll_of[o] = (uint8_t)pll;
+        m->clk_control[o] = si5351_ClkControl(pll, driveStrength, &out_conf);
+        if(fit[o][(best_mask & (1 << o)) ? best_b : best_a].lo < 5) {
+            shared = 0;
+        }
+    }
+    return shared ? 0 : 1;
+}
+
+void wspr_multi_start(wspr_multi_t* m, const uint8_t tones[WSPR_MULTI_OUTPUTS]) {
+    uint8_t o, first = WSPR_MULTI_OUTPUTS, last = 0;
+
+    // 不用的输出关断，其MultiSynth寄存器可以随连续写一起被改写
+    for(o = 0; o < WSPR_MULTI_OUTPUTS; o++) {
+        if(!(m->enabled & (1 << o))) continue;
+        memcpy(&m->shadow[o * SI5351_BULK_REGS], m->tone_regs[o][tones[o]], SI5351_BULK_REGS);
+        if(first == WSPR_MULTI_OUTPUTS) first = o;
+        last = o;
+    }
+
+    si5351_BatchBegin();
+    if(m->pll_used & (1 << SI5351_PLL_A)) si5351_writeRegs(SI5351_PLLA_BASE, m->pll_regs[SI5351_PLL_A]);
+    if(m->pll_used & (1 << SI5351_PLL_B)) si5351_writeRegs(SI5351_PLLB_BASE, m->pll_regs[SI5351_PLL_B]);
+    si5351_write(SI5351_PLL_RESET, SI5351_PLL_RESET_AB);
+    si5351_writeBurst(WSPR_MULTI_BASE + first * SI5351_BULK_REGS, &m->shadow[first * SI5351_BULK_REGS],
+                      (uint8_t)((last - first + 1) * SI5351_BULK_REGS));
+    for(o = 0; o < WSPR_MULTI_OUTPUTS; o++) {
+        si5351_write(SI5351_CLK_CONTROL(o), (m->enabled & (1 << o)) ? m->clk_control[o] : SI5351_CLK_POWER_DOWN);
+    }
+    si5351_EnableOutputs(m->enabled);
+    si5351_BatchCommit(0, 0);
+    si5351_Wait();
+}
+
+uint8_t wspr_multi_symbol(wspr_multi_t* m, const uint8_t tones[WSPR_MULTI_OUTPUTS]) {
+    uint8_t o, j, lo = WSPR_MULTI_REGS, hi = 0;
+
+    for(o = 0; o < WSPR_MULTI_OUTPUTS; o++) {
+        const uint8_t* regs = m->tone_regs[o][tones[o]];
+        if(!(m->enabled & (1 << o))) continue;
+        for(j = 0; j < SI5351_BULK_REGS; j++) {
+            uint8_t i = o * SI5351_BULK_REGS + j;
+            if(m->shadow[i] != regs[j]) {
+                m->shadow[i] = regs[j];
+                if(i < lo) lo = i;
+                hi = i;
+            }
+        }
+    }
+    if(lo > hi) {
+        return 0;
+    }
+    // 作为一批提交后立即返回，中断/DMA传输在下一个符号边沿前早已完成
+    si5351_BatchBegin();
+    si5351_writeBurst(WSPR_MULTI_BASE + lo, &m->shadow[lo], hi - lo + 1);
+    si5351_BatchCommit(0, 0);
+    return hi - lo + 1;
+}
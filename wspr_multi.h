@@ -0,0 +1,56 @@
+#ifndef WSPR_MULTI_H
+#define WSPR_MULTI_H
+
+#include <stdint.h>
+#include "si5351.h"
+
+/*
+ * 一片Si5351在CLK0~CLK2上同时发射最多三个波段的WSPR（消息可以各不相同）。
+ *
+ * 三个输出共用PLLA，必要时分出PLLB（si5351_Calc()在81MHz以下同样让所有输出
+ * 共用900MHz PLL）。每个输出的四个音调由各自的小数MultiSynth给出：P3固定为
+ * 2^20-1，规划器在整数倍频24~36和各输出专用的小数PLL中挑选，使每个输出的
+ * 四个音调共用P1，换音只改寄存器5~7（P2）。
+ *
+ * MultiSynth0~2的寄存器42~65地址连续。每个符号边沿把所有输出的变化合并为
+ * 一次I2C连续写，范围为第一个和最后一个变化字节之间（中间未变的字节按
+ * 影子寄存器原样重写），三个输出在同一事务内换音。两端输出都用上时最坏
+ * 为寄存器47~65共19字节，100kHz I2C下约2ms。
+ *
+ * 编译（固件）：与si5351.c、si5351_transport.c一起编译，
+ * app.c中定义WSPR_USE_MULTI后调用encode_multi()。
+ */
+
+#define WSPR_MULTI_OUTPUTS 3
+#define WSPR_MULTI_TONES 4
+#define WSPR_MULTI_BASE SI5351_MS_BASE(0) // MultiSynth0寄存器，MultiSynth1、2紧随其后
+#define WSPR_MULTI_REGS (WSPR_MULTI_OUTPUTS * SI5351_BULK_REGS)
+
+typedef struct {
+    uint8_t enabled;                                                      // 使用中的输出位掩码
+    uint8_t pll_used;                                                     // 位0为PLLA，位1为PLLB
+    uint8_t pll_of[WSPR_MULTI_OUTPUTS];                                   // 各输出所用PLL
+    si5351PLLConfig_t pll[2];
+    uint8_t pll_regs[2][SI5351_BULK_REGS];
+    uint8_t clk_control[WSPR_MULTI_OUTPUTS];
+    uint8_t tone_regs[WSPR_MULTI_OUTPUTS][WSPR_MULTI_TONES][SI5351_BULK_REGS];
+    uint8_t max_burst;                                                    // 每个符号边沿最多写入的字节数
+    uint8_t shadow[WSPR_MULTI_REGS];                                      // 寄存器42~65的当前值
+} wspr_multi_t;
+
+/*
+ * 规划PLL和各输出的音调寄存器。FclkCenti[k]为CLKk音调0的频率（0.01Hz），0表示不用。
+ * 成功返回0；参数错误（没有输出或频率超过75MHz）返回-1；
+ * 某个输出找不到共用P1的PLL时返回1，此时该输出换音连P1一起写，仍可正常发射。
+ */
+int wspr_multi_plan(wspr_multi_t* m, const uint64_t FclkCenti[WSPR_MULTI_OUTPUTS],
+                    si5351DriveStrength_t driveStrength);
+
+// 写入PLL并复位，写入各输出的首个音调，关闭不用的输出并打开其余输出。等待发送完成
+void wspr_multi_start(wspr_multi_t* m, const uint8_t tones[WSPR_MULTI_OUTPUTS]);
+
+// 符号边沿调用：tones为各输出本符号的音调。以一次连续写提交后立即返回，
+// 返回写入的字节数（没有变化时为0）
+uint8_t wspr_multi_symbol(wspr_multi_t* m, const uint8_t tones[WSPR_MULTI_OUTPUTS]);
+
+#endif
@@ -0,0 +1,123 @@
+// vim: set ai et ts=4 sw=4:
+
+#include <math.h>
+#include "wspr_ramp.h"
+
+// 过渡期间固定的MultiSynth P3（最大值），P2的分辨率约为f/(128·MS·2^20)
+#define RAMP_P3 ((uint64_t)SI5351_TONE_P3)
+
+// 高斯过渡的陡度：erf(±GAUSS_K/2)作为两端，再归一到0和1
+#define GAUSS_K 4.0
+#define RAMP_PI 3.14159265358979323846
+
+// 四个音调共用P1：X[0]与X[3]在同一个P3区间内，且MS在8~2048之间
+static int same_p1(const uint64_t* X) {
+    uint64_t p1 = X[0] / RAMP_P3;
+    return p1 == X[WSPR_RAMP_TONES - 1] / RAMP_P3 && X[WSPR_RAMP_TONES - 1] > 128ULL * 8 * RAMP_P3 &&
+           p1 < 128ULL * 2048;
+}
+
+// 过渡形状，x从0到1
+static double ramp_shape(wspr_ramp_shape_t shape, double x) {
+    if(shape == WSPR_RAMP_GAUSSIAN) {
+        return 0.5 * (1.0 + erf(GAUSS_K * (x - 0.5)) / erf(GAUSS_K * 0.5));
+    }
+    return 0.5 * (1.0 - cos(RAMP_PI * x));
+}
+
+int wspr_ramp_plan(wspr_ramp_t* r, uint64_t FclkCenti, uint8_t output, si5351DriveStrength_t driveStrength,
+                   wspr_ramp_shape_t shape, uint8_t steps) {
+    int rdiv = si5351_ToneRDiv(FclkCenti);
+    uint64_t F[WSPR_RAMP_TONES], X[WSPR_RAMP_TONES];
+    si5351PLLConfig_t pll_conf = {si5351_ToneMults[0], 0, 1};
+    uint8_t m, k, from, to, j;
+    int found = 0;
+
+    if(output > 2 || steps == 0 || steps > WSPR_RAMP_MAX_STEPS || steps > WSPR_RAMP_TICKS || rdiv < 0) {
+        return -1;
+    }
+    for(k = 0; k < WSPR_RAMP_TONES; k++) {
+        F[k] = si5351_ToneCenti(FclkCenti, k);
+    }
+
+    // 从900MHz往下找四个音调共用P1的整数倍频
+    for(m = 0; m < SI5351_TONE_MULTS && !found; m++) {
+        pll_conf.mult = si5351_ToneMults[m];
+        for(k = 0; k < WSPR_RAMP_TONES; k++) {
+            X[k] = si5351_ToneX(&pll_conf, F[k], (uint8_t)rdiv);
+        }
+        found = same_p1(X);
+    }
+    if(!found) {
+        // F与25MHz成简单倍数关系时，128·MS对所有整数倍频都正好落在P1边界上，改用小数PLL
+        si5351_TonePLL(F[0], (uint8_t)rdiv, &pll_conf);
+        for(k = 0; k < WSPR_RAMP_TONES; k++) {
+            X[k] = si5351_ToneX(&pll_conf, F[k], (uint8_t)rdiv);
+        }
+        found = same_p1(X);
+    }
+    if(!found) {
+        // 退回900MHz整数PLL，每个音调各自的P1
+        pll_conf.mult = si5351_ToneMults[0];
+        pll_conf.num = 0;
+        pll_conf.denom = 1;
+        for(k = 0; k < WSPR_RAMP_TONES; k++) {
+            X[k] = si5351_ToneX(&pll_conf, F[k], (uint8_t)rdiv);
+        }
+    }
+
+    si5351OutputConfig_t out_conf = {0, (int32_t)(X[0] / (128 * RAMP_P3)), 0, 1, (si5351RDiv_t)rdiv};
+    si5351_PLLRegs(&pll_conf, r->pll_regs);
+    r->clk_control = si5351_ClkControl(SI5351_PLL_A, driveStrength, &out_conf);
+    r->output = output;
+    for(k = 0; k < WSPR_RAMP_TONES; k++) {
+        si5351_ToneRegs(X[k], (uint8_t)rdiv, r->tone_regs[k]);
+    }
+    if(!found) {
+        r->steps = 0;
+        return 1;
+    }
+
+    // 逐步的P2；寄存器5（P3与P2的高4位）与上一步相同时只写6~7
+    r->steps = steps;
+    for(from = 0; from < WSPR_RAMP_TONES; from++) {
+        for(to = 0; to < WSPR_RAMP_TONES; to++) {
+            int32_t p2a = (int32_t)(X[from] % RAMP_P3);
+            int32_t p2b = (int32_t)(X[to] % RAMP_P3);
+            uint8_t prev5 = r->tone_regs[from][5];
+            if(from == to) continue;
+            for(j = 0; j < steps; j++) {
+                wspr_ramp_step_t* s = &r->ramp[from][to][j];
+                double w = ramp_shape(shape, (double)(j + 1) / steps);
+                int32_t p2 = (j == steps - 1) ? p2b : p2a + (int32_t)lround(w * (p2b - p2a));
+                s->regs[0] = (uint8_t)(((RAMP_P3 >> 12) & 0xF0) | ((p2 >> 16) & 0x0F));
+                s->regs[1] = (uint8_t)((p2 >> 8) & 0xFF);
+                s->regs[2] = (uint8_t)(p2 & 0xFF);
+                s->first = (s->regs[0] != prev5) ? 5 : 6;
+                prev5 = s->regs[0];
+            }
+        }
+    }
+    return 0;
+}
+
+void wspr_ramp_start(const wspr_ramp_t* r, uint8_t tone) {
+    si5351_StartOutput(SI5351_PLL_A, r->pll_regs, r->output, r->tone_regs[tone], r->clk_control);
+}
+
+void wspr_ramp_tick(const wspr_ramp_t* r, uint8_t from, uint8_t to, uint8_t tick) {
+    uint8_t base = SI5351_MS_BASE(r->output);
+    const wspr_ramp_step_t* s;
+
+    if(from == to) return;
+    if(r->steps == 0) {
+        if(tick == 0) si5351_writeRegs(base, r->tone_regs[to]);
+        return;
+    }
+    if(tick >= r->steps) return;
+    s = &r->ramp[from][to][tick];
+    // 作为一批提交后立即返回，中断/DMA传输在下一次定时器中断前即可完成
+    si5351_BatchBegin();
+    si5351_writeBurst(base + s->first, &s->regs[s->first - 5], 8 - s->first);
+    si5351_BatchCommit(0, 0);
+}
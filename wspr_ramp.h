@@ -0,0 +1,67 @@
+#ifndef WSPR_RAMP_H
+#define WSPR_RAMP_H
+
+#include <stdint.h>
+#include "si5351.h"
+
+/*
+ * 换音频率过渡：把每次音调切换拆成若干个中间频率，按升余弦或高斯形状
+ * 平滑过渡，减小单步跳变在约6Hz信号带宽之外产生的能量。
+ *
+ * 四个音调共用同一组PLL参数和MultiSynth的P1、P3（P3取最大值2^20-1），
+ * 只有P2不同，过渡过程中只需写MultiSynth寄存器5~7（P2），且多数步只写
+ * 6~7两个字节。发射前由wspr_ramp_plan()算好全部12种音调组合的逐步寄存器值，
+ * 发射时只查表并提交一次I2C连续写，使用中断/DMA传输时不等待发送完成。
+ *
+ * 符号定时器在ramp模式下每个符号中断WSPR_RAMP_TICKS次，每次中断写一步，
+ * 过渡占用每个符号开头的steps次中断。100kHz I2C下一步（地址、寄存器号和
+ * 2个数据字节）约0.4ms，远小于WSPR_RAMP_TICKS=64时10.7ms的中断间隔。
+ *
+ * 编译（固件）：与si5351.c、si5351_transport.c一起编译并链接libm，
+ * app.c中定义WSPR_USE_RAMP后调用encode_ramped()。
+ */
+
+#define WSPR_RAMP_TONES 4
+#define WSPR_RAMP_MAX_STEPS 32
+
+// 每个符号的定时器中断次数（定时器周期为 8192/12000/WSPR_RAMP_TICKS 秒）
+#ifndef WSPR_RAMP_TICKS
+#define WSPR_RAMP_TICKS 64
+#endif
+
+typedef enum {
+    WSPR_RAMP_RAISED_COSINE = 0, // 0.5(1-cos(πx))
+    WSPR_RAMP_GAUSSIAN      = 1, // 高斯滤波后的阶跃（erf），两端归一到0和1
+} wspr_ramp_shape_t;
+
+// 过渡中的一步：从MultiSynth寄存器first（5或6）起写到寄存器7
+typedef struct {
+    uint8_t first;
+    uint8_t regs[3]; // 寄存器5~7的值
+} wspr_ramp_step_t;
+
+typedef struct {
+    uint8_t output;                                        // CLK0~CLK2
+    uint8_t steps;                                         // 0表示直接跳变（写完整8字节）
+    uint8_t clk_control;                                   // CLKx控制寄存器
+    uint8_t pll_regs[SI5351_BULK_REGS];                    // PLLA寄存器
+    uint8_t tone_regs[WSPR_RAMP_TONES][SI5351_BULK_REGS];  // 各音调MultiSynth寄存器
+    wspr_ramp_step_t ramp[WSPR_RAMP_TONES][WSPR_RAMP_TONES][WSPR_RAMP_MAX_STEPS]; // [原音调][新音调][步]
+} wspr_ramp_t;
+
+/*
+ * 计算过渡表。FclkCenti为音调0的频率（0.01Hz），output为0~2，steps为过渡步数
+ * （1~WSPR_RAMP_MAX_STEPS，且不超过WSPR_RAMP_TICKS）。
+ * 成功返回0；参数错误返回-1；找不到四个音调共用P1的PLL倍频时返回1，
+ * 此时表格按直接跳变填好（steps为0），仍可正常发射。
+ */
+int wspr_ramp_plan(wspr_ramp_t* r, uint64_t FclkCenti, uint8_t output, si5351DriveStrength_t driveStrength,
+                   wspr_ramp_shape_t shape, uint8_t steps);
+
+// 写入PLL、复位PLL、写入首个音调的MultiSynth并打开输出
+void wspr_ramp_start(const wspr_ramp_t* r, uint8_t tone);
+
+// 每次定时器中断调用一次：tick为本符号内的中断序号，from/to为上一个和本符号的音调
+void wspr_ramp_tick(const wspr_ramp_t* r, uint8_t from, uint8_t to, uint8_t tick);
+
+#endif
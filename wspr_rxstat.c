@@ -0,0 +1,475 @@
+/*
+ * wspr_rxstat.c - 录音档案的电平统计与读取吞吐量
+ *
+ * 用wspr_wav的零拷贝读取依次处理大量WAV/原始录音：后台线程预取下一个文件，
+ * 当前文件按块转换到对齐的工作缓冲区（IQ拆成I、Q平面），统计每个文件的
+ * 直流分量、RMS和峰值（dBFS）。这也是接收端前端读取录音的方式。
+ *
+ * 编译：
+ *   gcc -O2 -march=native -I. -o wspr_rxstat wspr_rxstat.c wspr_wav.c -lpthread -lm
+ *   （不加-march=native时x86-64用SSE2，ARM用NEON，其他平台用标量转换）
+ *
+ * 用法：
+ *   wspr_rxstat [选项] 文件...
+ *     --list 文件         从文件读入路径（每行一个，'#'开头为注释），可与命令行文件混用
+ *     --raw s16|f32       原始采集文件（无文件头），配合：
+ *     --iq                2声道IQ（默认1声道）
+ *     --rate Hz           采样率（默认12000）
+ *     --offset 字节       跳过的文件头长度
+ *     --block 帧数        每次转换的帧数（默认65536）
+ *     --no-prefetch       不预取，逐个同步打开（对比用）
+ *     --check             生成各种格式的临时文件，校验解析、SIMD转换和档案遍历
+ *
+ * stdout为CSV：file,format,channels,rate,frames,seconds,dc_i,rms_dbfs_i,peak_dbfs_i,dc_q,rms_dbfs_q,peak_dbfs_q
+ * （实信号录音Q列为空）。stderr为总量、吞吐量（MB/s）和相当于实时的倍数。
+ * 返回：0成功，1有文件无法读取，2参数错误，3校验不一致。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "wspr_wav.h"
+
+static struct {
+    wspr_wav_raw_t raw;
+    int is_raw;
+    size_t block;
+    int no_prefetch;
+} cfg;
+
+typedef struct {
+    double sum, sum2, peak;
+} level_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// 一块样本的累计；分成4路部分和，循环可被向量化
+static void level_add(level_t *l, const float *x, size_t n) {
+    float s[4] = {0, 0, 0, 0}, s2[4] = {0, 0, 0, 0}, pk[4] = {0, 0, 0, 0};
+    size_t k, j;
+
+    for (k = 0; k + 4 <= n; k += 4) {
+        for (j = 0; j < 4; j++) {
+            float v = x[k + j];
+            float a = v < 0 ? -v : v;
+            s[j] += v;
+            s2[j] += v * v;
+            pk[j] = a > pk[j] ? a : pk[j];
+        }
+    }
+    for (; k < n; k++) {
+        float a = x[k] < 0 ? -x[k] : x[k];
+        s[0] += x[k];
+        s2[0] += x[k] * x[k];
+        pk[0] = a > pk[0] ? a : pk[0];
+    }
+    for (j = 0; j < 4; j++) {
+        l->sum += s[j];
+        l->sum2 += s2[j];
+        if (pk[j] > l->peak) l->peak = pk[j];
+    }
+}
+
+static double dbfs(double v) {
+    return v > 0 ? 20.0 * log10(v) : -999.0;
+}
+
+static void print_level(const level_t *l, uint64_t frames) {
+    double n = frames ? (double)frames : 1.0;
+    printf(",%.6f,%.2f,%.2f", l->sum / n, dbfs(sqrt(l->sum2 / n)), dbfs(l->peak));
+}
+
+// 统计一个已映射的文件，返回处理的字节数
+static uint64_t process(const char *path, const wspr_wav_t *w, wspr_rx_buf_t *buf) {
+    level_t li, lq;
+    uint64_t first = 0;
+
+    memset(&li, 0, sizeof(li));
+    memset(&lq, 0, sizeof(lq));
+    while (wspr_wav_read_buf(w, first, buf) > 0) {
+        level_add(&li, buf->i, buf->n);
+        if (w->channels == 2) level_add(&lq, buf->q, buf->n);
+        first += buf->n;
+    }
+
+    printf("%s,%s,%u,%u,%llu,%.3f", path, w->format == WSPR_WAV_S16 ? "s16" : "f32", (unsigned)w->channels,
+           (unsigned)w->rate, (unsigned long long)w->frames, w->rate ? (double)w->frames / w->rate : 0.0);
+    print_level(&li, w->frames);
+    if (w->channels == 2) {
+        print_level(&lq, w->frames);
+    } else {
+        printf(",,,");
+    }
+    printf("\n");
+    return w->frames * w->channels * (w->format == WSPR_WAV_S16 ? 2u : 4u);
+}
+
+// 从列表文件读入路径，追加到*paths
+static int read_list(const char *list, char ***paths, size_t *count, size_t *cap) {
+    FILE *f = fopen(list, "r");
+    char line[4096];
+
+    if (!f) {
+        perror(list);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        size_t len = strcspn(line, "\r\n");
+        line[len] = 0;
+        if (len == 0 || line[0] == '#') continue;
+        if (*count == *cap) {
+            *cap = *cap ? *cap * 2 : 256;
+            *paths = (char **)realloc(*paths, *cap * sizeof(char *));
+        }
+        (*paths)[(*count)++] = strdup(line);
+    }
+    fclose(f);
+    return 0;
+}
+
+static int run(const char *const *paths, size_t count) {
+    wspr_rx_buf_t buf;
+    wspr_wav_archive_t *a = NULL;
+    uint64_t bytes = 0, frames_total = 0;
+    double audio_sec = 0, t0, t1;
+    size_t k, failed = 0;
+    char err[128];
+
+    if (wspr_rx_buf_alloc(&buf, cfg.block, 1) != 0) {
+        fprintf(stderr, "内存不足\n");
+        return 1;
+    }
+    if (!cfg.no_prefetch) {
+        a = wspr_wav_archive_open(paths, count, cfg.is_raw ? &cfg.raw : NULL);
+        if (!a) {
+            fprintf(stderr, "无法启动预取线程\n");
+            wspr_rx_buf_free(&buf);
+            return 1;
+        }
+    }
+
+    printf("file,format,channels,rate,frames,seconds,dc_i,rms_dbfs_i,peak_dbfs_i,dc_q,rms_dbfs_q,peak_dbfs_q\n");
+    t0 = now_sec();
+    for (k = 0; k < count; k++) {
+        wspr_wav_t w;
+        size_t index = k;
+        int ret;
+
+        if (a) {
+            ret = wspr_wav_archive_next(a, &w, &index, err, sizeof(err));
+        } else if (cfg.is_raw) {
+            ret = wspr_wav_open_raw(paths[k], &cfg.raw, &w, err, sizeof(err)) == 0 ? 1 : -1;
+        } else {
+            ret = wspr_wav_open(paths[k], &w, err, sizeof(err)) == 0 ? 1 : -1;
+        }
+        if (ret < 0) {
+            fprintf(stderr, "%s: %s\n", paths[index], err);
+            failed++;
+            continue;
+        }
+        bytes += process(paths[index], &w, &buf);
+        frames_total += w.frames;
+        if (w.rate) audio_sec += (double)w.frames / w.rate;
+        wspr_wav_close(&w);
+    }
+    t1 = now_sec();
+    wspr_wav_archive_close(a);
+    wspr_rx_buf_free(&buf);
+
+    fprintf(stderr, "%zu 个文件（%zu 个失败），%llu 帧，%.1f MB，%.3f 秒，%.0f MB/s，%.0f 倍实时（%s%s）\n",
+            count, failed, (unsigned long long)frames_total, bytes / 1e6, t1 - t0, bytes / 1e6 / (t1 - t0),
+            audio_sec / (t1 - t0), wspr_wav_simd(), cfg.no_prefetch ? "，无预取" : "，预取");
+    return failed ? 1 : 0;
+}
+
+// ---------------------------------------------------------------- 校验
+
+static uint32_t rng = 2463534242u;
+
+static uint32_t rnd(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static void put16(FILE *f, uint32_t v) {
+    fputc((int)(v & 0xff), f);
+    fputc((int)((v >> 8) & 0xff), f);
+}
+
+static void put32(FILE *f, uint32_t v) {
+    put16(f, v & 0xffff);
+    put16(f, v >> 16);
+}
+
+typedef struct {
+    const char *name;
+    int rf64;          // RF64头，data长度为0xFFFFFFFF，真实长度在ds64中
+    int fmt_size;      // 16、18（浮点，数据按2字节对齐）或40（EXTENSIBLE）
+    int list_chunk;    // data前插一个奇数长度的LIST块
+    int truncated;     // data长度大于实际写入的长度
+    int raw_offset;    // >=0：无文件头的原始文件，前面有这么多字节的垃圾
+    wspr_wav_format_t format;
+    int channels;
+} check_case_t;
+
+static const check_case_t check_cases[] = {
+    {"s16_mono.wav", 0, 16, 0, 0, -1, WSPR_WAV_S16, 1},
+    {"s16_iq_ext.wav", 0, 40, 1, 0, -1, WSPR_WAV_S16, 2},
+    {"f32_iq_fmt18.wav", 0, 18, 0, 0, -1, WSPR_WAV_F32, 2},
+    {"f32_mono_rf64.wav", 1, 16, 1, 0, -1, WSPR_WAV_F32, 1},
+    {"s16_iq_truncated.wav", 0, 16, 0, 1, -1, WSPR_WAV_S16, 2},
+    {"f32_iq_ext.wav", 0, 40, 0, 0, -1, WSPR_WAV_F32, 2},
+    {"s16_iq.raw", 0, 0, 0, 0, 1, WSPR_WAV_S16, 2},
+    {"f32_mono.raw", 0, 0, 0, 0, 8, WSPR_WAV_F32, 1},
+};
+#define CHECK_CASES (sizeof(check_cases) / sizeof(check_cases[0]))
+#define CHECK_FRAMES 12347
+
+// 写测试文件，expect中为期望的float样本（交错），返回实际可读的帧数
+static uint64_t write_case(const char *path, const check_case_t *c, float *expect) {
+    FILE *f = fopen(path, "wb");
+    uint32_t bps = c->format == WSPR_WAV_S16 ? 2 : 4;
+    uint32_t n = CHECK_FRAMES * c->channels;
+    uint32_t data_bytes = n * bps;
+    uint32_t k;
+
+    if (!f) return 0;
+    if (c->raw_offset >= 0) {
+        for (k = 0; k < (uint32_t)c->raw_offset; k++) fputc(0x5a, f);
+    } else {
+        fwrite(c->rf64 ? "RF64" : "RIFF", 1, 4, f);
+        put32(f, c->rf64 ? 0xFFFFFFFFu : 0);
+        fwrite("WAVE", 1, 4, f);
+        if (c->rf64) {
+            fwrite("ds64", 1, 4, f);
+            put32(f, 28);
+            put32(f, 0);
+            put32(f, 0);
+            put32(f, data_bytes);
+            put32(f, 0);
+            put32(f, CHECK_FRAMES);
+            put32(f, 0);
+            put32(f, 0);
+        }
+        fwrite("fmt ", 1, 4, f);
+        put32(f, (uint32_t)c->fmt_size);
+        put16(f, c->fmt_size == 40 ? 0xFFFE : (c->format == WSPR_WAV_S16 ? 1 : 3));
+        put16(f, (uint32_t)c->channels);
+        put32(f, 12000);
+        put32(f, 12000 * bps * c->channels);
+        put16(f, bps * c->channels);
+        put16(f, bps * 8);
+        if (c->fmt_size >= 18) put16(f, (uint32_t)(c->fmt_size - 18));
+        if (c->fmt_size == 40) {
+            put16(f, bps * 8);
+            put32(f, c->channels == 2 ? 3 : 4);
+            // 子格式GUID：格式码 + KSDATAFORMAT后缀
+            put16(f, c->format == WSPR_WAV_S16 ? 1 : 3);
+            fwrite("\x00\x00\x00\x00\x10\x00\x80\x00\x00\xAA\x00\x38\x9B\x71", 1, 14, f);
+        }
+        if (c->list_chunk) {
+            fwrite("LIST", 1, 4, f);
+            put32(f, 3);
+            fwrite("abc\0", 1, 4, f); // 3字节加1字节填充
+        }
+        fwrite("data", 1, 4, f);
+        put32(f, c->rf64 ? 0xFFFFFFFFu : data_bytes + (c->truncated ? 4096u : 0u));
+    }
+
+    for (k = 0; k < n; k++) {
+        if (c->format == WSPR_WAV_S16) {
+            int16_t v = (int16_t)rnd();
+            if (k < 4) v = (int16_t)(k & 1 ? 32767 : -32768);
+            put16(f, (uint16_t)v);
+            expect[k] = (float)v / 32768.0f;
+        } else {
+            float v = (float)((int32_t)rnd()) / 2147483648.0f;
+            uint32_t u;
+            memcpy(&u, &v, 4);
+            put32(f, u);
+            expect[k] = v;
+        }
+    }
+    // 截断的录音末尾多出半帧
+    if (c->truncated) put16(f, 0x1234);
+    fclose(f);
+    return CHECK_FRAMES;
+}
+
+// 校验一个已映射的文件：随机起点/长度的读取与期望值逐个比对
+static long verify(const wspr_wav_t *w, const check_case_t *c, const float *expect, wspr_rx_buf_t *buf) {
+    long bad = 0;
+    int round;
+
+    if (w->frames != CHECK_FRAMES || w->channels != c->channels || w->format != c->format) return 1;
+    for (round = 0; round < 64; round++) {
+        uint64_t first = (round == 0) ? 0 : rnd() % (CHECK_FRAMES + 16);
+        size_t n = (round == 1) ? buf->cap : 1 + rnd() % 600;
+        size_t got, k;
+        int only_i = (round & 3) == 3;
+
+        if (n > buf->cap) n = buf->cap;
+        got = wspr_wav_read(w, first, n, buf->i, only_i ? NULL : buf->q);
+        if (got != (first >= CHECK_FRAMES ? 0 : (n < CHECK_FRAMES - first ? n : CHECK_FRAMES - first))) bad++;
+        for (k = 0; k < got; k++) {
+            if (buf->i[k] != expect[(first + k) * c->channels]) bad++;
+            if (c->channels == 2 && !only_i && buf->q[k] != expect[(first + k) * 2 + 1]) bad++;
+        }
+    }
+    return bad;
+}
+
+static int check(void) {
+    char dir[] = "/tmp/wspr_rxstat.XXXXXX";
+    char paths[CHECK_CASES + 1][64];
+    const char *plist[CHECK_CASES + 1];
+    float *expect[CHECK_CASES];
+    wspr_rx_buf_t buf;
+    wspr_wav_archive_t *a;
+    size_t c, index;
+    long bad = 0;
+    int pass, got;
+    char err[128];
+    FILE *f;
+
+    if (!mkdtemp(dir) || wspr_rx_buf_alloc(&buf, 4096, 1) != 0) {
+        fprintf(stderr, "无法创建临时目录\n");
+        return 1;
+    }
+    for (c = 0; c < CHECK_CASES; c++) {
+        snprintf(paths[c], sizeof(paths[c]), "%s/%s", dir, check_cases[c].name);
+        plist[c] = paths[c];
+        expect[c] = (float *)malloc(CHECK_FRAMES * 2 * sizeof(float));
+        write_case(paths[c], &check_cases[c], expect[c]);
+    }
+    // 最后一个是坏文件，档案遍历应报告错误并继续
+    snprintf(paths[CHECK_CASES], sizeof(paths[CHECK_CASES]), "%s/bad.wav", dir);
+    plist[CHECK_CASES] = paths[CHECK_CASES];
+    f = fopen(paths[CHECK_CASES], "wb");
+    if (f) {
+        fputs("RIFF\0\0\0\0WAVEjunk", f);
+        fclose(f);
+    }
+
+    // 第1遍逐个同步打开，第2遍经档案预取
+    for (pass = 0; pass < 2; pass++) {
+        wspr_wav_raw_t raw;
+        a = NULL;
+        for (c = 0; c < CHECK_CASES; c++) {
+            const check_case_t *cc = &check_cases[c];
+            wspr_wav_t w;
+            long b;
+
+            raw.format = cc->format;
+            raw.channels = (uint8_t)cc->channels;
+            raw.rate = 12000;
+            raw.offset = cc->raw_offset >= 0 ? (size_t)cc->raw_offset : 0;
+            if (pass == 0) {
+                got = (cc->raw_offset >= 0 ? wspr_wav_open_raw(paths[c], &raw, &w, err, sizeof(err))
+                                           : wspr_wav_open(paths[c], &w, err, sizeof(err))) == 0;
+            } else {
+                // 原始文件和WAV分别建档案，各只含一个文件，档案内的遍历在下面单独检查
+                a = wspr_wav_archive_open(&plist[c], 1, cc->raw_offset >= 0 ? &raw : NULL);
+                got = a && wspr_wav_archive_next(a, &w, &index, err, sizeof(err)) == 1 && index == 0;
+            }
+            b = got ? verify(&w, cc, expect[c], &buf) : 1;
+            if (b) fprintf(stderr, "不一致: %s（%s）\n", cc->name, pass ? "预取" : "同步");
+            bad += b;
+            if (got) wspr_wav_close(&w);
+            wspr_wav_archive_close(a);
+            a = NULL;
+        }
+    }
+
+    // WAV文件与坏文件组成的档案：顺序、错误报告与结束
+    {
+        const char *wavs[CHECK_CASES + 1];
+        wspr_wav_t w;
+        size_t n = 0, seen = 0;
+        int ret;
+        for (c = 0; c < CHECK_CASES; c++) {
+            if (check_cases[c].raw_offset < 0) wavs[n++] = plist[c];
+        }
+        wavs[n++] = plist[CHECK_CASES];
+        a = wspr_wav_archive_open(wavs, n, NULL);
+        while (a && (ret = wspr_wav_archive_next(a, &w, &index, err, sizeof(err))) != 0) {
+            if (index != seen || (ret < 0) != (index == n - 1)) bad++;
+            if (ret > 0) wspr_wav_close(&w);
+            seen++;
+        }
+        if (!a || seen != n) bad++;
+        wspr_wav_archive_close(a);
+    }
+
+    for (c = 0; c <= CHECK_CASES; c++) remove(paths[c]);
+    rmdir(dir);
+    for (c = 0; c < CHECK_CASES; c++) free(expect[c]);
+    wspr_rx_buf_free(&buf);
+    printf("校验: %zu 种格式 x 2 种打开方式（%s），%ld 处不一致\n", CHECK_CASES, wspr_wav_simd(), bad);
+    return bad ? 3 : 0;
+}
+
+int main(int argc, char **argv) {
+    char **paths = NULL;
+    size_t count = 0, cap = 0;
+    int bad_args = 0, do_check = 0, ret, i;
+
+    cfg.raw.channels = 1;
+    cfg.raw.rate = 12000;
+    cfg.block = 65536;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--list") == 0 && i + 1 < argc) {
+            if (read_list(argv[++i], &paths, &count, &cap) != 0) return 1;
+        } else if (strcmp(argv[i], "--raw") == 0 && i + 1 < argc) {
+            i++;
+            cfg.is_raw = 1;
+            if (strcmp(argv[i], "s16") == 0) cfg.raw.format = WSPR_WAV_S16;
+            else if (strcmp(argv[i], "f32") == 0) cfg.raw.format = WSPR_WAV_F32;
+            else bad_args = 1;
+        } else if (strcmp(argv[i], "--iq") == 0) {
+            cfg.raw.channels = 2;
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            cfg.raw.rate = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--offset") == 0 && i + 1 < argc) {
+            cfg.raw.offset = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--block") == 0 && i + 1 < argc) {
+            cfg.block = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--no-prefetch") == 0) {
+            cfg.no_prefetch = 1;
+        } else if (strcmp(argv[i], "--check") == 0) {
+            do_check = 1;
+        } else if (argv[i][0] == '-' && argv[i][1] != 0) {
+            bad_args = 1;
+        } else {
+            if (count == cap) {
+                cap = cap ? cap * 2 : 256;
+                paths = (char **)realloc(paths, cap * sizeof(char *));
+            }
+            paths[count++] = strdup(argv[i]);
+        }
+    }
+    if (cfg.block < 1 || (!do_check && count == 0)) bad_args = 1;
+    if (bad_args) {
+        fprintf(stderr,
+                "用法: %s [--list 列表] [--raw s16|f32 [--iq] [--rate Hz] [--offset 字节]]\n"
+                "          [--block 帧数] [--no-prefetch] 文件... | --check\n",
+                argv[0]);
+        return 2;
+    }
+
+    ret = do_check ? check() : run((const char *const *)paths, count);
+    for (i = 0; i < (int)count; i++) free(paths[i]);
+    free(paths);
+    return ret;
+}
@@ -0,0 +1,514 @@
+/*
+ * wspr_snr.c - 并行WSPR译码灵敏度（译码概率-SNR曲线）蒙特卡罗仿真
+ *
+ * 每次试验：wspr_encode()生成162个4-FSK符号 → 信道（AWGN、瑞利或莱斯衰落）
+ * → 每个符号四个音调的匹配滤波输出 → 已知同步比特下的非相干软判决（精确LLR）
+ * → wspr_deinterleave() → wspr_fano_decode()，载荷与发送一致即为成功。
+ * 假定时间、频率同步理想，结果是译码器和调制方式本身的极限。
+ *
+ * SNR按WSPR惯例为2500Hz带宽内的信噪比：Es/N0 = SNR + 10·log10(2500·8192/12000)，
+ * 即SNR + 32.3dB。衰落信道的复增益按一阶高斯-马尔可夫过程逐符号变化，相关系数
+ * 取J0(2π·fd·Ts)；--doppler 0为整条消息不变的块衰落。
+ *
+ * 试验以--batch次为一批分给线程池，每个线程有自己的xoshiro256**随机数发生器
+ * （每批按种子、SNR点和批序号重新播种，结果与线程数无关）。每完成一批就更新
+ * 该点的Wilson 95%置信区间，半宽小于--ci（且不少于--min-trials次）时停止该点；
+ * 各SNR点同时推进，先收敛的点不占用线程。
+ *
+ * 编译：
+ *   gcc -O3 -I. -o wspr_snr wspr_snr.c wspr_decode.c encode.c nhash.c -lpthread -lm
+ *
+ * 用法：
+ *   wspr_snr [-j 线程数] [--snr 起:止:步长] [--channel awgn|rayleigh|rician]
+ *            [--doppler Hz] [--k-factor dB] [--ci 半宽] [--min-trials N] [--max-trials N]
+ *            [--batch N] [--seed N] [--msg "呼号 网格 功率"] [--random-msgs]
+ *            [--max-cycles N] [--delta N] [-o 输出.csv]
+ *   wspr_snr --check      # 高SNR必须全部译出、极低SNR必须全部失败
+ *
+ * 输出CSV列：channel,snr_db,esn0_db,ebn0_db,trials,decoded,p,ci_low,ci_high,avg_cycles
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "encode.h"
+#include "wspr_decode.h"
+
+#define MAX_THREADS 256
+#define MAX_POINTS 512
+#define PI 3.14159265358979323846
+
+// WSPR符号时长（秒）与Es/N0相对2500Hz SNR的偏移
+#define SYMBOL_TIME (8192.0 / 12000.0)
+#define ESN0_OFFSET_DB (10.0 * log10(2500.0 * SYMBOL_TIME))
+
+// 软符号 = 128 + LLR·SOFT_SCALE（截断到0~255）
+#define SOFT_SCALE 8.0
+
+typedef enum { CH_AWGN, CH_RAYLEIGH, CH_RICIAN } channel_t;
+static const char *channel_names[] = {"awgn", "rayleigh", "rician"};
+
+static struct {
+    int threads;
+    double snr_lo, snr_hi, snr_step;
+    channel_t channel;
+    double doppler;
+    double k_factor_db;
+    double ci;
+    uint64_t min_trials, max_trials;
+    int batch;
+    uint64_t seed;
+    const char *msg;
+    int random_msgs;
+    uint32_t max_cycles;
+    int delta;
+    const char *out_path;
+} cfg;
+
+typedef struct {
+    double snr;
+    uint64_t trials, decoded;
+    uint64_t cycles;       // 成功译码的总步数
+    uint64_t batches;      // 已分出的批数（用作批序号）
+    int done;
+} point_t;
+
+static struct {
+    pthread_mutex_t lock;
+    point_t points[MAX_POINTS];
+    int npoints;
+    int rr;                // 轮转起点，让各点交替领取
+} st;
+
+static wspr_fano_metric_t metric;
+static double rho;         // 衰落的逐符号相关系数
+
+// 固定消息（未指定--random-msgs时）
+static char fixed_call[13], fixed_loc[7];
+static int8_t fixed_dbm;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* ---------- 每线程随机数：xoshiro256** ---------- */
+
+typedef struct {
+    uint64_t s[4];
+    double spare;
+    int has_spare;
+} rng_t;
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void rng_seed(rng_t *r, uint64_t a, uint64_t b, uint64_t c) {
+    uint64_t x = a ^ (b * 0x9e3779b97f4a7c15ULL) ^ (c * 0xc2b2ae3d27d4eb4fULL);
+    int i;
+    for (i = 0; i < 4; i++) r->s[i] = splitmix64(&x);
+    r->has_spare = 0;
+}
+
+static inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t rng_next(rng_t *r) {
+    uint64_t *s = r->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+// (0, 1)上的均匀分布
+static inline double rng_uniform(rng_t *r) {
+    return ((rng_next(r) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+// 标准正态（Box-Muller，成对生成）
+static double rng_gauss(rng_t *r) {
+    double u, v, m;
+    if (r->has_spare) {
+        r->has_spare = 0;
+        return r->spare;
+    }
+    u = rng_uniform(r);
+    v = rng_uniform(r);
+    m = sqrt(-2.0 * log(u));
+    r->spare = m * sin(2.0 * PI * v);
+    r->has_spare = 1;
+    return m * cos(2.0 * PI * v);
+}
+
+/* ---------- 信道与解调 ---------- */
+
+// ln I0(z)（Abramowitz & Stegun 9.8.1 / 9.8.2）
+static double ln_i0(double z) {
+    if (z < 3.75) {
+        double t = (z / 3.75) * (z / 3.75);
+        return log(1.0 + t * (3.5156229 + t * (3.0899424 + t * (1.2067492 + t * (0.2659732 +
+                   t * (0.0360768 + t * 0.0045813))))));
+    } else {
+        double t = 3.75 / z;
+        return z - 0.5 * log(z) + log(0.39894228 + t * (0.01328592 + t * (0.00225319 + t * (-0.00157565 +
+               t * (0.00916281 + t * (-0.02057706 + t * (0.02635537 + t * (-0.01647633 + t * 0.00392377))))))));
+    }
+}
+
+// 随机的类型1消息
+static void random_message(rng_t *r, char *call, char *loc, int8_t *dbm) {
+    static const int8_t powers[] = {0, 3, 7, 10, 13, 17, 20, 23, 27, 30, 33, 37, 40, 43, 47, 50, 53, 57, 60};
+    int len = 1 + (int)(rng_next(r) % 3), i;
+    char *p = call;
+    *p++ = (char)('A' + rng_next(r) % 26);
+    *p++ = (char)('A' + rng_next(r) % 26);
+    *p++ = (char)('0' + rng_next(r) % 10);
+    for (i = 0; i < len; i++) *p++ = (char)('A' + rng_next(r) % 26);
+    *p = 0;
+    loc[0] = (char)('A' + rng_next(r) % 18);
+    loc[1] = (char)('A' + rng_next(r) % 18);
+    loc[2] = (char)('0' + rng_next(r) % 10);
+    loc[3] = (char)('0' + rng_next(r) % 10);
+    loc[4] = 0;
+    *dbm = powers[rng_next(r) % (sizeof(powers) / sizeof(powers[0]))];
+}
+
+// 一次试验，成功返回1并累加步数
+static int trial(rng_t *r, double esn0, uint32_t *cycles_out) {
+    char call[13], loc[7], call_[13], loc_[7];
+    int8_t dbm;
+    uint8_t sym[WSPR_SYMBOL_COUNT], soft[WSPR_SYMBOL_COUNT];
+    double e[WSPR_SYMBOL_COUNT][4];
+    double amp = sqrt(esn0), hr, hi, sum_sig = 0.0, sum_noise = 0.0, es;
+    double los = 0.0, scatter = 1.0;
+    wspr_message_t msg;
+    uint64_t word, got;
+    int i, k;
+
+    memset(call, 0, sizeof(call));
+    memset(loc, 0, sizeof(loc));
+    if (cfg.random_msgs) {
+        random_message(r, call, loc, &dbm);
+    } else {
+        strcpy(call, fixed_call);
+        strcpy(loc, fixed_loc);
+        dbm = fixed_dbm;
+    }
+    wspr_encode(call, loc, dbm, sym);
+    memcpy(call_, call, sizeof(call_));
+    memcpy(loc_, loc, sizeof(loc_));
+    wspr_message_prep_r(&msg, call_, loc_, dbm);
+    word = wspr_pack50(&msg);
+
+    // 信道复增益：莱斯为直射分量加散射分量，总功率归一到1
+    if (cfg.channel == CH_RICIAN) {
+        double k = pow(10.0, cfg.k_factor_db / 10.0);
+        los = sqrt(k / (k + 1.0));
+        scatter = sqrt(1.0 / (k + 1.0));
+    }
+    hr = rng_gauss(r) * sqrt(0.5);
+    hi = rng_gauss(r) * sqrt(0.5);
+
+    // 四个音调的匹配滤波输出能量，噪声E|n|^2 = 1
+    for (i = 0; i < WSPR_SYMBOL_COUNT; i++) {
+        double gr = amp, gi = 0.0;
+        if (cfg.channel != CH_AWGN) {
+            if (i > 0) {
+                double w = sqrt(1.0 - rho * rho) * sqrt(0.5);
+                hr = rho * hr + w * rng_gauss(r);
+                hi = rho * hi + w * rng_gauss(r);
+            }
+            gr = amp * (los + scatter * hr);
+            gi = amp * scatter * hi;
+        }
+        for (k = 0; k < 4; k++) {
+            double nr = rng_gauss(r) * sqrt(0.5), ni = rng_gauss(r) * sqrt(0.5);
+            if (k == sym[i]) {
+                nr += gr;
+                ni += gi;
+            }
+            e[i][k] = nr * nr + ni * ni;
+        }
+    }
+
+    // 同步比特已知：数据比特只在sync与sync+2两个音调间判决，另两个音调估计噪声
+    for (i = 0; i < WSPR_SYMBOL_COUNT; i++) {
+        uint8_t s = WSPR_PLANE_BIT(&wspr_sync_plane, i);
+        sum_sig += e[i][s] + e[i][s + 2];
+        sum_noise += e[i][s ^ 1] + e[i][(s ^ 1) + 2];
+    }
+    {
+        double n0 = sum_noise / (2.0 * WSPR_SYMBOL_COUNT);
+        es = sum_sig / WSPR_SYMBOL_COUNT - 2.0 * n0;
+        if (es < 0.05 * n0) es = 0.05 * n0;
+        amp = sqrt(es) / n0;
+        for (i = 0; i < WSPR_SYMBOL_COUNT; i++) {
+            uint8_t s = WSPR_PLANE_BIT(&wspr_sync_plane, i);
+            // 非相干FSK的对数似然比：ln I0(2a|r1|/N0) - ln I0(2a|r0|/N0)
+            double llr = ln_i0(2.0 * amp * sqrt(e[i][s + 2])) - ln_i0(2.0 * amp * sqrt(e[i][s]));
+            double v = 128.0 + llr * SOFT_SCALE;
+            soft[i] = (uint8_t)(v < 0.0 ? 0 : v > 255.0 ? 255 : lround(v));
+        }
+    }
+
+    wspr_deinterleave(soft);
+    if (wspr_fano_decode(soft, &metric, cfg.delta, cfg.max_cycles, &got, cycles_out, NULL) != 0) {
+        return 0;
+    }
+    return got == word;
+}
+
+/* ---------- 调度与提前停止 ---------- */
+
+// Wilson 95%区间
+static void wilson(uint64_t n, uint64_t x, double *lo, double *hi) {
+    const double z = 1.959963984540054;
+    double p, d, c, h;
+    if (n == 0) {
+        *lo = 0.0;
+        *hi = 1.0;
+        return;
+    }
+    p = (double)x / n;
+    d = 1.0 + z * z / n;
+    c = (p + z * z / (2.0 * n)) / d;
+    h = z * sqrt(p * (1.0 - p) / n + z * z / (4.0 * n * n)) / d;
+    *lo = c - h < 0.0 ? 0.0 : c - h;
+    *hi = c + h > 1.0 ? 1.0 : c + h;
+}
+
+static int point_converged(const point_t *p) {
+    double lo, hi;
+    if (p->trials >= cfg.max_trials) return 1;
+    if (p->trials < cfg.min_trials) return 0;
+    wilson(p->trials, p->decoded, &lo, &hi);
+    return (hi - lo) / 2.0 <= cfg.ci;
+}
+
+// 轮转领取一个未收敛点的一批，返回点序号，全部完成返回-1
+static int claim(uint64_t *batch) {
+    int i, idx = -1;
+    pthread_mutex_lock(&st.lock);
+    for (i = 0; i < st.npoints; i++) {
+        int j = (st.rr + i) % st.npoints;
+        if (!st.points[j].done) {
+            idx = j;
+            *batch = st.points[j].batches++;
+            st.rr = j + 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&st.lock);
+    return idx;
+}
+
+static void *worker(void *arg) {
+    rng_t rng;
+    uint64_t batch;
+    int idx;
+    (void)arg;
+
+    while ((idx = claim(&batch)) >= 0) {
+        double esn0 = pow(10.0, (st.points[idx].snr + ESN0_OFFSET_DB) / 10.0);
+        uint64_t ok = 0, cycles = 0;
+        int i;
+
+        rng_seed(&rng, cfg.seed, (uint64_t)idx, batch);
+        for (i = 0; i < cfg.batch; i++) {
+            uint32_t c = 0;
+            if (trial(&rng, esn0, &c)) {
+                ok++;
+                cycles += c;
+            }
+        }
+
+        pthread_mutex_lock(&st.lock);
+        st.points[idx].trials += (uint64_t)cfg.batch;
+        st.points[idx].decoded += ok;
+        st.points[idx].cycles += cycles;
+        if (point_converged(&st.points[idx])) st.points[idx].done = 1;
+        pthread_mutex_unlock(&st.lock);
+    }
+    return NULL;
+}
+
+static void run(void) {
+    pthread_t th[MAX_THREADS];
+    int i;
+    for (i = 0; i < cfg.threads; i++) pthread_create(&th[i], NULL, worker, NULL);
+    for (i = 0; i < cfg.threads; i++) pthread_join(th[i], NULL);
+}
+
+static void setup_points(double lo, double hi, double step) {
+    double s;
+    memset(&st.points, 0, sizeof(st.points));
+    st.npoints = 0;
+    st.rr = 0;
+    for (s = lo; s <= hi + 1e-9 && st.npoints < MAX_POINTS; s += step) {
+        st.points[st.npoints++].snr = s;
+    }
+}
+
+static void write_csv(FILE *f) {
+    int i;
+    fprintf(f, "channel,snr_db,esn0_db,ebn0_db,trials,decoded,p,ci_low,ci_high,avg_cycles\n");
+    for (i = 0; i < st.npoints; i++) {
+        const point_t *p = &st.points[i];
+        double lo, hi;
+        wilson(p->trials, p->decoded, &lo, &hi);
+        // Eb按50个信息比特计：Eb/N0 = Es/N0 + 10·log10(162/50)
+        fprintf(f, "%s,%.2f,%.2f,%.2f,%llu,%llu,%.5f,%.5f,%.5f,%.0f\n", channel_names[cfg.channel], p->snr,
+                p->snr + ESN0_OFFSET_DB, p->snr + ESN0_OFFSET_DB + 10.0 * log10(162.0 / 50.0),
+                (unsigned long long)p->trials, (unsigned long long)p->decoded,
+                p->trials ? (double)p->decoded / p->trials : 0.0, lo, hi,
+                p->decoded ? (double)p->cycles / p->decoded : 0.0);
+    }
+}
+
+// 自检：AWGN下+0dB必须全部译出，-50dB必须全部失败
+static int self_check(void) {
+    channel_t ch = cfg.channel;
+    int ok;
+    cfg.channel = CH_AWGN;
+    cfg.min_trials = cfg.max_trials = 256;
+    setup_points(-50.0, 0.0, 50.0);
+    run();
+    ok = st.points[0].decoded == 0 && st.points[1].decoded == st.points[1].trials;
+    printf("-50 dB: %llu/%llu 译出，0 dB: %llu/%llu 译出 -> %s\n", (unsigned long long)st.points[0].decoded,
+           (unsigned long long)st.points[0].trials, (unsigned long long)st.points[1].decoded,
+           (unsigned long long)st.points[1].trials, ok ? "通过" : "失败");
+    cfg.channel = ch;
+    return ok ? 0 : 1;
+}
+
+static int parse_snr_range(const char *s) {
+    return sscanf(s, "%lf:%lf:%lf", &cfg.snr_lo, &cfg.snr_hi, &cfg.snr_step) == 3 && cfg.snr_step > 0 &&
+                   cfg.snr_hi >= cfg.snr_lo
+               ? 0
+               : -1;
+}
+
+int main(int argc, char **argv) {
+    int bad_args = 0, check = 0, i;
+    FILE *out = stdout;
+    double t0, t1;
+    uint64_t total = 0;
+
+    cfg.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    cfg.snr_lo = -34.0;
+    cfg.snr_hi = -22.0;
+    cfg.snr_step = 1.0;
+    cfg.channel = CH_AWGN;
+    cfg.doppler = 0.1;
+    cfg.k_factor_db = 6.0;
+    cfg.ci = 0.02;
+    cfg.min_trials = 200;
+    cfg.max_trials = 20000;
+    cfg.batch = 32;
+    cfg.seed = 1;
+    cfg.msg = "BI1TPH ON80 10";
+    cfg.max_cycles = 200000;
+    cfg.delta = 4 * WSPR_FANO_SCALE;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            cfg.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--snr") == 0 && i + 1 < argc) {
+            if (parse_snr_range(argv[++i]) != 0) bad_args = 1;
+        } else if (strcmp(argv[i], "--channel") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "awgn") == 0) cfg.channel = CH_AWGN;
+            else if (strcmp(argv[i], "rayleigh") == 0) cfg.channel = CH_RAYLEIGH;
+            else if (strcmp(argv[i], "rician") == 0) cfg.channel = CH_RICIAN;
+            else bad_args = 1;
+        } else if (strcmp(argv[i], "--doppler") == 0 && i + 1 < argc) {
+            cfg.doppler = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--k-factor") == 0 && i + 1 < argc) {
+            cfg.k_factor_db = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--ci") == 0 && i + 1 < argc) {
+            cfg.ci = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--min-trials") == 0 && i + 1 < argc) {
+            cfg.min_trials = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-trials") == 0 && i + 1 < argc) {
+            cfg.max_trials = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            cfg.batch = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            cfg.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--msg") == 0 && i + 1 < argc) {
+            cfg.msg = argv[++i];
+        } else if (strcmp(argv[i], "--random-msgs") == 0) {
+            cfg.random_msgs = 1;
+        } else if (strcmp(argv[i], "--max-cycles") == 0 && i + 1 < argc) {
+            cfg.max_cycles = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--delta") == 0 && i + 1 < argc) {
+            cfg.delta = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            cfg.out_path = argv[++i];
+        } else if (strcmp(argv[i], "--check") == 0) {
+            check = 1;
+        } else {
+            bad_args = 1;
+        }
+    }
+    {
+        int d;
+        if (sscanf(cfg.msg, "%12s %6s %d", fixed_call, fixed_loc, &d) != 3) bad_args = 1;
+        fixed_dbm = (int8_t)d;
+    }
+    if (cfg.batch < 1 || cfg.ci <= 0.0 || cfg.max_trials < 1 || cfg.delta < 1 || cfg.doppler < 0.0) bad_args = 1;
+    if (bad_args) {
+        fprintf(stderr,
+                "用法: %s [-j 线程数] [--snr 起:止:步长] [--channel awgn|rayleigh|rician]\n"
+                "          [--doppler Hz] [--k-factor dB] [--ci 半宽] [--min-trials N] [--max-trials N]\n"
+                "          [--batch N] [--seed N] [--msg \"呼号 网格 功率\"] [--random-msgs]\n"
+                "          [--max-cycles N] [--delta N] [-o 输出.csv] [--check]\n",
+                argv[0]);
+        return 2;
+    }
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.threads > MAX_THREADS) cfg.threads = MAX_THREADS;
+
+    // 软符号是按SOFT_SCALE缩放的精确LLR，对应高斯模型中2·amp/sigma^2 = 1/SOFT_SCALE
+    wspr_fano_metrics(&metric, 1.0, sqrt(2.0 * SOFT_SCALE));
+    rho = j0(2.0 * PI * cfg.doppler * SYMBOL_TIME);
+
+    pthread_mutex_init(&st.lock, NULL);
+    if (check) return self_check();
+
+    if (cfg.out_path) {
+        out = fopen(cfg.out_path, "w");
+        if (!out) {
+            perror(cfg.out_path);
+            return 1;
+        }
+    }
+    setup_points(cfg.snr_lo, cfg.snr_hi, cfg.snr_step);
+    t0 = now_sec();
+    run();
+    t1 = now_sec();
+    write_csv(out);
+    if (out != stdout) fclose(out);
+
+    for (i = 0; i < st.npoints; i++) total += st.points[i].trials;
+    fprintf(stderr, "%d 个SNR点，%llu 次试验，%d 线程，%.2f 秒，%.0f 次/秒\n", st.npoints,
+            (unsigned long long)total, cfg.threads, t1 - t0, total / (t1 - t0));
+    return 0;
+}
@@ -0,0 +1,526 @@
+/*
+ * wspr_sweep.c - 多核WSPR消息空间往返校验
+ *
+ * 对每条消息走完整个收发链路：prep → wspr_pack50() → wspr_convolve50()
+ * → wspr_interleave() → wspr_deinterleave() → wspr_fano_decode()
+ * → wspr_unpack50()，与规范化后的呼号、网格、功率逐项比较；同时与比特平面
+ * 路径wspr_convolve_interleave_plane()的信道比特比对。
+ *
+ * 消息空间：呼号按6字符格式枚举（首字符37种、第二字符36种、数字10种、
+ * 0~3个字母后缀共18279种），网格32400个，功率为wspr_message_prep_r()
+ * 接受的28个值。全空间约1.5e14条，无法穷举，提供三种模式：
+ *   fields      （默认）每个呼号、每个网格+功率组合至少出现一次，另一字段
+ *               按哈希搭配。呼号n和网格/功率m在载荷中互不影响，覆盖全部字段值
+ *   stratified  把全空间等分为--strata层，每层取--samples条伪随机消息
+ *   exhaustive  按呼号、网格、功率的顺序穷举（配合--range分片使用）
+ *
+ * 工作按--shard条一片由线程池按序领取。--checkpoint文件定期记录下一片
+ * 和未完成的片，Ctrl-C或重新运行时从断点继续；不一致的消息在所在片完成时
+ * 写入--mismatches文件，因此续跑不会重复。吞吐量（条/秒）输出到stderr。
+ *
+ * 编译：
+ *   gcc -O2 -I. -o wspr_sweep wspr_sweep.c wspr_decode.c encode.c nhash.c -lpthread -lm
+ *
+ * 用法：
+ *   wspr_sweep [-j 线程数] [--mode fields|stratified|exhaustive] [--range A:B]
+ *              [--samples K] [--strata S] [--seed N] [--shard N]
+ *              [--checkpoint 文件] [--interval 秒] [--mismatches 文件]
+ *   wspr_sweep --mode exhaustive --range 0:100000000 --checkpoint ex.ckpt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "encode.h"
+#include "wspr_decode.h"
+
+#define MAX_THREADS 256
+#define MAX_SHARD_MISMATCHES 16 // 每片最多记录的不一致行
+#define CHECKPOINT_VERSION 1
+
+// 呼号：首字符37 × 第二字符36 × 数字10 × 后缀18279（1 + 26 + 26^2 + 26^3）
+#define SUFFIX_COUNT 18279ULL
+#define CALL_COUNT (37ULL * 36 * 10 * SUFFIX_COUNT)
+#define GRID_COUNT 32400ULL
+#define POWER_COUNT 28ULL
+#define GP_COUNT (GRID_COUNT * POWER_COUNT)
+#define SPACE_COUNT (CALL_COUNT * GP_COUNT)
+
+static const int8_t powers[POWER_COUNT] = {-30, -27, -23, -20, -17, -13, -10, -7, -3, 0, 3, 7, 10, 13,
+                                           17, 20, 23, 27, 30, 33, 37, 40, 43, 47, 50, 53, 57, 60};
+
+typedef enum { MODE_FIELDS, MODE_STRATIFIED, MODE_EXHAUSTIVE } sweep_mode_t;
+
+static struct {
+    int threads;
+    sweep_mode_t mode;
+    uint64_t begin, end;   // 工作序号范围
+    uint64_t samples;      // stratified：每层条数
+    uint64_t strata;       // stratified：层数
+    uint64_t seed;
+    uint64_t shard;
+    const char *checkpoint;
+    double interval;
+    const char *mismatches;
+} cfg;
+
+// 各阶段的不一致类型
+enum { STAGE_PLANE, STAGE_DECODE, STAGE_UNPACK, STAGE_COUNT };
+static const char *stage_names[STAGE_COUNT] = {"plane", "decode", "unpack"};
+
+typedef struct {
+    uint64_t messages;
+    uint64_t skipped;              // 不可编码的呼号（首字符为空格且没有后缀）
+    uint64_t stage[STAGE_COUNT];
+} tally_t;
+
+// 共享状态：领取和完成都在锁内，检查点据此得到一致的快照
+static struct {
+    pthread_mutex_t lock;
+    uint64_t next;                 // 下一个未领取的片
+    uint64_t nshards;
+    uint64_t *pending;             // 续跑时需重做的片
+    size_t npending, pending_pos;
+    uint64_t current[MAX_THREADS]; // 各线程正在处理的片，UINT64_MAX表示空闲
+    tally_t total;
+    FILE *mismatch_file;
+} st;
+
+static volatile sig_atomic_t stop;
+static wspr_fano_metric_t metric;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t work_count(void) {
+    switch (cfg.mode) {
+    case MODE_FIELDS: return CALL_COUNT + GP_COUNT;
+    case MODE_STRATIFIED: return cfg.strata * cfg.samples;
+    default: return SPACE_COUNT;
+    }
+}
+
+// 工作序号 → (呼号序号, 网格+功率序号)
+static void work_item(uint64_t w, uint64_t *call, uint64_t *gp) {
+    if (cfg.mode == MODE_FIELDS) {
+        if (w < CALL_COUNT) {
+            *call = w;
+            *gp = splitmix64(w ^ cfg.seed) % GP_COUNT;
+        } else {
+            *gp = w - CALL_COUNT;
+            *call = splitmix64(w ^ cfg.seed) % CALL_COUNT;
+        }
+    } else {
+        uint64_t idx = w;
+        if (cfg.mode == MODE_STRATIFIED) {
+            uint64_t layer = w / cfg.samples;
+            uint64_t lo = SPACE_COUNT / cfg.strata * layer;
+            uint64_t hi = (layer + 1 == cfg.strata) ? SPACE_COUNT : lo + SPACE_COUNT / cfg.strata;
+            idx = lo + splitmix64(w ^ cfg.seed) % (hi - lo);
+        }
+        *call = idx / GP_COUNT;
+        *gp = idx % GP_COUNT;
+    }
+}
+
+// 呼号序号 → 字符串；首字符为空格且没有后缀时无法往返，返回-1
+static int make_call(uint64_t idx, char *call) {
+    static const char a37[] = " 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    static const char a36[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    uint64_t suffix = idx % SUFFIX_COUNT;
+    uint8_t c0, c1, c2, len, i;
+    char *p = call;
+
+    idx /= SUFFIX_COUNT;
+    c2 = (uint8_t)(idx % 10);
+    idx /= 10;
+    c1 = (uint8_t)(idx % 36);
+    c0 = (uint8_t)(idx / 36);
+
+    if (suffix == 0) len = 0;
+    else if (suffix <= 26) { len = 1; suffix -= 1; }
+    else if (suffix <= 26 + 676) { len = 2; suffix -= 27; }
+    else { len = 3; suffix -= 27 + 676; }
+    if (c0 == 0 && len == 0) return -1;
+
+    if (c0) *p++ = a37[c0];
+    *p++ = a36[c1];
+    *p++ = (char)('0' + c2);
+    for (i = len; i > 0; i--) {
+        uint64_t d = 1;
+        uint8_t k;
+        for (k = 1; k < i; k++) d *= 26;
+        *p++ = (char)('A' + (suffix / d) % 26);
+    }
+    *p = 0;
+    return 0;
+}
+
+static void make_grid(uint64_t gp, char *loc, int8_t *dbm) {
+    uint64_t g = gp / POWER_COUNT;
+    *dbm = powers[gp % POWER_COUNT];
+    loc[0] = (char)('A' + g / 1800);
+    loc[1] = (char)('A' + (g / 100) % 18);
+    loc[2] = (char)('0' + (g / 10) % 10);
+    loc[3] = (char)('0' + g % 10);
+    loc[4] = 0;
+}
+
+// 一条消息走完整个链路，返回不一致的阶段，全部一致返回-1
+static int round_trip(const char *call_in, const char *loc_in, int8_t dbm, wspr_decoded_t *dec, char *want_call) {
+    char call[13], loc[7];
+    wspr_message_t msg;
+    wspr_plane_t plane;
+    uint8_t s[WSPR_BIT_COUNT];
+    uint64_t word, got;
+    uint8_t i;
+
+    // wspr_message_prep_r()会检查前12个字符，剩余部分须为0
+    memset(call, 0, sizeof(call));
+    memcpy(call, call_in, strlen(call_in));
+    memset(loc, 0, sizeof(loc));
+    memcpy(loc, loc_in, strlen(loc_in));
+    wspr_message_prep_r(&msg, call, loc, dbm);
+    word = wspr_pack50(&msg);
+
+    wspr_convolve50(word, s);
+    wspr_interleave(s);
+    wspr_convolve_interleave_plane(word, &plane);
+    for (i = 0; i < WSPR_BIT_COUNT; i++) {
+        if (s[i] != WSPR_PLANE_BIT(&plane, i)) return STAGE_PLANE;
+    }
+
+    // 无噪声软符号
+    for (i = 0; i < WSPR_BIT_COUNT; i++) s[i] = s[i] ? 228 : 28;
+    wspr_deinterleave(s);
+    if (wspr_fano_decode(s, &metric, 4 * WSPR_FANO_SCALE, 10000, &got, NULL, NULL) != 0 || got != word) {
+        memset(dec, 0, sizeof(*dec));
+        return STAGE_DECODE;
+    }
+
+    // 规范化后的呼号去掉首尾空格再比较
+    {
+        const char *c = msg.callsign;
+        size_t len;
+        while (*c == ' ') c++;
+        len = strlen(c);
+        while (len && c[len - 1] == ' ') len--;
+        memcpy(want_call, c, len);
+        want_call[len] = 0;
+    }
+    if (wspr_unpack50(got, dec) != 0 || dec->type != 1 || strcmp(dec->callsign, want_call) != 0 ||
+        strncmp(dec->locator, msg.locator, 4) != 0 || dec->power != msg.power) {
+        return STAGE_UNPACK;
+    }
+    return -1;
+}
+
+// 领取下一片，没有剩余时返回UINT64_MAX
+static uint64_t claim(int tid) {
+    uint64_t shard = UINT64_MAX;
+    pthread_mutex_lock(&st.lock);
+    if (!stop) {
+        if (st.pending_pos < st.npending) {
+            shard = st.pending[st.pending_pos++];
+        } else if (st.next < st.nshards) {
+            shard = st.next++;
+        }
+    }
+    st.current[tid] = shard;
+    pthread_mutex_unlock(&st.lock);
+    return shard;
+}
+
+static void *worker(void *arg) {
+    int tid = (int)(intptr_t)arg;
+    char lines[MAX_SHARD_MISMATCHES][160];
+    uint64_t shard;
+
+    while ((shard = claim(tid)) != UINT64_MAX) {
+        uint64_t w = cfg.begin + shard * cfg.shard;
+        uint64_t end = w + cfg.shard;
+        tally_t t;
+        int nlines = 0, k;
+
+        memset(&t, 0, sizeof(t));
+        if (end > cfg.end) end = cfg.end;
+        for (; w < end; w++) {
+            uint64_t ci, gp;
+            char call[13], loc[5], want[13];
+            int8_t dbm;
+            wspr_decoded_t dec;
+            int stage;
+
+            if ((w & 4095) == 0 && stop) break;
+            work_item(w, &ci, &gp);
+            if (make_call(ci, call) != 0) {
+                t.skipped++;
+                continue;
+            }
+            make_grid(gp, loc, &dbm);
+            stage = round_trip(call, loc, dbm, &dec, want);
+            t.messages++;
+            if (stage >= 0) {
+                t.stage[stage]++;
+                if (nlines < MAX_SHARD_MISMATCHES) {
+                    snprintf(lines[nlines++], sizeof(lines[0]), "%llu,%s,%s,%d,%s,%s,%s,%d\n",
+                             (unsigned long long)w, stage_names[stage], call, dbm, loc, dec.callsign,
+                             dec.locator, dec.power);
+                }
+            }
+        }
+
+        pthread_mutex_lock(&st.lock);
+        if (w == end) {
+            // 整片完成才计入，中断的片留在current里由检查点记为待重做
+            st.total.messages += t.messages;
+            st.total.skipped += t.skipped;
+            for (k = 0; k < STAGE_COUNT; k++) st.total.stage[k] += t.stage[k];
+            for (k = 0; k < nlines; k++) {
+                if (st.mismatch_file) fputs(lines[k], st.mismatch_file);
+                else fputs(lines[k], stderr);
+            }
+            st.current[tid] = UINT64_MAX;
+        }
+        pthread_mutex_unlock(&st.lock);
+        if (w != end) break;
+    }
+    return NULL;
+}
+
+static int write_checkpoint(void) {
+    char tmp[4096 + 8];
+    FILE *f;
+    int k;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", cfg.checkpoint);
+    f = fopen(tmp, "w");
+    if (!f) {
+        perror(tmp);
+        return -1;
+    }
+    pthread_mutex_lock(&st.lock);
+    fprintf(f, "wspr_sweep %d\n", CHECKPOINT_VERSION);
+    fprintf(f, "mode %d range %llu %llu samples %llu strata %llu seed %llu shard %llu\n", (int)cfg.mode,
+            (unsigned long long)cfg.begin, (unsigned long long)cfg.end, (unsigned long long)cfg.samples,
+            (unsigned long long)cfg.strata, (unsigned long long)cfg.seed, (unsigned long long)cfg.shard);
+    fprintf(f, "next %llu\n", (unsigned long long)st.next);
+    fprintf(f, "tally %llu %llu", (unsigned long long)st.total.messages, (unsigned long long)st.total.skipped);
+    for (k = 0; k < STAGE_COUNT; k++) fprintf(f, " %llu", (unsigned long long)st.total.stage[k]);
+    fprintf(f, "\npending");
+    // 未领取的待重做片与正在处理的片
+    for (k = (int)st.pending_pos; k < (int)st.npending; k++) fprintf(f, " %llu", (unsigned long long)st.pending[k]);
+    for (k = 0; k < cfg.threads; k++) {
+        if (st.current[k] != UINT64_MAX) fprintf(f, " %llu", (unsigned long long)st.current[k]);
+    }
+    fprintf(f, "\n");
+    pthread_mutex_unlock(&st.lock);
+    if (fclose(f) != 0 || rename(tmp, cfg.checkpoint) != 0) {
+        perror(cfg.checkpoint);
+        return -1;
+    }
+    return 0;
+}
+
+// 读取检查点；文件不存在返回0（从头开始），参数不一致或格式错误返回-1
+static int read_checkpoint(void) {
+    FILE *f = fopen(cfg.checkpoint, "r");
+    unsigned long long v[7], next, tally[2 + STAGE_COUNT], x;
+    int version, mode, k;
+    size_t cap = 64;
+
+    if (!f) return 0;
+    if (fscanf(f, "wspr_sweep %d\n", &version) != 1 || version != CHECKPOINT_VERSION ||
+        fscanf(f, "mode %d range %llu %llu samples %llu strata %llu seed %llu shard %llu\n", &mode, &v[0],
+               &v[1], &v[2], &v[3], &v[4], &v[5]) != 7 ||
+        fscanf(f, "next %llu\n", &next) != 1 || fscanf(f, "tally %llu %llu", &tally[0], &tally[1]) != 2) {
+        fprintf(stderr, "%s: 检查点格式错误\n", cfg.checkpoint);
+        fclose(f);
+        return -1;
+    }
+    for (k = 0; k < STAGE_COUNT; k++) {
+        if (fscanf(f, "%llu", &tally[2 + k]) != 1) tally[2 + k] = 0;
+    }
+    if (mode != (int)cfg.mode || v[0] != cfg.begin || v[1] != cfg.end || v[2] != cfg.samples ||
+        v[3] != cfg.strata || v[4] != cfg.seed || v[5] != cfg.shard) {
+        fprintf(stderr, "%s: 检查点的参数与本次运行不同\n", cfg.checkpoint);
+        fclose(f);
+        return -1;
+    }
+    st.next = next;
+    st.total.messages = tally[0];
+    st.total.skipped = tally[1];
+    for (k = 0; k < STAGE_COUNT; k++) st.total.stage[k] = tally[2 + k];
+    if (fscanf(f, " pending") == 0) {
+        st.pending = (uint64_t *)malloc(cap * sizeof(uint64_t));
+        while (fscanf(f, "%llu", &x) == 1) {
+            if (st.npending == cap) {
+                cap *= 2;
+                st.pending = (uint64_t *)realloc(st.pending, cap * sizeof(uint64_t));
+            }
+            st.pending[st.npending++] = x;
+        }
+    }
+    fclose(f);
+    return 1;
+}
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static int parse_range(const char *s, uint64_t *a, uint64_t *b) {
+    char *e;
+    *a = strtoull(s, &e, 10);
+    if (*e != ':') return -1;
+    *b = strtoull(e + 1, &e, 10);
+    return (*e == 0 && *b > *a) ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+    pthread_t th[MAX_THREADS];
+    int bad_args = 0, have_range = 0, resumed, i;
+    uint64_t range_a = 0, range_b = 0, bad;
+    double t0, last, t1;
+    uint64_t start_messages;
+
+    cfg.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    cfg.mode = MODE_FIELDS;
+    cfg.samples = 64;
+    cfg.strata = 65536;
+    cfg.seed = 1;
+    cfg.shard = 1 << 20;
+    cfg.interval = 10.0;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            cfg.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "fields") == 0) cfg.mode = MODE_FIELDS;
+            else if (strcmp(argv[i], "stratified") == 0) cfg.mode = MODE_STRATIFIED;
+            else if (strcmp(argv[i], "exhaustive") == 0) cfg.mode = MODE_EXHAUSTIVE;
+            else bad_args = 1;
+        } else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc) {
+            if (parse_range(argv[++i], &range_a, &range_b) != 0) bad_args = 1;
+            have_range = 1;
+        } else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            cfg.samples = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--strata") == 0 && i + 1 < argc) {
+            cfg.strata = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            cfg.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+            cfg.shard = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            cfg.checkpoint = argv[++i];
+        } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            cfg.interval = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--mismatches") == 0 && i + 1 < argc) {
+            cfg.mismatches = argv[++i];
+        } else {
+            bad_args = 1;
+        }
+    }
+    if (cfg.samples == 0 || cfg.strata == 0 || cfg.shard == 0 || (cfg.checkpoint && strlen(cfg.checkpoint) > 4096)) {
+        bad_args = 1;
+    }
+    cfg.begin = have_range ? range_a : 0;
+    cfg.end = have_range ? range_b : work_count();
+    if (cfg.end > work_count()) cfg.end = work_count();
+    if (bad_args || cfg.begin >= cfg.end) {
+        fprintf(stderr,
+                "用法: %s [-j 线程数] [--mode fields|stratified|exhaustive] [--range A:B]\n"
+                "          [--samples K] [--strata S] [--seed N] [--shard N]\n"
+                "          [--checkpoint 文件] [--interval 秒] [--mismatches 文件]\n",
+                argv[0]);
+        return 2;
+    }
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.threads > MAX_THREADS) cfg.threads = MAX_THREADS;
+
+    pthread_mutex_init(&st.lock, NULL);
+    st.nshards = (cfg.end - cfg.begin + cfg.shard - 1) / cfg.shard;
+    for (i = 0; i < MAX_THREADS; i++) st.current[i] = UINT64_MAX;
+    resumed = 0;
+    if (cfg.checkpoint) {
+        resumed = read_checkpoint();
+        if (resumed < 0) return 1;
+    }
+    if (cfg.mismatches) {
+        // 续跑时追加：已写入的行都属于已完成的片
+        st.mismatch_file = fopen(cfg.mismatches, resumed ? "a" : "w");
+        if (!st.mismatch_file) {
+            perror(cfg.mismatches);
+            return 1;
+        }
+        if (!resumed) fprintf(st.mismatch_file, "work,stage,call,dbm,loc,decoded_call,decoded_loc,decoded_dbm\n");
+    }
+    wspr_fano_metrics(&metric, 100.0, 40.0);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    fprintf(stderr, "模式 %s，工作序号 [%llu, %llu)，%llu 片，%d 线程%s\n",
+            cfg.mode == MODE_FIELDS ? "fields" : cfg.mode == MODE_STRATIFIED ? "stratified" : "exhaustive",
+            (unsigned long long)cfg.begin, (unsigned long long)cfg.end, (unsigned long long)st.nshards,
+            cfg.threads, resumed ? "，从检查点继续" : "");
+
+    start_messages = st.total.messages;
+    t0 = last = now_sec();
+    for (i = 0; i < cfg.threads; i++) {
+        pthread_create(&th[i], NULL, worker, (void *)(intptr_t)i);
+    }
+
+    // 主线程定期报告进度并写检查点
+    for (;;) {
+        int busy = 0;
+        usleep(200000);
+        pthread_mutex_lock(&st.lock);
+        busy = st.next < st.nshards || st.pending_pos < st.npending;
+        for (i = 0; i < cfg.threads && !busy; i++) busy = st.current[i] != UINT64_MAX;
+        pthread_mutex_unlock(&st.lock);
+        if (!busy || stop) break;
+        if (now_sec() - last >= cfg.interval) {
+            double t = now_sec();
+            pthread_mutex_lock(&st.lock);
+            fprintf(stderr, "片 %llu/%llu，%llu 条，%.0f 条/秒\n", (unsigned long long)st.next,
+                    (unsigned long long)st.nshards, (unsigned long long)st.total.messages,
+                    (st.total.messages - start_messages) / (t - t0));
+            pthread_mutex_unlock(&st.lock);
+            if (cfg.checkpoint) write_checkpoint();
+            last = t;
+        }
+    }
+    for (i = 0; i < cfg.threads; i++) {
+        pthread_join(th[i], NULL);
+    }
+    t1 = now_sec();
+    if (cfg.checkpoint) write_checkpoint();
+    if (st.mismatch_file) fclose(st.mismatch_file);
+
+    bad = 0;
+    for (i = 0; i < STAGE_COUNT; i++) bad += st.total.stage[i];
+    fprintf(stderr, "%s%llu 条，跳过 %llu，不一致 %llu（plane %llu，decode %llu，unpack %llu），"
+                    "%.3f 秒，%.0f 条/秒\n",
+            stop ? "已中断：" : "", (unsigned long long)st.total.messages, (unsigned long long)st.total.skipped,
+            (unsigned long long)bad, (unsigned long long)st.total.stage[STAGE_PLANE],
+            (unsigned long long)st.total.stage[STAGE_DECODE], (unsigned long long)st.total.stage[STAGE_UNPACK],
+            t1 - t0, (st.total.messages - start_messages) / (t1 - t0));
+    return bad ? 3 : 0;
+}
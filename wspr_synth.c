@@ -0,0 +1,211 @@
+// vim: set ai et ts=4 sw=4:
+
+#include <string.h>
+#include "wspr_synth.h"
+
+int wspr_synth_plan(wspr_synth_table_t* t, const wspr_synth_backend_t* backend, void* dev, uint64_t FclkCenti) {
+    memset(t, 0, sizeof(*t));
+    t->backend = backend;
+    t->dev = dev;
+    return backend->plan(dev, FclkCenti, t);
+}
+
+void wspr_synth_start(const wspr_synth_table_t* t, uint8_t tone) {
+    t->backend->start(t->dev, t, tone & 3);
+}
+
+void wspr_synth_stop(const wspr_synth_table_t* t) {
+    t->backend->stop(t->dev);
+}
+
+/* ---------- Si5351 ---------- */
+
+// si5351_ToneTable()：PLLA固定为900MHz整数倍频，各音调按P3=2^20-1求MultiSynth，误差在毫赫兹量级；
+// R分频把MultiSynth输出抬到60MHz以下，低频段同样可用
+static int si5351Plan(void* dev, uint64_t FclkCenti, wspr_synth_table_t* t) {
+    wspr_synth_si5351_t* d = (wspr_synth_si5351_t*)dev;
+    uint8_t k;
+
+    if(d->output > 2 ||
+       si5351_ToneTable(FclkCenti, WSPR_SYNTH_TONES, d->drive, d->pll_regs, t->image, &d->clk_control) != 0) {
+        return -1;
+    }
+    t->len = SI5351_BULK_REGS;
+    for(k = 0; k < WSPR_SYNTH_TONES; k++) {
+        // 芯片按校正后的频率设置，实际输出即校正前的值
+        double f = si5351_RegsFreq(d->pll_regs, t->image[k]) * 100.0;
+        t->actual[k] = (uint64_t)(f * 100000000.0 / (100000000.0 - si5351Correction) + 0.5);
+    }
+    return 0;
+}
+
+static void si5351Write(void* dev, const uint8_t* image, uint8_t len) {
+    (void)len;
+    si5351_writeRegs(SI5351_MS_BASE(((wspr_synth_si5351_t*)dev)->output), image);
+}
+
+static void si5351Start(void* dev, const wspr_synth_table_t* t, uint8_t tone) {
+    wspr_synth_si5351_t* d = (wspr_synth_si5351_t*)dev;
+    si5351_StartOutput(SI5351_PLL_A, d->pll_regs, d->output, t->image[tone], d->clk_control);
+}
+
+static void si5351Stop(void* dev) {
+    (void)dev;
+    si5351_EnableOutputs(0);
+}
+
+const wspr_synth_backend_t wspr_synth_si5351 = {"si5351", si5351Plan, si5351Start, si5351Write, si5351Stop};
+
+/* ---------- DDS公共部分 ---------- */
+
+// 调谐字 = f·2^bits/ref，四舍五入；均为正数，+0.5取整（不依赖libm）
+static uint32_t ddsWord(const wspr_synth_dds_t* d, uint64_t FclkCenti, uint8_t bits) {
+    return (uint32_t)((double)FclkCenti / (double)d->ref_centi * (double)(1ULL << bits) + 0.5);
+}
+
+static uint64_t ddsActual(const wspr_synth_dds_t* d, uint32_t word, uint8_t bits) {
+    return (uint64_t)((double)word * (double)d->ref_centi / (double)(1ULL << bits) + 0.5);
+}
+
+static void ddsSend(const wspr_synth_dds_t* d, const uint8_t* data, uint8_t len) {
+    d->bus(d->bus_ctx, data, len);
+}
+
+/* ---------- AD9850 ---------- */
+
+// W0~W31（低位在前），然后控制字节：W32、W33为工厂测试位必须为0，W34为掉电，W35~W39为相位
+#define AD9850_POWER_DOWN 0x04
+
+static int ad9850Plan(void* dev, uint64_t FclkCenti, wspr_synth_table_t* t) {
+    const wspr_synth_dds_t* d = (const wspr_synth_dds_t*)dev;
+    uint8_t k;
+
+    if(d->ref_centi == 0 || si5351_ToneCenti(FclkCenti, WSPR_SYNTH_TONES - 1) * 2 >= d->ref_centi) {
+        return -1;
+    }
+    t->len = 5;
+    for(k = 0; k < WSPR_SYNTH_TONES; k++) {
+        uint32_t w = ddsWord(d, si5351_ToneCenti(FclkCenti, k), 32);
+        t->image[k][0] = (uint8_t)w;
+        t->image[k][1] = (uint8_t)(w >> 8);
+        t->image[k][2] = (uint8_t)(w >> 16);
+        t->image[k][3] = (uint8_t)(w >> 24);
+        t->image[k][4] = 0;
+        t->actual[k] = ddsActual(d, w, 32);
+    }
+    return 0;
+}
+
+static void ad9850Write(void* dev, const uint8_t* image, uint8_t len) {
+    ddsSend((const wspr_synth_dds_t*)dev, image, len);
+}
+
+static void ad9850Start(void* dev, const wspr_synth_table_t* t, uint8_t tone) {
+    ad9850Write(dev, t->image[tone], t->len);
+}
+
+static void ad9850Stop(void* dev) {
+    static const uint8_t off[5] = {0, 0, 0, 0, AD9850_POWER_DOWN};
+    ddsSend((const wspr_synth_dds_t*)dev, off, sizeof(off));
+}
+
+const wspr_synth_backend_t wspr_synth_ad9850 = {"ad9850", ad9850Plan, ad9850Start, ad9850Write, ad9850Stop};
+
+/* ---------- AD9833 ---------- */
+
+// 控制字：B28连续写FREQ0的低14位和高14位；RESET使输出保持在中点；SLEEP1关闭内部时钟
+#define AD9833_B28 0x2000
+#define AD9833_RESET 0x0100
+#define AD9833_SLEEP1 0x0080
+#define AD9833_FREQ0 0x4000
+#define AD9833_PHASE0 0xC000
+
+static int ad9833Plan(void* dev, uint64_t FclkCenti, wspr_synth_table_t* t) {
+    const wspr_synth_dds_t* d = (const wspr_synth_dds_t*)dev;
+    uint8_t k;
+
+    if(d->ref_centi == 0 || si5351_ToneCenti(FclkCenti, WSPR_SYNTH_TONES - 1) * 2 >= d->ref_centi) {
+        return -1;
+    }
+    t->len = 6;
+    for(k = 0; k < WSPR_SYNTH_TONES; k++) {
+        uint32_t w = ddsWord(d, si5351_ToneCenti(FclkCenti, k), 28) & 0x0FFFFFFF;
+        uint16_t words[3] = {AD9833_B28, (uint16_t)(AD9833_FREQ0 | (w & 0x3FFF)),
+                             (uint16_t)(AD9833_FREQ0 | (w >> 14))};
+        uint8_t j;
+        for(j = 0; j < 3; j++) {
+            t->image[k][2 * j] = (uint8_t)(words[j] >> 8);
+            t->image[k][2 * j + 1] = (uint8_t)words[j];
+        }
+        t->actual[k] = ddsActual(d, w, 28);
+    }
+    return 0;
+}
+
+static void ad9833Word(const wspr_synth_dds_t* d, uint16_t w) {
+    uint8_t b[2] = {(uint8_t)(w >> 8), (uint8_t)w};
+    ddsSend(d, b, 2);
+}
+
+static void ad9833Write(void* dev, const uint8_t* image, uint8_t len) {
+    uint8_t j;
+    for(j = 0; j < len; j += 2) {
+        ddsSend((const wspr_synth_dds_t*)dev, image + j, 2);
+    }
+}
+
+static void ad9833Start(void* dev, const wspr_synth_table_t* t, uint8_t tone) {
+    const wspr_synth_dds_t* d = (const wspr_synth_dds_t*)dev;
+    ad9833Word(d, AD9833_B28 | AD9833_RESET);
+    ad9833Write(dev, t->image[tone] + 2, t->len - 2);
+    ad9833Word(d, AD9833_PHASE0);
+    ad9833Word(d, AD9833_B28);  // 退出复位，开始输出
+}
+
+static void ad9833Stop(void* dev) {
+    ad9833Word((const wspr_synth_dds_t*)dev, AD9833_B28 | AD9833_RESET | AD9833_SLEEP1);
+}
+
+const wspr_synth_backend_t wspr_synth_ad9833 = {"ad9833", ad9833Plan, ad9833Start, ad9833Write, ad9833Stop};
+
+/* ---------- 模拟后端 ---------- */
+
+static int mockPlan(void* dev, uint64_t FclkCenti, wspr_synth_table_t* t) {
+    const wspr_synth_mock_t* d = (const wspr_synth_mock_t*)dev;
+    uint8_t k, j;
+
+    t->len = 8;
+    for(k = 0; k < WSPR_SYNTH_TONES; k++) {
+        uint64_t f = si5351_ToneCenti(FclkCenti, k);
+        if(d->step_centi) {
+            f = (f + d->step_centi / 2) / d->step_centi * d->step_centi;
+        }
+        for(j = 0; j < 8; j++) {
+            t->image[k][j] = (uint8_t)(f >> (8 * j));
+        }
+        t->actual[k] = f;
+    }
+    return 0;
+}
+
+static void mockWrite(void* dev, const uint8_t* image, uint8_t len) {
+    wspr_synth_mock_t* d = (wspr_synth_mock_t*)dev;
+    uint64_t f = 0;
+    uint8_t j;
+    for(j = 0; j < len; j++) {
+        f |= (uint64_t)image[j] << (8 * j);
+    }
+    d->freq_centi = f;
+    d->writes++;
+}
+
+static void mockStart(void* dev, const wspr_synth_table_t* t, uint8_t tone) {
+    mockWrite(dev, t->image[tone], t->len);
+    ((wspr_synth_mock_t*)dev)->writes = 0;
+}
+
+static void mockStop(void* dev) {
+    ((wspr_synth_mock_t*)dev)->freq_centi = 0;
+}
+
+const wspr_synth_backend_t wspr_synth_mock = {"mock", mockPlan, mockStart, mockWrite, mockStop};
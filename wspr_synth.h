@@ -0,0 +1,94 @@
+#ifndef WSPR_SYNTH_H
+#define WSPR_SYNTH_H
+
+#include <stdint.h>
+#include "si5351.h"
+
+/*
+ * 与芯片无关的音调表：每个频率合成器后端在发射前把WSPR的四个音调各算成一份
+ * 寄存器映像（Si5351的MultiSynth寄存器、DDS的调谐字等），发射时符号循环只按
+ * 符号值查这张4项的表并原样写出，不再做任何频率计算。
+ *
+ *   wspr_synth_table_t t;
+ *   wspr_synth_plan(&t, &wspr_synth_si5351, &si5351_dev, (uint64_t)freq * 100);
+ *   wspr_synth_start(&t, tx_buffer[0]);
+ *   for(i = 0; i < WSPR_SYMBOL_COUNT; i++) { wspr_synth_tone(&t, tx_buffer[i]); 等待符号定时器; }
+ *   wspr_synth_stop(&t);
+ *
+ * 后端：
+ *   wspr_synth_si5351  si5351.c，PLLA固定900MHz，每个音调8字节MultiSynth映像（P3=2^20-1，见
+ *                      si5351_ToneX()），4kHz~75MHz
+ *   wspr_synth_ad9850  40比特串行字（32比特调谐字低位在前 + 控制字节），低于参考时钟的1/2
+ *   wspr_synth_ad9833  28比特FREQ0，三个16比特SPI字，低于MCLK的1/2
+ *   wspr_synth_mock    主机测试：映像为8字节小端频率（0.01Hz），记录写入次数和最后的频率
+ *
+ * DDS后端通过板级提供的总线函数发送字节：AD9850每次调用为一个完整的40比特字
+ * （按字节低位在前移出，之后给FQ_UD脉冲），AD9833每次调用为一个16比特字（FSYNC包住的两字节，高字节在前）。
+ */
+
+#define WSPR_SYNTH_TONES 4
+#define WSPR_SYNTH_IMAGE_MAX 8
+
+typedef struct wspr_synth_backend_s wspr_synth_backend_t;
+
+typedef struct {
+    const wspr_synth_backend_t* backend;
+    void* dev;                                               // 后端的设备参数
+    uint8_t len;                                             // 每个音调映像的字节数
+    uint8_t image[WSPR_SYNTH_TONES][WSPR_SYNTH_IMAGE_MAX];   // 各音调映像
+    uint64_t actual[WSPR_SYNTH_TONES];                       // 各音调的实际频率（0.01Hz）
+} wspr_synth_table_t;
+
+struct wspr_synth_backend_s {
+    const char* name;
+    // 按音调0的频率填写t的len、image和actual；频率超出范围返回-1
+    int (*plan)(void* dev, uint64_t FclkCenti, wspr_synth_table_t* t);
+    // 初始化芯片、写入首个音调并打开输出
+    void (*start)(void* dev, const wspr_synth_table_t* t, uint8_t tone);
+    // 写出一个音调映像，符号循环中只调用这一项
+    void (*write)(void* dev, const uint8_t* image, uint8_t len);
+    // 关闭输出
+    void (*stop)(void* dev);
+};
+
+// 板级总线：DDS后端发送一次传输
+typedef void (*wspr_synth_bus_t)(void* ctx, const uint8_t* data, uint8_t len);
+
+// Si5351后端参数；pll_regs、clk_control由plan填写
+typedef struct {
+    uint8_t output;                      // CLK0~CLK2
+    si5351DriveStrength_t drive;
+    uint8_t pll_regs[SI5351_BULK_REGS];
+    uint8_t clk_control;
+} wspr_synth_si5351_t;
+
+// DDS后端参数：ref_centi为实测的参考时钟（0.01Hz），频率校正直接体现在这里
+typedef struct {
+    uint64_t ref_centi;
+    wspr_synth_bus_t bus;
+    void* bus_ctx;
+} wspr_synth_dds_t;
+
+// 模拟后端的记录
+typedef struct {
+    uint32_t writes;        // write()调用次数（不含start）
+    uint64_t freq_centi;    // 当前频率，0表示输出关闭
+    uint64_t step_centi;    // 频率分辨率，0表示精确，用于模拟DDS的量化
+} wspr_synth_mock_t;
+
+extern const wspr_synth_backend_t wspr_synth_si5351;
+extern const wspr_synth_backend_t wspr_synth_ad9850;
+extern const wspr_synth_backend_t wspr_synth_ad9833;
+extern const wspr_synth_backend_t wspr_synth_mock;
+
+// 计算音调表，成功返回0
+int wspr_synth_plan(wspr_synth_table_t* t, const wspr_synth_backend_t* backend, void* dev, uint64_t FclkCenti);
+void wspr_synth_start(const wspr_synth_table_t* t, uint8_t tone);
+void wspr_synth_stop(const wspr_synth_table_t* t);
+
+// 发射音调tone（0~3），只查表
+static inline void wspr_synth_tone(const wspr_synth_table_t* t, uint8_t tone) {
+    t->backend->write(t->dev, t->image[tone & 3], t->len);
+}
+
+#endif
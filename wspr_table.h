@@ -0,0 +1,37 @@
+#ifndef WSPR_TABLE_H
+#define WSPR_TABLE_H
+
+#include <stdint.h>
+#include "si5351.h"
+
+/*
+ * 预计算的WSPR发射表格，由主机端工具wspr_tablegen生成（见wspr_tablegen.c）。
+ * 固件直接从Flash中的const表格取符号和寄存器映像，开机无需再运行
+ * wspr_encode()和si5351_Calc()。
+ */
+
+#define WSPR_TABLE_TONES 4
+// 162个2比特符号，每字节4个，低位在前
+#define WSPR_TABLE_SYMBOL_BYTES 41
+
+// 一条消息的打包符号
+typedef struct {
+    const char *call;
+    const char *loc;
+    int8_t dbm;
+    uint8_t symbols[WSPR_TABLE_SYMBOL_BYTES];
+} wspr_message_table_t;
+
+// 一个频段：共享的PLL寄存器映像 + 每个音调的MultiSynth寄存器映像
+typedef struct {
+    uint32_t freq;                                       // 载波频率（Hz）
+    uint8_t clk_control;                                 // CLKx控制寄存器取值
+    uint8_t pll_regs[SI5351_BULK_REGS];                  // PLL参数寄存器
+    uint8_t tone_regs[WSPR_TABLE_TONES][SI5351_BULK_REGS]; // 各音调MultiSynth寄存器
+} wspr_band_table_t;
+
+// 取第i个符号（0~3）
+#define WSPR_TABLE_SYMBOL(msg, i) \
+    ((uint8_t)(((msg)->symbols[(i) >> 2] >> (((i) & 3) * 2)) & 0x03))
+
+#endif
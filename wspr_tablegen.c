@@ -0,0 +1,357 @@
+/*
+ * wspr_tablegen.c - 主机端WSPR发射表格生成工具
+ *
+ * 根据信标配置生成C头文件：每条消息的打包符号表（每符号2比特）和
+ * 每个频段、每个音调的Si5351寄存器映像。固件把这些const表格链接进Flash，
+ * 发射时直接查表写寄存器（见wspr_table.h和app.c）。
+ *
+ * 编译：
+ *   gcc -O2 -DSI5351_NO_HAL -I. -o wspr_tablegen wspr_tablegen.c encode.c nhash.c si5351.c
+ *
+ * 用法：
+ *   wspr_tablegen beacon.cfg [wspr_tables.h]
+ *
+ * 配置文件为 key=value 格式（与Filter1.ftr相同），'#'开头为注释：
+ *   correction=970          # 100MHz处的频率误差，见si5351_Init()
+ *   drive=3                 # si5351DriveStrength_t，0~3
+ *   band=7040100            # 可重复，载波频率（Hz）
+ *   message=BI1TPH ON80 10  # 可重复，呼号 网格 功率(-30~60 dBm)
+ *
+ * 寄存器映像由si5351_ToneTable()生成（PLLA 900MHz，各音调共用PLL和R分频），
+ * 支持4kHz~75MHz的频段，超出范围时报错。生成后工具会校验表格：符号与wspr_encode()
+ * 的结果比对；寄存器映像解码回频率（Fpll/MS/R，扣除校正）与载波 + k·12000/8192 Hz
+ * 比对，误差须在TONE_TOLERANCE_HZ以内，并检查PLL、MS的取值范围和CLK控制寄存器。
+ * 大小统计输出到stderr。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "encode.h"
+#include "si5351.h"
+#include "wspr_table.h"
+
+#define MAX_BANDS 16
+#define MAX_MESSAGES 32
+#define MAX_LINE 256
+
+// 解码频率与理论音调频率的最大允许误差：音调频率取整到0.01Hz、校正取整各约0.005Hz，
+// P3=2^20-1时MultiSynth在75MHz处的分辨率约0.02Hz
+#define TONE_TOLERANCE_HZ 0.05
+
+// wspr_encode()接受的功率范围（dBm）
+#define MIN_DBM (-30)
+#define MAX_DBM 60
+
+typedef struct {
+    char call[13];
+    char loc[7];
+    int8_t dbm;
+} beacon_message_t;
+
+typedef struct {
+    int32_t correction;
+    si5351DriveStrength_t drive;
+    int band_count;
+    uint32_t bands[MAX_BANDS];
+    int message_count;
+    beacon_message_t messages[MAX_MESSAGES];
+} beacon_config_t;
+
+// 只用si5351.c的计算和寄存器映像函数，不写硬件
+void si5351_write(uint8_t reg, uint8_t value) {
+    (void)reg;
+    (void)value;
+}
+
+/*
+ * 呼号只允许A-Z、0-9、'/'和'<>'，网格为AA00或AA00AA（字段A-R，子网格A-X），
+ * 小写先转为大写。二者原样写进生成头文件的字符串字面量，其他字符不能出现
+ */
+static int valid_message(char *call, char *loc) {
+    size_t i, n = strlen(loc);
+
+    for (i = 0; call[i]; i++) {
+        if (call[i] >= 'a' && call[i] <= 'z') call[i] = (char)(call[i] - 'a' + 'A');
+        if (!((call[i] >= 'A' && call[i] <= 'Z') || (call[i] >= '0' && call[i] <= '9') || call[i] == '/' ||
+              call[i] == '<' || call[i] == '>')) {
+            return 0;
+        }
+    }
+    for (i = 0; i < n; i++) {
+        if (loc[i] >= 'a' && loc[i] <= 'z') loc[i] = (char)(loc[i] - 'a' + 'A');
+    }
+    if (n != 4 && n != 6) return 0;
+    if (loc[0] < 'A' || loc[0] > 'R' || loc[1] < 'A' || loc[1] > 'R') return 0;
+    if (loc[2] < '0' || loc[2] > '9' || loc[3] < '0' || loc[3] > '9') return 0;
+    if (n == 6 && (loc[4] < 'A' || loc[4] > 'X' || loc[5] < 'A' || loc[5] > 'X')) return 0;
+    return 1;
+}
+
+static char *trim(char *s) {
+    char *end;
+    while (*s == ' ' || *s == '\t') s++;
+    end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n')) end--;
+    *end = 0;
+    return s;
+}
+
+// 解析配置文件，成功返回0
+static int load_config(const char *path, beacon_config_t *cfg) {
+    FILE *f = fopen(path, "r");
+    char line[MAX_LINE];
+    int lineno = 0;
+
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->drive = SI5351_DRIVE_STRENGTH_8MA;
+
+    while (fgets(line, sizeof(line), f)) {
+        char *key, *val, *eq, *hash;
+        lineno++;
+        hash = strchr(line, '#');
+        if (hash) *hash = 0;
+        key = trim(line);
+        if (*key == 0) continue;
+        eq = strchr(key, '=');
+        if (!eq) {
+            fprintf(stderr, "%s:%d: 缺少'='\n", path, lineno);
+            fclose(f);
+            return 1;
+        }
+        *eq = 0;
+        key = trim(key);
+        val = trim(eq + 1);
+
+        if (strcmp(key, "correction") == 0) {
+            cfg->correction = (int32_t)strtol(val, NULL, 10);
+        } else if (strcmp(key, "drive") == 0) {
+            char *end;
+            long drive = strtol(val, &end, 10);
+            if (end == val || *end != 0 || drive < SI5351_DRIVE_STRENGTH_2MA || drive > SI5351_DRIVE_STRENGTH_8MA) {
+                fprintf(stderr, "%s:%d: drive应为0~3（2/4/6/8mA）\n", path, lineno);
+                fclose(f);
+                return 1;
+            }
+            cfg->drive = (si5351DriveStrength_t)drive;
+        } else if (strcmp(key, "band") == 0) {
+            if (cfg->band_count >= MAX_BANDS) {
+                fprintf(stderr, "%s:%d: 频段过多（最多%d个）\n", path, lineno, MAX_BANDS);
+                fclose(f);
+                return 1;
+            }
+            cfg->bands[cfg->band_count++] = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcmp(key, "message") == 0) {
+            beacon_message_t *m;
+            int dbm;
+            if (cfg->message_count >= MAX_MESSAGES) {
+                fprintf(stderr, "%s:%d: 消息过多（最多%d条）\n", path, lineno, MAX_MESSAGES);
+                fclose(f);
+                return 1;
+            }
+            m = &cfg->messages[cfg->message_count];
+            if (sscanf(val, "%12s %6s %d", m->call, m->loc, &dbm) != 3) {
+                fprintf(stderr, "%s:%d: message格式应为\"呼号 网格 功率\"\n", path, lineno);
+                fclose(f);
+                return 1;
+            }
+            if (dbm < MIN_DBM || dbm > MAX_DBM) {
+                fprintf(stderr, "%s:%d: 功率%d dBm超出范围（%d~%d）\n", path, lineno, dbm, MIN_DBM, MAX_DBM);
+                fclose(f);
+                return 1;
+            }
+            if (!valid_message(m->call, m->loc)) {
+                fprintf(stderr, "%s:%d: 呼号只能含A-Z、0-9、'/'和'<>'，网格应为AA00或AA00AA\n", path, lineno);
+                fclose(f);
+                return 1;
+            }
+            m->dbm = (int8_t)dbm;
+            cfg->message_count++;
+        } else {
+            fprintf(stderr, "%s:%d: 未知的键\"%s\"\n", path, lineno, key);
+            fclose(f);
+            return 1;
+        }
+    }
+    fclose(f);
+
+    if (cfg->band_count == 0 || cfg->message_count == 0) {
+        fprintf(stderr, "%s: 至少需要一个band和一条message\n", path);
+        return 1;
+    }
+    return 0;
+}
+
+static void build_message(const beacon_message_t *m, wspr_message_table_t *t) {
+    uint8_t symbols[WSPR_SYMBOL_COUNT];
+    int i;
+
+    wspr_encode(m->call, m->loc, m->dbm, symbols);
+    memset(t->symbols, 0, sizeof(t->symbols));
+    for (i = 0; i < WSPR_SYMBOL_COUNT; i++) {
+        t->symbols[i >> 2] |= (uint8_t)((symbols[i] & 0x03) << ((i & 3) * 2));
+    }
+    t->call = m->call;
+    t->loc = m->loc;
+    t->dbm = m->dbm;
+}
+
+// 频段超出si5351_ToneTable()的范围时返回-1
+static int build_band(uint32_t freq, si5351DriveStrength_t drive, wspr_band_table_t *t) {
+    t->freq = freq;
+    return si5351_ToneTable((uint64_t)freq * 100, WSPR_TABLE_TONES, drive, t->pll_regs, t->tone_regs,
+                            &t->clk_control);
+}
+
+// 校验表格，返回不一致的项数
+static int verify(const beacon_config_t *cfg, const wspr_message_table_t *msgs, const wspr_band_table_t *bands) {
+    int errors = 0;
+    int i, j;
+
+    for (i = 0; i < cfg->message_count; i++) {
+        uint8_t symbols[WSPR_SYMBOL_COUNT];
+        wspr_encode(cfg->messages[i].call, cfg->messages[i].loc, cfg->messages[i].dbm, symbols);
+        for (j = 0; j < WSPR_SYMBOL_COUNT; j++) {
+            if (WSPR_TABLE_SYMBOL(&msgs[i], j) != symbols[j]) {
+                fprintf(stderr, "校验失败: 消息%d符号%d\n", i, j);
+                errors++;
+                break;
+            }
+        }
+    }
+
+    for (i = 0; i < cfg->band_count; i++) {
+        const wspr_band_table_t *b = &bands[i];
+        double fpll = 25e6 * si5351_RegsRatio(b->pll_regs);
+        uint8_t tone;
+
+        if (fpll < 600e6 || fpll > 900e6 + 1) {
+            fprintf(stderr, "校验失败: 频段%lu的PLL为%.0f Hz，超出600~900MHz\n", (unsigned long)b->freq, fpll);
+            errors++;
+        }
+        // CLK控制：PLLA、MultiSynth作为输入、未关断、驱动强度与配置一致
+        if ((b->clk_control & 0xAF) != (0x0C | cfg->drive)) {
+            fprintf(stderr, "校验失败: 频段%lu的CLK控制寄存器0x%02x\n", (unsigned long)b->freq, b->clk_control);
+            errors++;
+        }
+        for (tone = 0; tone < WSPR_TABLE_TONES; tone++) {
+            double ms = si5351_RegsRatio(b->tone_regs[tone]);
+            // 芯片按扣除校正后的频率设置，实际输出为解码频率还原校正
+            double f = fpll / ms / si5351_RegsRDiv(b->tone_regs[tone]) * 1e8 / (1e8 - cfg->correction);
+            double want = b->freq + tone * 12000.0 / 8192.0;
+            if (ms < 8 || ms > 2048 || f - want > TONE_TOLERANCE_HZ || want - f > TONE_TOLERANCE_HZ) {
+                fprintf(stderr, "校验失败: 频段%lu音调%u为%.4f Hz（应为%.4f Hz，MS %.3f）\n",
+                        (unsigned long)b->freq, tone, f, want, ms);
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+static void emit_bytes(FILE *out, const uint8_t *p, int n) {
+    int i;
+    fprintf(out, "{");
+    for (i = 0; i < n; i++) {
+        fprintf(out, "%s0x%02x", i ? ", " : "", p[i]);
+    }
+    fprintf(out, "}");
+}
+
+static void emit_header(FILE *out, const char *cfg_path, const beacon_config_t *cfg,
+                        const wspr_message_table_t *msgs, const wspr_band_table_t *bands) {
+    int i, j;
+
+    fprintf(out, "/* 由wspr_tablegen根据%s自动生成，请勿手工修改 */\n", cfg_path);
+    fprintf(out, "#ifndef WSPR_TABLES_H\n#define WSPR_TABLES_H\n\n");
+    fprintf(out, "#include \"wspr_table.h\"\n\n");
+    fprintf(out, "#define WSPR_TABLE_CORRECTION %ld\n", (long)cfg->correction);
+    fprintf(out, "#define WSPR_MESSAGE_COUNT %d\n", cfg->message_count);
+    fprintf(out, "#define WSPR_BAND_COUNT %d\n\n", cfg->band_count);
+
+    fprintf(out, "static const wspr_message_table_t wspr_messages[WSPR_MESSAGE_COUNT] = {\n");
+    for (i = 0; i < cfg->message_count; i++) {
+        fprintf(out, "    {\"%s\", \"%s\", %d,\n     {", msgs[i].call, msgs[i].loc, msgs[i].dbm);
+        for (j = 0; j < WSPR_TABLE_SYMBOL_BYTES; j++) {
+            fprintf(out, "%s0x%02x", j == 0 ? "" : ((j % 12) == 0 ? ",\n      " : ", "), msgs[i].symbols[j]);
+        }
+        fprintf(out, "}},\n");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const wspr_band_table_t wspr_bands[WSPR_BAND_COUNT] = {\n");
+    for (i = 0; i < cfg->band_count; i++) {
+        fprintf(out, "    {%luUL, 0x%02x,\n     ", (unsigned long)bands[i].freq, bands[i].clk_control);
+        emit_bytes(out, bands[i].pll_regs, SI5351_BULK_REGS);
+        fprintf(out, ",\n     {");
+        for (j = 0; j < WSPR_TABLE_TONES; j++) {
+            fprintf(out, "%s", j ? ",\n      " : "");
+            emit_bytes(out, bands[i].tone_regs[j], SI5351_BULK_REGS);
+        }
+        fprintf(out, "}},\n");
+    }
+    fprintf(out, "};\n\n#endif\n");
+}
+
+int main(int argc, char **argv) {
+    static beacon_config_t cfg;
+    static wspr_message_table_t msgs[MAX_MESSAGES];
+    static wspr_band_table_t bands[MAX_BANDS];
+    FILE *out = stdout;
+    int i, errors;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "用法: %s beacon.cfg [wspr_tables.h]\n", argv[0]);
+        return 2;
+    }
+    if (load_config(argv[1], &cfg) != 0) {
+        return 1;
+    }
+
+    si5351Correction = cfg.correction;
+    for (i = 0; i < cfg.message_count; i++) {
+        build_message(&cfg.messages[i], &msgs[i]);
+    }
+    for (i = 0; i < cfg.band_count; i++) {
+        if (build_band(cfg.bands[i], cfg.drive, &bands[i]) != 0) {
+            fprintf(stderr, "%s: 不支持的频段%lu Hz（Si5351音调表支持4kHz~75MHz）\n", argv[1],
+                    (unsigned long)cfg.bands[i]);
+            return 1;
+        }
+    }
+
+    errors = verify(&cfg, msgs, bands);
+    if (errors) {
+        fprintf(stderr, "%d项与运行时路径不一致，未生成头文件\n", errors);
+        return 1;
+    }
+
+    if (argc == 3) {
+        out = fopen(argv[2], "w");
+        if (!out) {
+            perror(argv[2]);
+            return 1;
+        }
+    }
+    emit_header(out, argv[1], &cfg, msgs, bands);
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    fprintf(stderr, "消息表: %d x %d 字节符号 = %d 字节\n", cfg.message_count, WSPR_TABLE_SYMBOL_BYTES,
+            cfg.message_count * WSPR_TABLE_SYMBOL_BYTES);
+    fprintf(stderr, "频段表: %d x %d 字节寄存器 = %d 字节\n", cfg.band_count,
+            1 + SI5351_BULK_REGS * (1 + WSPR_TABLE_TONES),
+            cfg.band_count * (1 + SI5351_BULK_REGS * (1 + WSPR_TABLE_TONES)));
+    fprintf(stderr, "结构体合计（主机sizeof，不含呼号字符串）: %lu 字节\n",
+            (unsigned long)(cfg.message_count * sizeof(wspr_message_table_t) +
+                            cfg.band_count * sizeof(wspr_band_table_t)));
+    fprintf(stderr, "符号与wspr_encode()一致，寄存器映像解码频率误差在%.2fHz以内\n", TONE_TOLERANCE_HZ);
+    return 0;
+}
@@ -0,0 +1,231 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "wspr_trace.h"
+
+#ifdef WSPR_TRACE
+
+#if (WSPR_TRACE_RING & (WSPR_TRACE_RING - 1)) != 0
+#error "WSPR_TRACE_RING必须为2的幂"
+#endif
+
+typedef struct {
+	uint32_t head; // 已写入的事件总数，写入端以release发布
+	wspr_trace_stats_t stats[WSPR_STAGE_COUNT];
+	wspr_trace_event_t ev[WSPR_TRACE_RING];
+} wspr_trace_ring_t;
+
+static wspr_trace_ring_t wspr_trace_rings[WSPR_TRACE_THREADS];
+static uint32_t wspr_trace_claimed;
+
+#ifndef WSPR_TRACE_NO_TLS
+#if defined(__GNUC__)
+static __thread wspr_trace_ring_t *wspr_trace_mine;
+#else
+static _Thread_local wspr_trace_ring_t *wspr_trace_mine;
+#endif
+// 池已用完的线程指向这里，不再记录
+static wspr_trace_ring_t wspr_trace_overflow;
+#endif
+
+static const char *const wspr_trace_names[WSPR_STAGE_COUNT] = {
+	"prep", "pack", "nhash", "convolve", "interleave", "conv_interleave", "merge_sync", "encode",
+};
+
+// 当前线程的环，首次调用时领取
+static wspr_trace_ring_t *wspr_trace_self(void)
+{
+#ifdef WSPR_TRACE_NO_TLS
+	if (wspr_trace_claimed == 0)
+	{
+		wspr_trace_claimed = 1;
+	}
+	return &wspr_trace_rings[0];
+#else
+	if (!wspr_trace_mine)
+	{
+		uint32_t i = __atomic_fetch_add(&wspr_trace_claimed, 1, __ATOMIC_RELAXED);
+		wspr_trace_mine = (i < WSPR_TRACE_THREADS) ? &wspr_trace_rings[i] : &wspr_trace_overflow;
+	}
+	return (wspr_trace_mine == &wspr_trace_overflow) ? NULL : wspr_trace_mine;
+#endif
+}
+
+/**
+ * @brief 记录一个阶段，由WSPR_TRACE_END()调用。
+ *
+ * @param stage 阶段（wspr_trace_stage_t）。
+ * @param start WSPR_TRACE_BEGIN()读到的计数。
+ *
+ * 只有本线程写自己的环：先写事件和统计，再发布写入计数。
+ */
+void wspr_trace_record(uint8_t stage, uint32_t start)
+{
+	uint32_t cycles = wspr_trace_now() - start;
+	wspr_trace_ring_t *r = wspr_trace_self();
+	wspr_trace_stats_t *st;
+	wspr_trace_event_t *e;
+	uint32_t h;
+
+	if (!r || stage >= WSPR_STAGE_COUNT)
+	{
+		return;
+	}
+	h = r->head;
+	e = &r->ev[h & (WSPR_TRACE_RING - 1)];
+	e->start = start;
+	e->cycles = cycles;
+	e->stage = stage;
+
+	st = &r->stats[stage];
+	if (st->count == 0 || cycles < st->min)
+	{
+		st->min = cycles;
+	}
+	if (cycles > st->max)
+	{
+		st->max = cycles;
+	}
+	st->total += cycles;
+	st->count++;
+
+	__atomic_store_n(&r->head, h + 1, __ATOMIC_RELEASE);
+}
+
+void wspr_trace_init(void)
+{
+#if !defined(WSPR_TRACE_CYCLES) && \
+	(defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__))
+	*(volatile uint32_t *)0xE000EDFC |= (1u << 24); // DEMCR.TRCENA
+	*(volatile uint32_t *)0xE0001004 = 0;           // DWT_CYCCNT
+	*(volatile uint32_t *)0xE0001000 |= 1u;         // DWT_CTRL.CYCCNTENA
+#endif
+}
+
+uint8_t wspr_trace_threads(void)
+{
+	uint32_t n = __atomic_load_n(&wspr_trace_claimed, __ATOMIC_ACQUIRE);
+	return (uint8_t)((n < WSPR_TRACE_THREADS) ? n : WSPR_TRACE_THREADS);
+}
+
+/**
+ * @brief 取线程环的快照。
+ *
+ * 复制前后各读一次写入计数；写入端可能正在覆盖第head2个事件所在的槽位，
+ * 因此序号不大于head2 - WSPR_TRACE_RING的事件都视为已被覆盖并丢弃。
+ */
+uint32_t wspr_trace_snapshot(uint8_t thread, wspr_trace_event_t *out, uint32_t max)
+{
+	const wspr_trace_ring_t *r;
+	uint32_t h1, h2, n, first, valid, i;
+
+	if (thread >= wspr_trace_threads())
+	{
+		return 0;
+	}
+	r = &wspr_trace_rings[thread];
+	h1 = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+	n = (h1 < WSPR_TRACE_RING) ? h1 : WSPR_TRACE_RING;
+	if (n > max)
+	{
+		n = max;
+	}
+	first = h1 - n;
+	for (i = 0; i < n; i++)
+	{
+		out[i] = r->ev[(first + i) & (WSPR_TRACE_RING - 1)];
+	}
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	h2 = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+
+	valid = (h2 >= WSPR_TRACE_RING) ? h2 - WSPR_TRACE_RING + 1 : 0;
+	if (valid > first)
+	{
+		uint32_t drop = (valid - first < n) ? valid - first : n;
+		memmove(out, out + drop, (n - drop) * sizeof(*out));
+		n -= drop;
+	}
+	return n;
+}
+
+void wspr_trace_summary(wspr_trace_stats_t *stats)
+{
+	uint8_t t, s, n = wspr_trace_threads();
+
+	memset(stats, 0, sizeof(*stats) * WSPR_STAGE_COUNT);
+	for (t = 0; t < n; t++)
+	{
+		for (s = 0; s < WSPR_STAGE_COUNT; s++)
+		{
+			const wspr_trace_stats_t *src = &wspr_trace_rings[t].stats[s];
+			wspr_trace_stats_t *dst = &stats[s];
+			if (src->count == 0)
+			{
+				continue;
+			}
+			if (dst->count == 0 || src->min < dst->min)
+			{
+				dst->min = src->min;
+			}
+			if (src->max > dst->max)
+			{
+				dst->max = src->max;
+			}
+			dst->total += src->total;
+			dst->count += src->count;
+		}
+	}
+}
+
+/**
+ * @brief 文本报表：每阶段的次数、平均/最小/最大周期数，以及占wspr_encode()总耗时的比例。
+ *
+ * 直接调用wspr_encode_plane()等底层入口时没有WSPR_STAGE_ENCODE记录，
+ * 比例改为相对于各顶层阶段之和（NHASH已含在PACK中，不重复计入）。
+ */
+int wspr_trace_dump(char *buf, size_t len)
+{
+	wspr_trace_stats_t stats[WSPR_STAGE_COUNT];
+	uint64_t whole;
+	int pos = 0, r;
+	uint8_t s;
+
+	wspr_trace_summary(stats);
+	whole = stats[WSPR_STAGE_ENCODE].total;
+	if (whole == 0)
+	{
+		for (s = 0; s < WSPR_STAGE_ENCODE; s++)
+		{
+			whole += (s == WSPR_STAGE_NHASH) ? 0 : stats[s].total;
+		}
+	}
+	r = snprintf(buf, len, "%-16s %10s %10s %10s %10s %7s  (%u threads)\n", "stage", "count", "avg", "min",
+	             "max", "share", (unsigned)wspr_trace_threads());
+	pos += (r > 0) ? r : 0;
+	for (s = 0; s < WSPR_STAGE_COUNT; s++)
+	{
+		const wspr_trace_stats_t *st = &stats[s];
+		if (st->count == 0)
+		{
+			continue;
+		}
+		r = snprintf(buf + ((size_t)pos < len ? (size_t)pos : len), (size_t)pos < len ? len - (size_t)pos : 0,
+		             "%-16s %10lu %10.1f %10lu %10lu %6.1f%%\n", wspr_trace_names[s], (unsigned long)st->count,
+		             (double)st->total / st->count, (unsigned long)st->min, (unsigned long)st->max,
+		             whole ? 100.0 * (double)st->total / (double)whole : 0.0);
+		pos += (r > 0) ? r : 0;
+	}
+	return pos;
+}
+
+void wspr_trace_reset(void)
+{
+	memset(wspr_trace_rings, 0, sizeof(wspr_trace_rings));
+}
+
+const char *wspr_trace_stage_name(uint8_t stage)
+{
+	return (stage < WSPR_STAGE_COUNT) ? wspr_trace_names[stage] : "?";
+}
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef WSPR_TRACE_H
+#define WSPR_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * 编码各阶段的周期计数跟踪，编译时选择：定义WSPR_TRACE时encode.c在每个阶段前后
+ * 读取周期计数器，把耗时写入当前线程的环形缓冲区并累计每阶段统计；不定义时
+ * 钩子宏展开为空，不产生任何代码，wspr_trace_init()等接口为头文件中的空操作。
+ *
+ * 每个线程第一次记录时从静态池（WSPR_TRACE_THREADS个）中原子地领取一个环，
+ * 此后只有该线程写这个环，写入不加锁；线程退出后环保留，供结束时导出。
+ * 读取端（任意线程）按写入计数取快照，丢弃读取期间被覆盖的事件。
+ *
+ * 周期计数器：x86为TSC，AArch64为cntvct_el0，Cortex-M3/M4/M7/M33为DWT_CYCCNT
+ * （wspr_trace_init()负责打开），也可定义WSPR_TRACE_CYCLES()自行提供。
+ * 裸机ARM上默认不用线程局部存储（WSPR_TRACE_NO_TLS），只有一个环。
+ *
+ * 阶段耗时含嵌套：WSPR_STAGE_PACK包含其中的WSPR_STAGE_NHASH，WSPR_STAGE_ENCODE
+ * 为wspr_encode()整体。
+ */
+
+typedef enum {
+	WSPR_STAGE_PREP = 0,         // wspr_message_prep_r()
+	WSPR_STAGE_PACK,             // wspr_bit_packing_r()、wspr_pack50()
+	WSPR_STAGE_NHASH,            // 类型3消息中的nhash_()
+	WSPR_STAGE_CONVOLVE,         // convolve()、wspr_convolve50()、wspr_convolve_plane()
+	WSPR_STAGE_INTERLEAVE,       // wspr_interleave()、wspr_interleave_plane()
+	WSPR_STAGE_CONV_INTERLEAVE,  // 合并的卷积+交织（平面生成矩阵；inplace版本同时合并同步）
+	WSPR_STAGE_MERGE_SYNC,       // wspr_merge_sync_vector()、wspr_plane_to_symbols/packed()
+	WSPR_STAGE_ENCODE,           // wspr_encode()整体
+	WSPR_STAGE_COUNT
+} wspr_trace_stage_t;
+
+// 每个线程环中的事件数，必须为2的幂
+#ifndef WSPR_TRACE_RING
+#define WSPR_TRACE_RING 256
+#endif
+
+#if !defined(WSPR_TRACE_NO_TLS) && defined(__arm__) && !defined(__linux__)
+#define WSPR_TRACE_NO_TLS
+#endif
+
+#ifndef WSPR_TRACE_THREADS
+#ifdef WSPR_TRACE_NO_TLS
+#define WSPR_TRACE_THREADS 1
+#else
+#define WSPR_TRACE_THREADS 64
+#endif
+#endif
+
+typedef struct {
+	uint32_t start;   // 阶段开始时的计数器低32位
+	uint32_t cycles;  // 阶段耗时
+	uint8_t stage;    // wspr_trace_stage_t
+} wspr_trace_event_t;
+
+typedef struct {
+	uint32_t count;
+	uint64_t total;
+	uint32_t min;
+	uint32_t max;
+} wspr_trace_stats_t;
+
+#ifdef WSPR_TRACE
+
+#if defined(WSPR_TRACE_CYCLES)
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// 当前周期计数（低32位，差值按模2^32计算）
+static inline uint32_t wspr_trace_now(void)
+{
+#if defined(WSPR_TRACE_CYCLES)
+	return (uint32_t)(WSPR_TRACE_CYCLES());
+#elif defined(__x86_64__) || defined(__i386__)
+	return (uint32_t)__rdtsc();
+#elif defined(__aarch64__)
+	uint64_t v;
+	__asm__ volatile("mrs %0, cntvct_el0" : "=r"(v));
+	return (uint32_t)v;
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+	return *(volatile uint32_t *)0xE0001004; // DWT_CYCCNT
+#else
+#error "WSPR_TRACE: 请为此平台定义WSPR_TRACE_CYCLES()"
+#endif
+}
+
+void wspr_trace_record(uint8_t stage, uint32_t start);
+
+#define WSPR_TRACE_BEGIN(t) uint32_t t = wspr_trace_now()
+#define WSPR_TRACE_END(stage, t) wspr_trace_record((stage), (t))
+
+// 打开周期计数器（Cortex-M的DWT），其他平台无操作
+void wspr_trace_init(void);
+// 已领取环的线程数
+uint8_t wspr_trace_threads(void);
+// 复制线程thread最近的至多max个事件（按时间顺序），返回个数
+uint32_t wspr_trace_snapshot(uint8_t thread, wspr_trace_event_t *out, uint32_t max);
+// 汇总所有线程的各阶段统计，stats长度为WSPR_STAGE_COUNT
+void wspr_trace_summary(wspr_trace_stats_t *stats);
+// 文本报表写入buf，返回snprintf语义的长度
+int wspr_trace_dump(char *buf, size_t len);
+// 清空所有环和统计；须在没有线程编码时调用
+void wspr_trace_reset(void);
+const char *wspr_trace_stage_name(uint8_t stage);
+
+#else
+
+#define WSPR_TRACE_BEGIN(t)
+#define WSPR_TRACE_END(stage, t) ((void)0)
+
+// 不跟踪时以下接口为空操作，调用方无需条件编译，也不必链接wspr_trace.c
+static inline void wspr_trace_init(void)
+{
+}
+
+static inline uint8_t wspr_trace_threads(void)
+{
+	return 0;
+}
+
+static inline uint32_t wspr_trace_snapshot(uint8_t thread, wspr_trace_event_t *out, uint32_t max)
+{
+	(void)thread;
+	(void)out;
+	(void)max;
+	return 0;
+}
+
+static inline void wspr_trace_summary(wspr_trace_stats_t *stats)
+{
+	uint8_t s;
+	for (s = 0; s < WSPR_STAGE_COUNT; s++)
+	{
+		stats[s].count = 0;
+		stats[s].total = 0;
+		stats[s].min = 0;
+		stats[s].max = 0;
+	}
+}
+
+static inline int wspr_trace_dump(char *buf, size_t len)
+{
+	if (len)
+	{
+		buf[0] = 0;
+	}
+	return 0;
+}
+
+static inline void wspr_trace_reset(void)
+{
+}
+
+static inline const char *wspr_trace_stage_name(uint8_t stage)
+{
+	(void)stage;
+	return "?";
+}
+
+#endif
+
+#endif
@@ -0,0 +1,963 @@
+/*
+ * wspr_waterfall.c - 发射机合成信号与接收录音的瀑布图
+ *
+ * 每个输入是一路信号：WAV/原始录音（wspr_wav零拷贝读取），或--msg合成的一条完整
+ * WSPR发射（wspr_encode()的162个符号，连续相位4-FSK，可加漂移和噪声）。合成时四个
+ * 音调的频率取自频率合成器后端（wspr_synth）的实际输出频率，能看到寄存器量化和
+ * 音调0的频率误差。一个2分钟时隙为120秒，发射从第1秒开始，持续110.6秒。
+ *
+ * 各路信号分给线程池并行处理，共用同一份FFT计划（wspr_wfall_plan_t，按采样率和
+ * 实信号/IQ区分），每路各写一个PGM或二进制瀑布图文件，可选输出每行的峰值频率
+ * （看漂移）。默认参数下频点间隔0.73Hz（音调间隔1.46Hz的一半），行间隔0.17秒。
+ *
+ * 编译：
+ *   gcc -O2 -march=native -DSI5351_NO_HAL -I. -o wspr_waterfall wspr_waterfall.c wspr_wfall.c wspr_wav.c \
+ *       wspr_synth.c si5351.c encode.c nhash.c -lpthread -lm
+ *
+ * 用法：
+ *   wspr_waterfall [选项] [录音...]
+ *     --msg "呼号 网格 功率"   合成一条发射（可重复，每条一路）
+ *     --synth exact|si5351|ad9850|ad9833   音调频率来源（默认exact）
+ *     --freq Hz            发射频率（音调0，默认14097100），--ref Hz为DDS参考时钟
+ *     --audio Hz           合成信号的音频中心频率（默认1500）
+ *     --drift Hz/分        线性漂移，--snr dB为2500Hz带宽内的信噪比（默认无噪声），--seed N
+ *     --repeat N           每条--msg重复N路（各路噪声不同，测多路吞吐量）
+ *     --list 文件、--raw s16|f32、--iq、--rate Hz、--offset 字节   录音，含义同wspr_rxstat
+ *     --nfft N（默认16384） --hop N（默认2048） --window hann|blackman|rect
+ *     --band 低:高 Hz（默认1400:1600，full为全部频点） --floor dB（默认-110） --range dB（默认100）
+ *     -o 目录              写出瀑布图（<目录>/<序号>_<名称>.pgm或.wfl）
+ *     --format pgm|bin     -j 线程数     --peaks 文件（CSV：每行的峰值频率）
+ *     --check              FFT对照DFT、分块一致性、由瀑布图逐行解出符号、漂移测量、文件格式
+ *
+ * stderr输出总行数、音频时长和相当于实时的倍数。返回：0成功，1读写失败，2参数错误，3校验不一致。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "encode.h"
+#include "wspr_synth.h"
+#include "wspr_wav.h"
+#include "wspr_wfall.h"
+
+#define MAX_THREADS 256
+#define MAX_PLANS 16
+#define PI 3.14159265358979323846
+#define TONE_SPACING (12000.0 / 8192.0)
+#define SYNTH_RATE 12000
+#define SYMBOL_SAMPLES 8192
+#define SLOT_SAMPLES (120 * SYNTH_RATE)
+#define TX_START SYNTH_RATE
+#define BLOCK_FRAMES 65536
+
+static struct {
+    int threads;
+    const char *synth;
+    uint32_t freq;
+    double ref;
+    double audio;
+    double drift;        // Hz/分
+    double snr;
+    int noise;
+    uint64_t seed;
+    int repeat;
+    wspr_wav_raw_t raw;
+    int is_raw;
+    wspr_wfall_config_t wf;
+    int full_band;
+    const char *out_dir;
+    wspr_wfall_format_t format;
+    const char *peaks_path;
+} cfg;
+
+typedef struct {
+    const char *path;            // 录音，NULL为合成
+    const char *msg;
+    char name[64];
+    uint64_t seed;
+    // 结果
+    uint64_t rows, frames;
+    uint32_t rate;
+    int failed;
+    char err[160];
+    float *peak_hz, *peak_db;
+    size_t peak_cap;
+} job_t;
+
+static struct {
+    pthread_mutex_t lock;
+    job_t *jobs;
+    size_t njobs, next;
+    wspr_wfall_plan_t plans[MAX_PLANS];
+    int nplans;
+} st;
+
+// 不写硬件：只用wspr_synth各后端算出的实际音调频率
+void si5351_write(uint8_t reg, uint8_t value) {
+    (void)reg;
+    (void)value;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ---------------------------------------------------------------- 合成
+
+/*
+ * 四个音调的音频频率：后端的实际输出频率相对--freq的偏差原样加到音频上，
+ * 音调0的标称音频频率为center - 1.5倍音调间隔
+ */
+static int tone_plan(const char *synth, uint32_t freq, double ref, double center, double *tone_hz) {
+    const wspr_synth_backend_t *backend;
+    wspr_synth_si5351_t si = {0, SI5351_DRIVE_STRENGTH_8MA, {0}, 0};
+    wspr_synth_dds_t dds = {0, NULL, NULL};
+    wspr_synth_table_t t;
+    void *dev;
+    int k;
+
+    if (strcmp(synth, "exact") == 0) {
+        for (k = 0; k < 4; k++) tone_hz[k] = center + (k - 1.5) * TONE_SPACING;
+        return 0;
+    }
+    if (strcmp(synth, "si5351") == 0) {
+        backend = &wspr_synth_si5351;
+        dev = &si;
+    } else if (strcmp(synth, "ad9850") == 0 || strcmp(synth, "ad9833") == 0) {
+        backend = synth[4] == '5' ? &wspr_synth_ad9850 : &wspr_synth_ad9833;
+        dds.ref_centi = (uint64_t)llround((ref > 0 ? ref : (synth[4] == '5' ? 125e6 : 25e6)) * 100.0);
+        dev = &dds;
+    } else {
+        return -1;
+    }
+    if (wspr_synth_plan(&t, backend, dev, (uint64_t)freq * 100) != 0) return -1;
+    for (k = 0; k < 4; k++) {
+        tone_hz[k] = center - 1.5 * TONE_SPACING + ((double)t.actual[k] - (double)freq * 100.0) / 100.0;
+    }
+    return 0;
+}
+
+typedef struct {
+    uint8_t symbols[WSPR_SYMBOL_COUNT];
+    double tone_hz[4];
+    double drift;                // Hz/秒，以发射中点为0
+    double amp, sigma;
+    uint64_t start, pos, total;
+    double phase;
+    uint64_t rng;
+    double spare;
+    int has_spare;
+} synth_t;
+
+static double synth_uniform(synth_t *s) {
+    s->rng ^= s->rng << 13;
+    s->rng ^= s->rng >> 7;
+    s->rng ^= s->rng << 17;
+    return ((s->rng >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+static double synth_gauss(synth_t *s) {
+    double r, a;
+    if (s->has_spare) {
+        s->has_spare = 0;
+        return s->spare;
+    }
+    r = sqrt(-2.0 * log(synth_uniform(s)));
+    a = 2.0 * PI * synth_uniform(s);
+    s->spare = r * sin(a);
+    s->has_spare = 1;
+    return r * cos(a);
+}
+
+static void synth_init(synth_t *s, const uint8_t *symbols, const double *tone_hz, double drift_per_min,
+                       int noise, double snr, uint64_t seed, uint64_t start, uint64_t total) {
+    memset(s, 0, sizeof(*s));
+    memcpy(s->symbols, symbols, WSPR_SYMBOL_COUNT);
+    memcpy(s->tone_hz, tone_hz, sizeof(s->tone_hz));
+    s->drift = drift_per_min / 60.0;
+    s->amp = 0.5;
+    // 信号功率amp²/2，噪声在0~rate/2内均匀分布，折算到2500Hz
+    s->sigma = noise ? sqrt(s->amp * s->amp / 2.0 / pow(10.0, snr / 10.0) / (2500.0 / (SYNTH_RATE / 2.0))) : 0.0;
+    s->rng = seed * 0x9E3779B97F4A7C15ULL + 1;
+    s->start = start;
+    s->total = total;
+}
+
+// 生成至多n个样本，返回实际个数
+static size_t synth_block(synth_t *s, float *out, size_t n) {
+    const uint64_t tx_len = (uint64_t)WSPR_SYMBOL_COUNT * SYMBOL_SAMPLES;
+    const double mid = tx_len / 2.0;
+    size_t k;
+
+    if (n > s->total - s->pos) n = (size_t)(s->total - s->pos);
+    for (k = 0; k < n; k++) {
+        uint64_t t = s->pos + k;
+        double v = 0.0;
+        if (t >= s->start && t < s->start + tx_len) {
+            double x = (double)(t - s->start);
+            double f = s->tone_hz[s->symbols[(t - s->start) / SYMBOL_SAMPLES] & 3] + s->drift * (x - mid) / SYNTH_RATE;
+            v = s->amp * sin(s->phase);
+            s->phase += 2.0 * PI * f / SYNTH_RATE;
+            if (s->phase > 2.0 * PI) s->phase -= 2.0 * PI;
+        }
+        if (s->sigma > 0) v += s->sigma * synth_gauss(s);
+        out[k] = (float)v;
+    }
+    s->pos += n;
+    return n;
+}
+
+static int encode_msg(const char *msg, uint8_t *symbols) {
+    char call[13], loc[7];
+    int d;
+
+    if (sscanf(msg, "%12s %6s %d", call, loc, &d) != 3) return -1;
+    wspr_encode(call, loc, (int8_t)d, symbols);
+    return 0;
+}
+
+// ---------------------------------------------------------------- 处理
+
+// 按采样率与IQ取共用的计划，首次用到时创建
+static const wspr_wfall_plan_t *get_plan(uint32_t rate, int iq, char *err, size_t err_size) {
+    const wspr_wfall_plan_t *p = NULL;
+    int k;
+
+    pthread_mutex_lock(&st.lock);
+    for (k = 0; k < st.nplans; k++) {
+        if (st.plans[k].cfg.rate == rate && (st.plans[k].cfg.iq != 0) == (iq != 0)) p = &st.plans[k];
+    }
+    if (!p && st.nplans < MAX_PLANS) {
+        wspr_wfall_config_t c = cfg.wf;
+        c.rate = rate;
+        c.iq = iq;
+        if (cfg.full_band) c.f_lo = c.f_hi = 0;
+        if (wspr_wfall_plan(&st.plans[st.nplans], &c, err, err_size) == 0) p = &st.plans[st.nplans++];
+    } else if (!p) {
+        snprintf(err, err_size, "采样率种类过多");
+    }
+    pthread_mutex_unlock(&st.lock);
+    return p;
+}
+
+typedef struct {
+    job_t *job;
+    const wspr_wfall_plan_t *plan;
+    wspr_wfall_writer_t *writer;
+    int write_failed;
+} emit_ctx_t;
+
+static void emit_row(void *ctx, const wspr_wfall_row_t *row) {
+    emit_ctx_t *e = (emit_ctx_t *)ctx;
+    job_t *j = e->job;
+
+    if (e->writer && wspr_wfall_writer_row(e->writer, row->pix) != 0) e->write_failed = 1;
+    if (cfg.peaks_path) {
+        const wspr_wfall_plan_t *p = e->plan;
+        uint32_t c, best = 0;
+        if (row->index >= j->peak_cap) {
+            j->peak_cap = j->peak_cap ? j->peak_cap * 2 : 1024;
+            j->peak_hz = (float *)realloc(j->peak_hz, j->peak_cap * sizeof(float));
+            j->peak_db = (float *)realloc(j->peak_db, j->peak_cap * sizeof(float));
+        }
+        for (c = 1; c < p->width; c++) {
+            if (row->db[c] > row->db[best]) best = c;
+        }
+        j->peak_hz[row->index] = (float)wspr_wfall_column_hz(p, best);
+        j->peak_db[row->index] = row->db[best];
+    }
+}
+
+static void run_job(job_t *j, wspr_rx_buf_t *buf) {
+    wspr_wav_t w;
+    synth_t syn;
+    const wspr_wfall_plan_t *p;
+    wspr_wfall_t s;
+    wspr_wfall_writer_t writer;
+    emit_ctx_t e;
+    int iq;
+
+    memset(&w, 0, sizeof(w));
+    if (j->path) {
+        int r = cfg.is_raw ? wspr_wav_open_raw(j->path, &cfg.raw, &w, j->err, sizeof(j->err))
+                           : wspr_wav_open(j->path, &w, j->err, sizeof(j->err));
+        if (r != 0) {
+            j->failed = 1;
+            return;
+        }
+        j->rate = w.rate;
+        iq = w.channels == 2;
+    } else {
+        uint8_t symbols[WSPR_SYMBOL_COUNT];
+        double tone_hz[4];
+        encode_msg(j->msg, symbols);
+        tone_plan(cfg.synth, cfg.freq, cfg.ref, cfg.audio, tone_hz);
+        synth_init(&syn, symbols, tone_hz, cfg.drift, cfg.noise, cfg.snr, j->seed, TX_START, SLOT_SAMPLES);
+        j->rate = SYNTH_RATE;
+        iq = 0;
+    }
+
+    p = get_plan(j->rate, iq, j->err, sizeof(j->err));
+    if (!p || wspr_wfall_init(&s, p) != 0) {
+        if (p) snprintf(j->err, sizeof(j->err), "内存不足");
+        j->failed = 1;
+        if (j->path) wspr_wav_close(&w);
+        return;
+    }
+    memset(&e, 0, sizeof(e));
+    e.job = j;
+    e.plan = p;
+    if (cfg.out_dir) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%04zu_%s.%s", cfg.out_dir, (size_t)(j - st.jobs), j->name,
+                 cfg.format == WSPR_WFALL_PGM ? "pgm" : "wfl");
+        if (wspr_wfall_writer_open(&writer, path, cfg.format, p, j->err, sizeof(j->err)) != 0) {
+            j->failed = 1;
+            wspr_wfall_free(&s);
+            if (j->path) wspr_wav_close(&w);
+            return;
+        }
+        e.writer = &writer;
+    }
+
+    if (j->path) {
+        uint64_t first = 0;
+        while (wspr_wav_read_buf(&w, first, buf) > 0) {
+            wspr_wfall_push(&s, buf->i, iq ? buf->q : NULL, buf->n, emit_row, &e);
+            first += buf->n;
+        }
+        j->frames = w.frames;
+        wspr_wav_close(&w);
+    } else {
+        size_t n;
+        while ((n = synth_block(&syn, buf->i, buf->cap)) > 0) {
+            wspr_wfall_push(&s, buf->i, NULL, n, emit_row, &e);
+            j->frames += n;
+        }
+    }
+    j->rows = s.rows;
+    wspr_wfall_free(&s);
+    if (e.writer && (wspr_wfall_writer_close(&writer) != 0 || e.write_failed)) {
+        snprintf(j->err, sizeof(j->err), "写入瀑布图失败");
+        j->failed = 1;
+    }
+}
+
+static void *worker(void *arg) {
+    wspr_rx_buf_t buf;
+    (void)arg;
+
+    if (wspr_rx_buf_alloc(&buf, BLOCK_FRAMES, 1) != 0) return NULL;
+    for (;;) {
+        size_t k;
+        pthread_mutex_lock(&st.lock);
+        k = st.next++;
+        pthread_mutex_unlock(&st.lock);
+        if (k >= st.njobs) break;
+        run_job(&st.jobs[k], &buf);
+    }
+    wspr_rx_buf_free(&buf);
+    return NULL;
+}
+
+static void set_name(job_t *j, const char *src) {
+    const char *b = strrchr(src, '/');
+    size_t k, n = 0;
+
+    b = b ? b + 1 : src;
+    for (k = 0; b[k] && n + 1 < sizeof(j->name); k++) {
+        char c = b[k];
+        if (j->path && c == '.' && strchr(b + k + 1, '.') == NULL) break; // 去掉扩展名
+        j->name[n++] = (char)(((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '-')
+                                  ? c
+                                  : '_');
+    }
+    j->name[n] = 0;
+}
+
+static int write_peaks(void) {
+    FILE *f = fopen(cfg.peaks_path, "w");
+    size_t k;
+    uint64_t r;
+
+    if (!f) {
+        perror(cfg.peaks_path);
+        return -1;
+    }
+    fprintf(f, "job,name,row,time_s,peak_hz,peak_dbfs\n");
+    for (k = 0; k < st.njobs; k++) {
+        const job_t *j = &st.jobs[k];
+        if (j->failed || !j->rate) continue;
+        for (r = 0; r < j->rows; r++) {
+            double t = ((double)r * cfg.wf.hop + cfg.wf.nfft / 2.0) / j->rate;
+            fprintf(f, "%zu,%s,%llu,%.3f,%.3f,%.2f\n", k, j->name, (unsigned long long)r, t, j->peak_hz[r],
+                    j->peak_db[r]);
+        }
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static int run(void) {
+    pthread_t th[MAX_THREADS];
+    uint64_t rows = 0;
+    double audio = 0, t0, t1;
+    size_t k, failed = 0;
+    int i, threads = cfg.threads;
+
+    if (threads > (int)st.njobs) threads = (int)st.njobs;
+    t0 = now_sec();
+    for (i = 0; i < threads; i++) pthread_create(&th[i], NULL, worker, NULL);
+    for (i = 0; i < threads; i++) pthread_join(th[i], NULL);
+    t1 = now_sec();
+
+    for (k = 0; k < st.njobs; k++) {
+        const job_t *j = &st.jobs[k];
+        if (j->failed) {
+            fprintf(stderr, "%s: %s\n", j->path ? j->path : j->msg, j->err);
+            failed++;
+            continue;
+        }
+        rows += j->rows;
+        audio += (double)j->frames / j->rate;
+    }
+    if (cfg.peaks_path && write_peaks() != 0) failed++;
+    fprintf(stderr, "%zu 路（%zu 路失败），%llu 行，音频 %.1f 秒，%.3f 秒，%.0f 倍实时，%d 线程（%s）\n", st.njobs, failed,
+            (unsigned long long)rows, audio, t1 - t0, audio / (t1 - t0), threads, wspr_wfall_simd());
+    if (st.nplans) {
+        const wspr_wfall_plan_t *p = &st.plans[0];
+        fprintf(stderr, "每行 %u 列：%.3f ~ %.3f Hz，频点间隔 %.4f Hz，行间隔 %.4f 秒\n", p->width,
+                wspr_wfall_column_hz(p, 0), wspr_wfall_column_hz(p, p->width - 1), p->bin_hz,
+                (double)p->cfg.hop / p->cfg.rate);
+    }
+    return failed ? 1 : 0;
+}
+
+// ---------------------------------------------------------------- 校验
+
+typedef struct {
+    float *db;
+    uint8_t *pix;
+    size_t rows, cap, width;
+} rows_t;
+
+static void collect_row(void *ctx, const wspr_wfall_row_t *row) {
+    rows_t *r = (rows_t *)ctx;
+    if (r->rows == r->cap) {
+        r->cap = r->cap ? r->cap * 2 : 64;
+        r->db = (float *)realloc(r->db, r->cap * r->width * sizeof(float));
+        r->pix = (uint8_t *)realloc(r->pix, r->cap * r->width);
+    }
+    memcpy(r->db + r->rows * r->width, row->db, r->width * sizeof(float));
+    memcpy(r->pix + r->rows * r->width, row->pix, r->width);
+    r->rows++;
+}
+
+static void rows_free(rows_t *r) {
+    free(r->db);
+    free(r->pix);
+    memset(r, 0, sizeof(*r));
+}
+
+// 一次推入全部样本或按随机长度分块推入，收集各行
+static int push_all(const wspr_wfall_plan_t *p, const float *i, const float *q, size_t n, int chunked, rows_t *out,
+                    uint64_t *rng) {
+    wspr_wfall_t s;
+    size_t k = 0;
+
+    memset(out, 0, sizeof(*out));
+    out->width = p->width;
+    if (wspr_wfall_init(&s, p) != 0) return -1;
+    while (k < n) {
+        size_t len = n - k;
+        if (chunked) {
+            *rng = *rng * 6364136223846793005ULL + 1442695040888963407ULL;
+            len = 1 + (size_t)((*rng >> 33) % 700);
+            if (len > n - k) len = n - k;
+        }
+        wspr_wfall_push(&s, i + k, q ? q + k : NULL, len, collect_row, out);
+        k += len;
+    }
+    wspr_wfall_free(&s);
+    return 0;
+}
+
+static wspr_wfall_config_t check_config(uint32_t nfft, uint32_t hop, int iq, wspr_wfall_window_t win) {
+    wspr_wfall_config_t c;
+    memset(&c, 0, sizeof(c));
+    c.rate = SYNTH_RATE;
+    c.nfft = nfft;
+    c.hop = hop;
+    c.iq = iq;
+    c.window = win;
+    c.db_floor = -150.0f;
+    c.db_range = 150.0f;
+    return c;
+}
+
+// 整行与双精度DFT对照：功率不低于最大值-60dB的频点误差须小于0.01dB，像素误差不超过1
+static long check_dft(void) {
+    static const uint32_t sizes[] = {16, 64, 2048};
+    uint64_t rng = 12345;
+    long bad = 0;
+    size_t si;
+    int iq, win;
+
+    for (si = 0; si < sizeof(sizes) / sizeof(sizes[0]); si++) {
+        for (iq = 0; iq < 2; iq++) {
+            for (win = 0; win < 3; win++) {
+                uint32_t n = sizes[si], t, c;
+                wspr_wfall_config_t cc = check_config(n, n, iq, (wspr_wfall_window_t)win);
+                wspr_wfall_plan_t p;
+                float *xi = (float *)malloc(n * sizeof(float)), *xq = (float *)malloc(n * sizeof(float));
+                double *ref = (double *)malloc((n + 1) * sizeof(double)), maxp = 0;
+                rows_t rows;
+                long before = bad;
+
+                if (wspr_wfall_plan(&p, &cc, NULL, 0) != 0) return 1;
+                for (t = 0; t < n; t++) {
+                    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+                    xi[t] = (float)((int32_t)(rng >> 32) / 2147483648.0);
+                    xq[t] = (float)((int32_t)rng / 2147483648.0);
+                }
+                // 加一个强单音，使频谱有动态范围
+                for (t = 0; t < n; t++) xi[t] += (float)(4.0 * cos(2.0 * PI * 3.3 * t / n));
+                for (c = 0; c < p.width; c++) {
+                    double sr = 0, si2 = 0;
+                    int64_t b = p.bin_lo + (int64_t)c;
+                    for (t = 0; t < n; t++) {
+                        double a = -2.0 * PI * (double)((b * (int64_t)t) % (int64_t)n) / n, w = p.window[t];
+                        double vi = xi[t] * w, vq = iq ? xq[t] * w : 0.0;
+                        sr += vi * cos(a) - vq * sin(a);
+                        si2 += vi * sin(a) + vq * cos(a);
+                    }
+                    ref[c] = sr * sr + si2 * si2;
+                    if (ref[c] > maxp) maxp = ref[c];
+                }
+                push_all(&p, xi, iq ? xq : NULL, n, 0, &rows, &rng);
+                if (rows.rows != 1) bad++;
+                for (c = 0; c < p.width && rows.rows == 1; c++) {
+                    double d = 10.0 * log10(ref[c] + 1e-30) + p.db_offset;
+                    double v = (d - cc.db_floor) * 255.0 / cc.db_range;
+                    int px = v < 0 ? 0 : (v > 255 ? 255 : (int)v);
+                    if (ref[c] >= maxp * 1e-6 && fabs(rows.db[c] - d) > 0.01) bad++;
+                    if (abs(rows.pix[c] - px) > 1 && ref[c] >= maxp * 1e-6) bad++;
+                }
+                if (bad > before) fprintf(stderr, "DFT不一致: nfft=%u iq=%d window=%d\n", n, iq, win);
+                rows_free(&rows);
+                wspr_wfall_plan_free(&p);
+                free(xi);
+                free(xq);
+                free(ref);
+            }
+        }
+    }
+    return bad;
+}
+
+// 分块推入与一次推入逐行完全相同，行数符合wspr_wfall_rows_for()
+static long check_stream(void) {
+    const size_t n = 20000;
+    float *xi = (float *)malloc(n * sizeof(float)), *xq = (float *)malloc(n * sizeof(float));
+    uint64_t rng = 99;
+    long bad = 0;
+    int iq;
+    size_t k;
+
+    for (k = 0; k < n; k++) {
+        xi[k] = (float)sin(0.05 * k) + (float)(k % 7) * 0.01f;
+        xq[k] = (float)cos(0.031 * k);
+    }
+    for (iq = 0; iq < 2; iq++) {
+        static const uint32_t hops[] = {1, 200, 512};
+        size_t h;
+        for (h = 0; h < 3; h++) {
+            wspr_wfall_config_t cc = check_config(512, hops[h], iq, WSPR_WFALL_HANN);
+            wspr_wfall_plan_t p;
+            rows_t a, b;
+            size_t len = hops[h] == 1 ? 3000 : n;
+
+            cc.f_lo = 100;
+            cc.f_hi = 900;
+            if (wspr_wfall_plan(&p, &cc, NULL, 0) != 0) return 1;
+            push_all(&p, xi, iq ? xq : NULL, len, 0, &a, &rng);
+            push_all(&p, xi, iq ? xq : NULL, len, 1, &b, &rng);
+            if (a.rows != b.rows || a.rows != wspr_wfall_rows_for(&p, len) ||
+                memcmp(a.db, b.db, a.rows * p.width * sizeof(float)) != 0) {
+                fprintf(stderr, "分块不一致: iq=%d hop=%u\n", iq, hops[h]);
+                bad++;
+            }
+            // 每行须等于单独对该行窗口内的样本做一次的结果
+            for (k = 0; k < a.rows; k += 1 + a.rows / 16) {
+                rows_t one;
+                push_all(&p, xi + k * hops[h], iq ? xq + k * hops[h] : NULL, 512, 0, &one, &rng);
+                if (one.rows != 1 || memcmp(one.db, a.db + k * p.width, p.width * sizeof(float)) != 0) {
+                    fprintf(stderr, "重叠不一致: iq=%d hop=%u 行 %zu\n", iq, hops[h], k);
+                    bad++;
+                }
+                rows_free(&one);
+            }
+            rows_free(&a);
+            rows_free(&b);
+            wspr_wfall_plan_free(&p);
+        }
+    }
+    free(xi);
+    free(xq);
+    return bad;
+}
+
+// 合成一条发射，行与符号对齐（nfft = hop = 8192，频点间隔恰为音调间隔），逐行取四个音调中最强的即为符号
+static long check_tones(void) {
+    static const char *synths[] = {"exact", "si5351", "ad9850", "ad9833"};
+    const uint64_t total = (uint64_t)WSPR_SYMBOL_COUNT * SYMBOL_SAMPLES;
+    uint8_t symbols[WSPR_SYMBOL_COUNT];
+    float *audio = (float *)malloc(total * sizeof(float));
+    long bad = 0;
+    size_t si;
+
+    encode_msg("K1ABC FN42 37", symbols);
+    for (si = 0; si < 4; si++) {
+        wspr_wfall_config_t cc = check_config(SYMBOL_SAMPLES, SYMBOL_SAMPLES, 0, WSPR_WFALL_HANN);
+        wspr_wfall_plan_t p;
+        double tone_hz[4];
+        synth_t syn;
+        rows_t rows;
+        uint64_t rng = 1;
+        size_t r, errors = 0;
+        int32_t b0;
+
+        cc.f_lo = 1400;
+        cc.f_hi = 1600;
+        if (wspr_wfall_plan(&p, &cc, NULL, 0) != 0 ||
+            tone_plan(synths[si], 7040100, 0, 1024.0 * TONE_SPACING + 1.5 * TONE_SPACING, tone_hz) != 0) {
+            fprintf(stderr, "无法规划音调: %s\n", synths[si]);
+            bad++;
+            continue;
+        }
+        synth_init(&syn, symbols, tone_hz, 0, 0, 0, 1, 0, total);
+        synth_block(&syn, audio, total);
+        push_all(&p, audio, NULL, total, 1, &rows, &rng);
+        b0 = 1024 - p.bin_lo;
+        for (r = 0; r < rows.rows; r++) {
+            const float *d = rows.db + r * p.width + b0;
+            int k, best = 0;
+            for (k = 1; k < 4; k++) {
+                if (d[k] > d[best]) best = k;
+            }
+            if (best != symbols[r]) errors++;
+        }
+        if (rows.rows != WSPR_SYMBOL_COUNT || errors) {
+            fprintf(stderr, "符号不一致: %s，%zu 行，%zu 处\n", synths[si], rows.rows, errors);
+            bad++;
+        }
+        rows_free(&rows);
+        wspr_wfall_plan_free(&p);
+    }
+    free(audio);
+    return bad;
+}
+
+// 单音加线性漂移：峰值频率（抛物线插值）对时间的回归斜率与设定值相差不超过3%
+static long check_drift(void) {
+    const double drift = 6.0; // Hz/分
+    uint8_t zeros[WSPR_SYMBOL_COUNT];
+    double tone_hz[4] = {1500, 1500, 1500, 1500};
+    wspr_wfall_config_t cc = check_config(16384, 2048, 0, WSPR_WFALL_HANN);
+    wspr_wfall_plan_t p;
+    float *audio = (float *)malloc(SLOT_SAMPLES * sizeof(float));
+    double sx = 0, sy = 0, sxx = 0, sxy = 0, slope, mid_hz;
+    size_t r, n = 0;
+    uint64_t rng = 7;
+    synth_t syn;
+    rows_t rows;
+    long bad = 0;
+
+    memset(zeros, 0, sizeof(zeros));
+    cc.f_lo = 1400;
+    cc.f_hi = 1600;
+    if (wspr_wfall_plan(&p, &cc, NULL, 0) != 0) return 1;
+    synth_init(&syn, zeros, tone_hz, drift, 1, -10.0, 3, TX_START, SLOT_SAMPLES);
+    synth_block(&syn, audio, SLOT_SAMPLES);
+    push_all(&p, audio, NULL, SLOT_SAMPLES, 1, &rows, &rng);
+    for (r = 0; r < rows.rows; r++) {
+        uint64_t first = r * cc.hop;
+        const float *d = rows.db + r * p.width;
+        uint32_t c, best = 1;
+        double x, off;
+        if (first < TX_START || first + cc.nfft > TX_START + (uint64_t)WSPR_SYMBOL_COUNT * SYMBOL_SAMPLES) continue;
+        for (c = 2; c + 1 < p.width; c++) {
+            if (d[c] > d[best]) best = c;
+        }
+        off = 0.5 * (d[best - 1] - d[best + 1]) / (d[best - 1] - 2 * d[best] + d[best + 1]);
+        x = ((double)first + cc.nfft / 2.0 - TX_START) / SYNTH_RATE;
+        sx += x;
+        sy += wspr_wfall_column_hz(&p, best) + off * p.bin_hz;
+        sxx += x * x;
+        sxy += x * (wspr_wfall_column_hz(&p, best) + off * p.bin_hz);
+        n++;
+    }
+    slope = (n * sxy - sx * sy) / (n * sxx - sx * sx) * 60.0;
+    mid_hz = (sy - slope / 60.0 * sx) / n + slope / 60.0 * (WSPR_SYMBOL_COUNT * SYMBOL_SAMPLES / 2.0 / SYNTH_RATE);
+    if (n < 500 || fabs(slope - drift) > 0.03 * drift || fabs(mid_hz - 1500.0) > 0.05) {
+        fprintf(stderr, "漂移不一致: %zu 行，%.3f Hz/分，中点 %.3f Hz\n", n, slope, mid_hz);
+        bad++;
+    }
+    rows_free(&rows);
+    wspr_wfall_plan_free(&p);
+    free(audio);
+    return bad;
+}
+
+// PGM与二进制文件的行数回填与文件长度
+static long check_files(void) {
+    char dir[] = "/tmp/wspr_waterfall.XXXXXX", path[64];
+    wspr_wfall_config_t cc = check_config(256, 100, 1, WSPR_WFALL_HANN);
+    wspr_wfall_plan_t p;
+    long bad = 0;
+    int fmt;
+
+    if (!mkdtemp(dir) || wspr_wfall_plan(&p, &cc, NULL, 0) != 0) return 1;
+    for (fmt = 0; fmt < 2; fmt++) {
+        wspr_wfall_writer_t w;
+        uint8_t row[256];
+        unsigned width = 0, height = 0, maxval = 0;
+        long size = 0;
+        FILE *f;
+        int r;
+
+        snprintf(path, sizeof(path), "%s/w.%s", dir, fmt ? "wfl" : "pgm");
+        memset(row, 0x80, sizeof(row));
+        if (wspr_wfall_writer_open(&w, path, (wspr_wfall_format_t)fmt, &p, NULL, 0) != 0) {
+            bad++;
+            continue;
+        }
+        for (r = 0; r < 37; r++) wspr_wfall_writer_row(&w, row);
+        if (wspr_wfall_writer_close(&w) != 0) bad++;
+        f = fopen(path, "rb");
+        if (!f) {
+            bad++;
+            continue;
+        }
+        if (fmt == WSPR_WFALL_PGM) {
+            char line[256];
+            long header;
+            if (!fgets(line, sizeof(line), f) || strcmp(line, "P5\n") != 0) bad++;
+            if (!fgets(line, sizeof(line), f) || line[0] != '#') bad++;
+            if (fscanf(f, "%u %u %u", &width, &height, &maxval) != 3 || fgetc(f) != '\n') bad++;
+            header = ftell(f);
+            fseek(f, 0, SEEK_END);
+            size = ftell(f) - header;
+        } else {
+            uint8_t h[64];
+            if (fread(h, 1, 64, f) != 64 || memcmp(h, "WFL1", 4) != 0) bad++;
+            width = h[8] | (h[9] << 8) | ((unsigned)h[10] << 16) | ((unsigned)h[11] << 24);
+            height = h[12] | (h[13] << 8) | ((unsigned)h[14] << 16) | ((unsigned)h[15] << 24);
+            maxval = 255;
+            fseek(f, 0, SEEK_END);
+            size = ftell(f) - 64;
+        }
+        fclose(f);
+        remove(path);
+        if (width != p.width || height != 37 || maxval != 255 || size != 37L * (long)p.width) {
+            fprintf(stderr, "文件格式不一致: %s\n", fmt ? "bin" : "pgm");
+            bad++;
+        }
+    }
+    rmdir(dir);
+    wspr_wfall_plan_free(&p);
+    return bad;
+}
+
+static int check(void) {
+    long dft = check_dft(), stream = check_stream(), tones = check_tones(), drift = check_drift();
+    long files = check_files();
+
+    printf("校验（%s）: DFT对照 %ld，分块 %ld，符号 %ld，漂移 %ld，文件 %ld 处不一致\n", wspr_wfall_simd(), dft, stream,
+           tones, drift, files);
+    return dft || stream || tones || drift || files ? 3 : 0;
+}
+
+// ---------------------------------------------------------------- 参数
+
+static int add_job(const char *path, const char *msg) {
+    job_t *j;
+    if (st.njobs % 256 == 0) {
+        st.jobs = (job_t *)realloc(st.jobs, (st.njobs + 256) * sizeof(job_t));
+        if (!st.jobs) return -1;
+    }
+    j = &st.jobs[st.njobs++];
+    memset(j, 0, sizeof(*j));
+    j->path = path;
+    j->msg = msg;
+    set_name(j, path ? path : msg);
+    return 0;
+}
+
+static int read_list(const char *list) {
+    FILE *f = fopen(list, "r");
+    char line[4096];
+
+    if (!f) {
+        perror(list);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        size_t len = strcspn(line, "\r\n");
+        line[len] = 0;
+        if (len == 0 || line[0] == '#') continue;
+        add_job(strdup(line), NULL);
+    }
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *msgs[256];
+    int nmsgs = 0, bad_args = 0, do_check = 0, ret, i, r;
+    uint8_t symbols[WSPR_SYMBOL_COUNT];
+    double tone_hz[4];
+
+    cfg.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    cfg.synth = "exact";
+    cfg.freq = 14097100;
+    cfg.audio = 1500.0;
+    cfg.seed = 1;
+    cfg.repeat = 1;
+    cfg.raw.channels = 1;
+    cfg.raw.rate = 12000;
+    cfg.wf.nfft = 16384;
+    cfg.wf.hop = 2048;
+    cfg.wf.window = WSPR_WFALL_HANN;
+    cfg.wf.f_lo = 1400.0;
+    cfg.wf.f_hi = 1600.0;
+    cfg.wf.db_floor = -110.0f;
+    cfg.wf.db_range = 100.0f;
+    cfg.format = WSPR_WFALL_PGM;
+    pthread_mutex_init(&st.lock, NULL);
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            cfg.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--msg") == 0 && i + 1 < argc) {
+            if (nmsgs < 256) msgs[nmsgs++] = argv[i + 1];
+            if (encode_msg(argv[++i], symbols) != 0) bad_args = 1;
+        } else if (strcmp(argv[i], "--synth") == 0 && i + 1 < argc) {
+            cfg.synth = argv[++i];
+        } else if (strcmp(argv[i], "--freq") == 0 && i + 1 < argc) {
+            cfg.freq = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--ref") == 0 && i + 1 < argc) {
+            cfg.ref = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--audio") == 0 && i + 1 < argc) {
+            cfg.audio = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--drift") == 0 && i + 1 < argc) {
+            cfg.drift = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--snr") == 0 && i + 1 < argc) {
+            cfg.snr = atof(argv[++i]);
+            cfg.noise = 1;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            cfg.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            cfg.repeat = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--list") == 0 && i + 1 < argc) {
+            if (read_list(argv[++i]) != 0) return 1;
+        } else if (strcmp(argv[i], "--raw") == 0 && i + 1 < argc) {
+            i++;
+            cfg.is_raw = 1;
+            if (strcmp(argv[i], "s16") == 0) cfg.raw.format = WSPR_WAV_S16;
+            else if (strcmp(argv[i], "f32") == 0) cfg.raw.format = WSPR_WAV_F32;
+            else bad_args = 1;
+        } else if (strcmp(argv[i], "--iq") == 0) {
+            cfg.raw.channels = 2;
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            cfg.raw.rate = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--offset") == 0 && i + 1 < argc) {
+            cfg.raw.offset = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--nfft") == 0 && i + 1 < argc) {
+            cfg.wf.nfft = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--hop") == 0 && i + 1 < argc) {
+            cfg.wf.hop = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "hann") == 0) cfg.wf.window = WSPR_WFALL_HANN;
+            else if (strcmp(argv[i], "blackman") == 0) cfg.wf.window = WSPR_WFALL_BLACKMAN_HARRIS;
+            else if (strcmp(argv[i], "rect") == 0) cfg.wf.window = WSPR_WFALL_RECT;
+            else bad_args = 1;
+        } else if (strcmp(argv[i], "--band") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "full") == 0) cfg.full_band = 1;
+            else if (sscanf(argv[i], "%lf:%lf", &cfg.wf.f_lo, &cfg.wf.f_hi) != 2 || cfg.wf.f_lo >= cfg.wf.f_hi)
+                bad_args = 1;
+        } else if (strcmp(argv[i], "--floor") == 0 && i + 1 < argc) {
+            cfg.wf.db_floor = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc) {
+            cfg.wf.db_range = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            cfg.out_dir = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "pgm") == 0) cfg.format = WSPR_WFALL_PGM;
+            else if (strcmp(argv[i], "bin") == 0) cfg.format = WSPR_WFALL_BIN;
+            else bad_args = 1;
+        } else if (strcmp(argv[i], "--peaks") == 0 && i + 1 < argc) {
+            cfg.peaks_path = argv[++i];
+        } else if (strcmp(argv[i], "--check") == 0) {
+            do_check = 1;
+        } else if (argv[i][0] == '-' && argv[i][1] != 0) {
+            bad_args = 1;
+        } else {
+            add_job(argv[i], NULL);
+        }
+    }
+    for (i = 0; i < nmsgs; i++) {
+        for (r = 0; r < cfg.repeat; r++) {
+            add_job(NULL, msgs[i]);
+            st.jobs[st.njobs - 1].seed = cfg.seed + (uint64_t)st.njobs;
+        }
+    }
+    if (nmsgs && tone_plan(cfg.synth, cfg.freq, cfg.ref, cfg.audio, tone_hz) != 0) {
+        fprintf(stderr, "后端 %s 无法产生 %u Hz\n", cfg.synth, cfg.freq);
+        bad_args = 1;
+    }
+    if (cfg.threads < 1 || cfg.threads > MAX_THREADS || cfg.repeat < 1 || (!do_check && st.njobs == 0)) bad_args = 1;
+    if (bad_args) {
+        fprintf(stderr,
+                "用法: %s [-j 线程数] [--msg \"呼号 网格 功率\"]... [--synth exact|si5351|ad9850|ad9833]\n"
+                "          [--freq Hz] [--ref Hz] [--audio Hz] [--drift Hz/分] [--snr dB] [--seed N] [--repeat N]\n"
+                "          [--list 列表] [--raw s16|f32 [--iq] [--rate Hz] [--offset 字节]]\n"
+                "          [--nfft N] [--hop N] [--window hann|blackman|rect] [--band 低:高|full]\n"
+                "          [--floor dB] [--range dB] [-o 目录] [--format pgm|bin] [--peaks 文件] [录音...]\n"
+                "       %s --check\n",
+                argv[0], argv[0]);
+        return 2;
+    }
+
+    if (do_check) {
+        ret = check();
+    } else {
+        char err[128];
+        wspr_wfall_config_t c = cfg.wf;
+        c.rate = SYNTH_RATE;
+        if (cfg.full_band) c.f_lo = c.f_hi = 0;
+        // 先按默认采样率检查一次参数，避免每路都报同样的错误
+        if (wspr_wfall_plan(&st.plans[0], &c, err, sizeof(err)) != 0) {
+            fprintf(stderr, "%s\n", err);
+            return 2;
+        }
+        wspr_wfall_plan_free(&st.plans[0]);
+        ret = run();
+    }
+    for (i = 0; i < st.nplans; i++) wspr_wfall_plan_free(&st.plans[i]);
+    for (i = 0; i < (int)st.njobs; i++) {
+        free(st.jobs[i].peak_hz);
+        free(st.jobs[i].peak_db);
+    }
+    free(st.jobs);
+    return ret;
+}
@@ -0,0 +1,518 @@
+/*
+ * wspr_wav.c - WAV/原始录音的mmap读取、SIMD样本转换与档案预取，见wspr_wav.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "wspr_wav.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define WAV_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define WAV_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define WAV_NEON 1
+#endif
+
+#define WAV_FORMAT_PCM 1
+#define WAV_FORMAT_FLOAT 3
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+
+#define S16_SCALE (1.0f / 32768.0f)
+// IQ只取I时，Q写入的栈上暂存区长度（帧）
+#define DISCARD_FRAMES 256
+#define PAGE_STRIDE 4096
+
+static void set_err(char *err, size_t size, const char *msg) {
+    if (err && size) snprintf(err, size, "%s", msg);
+}
+
+static uint32_t rd16(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t rd32(const uint8_t *p) {
+    return rd16(p) | (rd16(p + 2) << 16);
+}
+
+static uint64_t rd64(const uint8_t *p) {
+    return rd32(p) | ((uint64_t)rd32(p + 4) << 32);
+}
+
+static size_t frame_bytes(const wspr_wav_t *w) {
+    return (size_t)w->channels * (w->format == WSPR_WAV_S16 ? 2 : 4);
+}
+
+// 只读映射整个文件。populate非0时在映射时就把全部页读入（预取线程使用）
+static int map_file(const char *path, int populate, wspr_wav_t *w, char *err, size_t err_size) {
+    struct stat st;
+    void *map;
+    int flags = MAP_PRIVATE;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        if (fd >= 0) close(fd);
+        set_err(err, err_size, "无法读取文件");
+        return -1;
+    }
+    if ((uint64_t)st.st_size > (uint64_t)SIZE_MAX) {
+        close(fd);
+        set_err(err, err_size, "文件超出地址空间");
+        return -1;
+    }
+#ifdef MAP_POPULATE
+    if (populate) flags |= MAP_POPULATE;
+#endif
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        set_err(err, err_size, "mmap失败");
+        return -1;
+    }
+    memset(w, 0, sizeof(*w));
+    w->map = map;
+    w->map_len = (size_t)st.st_size;
+#ifndef MAP_POPULATE
+    if (populate) {
+        // 逐页读一个字节，把文件调入页缓存
+        volatile uint8_t sink = 0;
+        size_t off;
+        for (off = 0; off < w->map_len; off += PAGE_STRIDE) sink ^= ((const uint8_t *)map)[off];
+        (void)sink;
+    }
+#endif
+    // 解码和分析都是顺序扫描，让内核加大预读
+    madvise(map, w->map_len, MADV_SEQUENTIAL);
+    return 0;
+}
+
+void wspr_wav_close(wspr_wav_t *w) {
+    if (w->map) munmap(w->map, w->map_len);
+    memset(w, 0, sizeof(*w));
+}
+
+static int parse_wav(wspr_wav_t *w, char *err, size_t err_size) {
+    const uint8_t *p = (const uint8_t *)w->map;
+    uint64_t len = w->map_len, pos = 12;
+    uint64_t data_off = 0, data_size = 0, ds64_data = 0;
+    uint32_t tag = 0, channels = 0, rate = 0, bits = 0;
+    int rf64, have_fmt = 0, have_data = 0;
+
+    if (len < 12 || memcmp(p + 8, "WAVE", 4) != 0) {
+        set_err(err, err_size, "不是WAV文件");
+        return -1;
+    }
+    rf64 = memcmp(p, "RF64", 4) == 0;
+    if (!rf64 && memcmp(p, "RIFF", 4) != 0) {
+        set_err(err, err_size, "不是WAV文件");
+        return -1;
+    }
+
+    while (pos + 8 <= len && !have_data) {
+        const uint8_t *id = p + pos;
+        uint64_t size = rd32(p + pos + 4);
+        uint64_t body = pos + 8;
+
+        if (memcmp(id, "ds64", 4) == 0 && size >= 24 && body + 24 <= len) {
+            ds64_data = rd64(p + body + 8);
+        } else if (memcmp(id, "fmt ", 4) == 0 && size >= 16 && body + 16 <= len) {
+            tag = rd16(p + body);
+            channels = rd16(p + body + 2);
+            rate = rd32(p + body + 4);
+            bits = rd16(p + body + 14);
+            // WAVE_FORMAT_EXTENSIBLE：子格式GUID的前两个字节即格式码
+            if (tag == WAV_FORMAT_EXTENSIBLE && size >= 40 && body + 40 <= len) tag = rd16(p + body + 24);
+            have_fmt = 1;
+        } else if (memcmp(id, "data", 4) == 0) {
+            data_off = body;
+            data_size = (rf64 && size == 0xFFFFFFFFu) ? ds64_data : size;
+            have_data = 1;
+            break;
+        }
+        pos = body + size + (size & 1);
+    }
+
+    if (!have_fmt || !have_data) {
+        set_err(err, err_size, "缺少fmt或data块");
+        return -1;
+    }
+    if (tag == WAV_FORMAT_PCM && bits == 16) {
+        w->format = WSPR_WAV_S16;
+    } else if (tag == WAV_FORMAT_FLOAT && bits == 32) {
+        w->format = WSPR_WAV_F32;
+    } else {
+        set_err(err, err_size, "只支持16位整数或32位浮点样本");
+        return -1;
+    }
+    if (channels != 1 && channels != 2) {
+        set_err(err, err_size, "只支持1声道或2声道（IQ）");
+        return -1;
+    }
+    // 录音中断时data块长度常常未回填，以文件实际长度为准
+    if (data_off > len) data_off = len;
+    if (data_size > len - data_off) data_size = len - data_off;
+
+    w->channels = (uint8_t)channels;
+    w->rate = rate;
+    w->data = p + data_off;
+    w->frames = data_size / frame_bytes(w);
+    return 0;
+}
+
+static int open_any(const char *path, const wspr_wav_raw_t *raw, int populate, wspr_wav_t *w, char *err,
+                    size_t err_size) {
+    if (raw && (raw->channels < 1 || raw->channels > 2)) {
+        set_err(err, err_size, "只支持1声道或2声道（IQ）");
+        return -1;
+    }
+    if (map_file(path, populate, w, err, err_size) != 0) return -1;
+    if (!raw) {
+        if (parse_wav(w, err, err_size) != 0) {
+            wspr_wav_close(w);
+            return -1;
+        }
+        return 0;
+    }
+    w->format = raw->format;
+    w->channels = raw->channels;
+    w->rate = raw->rate;
+    w->data = (const uint8_t *)w->map + (raw->offset < w->map_len ? raw->offset : w->map_len);
+    w->frames = (w->map_len - (size_t)(w->data - (const uint8_t *)w->map)) / frame_bytes(w);
+    return 0;
+}
+
+int wspr_wav_open(const char *path, wspr_wav_t *w, char *err, size_t err_size) {
+    return open_any(path, NULL, 0, w, err, err_size);
+}
+
+int wspr_wav_open_raw(const char *path, const wspr_wav_raw_t *raw, wspr_wav_t *w, char *err, size_t err_size) {
+    return open_any(path, raw, 0, w, err, err_size);
+}
+
+// ---------------------------------------------------------------- 样本转换
+
+const char *wspr_wav_simd(void) {
+#if defined(WAV_AVX2)
+    return "avx2";
+#elif defined(WAV_SSE2)
+    return "sse2";
+#elif defined(WAV_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+// 源数据在映射中可能只按2字节对齐（如fmt块长度为18时），标量路径用memcpy取浮点
+static float load_f32(const uint8_t *p) {
+    float v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static void cvt_s16(const int16_t *src, float *dst, size_t n) {
+    size_t k = 0;
+#if defined(WAV_AVX2)
+    const __m256 scale = _mm256_set1_ps(S16_SCALE);
+    for (; k + 16 <= n; k += 16) {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + k)));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(src + k + 8)));
+        _mm256_storeu_ps(dst + k, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+        _mm256_storeu_ps(dst + k + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+    }
+#elif defined(WAV_SSE2)
+    const __m128 scale = _mm_set1_ps(S16_SCALE);
+    for (; k + 8 <= n; k += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + k));
+        // 16位样本放到32位的高半部，再算术右移完成符号扩展
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(dst + k, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + k + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#elif defined(WAV_NEON)
+    for (; k + 8 <= n; k += 8) {
+        int16x8_t x = vld1q_s16(src + k);
+        vst1q_f32(dst + k, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), S16_SCALE));
+        vst1q_f32(dst + k + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), S16_SCALE));
+    }
+#endif
+    for (; k < n; k++) dst[k] = (float)src[k] * S16_SCALE;
+}
+
+// 交错的I/Q样本拆成两个平面
+static void cvt_s16_iq(const int16_t *src, float *i, float *q, size_t n) {
+    size_t k = 0;
+#if defined(WAV_AVX2)
+    const __m256 scale = _mm256_set1_ps(S16_SCALE);
+    for (; k + 8 <= n; k += 8) {
+        // 每个32位元素是一帧：低16位为I，高16位为Q
+        __m256i x = _mm256_loadu_si256((const __m256i *)(src + 2 * k));
+        __m256i vi = _mm256_srai_epi32(_mm256_slli_epi32(x, 16), 16);
+        __m256i vq = _mm256_srai_epi32(x, 16);
+        _mm256_storeu_ps(i + k, _mm256_mul_ps(_mm256_cvtepi32_ps(vi), scale));
+        _mm256_storeu_ps(q + k, _mm256_mul_ps(_mm256_cvtepi32_ps(vq), scale));
+    }
+#elif defined(WAV_SSE2)
+    const __m128 scale = _mm_set1_ps(S16_SCALE);
+    for (; k + 4 <= n; k += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + 2 * k));
+        __m128i vi = _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+        __m128i vq = _mm_srai_epi32(x, 16);
+        _mm_storeu_ps(i + k, _mm_mul_ps(_mm_cvtepi32_ps(vi), scale));
+        _mm_storeu_ps(q + k, _mm_mul_ps(_mm_cvtepi32_ps(vq), scale));
+    }
+#elif defined(WAV_NEON)
+    for (; k + 8 <= n; k += 8) {
+        int16x8x2_t x = vld2q_s16(src + 2 * k);
+        vst1q_f32(i + k, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x.val[0]))), S16_SCALE));
+        vst1q_f32(i + k + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x.val[0]))), S16_SCALE));
+        vst1q_f32(q + k, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x.val[1]))), S16_SCALE));
+        vst1q_f32(q + k + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x.val[1]))), S16_SCALE));
+    }
+#endif
+    for (; k < n; k++) {
+        i[k] = (float)src[2 * k] * S16_SCALE;
+        q[k] = (float)src[2 * k + 1] * S16_SCALE;
+    }
+}
+
+static void cvt_f32_iq(const uint8_t *src, float *i, float *q, size_t n) {
+    size_t k = 0;
+#if defined(WAV_AVX2)
+    for (; k + 8 <= n; k += 8) {
+        __m256 a = _mm256_loadu_ps((const float *)(const void *)(src + 8 * k));
+        __m256 b = _mm256_loadu_ps((const float *)(const void *)(src + 8 * k + 32));
+        // 每个128位通道内取偶/奇元素，再按64位重排回帧顺序
+        __m256 vi = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 vq = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm256_storeu_ps(i + k, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(vi), _MM_SHUFFLE(3, 1, 2, 0))));
+        _mm256_storeu_ps(q + k, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(vq), _MM_SHUFFLE(3, 1, 2, 0))));
+    }
+#elif defined(WAV_SSE2)
+    for (; k + 4 <= n; k += 4) {
+        __m128 a = _mm_loadu_ps((const float *)(const void *)(src + 8 * k));
+        __m128 b = _mm_loadu_ps((const float *)(const void *)(src + 8 * k + 16));
+        _mm_storeu_ps(i + k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(q + k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+#elif defined(WAV_NEON)
+    if (((uintptr_t)src & 3) == 0) {
+        for (; k + 4 <= n; k += 4) {
+            float32x4x2_t x = vld2q_f32((const float *)(const void *)(src + 8 * k));
+            vst1q_f32(i + k, x.val[0]);
+            vst1q_f32(q + k, x.val[1]);
+        }
+    }
+#endif
+    for (; k < n; k++) {
+        i[k] = load_f32(src + 8 * k);
+        q[k] = load_f32(src + 8 * k + 4);
+    }
+}
+
+size_t wspr_wav_read(const wspr_wav_t *w, uint64_t first, size_t n, float *i, float *q) {
+    const uint8_t *src;
+
+    if (first >= w->frames) return 0;
+    if (n > w->frames - first) n = (size_t)(w->frames - first);
+    src = w->data + first * frame_bytes(w);
+
+    if (w->channels == 1) {
+        if (w->format == WSPR_WAV_S16) {
+            if (((uintptr_t)src & 1) == 0) {
+                cvt_s16((const int16_t *)(const void *)src, i, n);
+            } else {
+                size_t k;
+                for (k = 0; k < n; k++) i[k] = (float)(int16_t)rd16(src + 2 * k) * S16_SCALE;
+            }
+        } else {
+            // 已是float，直接拷贝
+            memcpy(i, src, n * sizeof(float));
+        }
+        return n;
+    }
+
+    if (!q) {
+        // 只要I：Q写进栈上暂存区后丢弃
+        float discard[DISCARD_FRAMES];
+        size_t done = 0;
+        while (done < n) {
+            size_t m = (n - done < DISCARD_FRAMES) ? n - done : DISCARD_FRAMES;
+            wspr_wav_read(w, first + done, m, i + done, discard);
+            done += m;
+        }
+        return n;
+    }
+    if (w->format == WSPR_WAV_S16 && ((uintptr_t)src & 1) == 0) {
+        cvt_s16_iq((const int16_t *)(const void *)src, i, q, n);
+    } else if (w->format == WSPR_WAV_S16) {
+        size_t k;
+        for (k = 0; k < n; k++) {
+            i[k] = (float)(int16_t)rd16(src + 4 * k) * S16_SCALE;
+            q[k] = (float)(int16_t)rd16(src + 4 * k + 2) * S16_SCALE;
+        }
+    } else {
+        cvt_f32_iq(src, i, q, n);
+    }
+    return n;
+}
+
+size_t wspr_wav_read_buf(const wspr_wav_t *w, uint64_t first, wspr_rx_buf_t *b) {
+    b->n = wspr_wav_read(w, first, b->cap, b->i, w->channels == 2 ? b->q : NULL);
+    return b->n;
+}
+
+int wspr_rx_buf_alloc(wspr_rx_buf_t *b, size_t frames, int iq) {
+    size_t cap = (frames + 15) & ~(size_t)15;
+
+    memset(b, 0, sizeof(*b));
+    if (cap == 0) cap = 16;
+    if (posix_memalign((void **)&b->i, 64, cap * sizeof(float)) != 0) {
+        b->i = NULL;
+        return -1;
+    }
+    if (iq && posix_memalign((void **)&b->q, 64, cap * sizeof(float)) != 0) {
+        free(b->i);
+        b->i = NULL;
+        b->q = NULL;
+        return -1;
+    }
+    b->cap = cap;
+    return 0;
+}
+
+void wspr_rx_buf_free(wspr_rx_buf_t *b) {
+    free(b->i);
+    free(b->q);
+    memset(b, 0, sizeof(*b));
+}
+
+// ---------------------------------------------------------------- 录音档案
+
+#define SLOT_EMPTY ((size_t)-1)
+
+struct wspr_wav_archive_s {
+    const char *const *paths;
+    size_t count;
+    wspr_wav_raw_t raw;
+    int is_raw;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int stop;
+    size_t next;  // 下一个交给调用者的序号
+    size_t want;  // 请预取线程打开的序号
+    // 预取槽：slot_index为SLOT_EMPTY表示空
+    size_t slot_index;
+    int slot_ret;
+    wspr_wav_t slot;
+    char slot_err[128];
+};
+
+// 预取线程：每次只提前打开一个文件，用MAP_POPULATE（或逐页读）把它调入内存
+static void *prefetch_main(void *arg) {
+    wspr_wav_archive_t *a = (wspr_wav_archive_t *)arg;
+
+    pthread_mutex_lock(&a->lock);
+    for (;;) {
+        size_t index;
+        wspr_wav_t w;
+        char err[128];
+        int ret;
+
+        while (!a->stop && (a->want >= a->count || a->slot_index != SLOT_EMPTY)) {
+            pthread_cond_wait(&a->cond, &a->lock);
+        }
+        if (a->stop) break;
+        index = a->want;
+        pthread_mutex_unlock(&a->lock);
+
+        err[0] = 0;
+        memset(&w, 0, sizeof(w));
+        ret = open_any(a->paths[index], a->is_raw ? &a->raw : NULL, 1, &w, err, sizeof(err));
+
+        pthread_mutex_lock(&a->lock);
+        a->slot = w;
+        a->slot_ret = ret;
+        memcpy(a->slot_err, err, sizeof(err));
+        a->slot_index = index;
+        a->want = a->count; // 下一次请求由wspr_wav_archive_next()发出
+        pthread_cond_broadcast(&a->cond);
+    }
+    pthread_mutex_unlock(&a->lock);
+    return NULL;
+}
+
+wspr_wav_archive_t *wspr_wav_archive_open(const char *const *paths, size_t count, const wspr_wav_raw_t *raw) {
+    wspr_wav_archive_t *a = (wspr_wav_archive_t *)calloc(1, sizeof(*a));
+
+    if (!a) return NULL;
+    a->paths = paths;
+    a->count = count;
+    if (raw) {
+        a->raw = *raw;
+        a->is_raw = 1;
+    }
+    a->slot_index = SLOT_EMPTY;
+    // 立即开始预取第一个文件
+    a->want = 0;
+    pthread_mutex_init(&a->lock, NULL);
+    pthread_cond_init(&a->cond, NULL);
+    if (pthread_create(&a->thread, NULL, prefetch_main, a) != 0) {
+        pthread_mutex_destroy(&a->lock);
+        pthread_cond_destroy(&a->cond);
+        free(a);
+        return NULL;
+    }
+    return a;
+}
+
+int wspr_wav_archive_next(wspr_wav_archive_t *a, wspr_wav_t *w, size_t *index, char *err, size_t err_size) {
+    int ret;
+
+    pthread_mutex_lock(&a->lock);
+    if (a->next >= a->count) {
+        pthread_mutex_unlock(&a->lock);
+        return 0;
+    }
+    while (a->slot_index != a->next) {
+        pthread_cond_wait(&a->cond, &a->lock);
+    }
+    *w = a->slot;
+    ret = a->slot_ret;
+    set_err(err, err_size, a->slot_err);
+    if (index) *index = a->next;
+    a->slot_index = SLOT_EMPTY;
+    a->next++;
+    // 调用者处理这个文件的同时，预取下一个
+    a->want = a->next;
+    pthread_cond_broadcast(&a->cond);
+    pthread_mutex_unlock(&a->lock);
+    return ret == 0 ? 1 : -1;
+}
+
+void wspr_wav_archive_close(wspr_wav_archive_t *a) {
+    if (!a) return;
+    pthread_mutex_lock(&a->lock);
+    a->stop = 1;
+    pthread_cond_broadcast(&a->cond);
+    pthread_mutex_unlock(&a->lock);
+    pthread_join(a->thread, NULL);
+    // 已预取但未取走的文件
+    if (a->slot_index != SLOT_EMPTY && a->slot_ret == 0) wspr_wav_close(&a->slot);
+    pthread_mutex_destroy(&a->lock);
+    pthread_cond_destroy(&a->cond);
+    free(a);
+}
@@ -0,0 +1,84 @@
+#ifndef WSPR_WAV_H
+#define WSPR_WAV_H
+
+/*
+ * wspr_wav.h - 录音文件的零拷贝读取：WAV（含WAVE_FORMAT_EXTENSIBLE与RF64）和原始采集文件
+ *
+ * 文件整个只读mmap，样本不经堆上的中间缓冲区：wspr_wav_read()直接从映射中
+ * 取一段帧，用SIMD（x86 SSE2/AVX2、ARM NEON，否则标量）转换成±1满幅的float，
+ * IQ录音同时拆成I、Q两个平面，写入调用者的对齐工作缓冲区（wspr_rx_buf_t）。
+ *
+ * 支持的样本：16位有符号整数、32位IEEE浮点；1声道（实信号）或2声道（IQ，I在前）。
+ * 原始文件没有文件头，格式、声道数和采样率由调用者给出。
+ *
+ * 大量录音按顺序处理时用wspr_wav_archive_t：后台线程提前打开并映射下一个文件，
+ * 按页读一遍把它调入页缓存，当前文件处理完时下一个已在内存中。
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum { WSPR_WAV_S16 = 0, WSPR_WAV_F32 = 1 } wspr_wav_format_t;
+
+typedef struct {
+    const uint8_t *data;       // 第一帧
+    uint64_t frames;           // 帧数（每帧channels个样本）
+    uint32_t rate;             // 采样率（Hz）
+    uint8_t channels;          // 1：实信号；2：IQ
+    wspr_wav_format_t format;
+    // 映射
+    void *map;
+    size_t map_len;
+} wspr_wav_t;
+
+// 原始采集文件的描述；offset为跳过的文件头字节数
+typedef struct {
+    wspr_wav_format_t format;
+    uint8_t channels;
+    uint32_t rate;
+    size_t offset;
+} wspr_wav_raw_t;
+
+// 对齐的工作缓冲区：i、q各cap帧，64字节对齐，长度向上补齐到16的倍数
+typedef struct {
+    float *i;
+    float *q;     // 只分配给IQ
+    size_t cap;
+    size_t n;     // 当前有效帧数
+} wspr_rx_buf_t;
+
+// 映射WAV文件。失败返回-1，并在err（可为NULL）中写入原因
+int wspr_wav_open(const char *path, wspr_wav_t *w, char *err, size_t err_size);
+// 映射原始采集文件，末尾不足一帧的字节被忽略
+int wspr_wav_open_raw(const char *path, const wspr_wav_raw_t *raw, wspr_wav_t *w, char *err, size_t err_size);
+void wspr_wav_close(wspr_wav_t *w);
+
+// 把帧[first, first+n)转换为float写入i（和q）。实信号录音q可为NULL；
+// IQ录音q为NULL时只取I。返回实际帧数（到文件末尾为止）
+size_t wspr_wav_read(const wspr_wav_t *w, uint64_t first, size_t n, float *i, float *q);
+// 读入b，最多b->cap帧，更新b->n并返回
+size_t wspr_wav_read_buf(const wspr_wav_t *w, uint64_t first, wspr_rx_buf_t *b);
+
+// iq为非0时同时分配q平面，成功返回0
+int wspr_rx_buf_alloc(wspr_rx_buf_t *b, size_t frames, int iq);
+void wspr_rx_buf_free(wspr_rx_buf_t *b);
+
+// 本次构建使用的转换实现（"avx2"、"sse2"、"neon"或"scalar"）
+const char *wspr_wav_simd(void);
+
+// ---------------------------------------------------------------- 录音档案
+
+typedef struct wspr_wav_archive_s wspr_wav_archive_t;
+
+// 依次读取paths中的count个文件；raw为NULL时按WAV解析。paths须在关闭前保持有效。
+// 失败返回NULL
+wspr_wav_archive_t *wspr_wav_archive_open(const char *const *paths, size_t count, const wspr_wav_raw_t *raw);
+/*
+ * 取下一个文件：1表示w已映射（用完后照常wspr_wav_close()），0表示已无文件，
+ * -1表示该文件无法读取（err中为原因，*index仍有效，可继续调用取后面的文件）。
+ * index可为NULL，返回文件在paths中的序号。
+ */
+int wspr_wav_archive_next(wspr_wav_archive_t *a, wspr_wav_t *w, size_t *index, char *err, size_t err_size);
+void wspr_wav_archive_close(wspr_wav_archive_t *a);
+
+#endif
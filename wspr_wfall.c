@@ -0,0 +1,624 @@
+/*
+ * wspr_wfall.c - 流式瀑布图引擎：加窗重叠FFT、SIMD功率/对数/像素映射与PGM/二进制输出，见wspr_wfall.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "wspr_wfall.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define WFALL_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define WFALL_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define WFALL_NEON 1
+#endif
+
+#define WFALL_PI 3.14159265358979323846
+// 功率下限，避免对0取对数（-300dB）
+#define POWER_EPS 1e-30f
+// 10·log10(2)与2/ln(2)
+#define DB_PER_LOG2 3.01029995663981195f
+#define TWO_OVER_LN2 2.88539008177792681f
+#define BIN_HEADER_BYTES 64
+
+static void set_err(char *err, size_t size, const char *msg) {
+    if (err && size) snprintf(err, size, "%s", msg);
+}
+
+static void *alloc_floats(size_t n) {
+    void *p;
+    if (posix_memalign(&p, 64, (n + 16) * sizeof(float)) != 0) return NULL;
+    return p;
+}
+
+// ---------------------------------------------------------------- 计划
+
+static double window_at(wspr_wfall_window_t win, uint32_t k, uint32_t n) {
+    double x = 2.0 * WFALL_PI * k / n; // 周期窗，重叠相加时平坦
+    switch (win) {
+    case WSPR_WFALL_HANN:
+        return 0.5 - 0.5 * cos(x);
+    case WSPR_WFALL_BLACKMAN_HARRIS:
+        return 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2 * x) - 0.01168 * cos(3 * x);
+    default:
+        return 1.0;
+    }
+}
+
+int wspr_wfall_plan(wspr_wfall_plan_t *p, const wspr_wfall_config_t *cfg, char *err, size_t err_size) {
+    uint32_t n = cfg->nfft, m, h, j, k, bits = 0;
+    int32_t lo, hi, min_bin, max_bin;
+    double wsum = 0;
+
+    memset(p, 0, sizeof(*p));
+    if (n < WSPR_WFALL_MIN_FFT || n > WSPR_WFALL_MAX_FFT || (n & (n - 1)) != 0) {
+        set_err(err, err_size, "nfft须为16~1048576之间的2的幂");
+        return -1;
+    }
+    if (cfg->hop < 1 || cfg->hop > n || cfg->rate == 0) {
+        set_err(err, err_size, "hop须在1~nfft之间，采样率不能为0");
+        return -1;
+    }
+    if (!(cfg->db_range > 0)) {
+        set_err(err, err_size, "显示范围须大于0dB");
+        return -1;
+    }
+    p->cfg = *cfg;
+    p->m = m = cfg->iq ? n : n / 2;
+    p->bin_hz = (double)cfg->rate / n;
+
+    // 显示频段：实信号的频点0~n/2，IQ的频点-n/2~n/2-1
+    min_bin = cfg->iq ? -(int32_t)(n / 2) : 0;
+    max_bin = cfg->iq ? (int32_t)(n / 2) - 1 : (int32_t)(n / 2);
+    lo = min_bin;
+    hi = max_bin;
+    if (cfg->f_hi != cfg->f_lo) {
+        double a = cfg->f_lo < cfg->f_hi ? cfg->f_lo : cfg->f_hi;
+        double b = cfg->f_lo < cfg->f_hi ? cfg->f_hi : cfg->f_lo;
+        if (a / p->bin_hz > min_bin) lo = (int32_t)ceil(a / p->bin_hz - 1e-9);
+        if (b / p->bin_hz < max_bin) hi = (int32_t)floor(b / p->bin_hz + 1e-9);
+    }
+    if (hi < lo) {
+        set_err(err, err_size, "显示频段内没有频点");
+        return -1;
+    }
+    p->bin_lo = lo;
+    p->width = (uint32_t)(hi - lo + 1);
+
+    p->window = (float *)alloc_floats(n);
+    p->tw_re = (float *)alloc_floats(m);
+    p->tw_im = (float *)alloc_floats(m);
+    p->rev = (uint32_t *)malloc(m * sizeof(uint32_t));
+    if (!cfg->iq) {
+        p->split_re = (float *)alloc_floats(p->width);
+        p->split_im = (float *)alloc_floats(p->width);
+    }
+    if (!p->window || !p->tw_re || !p->tw_im || !p->rev || (!cfg->iq && (!p->split_re || !p->split_im))) {
+        wspr_wfall_plan_free(p);
+        set_err(err, err_size, "内存不足");
+        return -1;
+    }
+
+    for (k = 0; k < n; k++) {
+        double w = window_at(cfg->window, k, n);
+        p->window[k] = (float)w;
+        wsum += w;
+    }
+    // 满幅实正弦在频点中心的幅度为窗和/2，满幅复指数为窗和
+    p->db_offset = (float)(-20.0 * log10(cfg->iq ? wsum : wsum / 2.0));
+
+    p->tw_re[0] = 1.0f;
+    p->tw_im[0] = 0.0f;
+    for (h = 1; h < m; h <<= 1) {
+        for (j = 0; j < h; j++) {
+            double a = -WFALL_PI * j / h;
+            p->tw_re[h + j] = (float)cos(a);
+            p->tw_im[h + j] = (float)sin(a);
+        }
+    }
+    while ((1u << bits) < m) bits++;
+    for (k = 0; k < m; k++) {
+        uint32_t r = 0, x = k;
+        for (j = 0; j < bits; j++) {
+            r = (r << 1) | (x & 1);
+            x >>= 1;
+        }
+        p->rev[k] = r;
+    }
+    if (!cfg->iq) {
+        for (k = 0; k < p->width; k++) {
+            double a = -2.0 * WFALL_PI * (double)(lo + (int32_t)k) / n;
+            p->split_re[k] = (float)cos(a);
+            p->split_im[k] = (float)sin(a);
+        }
+    }
+    return 0;
+}
+
+void wspr_wfall_plan_free(wspr_wfall_plan_t *p) {
+    free(p->window);
+    free(p->tw_re);
+    free(p->tw_im);
+    free(p->rev);
+    free(p->split_re);
+    free(p->split_im);
+    memset(p, 0, sizeof(*p));
+}
+
+double wspr_wfall_column_hz(const wspr_wfall_plan_t *p, uint32_t col) {
+    return (p->bin_lo + (int32_t)col) * p->bin_hz;
+}
+
+uint64_t wspr_wfall_rows_for(const wspr_wfall_plan_t *p, uint64_t frames) {
+    if (frames < p->cfg.nfft) return 0;
+    return (frames - p->cfg.nfft) / p->cfg.hop + 1;
+}
+
+// ---------------------------------------------------------------- FFT
+
+/*
+ * 输入按自然顺序加窗后做基2频率抽取FFT，输出为比特反转顺序，频点k在rev[k]处。
+ * 只有显示频段内的频点被读出，因此不需要对整个数组做比特反转重排。
+ * 蝶形与加窗循环显式向量化：数据与窗、旋转因子在不同数组中，-O2下编译器
+ * 不会为此生成运行时别名检查
+ */
+
+// 一组h个蝶形：(a, b) -> (a + b, (a - b)·w)
+static void butterflies(float *ar, float *ai, float *br, float *bi, const float *wr, const float *wi, uint32_t h) {
+    uint32_t j = 0;
+#if defined(WFALL_AVX2)
+    for (; j + 8 <= h; j += 8) {
+        __m256 xr = _mm256_loadu_ps(ar + j), xi = _mm256_loadu_ps(ai + j);
+        __m256 yr = _mm256_loadu_ps(br + j), yi = _mm256_loadu_ps(bi + j);
+        __m256 cr = _mm256_loadu_ps(wr + j), ci = _mm256_loadu_ps(wi + j);
+        __m256 dr = _mm256_sub_ps(xr, yr), di = _mm256_sub_ps(xi, yi);
+        _mm256_storeu_ps(ar + j, _mm256_add_ps(xr, yr));
+        _mm256_storeu_ps(ai + j, _mm256_add_ps(xi, yi));
+        _mm256_storeu_ps(br + j, _mm256_sub_ps(_mm256_mul_ps(dr, cr), _mm256_mul_ps(di, ci)));
+        _mm256_storeu_ps(bi + j, _mm256_add_ps(_mm256_mul_ps(dr, ci), _mm256_mul_ps(di, cr)));
+    }
+#endif
+#if defined(WFALL_AVX2) || defined(WFALL_SSE2)
+    for (; j + 4 <= h; j += 4) {
+        __m128 xr = _mm_loadu_ps(ar + j), xi = _mm_loadu_ps(ai + j);
+        __m128 yr = _mm_loadu_ps(br + j), yi = _mm_loadu_ps(bi + j);
+        __m128 cr = _mm_loadu_ps(wr + j), ci = _mm_loadu_ps(wi + j);
+        __m128 dr = _mm_sub_ps(xr, yr), di = _mm_sub_ps(xi, yi);
+        _mm_storeu_ps(ar + j, _mm_add_ps(xr, yr));
+        _mm_storeu_ps(ai + j, _mm_add_ps(xi, yi));
+        _mm_storeu_ps(br + j, _mm_sub_ps(_mm_mul_ps(dr, cr), _mm_mul_ps(di, ci)));
+        _mm_storeu_ps(bi + j, _mm_add_ps(_mm_mul_ps(dr, ci), _mm_mul_ps(di, cr)));
+    }
+#elif defined(WFALL_NEON)
+    for (; j + 4 <= h; j += 4) {
+        float32x4_t xr = vld1q_f32(ar + j), xi = vld1q_f32(ai + j);
+        float32x4_t yr = vld1q_f32(br + j), yi = vld1q_f32(bi + j);
+        float32x4_t cr = vld1q_f32(wr + j), ci = vld1q_f32(wi + j);
+        float32x4_t dr = vsubq_f32(xr, yr), di = vsubq_f32(xi, yi);
+        vst1q_f32(ar + j, vaddq_f32(xr, yr));
+        vst1q_f32(ai + j, vaddq_f32(xi, yi));
+        vst1q_f32(br + j, vmlsq_f32(vmulq_f32(dr, cr), di, ci));
+        vst1q_f32(bi + j, vmlaq_f32(vmulq_f32(dr, ci), di, cr));
+    }
+#endif
+    for (; j < h; j++) {
+        float dr = ar[j] - br[j], di = ai[j] - bi[j];
+        ar[j] += br[j];
+        ai[j] += bi[j];
+        br[j] = dr * wr[j] - di * wi[j];
+        bi[j] = dr * wi[j] + di * wr[j];
+    }
+}
+
+// 最后两级旋转因子为1和-i，合并成一个无乘法的基4循环
+static void fft_core(const wspr_wfall_plan_t *p, float *re, float *im) {
+    uint32_t m = p->m, h, i;
+
+    for (h = m / 2; h >= 4; h >>= 1) {
+        for (i = 0; i < m; i += 2 * h) butterflies(re + i, im + i, re + i + h, im + i + h, p->tw_re + h, p->tw_im + h, h);
+    }
+    for (i = 0; i + 4 <= m; i += 4) {
+        float ar = re[i] + re[i + 2], ai = im[i] + im[i + 2];
+        float br = re[i + 1] + re[i + 3], bi = im[i + 1] + im[i + 3];
+        float cr = re[i] - re[i + 2], ci = im[i] - im[i + 2];
+        // (x1 - x3)·(-i)
+        float dr = im[i + 1] - im[i + 3], di = re[i + 3] - re[i + 1];
+        re[i] = ar + br;
+        im[i] = ai + bi;
+        re[i + 1] = ar - br;
+        im[i + 1] = ai - bi;
+        re[i + 2] = cr + dr;
+        im[i + 2] = ci + di;
+        re[i + 3] = cr - dr;
+        im[i + 3] = ci - di;
+    }
+}
+
+// 实信号加窗，偶、奇样本分别写入re、im（m点复数序列）
+static void window_split(const float *x, const float *w, float *re, float *im, uint32_t m) {
+    uint32_t k = 0;
+#if defined(WFALL_AVX2)
+    for (; k + 8 <= m; k += 8) {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(x + 2 * k), _mm256_loadu_ps(w + 2 * k));
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(x + 2 * k + 8), _mm256_loadu_ps(w + 2 * k + 8));
+        // 每个128位通道内取偶/奇元素，再按64位重排回原顺序
+        __m256 e = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 o = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm256_storeu_ps(re + k, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(e), _MM_SHUFFLE(3, 1, 2, 0))));
+        _mm256_storeu_ps(im + k, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(o), _MM_SHUFFLE(3, 1, 2, 0))));
+    }
+#elif defined(WFALL_SSE2)
+    for (; k + 4 <= m; k += 4) {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(x + 2 * k), _mm_loadu_ps(w + 2 * k));
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(x + 2 * k + 4), _mm_loadu_ps(w + 2 * k + 4));
+        _mm_storeu_ps(re + k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(im + k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+#elif defined(WFALL_NEON)
+    for (; k + 4 <= m; k += 4) {
+        float32x4x2_t a = vld2q_f32(x + 2 * k), b = vld2q_f32(w + 2 * k);
+        vst1q_f32(re + k, vmulq_f32(a.val[0], b.val[0]));
+        vst1q_f32(im + k, vmulq_f32(a.val[1], b.val[1]));
+    }
+#endif
+    for (; k < m; k++) {
+        re[k] = x[2 * k] * w[2 * k];
+        im[k] = x[2 * k + 1] * w[2 * k + 1];
+    }
+}
+
+static void window_mul(const float *x, const float *w, float *dst, uint32_t n) {
+    uint32_t k = 0;
+#if defined(WFALL_AVX2)
+    for (; k + 8 <= n; k += 8) _mm256_storeu_ps(dst + k, _mm256_mul_ps(_mm256_loadu_ps(x + k), _mm256_loadu_ps(w + k)));
+#elif defined(WFALL_SSE2)
+    for (; k + 4 <= n; k += 4) _mm_storeu_ps(dst + k, _mm_mul_ps(_mm_loadu_ps(x + k), _mm_loadu_ps(w + k)));
+#elif defined(WFALL_NEON)
+    for (; k + 4 <= n; k += 4) vst1q_f32(dst + k, vmulq_f32(vld1q_f32(x + k), vld1q_f32(w + k)));
+#endif
+    for (; k < n; k++) dst[k] = x[k] * w[k];
+}
+
+// 实信号：偶、奇样本作为m点复数序列的实部、虚部，FFT后拆分出显示频段内的频点
+static void spectrum_real(wspr_wfall_t *s) {
+    const wspr_wfall_plan_t *p = s->plan;
+    uint32_t m = p->m, c;
+
+    window_split(s->in_i, p->window, s->re, s->im, m);
+    fft_core(p, s->re, s->im);
+    for (c = 0; c < p->width; c++) {
+        uint32_t b = (uint32_t)(p->bin_lo + (int32_t)c);
+        uint32_t k1 = p->rev[b & (m - 1)], k2 = p->rev[(m - b) & (m - 1)];
+        float zr = s->re[k1], zi = s->im[k1], yr = s->re[k2], yi = s->im[k2];
+        // E = (Z[k] + conj(Z[m-k]))/2，O = (Z[k] - conj(Z[m-k]))/(2i)，X = E + W^k·O
+        float er = 0.5f * (zr + yr), ei = 0.5f * (zi - yi);
+        float or_ = 0.5f * (zi + yi), oi = -0.5f * (zr - yr);
+        s->xr[c] = er + p->split_re[c] * or_ - p->split_im[c] * oi;
+        s->xi[c] = ei + p->split_re[c] * oi + p->split_im[c] * or_;
+    }
+}
+
+static void spectrum_iq(wspr_wfall_t *s) {
+    const wspr_wfall_plan_t *p = s->plan;
+    uint32_t m = p->m, c;
+
+    window_mul(s->in_i, p->window, s->re, m);
+    window_mul(s->in_q, p->window, s->im, m);
+    fft_core(p, s->re, s->im);
+    for (c = 0; c < p->width; c++) {
+        uint32_t b = p->rev[(uint32_t)(p->bin_lo + (int32_t)c) & (m - 1)];
+        s->xr[c] = s->re[b];
+        s->xi[c] = s->im[b];
+    }
+}
+
+// ---------------------------------------------------------------- 功率、对数与像素
+
+const char *wspr_wfall_simd(void) {
+#if defined(WFALL_AVX2)
+    return "avx2";
+#elif defined(WFALL_SSE2)
+    return "sse2";
+#elif defined(WFALL_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+/*
+ * log2(p)：p = 2^e·x，x∈[1,2)，t = (x-1)/(x+1)∈[0,1/3)，
+ * log2(x) = 2/ln2·(t + t³/3 + t⁵/5 + t⁷/7 + t⁹/9)，截断误差小于2e-6
+ */
+static float log2_approx(float p) {
+    uint32_t u;
+    float x, t, t2;
+    int32_t e;
+
+    memcpy(&u, &p, sizeof(u));
+    e = (int32_t)(u >> 23) - 127;
+    u = (u & 0x007FFFFFu) | 0x3F800000u;
+    memcpy(&x, &u, sizeof(x));
+    t = (x - 1.0f) / (x + 1.0f);
+    t2 = t * t;
+    return (float)e + TWO_OVER_LN2 * t * (1.0f + t2 * (1.0f / 3 + t2 * (1.0f / 5 + t2 * (1.0f / 7 + t2 * (1.0f / 9)))));
+}
+
+static void scale_row(const wspr_wfall_plan_t *p, const float *xr, const float *xi, float *db, uint8_t *pix) {
+    const float offset = p->db_offset, floor_db = p->cfg.db_floor, k255 = 255.0f / p->cfg.db_range;
+    size_t n = p->width, k = 0;
+
+#if defined(WFALL_AVX2)
+    const __m256 eps = _mm256_set1_ps(POWER_EPS), one = _mm256_set1_ps(1.0f);
+    const __m256i mant = _mm256_set1_epi32(0x007FFFFF), expo = _mm256_set1_epi32(0x3F800000);
+    for (; k + 8 <= n; k += 8) {
+        __m256 r = _mm256_loadu_ps(xr + k), i = _mm256_loadu_ps(xi + k);
+        __m256 pw = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r, r), _mm256_mul_ps(i, i)), eps);
+        __m256i u = _mm256_castps_si256(pw);
+        __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(u, 23), _mm256_set1_epi32(127)));
+        __m256 x = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(u, mant), expo));
+        __m256 t = _mm256_div_ps(_mm256_sub_ps(x, one), _mm256_add_ps(x, one));
+        __m256 t2 = _mm256_mul_ps(t, t);
+        __m256 poly = _mm256_add_ps(_mm256_set1_ps(1.0f / 7), _mm256_mul_ps(t2, _mm256_set1_ps(1.0f / 9)));
+        __m256 d, v;
+        __m128i lo, hi, w16;
+        poly = _mm256_add_ps(_mm256_set1_ps(1.0f / 5), _mm256_mul_ps(t2, poly));
+        poly = _mm256_add_ps(_mm256_set1_ps(1.0f / 3), _mm256_mul_ps(t2, poly));
+        poly = _mm256_add_ps(one, _mm256_mul_ps(t2, poly));
+        d = _mm256_add_ps(e, _mm256_mul_ps(_mm256_set1_ps(TWO_OVER_LN2), _mm256_mul_ps(t, poly)));
+        d = _mm256_add_ps(_mm256_mul_ps(d, _mm256_set1_ps(DB_PER_LOG2)), _mm256_set1_ps(offset));
+        _mm256_storeu_ps(db + k, d);
+        v = _mm256_mul_ps(_mm256_sub_ps(d, _mm256_set1_ps(floor_db)), _mm256_set1_ps(k255));
+        v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+        lo = _mm256_castsi256_si128(_mm256_cvttps_epi32(v));
+        hi = _mm256_extracti128_si256(_mm256_cvttps_epi32(v), 1);
+        w16 = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64((__m128i *)(void *)(pix + k), _mm_packus_epi16(w16, w16));
+    }
+#elif defined(WFALL_SSE2)
+    const __m128 eps = _mm_set1_ps(POWER_EPS), one = _mm_set1_ps(1.0f);
+    const __m128i mant = _mm_set1_epi32(0x007FFFFF), expo = _mm_set1_epi32(0x3F800000);
+    for (; k + 8 <= n; k += 8) {
+        __m128i q[2], w16;
+        int h;
+        for (h = 0; h < 2; h++) {
+            __m128 r = _mm_loadu_ps(xr + k + 4 * h), i = _mm_loadu_ps(xi + k + 4 * h);
+            __m128 pw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(i, i)), eps);
+            __m128i u = _mm_castps_si128(pw);
+            __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(u, 23), _mm_set1_epi32(127)));
+            __m128 x = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(u, mant), expo));
+            __m128 t = _mm_div_ps(_mm_sub_ps(x, one), _mm_add_ps(x, one));
+            __m128 t2 = _mm_mul_ps(t, t);
+            __m128 poly = _mm_add_ps(_mm_set1_ps(1.0f / 7), _mm_mul_ps(t2, _mm_set1_ps(1.0f / 9)));
+            __m128 d, v;
+            poly = _mm_add_ps(_mm_set1_ps(1.0f / 5), _mm_mul_ps(t2, poly));
+            poly = _mm_add_ps(_mm_set1_ps(1.0f / 3), _mm_mul_ps(t2, poly));
+            poly = _mm_add_ps(one, _mm_mul_ps(t2, poly));
+            d = _mm_add_ps(e, _mm_mul_ps(_mm_set1_ps(TWO_OVER_LN2), _mm_mul_ps(t, poly)));
+            d = _mm_add_ps(_mm_mul_ps(d, _mm_set1_ps(DB_PER_LOG2)), _mm_set1_ps(offset));
+            _mm_storeu_ps(db + k + 4 * h, d);
+            v = _mm_mul_ps(_mm_sub_ps(d, _mm_set1_ps(floor_db)), _mm_set1_ps(k255));
+            v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+            q[h] = _mm_cvttps_epi32(v);
+        }
+        w16 = _mm_packs_epi32(q[0], q[1]);
+        _mm_storel_epi64((__m128i *)(void *)(pix + k), _mm_packus_epi16(w16, w16));
+    }
+#elif defined(WFALL_NEON)
+    const float32x4_t eps = vdupq_n_f32(POWER_EPS), one = vdupq_n_f32(1.0f);
+    for (; k + 8 <= n; k += 8) {
+        uint32x4_t q[2];
+        int h;
+        for (h = 0; h < 2; h++) {
+            float32x4_t r = vld1q_f32(xr + k + 4 * h), i = vld1q_f32(xi + k + 4 * h);
+            float32x4_t pw = vaddq_f32(vmlaq_f32(vmulq_f32(r, r), i, i), eps);
+            uint32x4_t u = vreinterpretq_u32_f32(pw);
+            float32x4_t e = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(u, 23)), vdupq_n_s32(127)));
+            float32x4_t x = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(u, vdupq_n_u32(0x007FFFFF)), vdupq_n_u32(0x3F800000)));
+            float32x4_t num = vsubq_f32(x, one), den = vaddq_f32(x, one);
+            float32x4_t rcp = vrecpeq_f32(den), t, t2, poly, d, v;
+            // 两次牛顿迭代使倒数达到单精度
+            rcp = vmulq_f32(rcp, vrecpsq_f32(den, rcp));
+            rcp = vmulq_f32(rcp, vrecpsq_f32(den, rcp));
+            t = vmulq_f32(num, rcp);
+            t2 = vmulq_f32(t, t);
+            poly = vmlaq_f32(vdupq_n_f32(1.0f / 7), t2, vdupq_n_f32(1.0f / 9));
+            poly = vmlaq_f32(vdupq_n_f32(1.0f / 5), t2, poly);
+            poly = vmlaq_f32(vdupq_n_f32(1.0f / 3), t2, poly);
+            poly = vmlaq_f32(one, t2, poly);
+            d = vmlaq_f32(e, vdupq_n_f32(TWO_OVER_LN2), vmulq_f32(t, poly));
+            d = vmlaq_f32(vdupq_n_f32(offset), d, vdupq_n_f32(DB_PER_LOG2));
+            vst1q_f32(db + k + 4 * h, d);
+            v = vmulq_f32(vsubq_f32(d, vdupq_n_f32(floor_db)), vdupq_n_f32(k255));
+            v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(0.0f)), vdupq_n_f32(255.0f));
+            q[h] = vcvtq_u32_f32(v);
+        }
+        vst1_u8(pix + k, vmovn_u16(vcombine_u16(vmovn_u32(q[0]), vmovn_u32(q[1]))));
+    }
+#endif
+    for (; k < n; k++) {
+        float d = log2_approx(xr[k] * xr[k] + xi[k] * xi[k] + POWER_EPS) * DB_PER_LOG2 + offset;
+        float v = (d - floor_db) * k255;
+        db[k] = d;
+        pix[k] = (uint8_t)(v < 0 ? 0 : (v > 255.0f ? 255.0f : v));
+    }
+}
+
+// ---------------------------------------------------------------- 流
+
+int wspr_wfall_init(wspr_wfall_t *s, const wspr_wfall_plan_t *p) {
+    memset(s, 0, sizeof(*s));
+    s->plan = p;
+    s->in_i = (float *)alloc_floats(p->cfg.nfft);
+    s->in_q = p->cfg.iq ? (float *)alloc_floats(p->cfg.nfft) : NULL;
+    s->re = (float *)alloc_floats(p->m);
+    s->im = (float *)alloc_floats(p->m);
+    s->xr = (float *)alloc_floats(p->width);
+    s->xi = (float *)alloc_floats(p->width);
+    s->db = (float *)alloc_floats(p->width);
+    s->pix = (uint8_t *)malloc(p->width + 16);
+    if (!s->in_i || (p->cfg.iq && !s->in_q) || !s->re || !s->im || !s->xr || !s->xi || !s->db || !s->pix) {
+        wspr_wfall_free(s);
+        return -1;
+    }
+    return 0;
+}
+
+void wspr_wfall_free(wspr_wfall_t *s) {
+    free(s->in_i);
+    free(s->in_q);
+    free(s->re);
+    free(s->im);
+    free(s->xr);
+    free(s->xi);
+    free(s->db);
+    free(s->pix);
+    memset(s, 0, sizeof(*s));
+}
+
+void wspr_wfall_reset(wspr_wfall_t *s) {
+    s->fill = 0;
+    s->rows = 0;
+}
+
+size_t wspr_wfall_push(wspr_wfall_t *s, const float *i, const float *q, size_t n, wspr_wfall_emit_t emit, void *ctx) {
+    const wspr_wfall_plan_t *p = s->plan;
+    const size_t nfft = p->cfg.nfft, hop = p->cfg.hop;
+    size_t rows = 0;
+
+    while (n) {
+        size_t take = nfft - s->fill;
+        if (take > n) take = n;
+        memcpy(s->in_i + s->fill, i, take * sizeof(float));
+        if (p->cfg.iq) {
+            if (q) {
+                memcpy(s->in_q + s->fill, q, take * sizeof(float));
+                q += take;
+            } else {
+                memset(s->in_q + s->fill, 0, take * sizeof(float));
+            }
+        }
+        s->fill += take;
+        i += take;
+        n -= take;
+        if (s->fill < nfft) break;
+
+        if (p->cfg.iq) {
+            spectrum_iq(s);
+        } else {
+            spectrum_real(s);
+        }
+        scale_row(p, s->xr, s->xi, s->db, s->pix);
+        if (emit) {
+            wspr_wfall_row_t row;
+            row.index = s->rows;
+            row.first = s->rows * hop;
+            row.db = s->db;
+            row.pix = s->pix;
+            emit(ctx, &row);
+        }
+        s->rows++;
+        rows++;
+        // 保留重叠部分
+        memmove(s->in_i, s->in_i + hop, (nfft - hop) * sizeof(float));
+        if (p->cfg.iq) memmove(s->in_q, s->in_q + hop, (nfft - hop) * sizeof(float));
+        s->fill = nfft - hop;
+    }
+    return rows;
+}
+
+// ---------------------------------------------------------------- 输出文件
+
+static void put32(uint8_t *b, uint32_t v) {
+    b[0] = (uint8_t)v;
+    b[1] = (uint8_t)(v >> 8);
+    b[2] = (uint8_t)(v >> 16);
+    b[3] = (uint8_t)(v >> 24);
+}
+
+static void put64(uint8_t *b, uint64_t v) {
+    put32(b, (uint32_t)v);
+    put32(b + 4, (uint32_t)(v >> 32));
+}
+
+int wspr_wfall_writer_open(wspr_wfall_writer_t *w, const char *path, wspr_wfall_format_t format,
+                           const wspr_wfall_plan_t *p, char *err, size_t err_size) {
+    memset(w, 0, sizeof(*w));
+    w->f = fopen(path, "wb");
+    if (!w->f) {
+        set_err(err, err_size, "无法创建输出文件");
+        return -1;
+    }
+    w->format = format;
+    w->width = p->width;
+    if (format == WSPR_WFALL_PGM) {
+        // 高度先写成定宽的空格填充字段，关闭时原位回填
+        fprintf(w->f, "P5\n# wspr_wfall f0=%.6f df=%.6f hop=%u rate=%u floor=%.1f range=%.1f\n%u ",
+                wspr_wfall_column_hz(p, 0), p->bin_hz, p->cfg.hop, p->cfg.rate, p->cfg.db_floor, p->cfg.db_range,
+                p->width);
+        w->rows_pos = ftell(w->f);
+        fprintf(w->f, "%10u\n255\n", 0u);
+    } else {
+        uint8_t h[BIN_HEADER_BYTES];
+        double f0 = wspr_wfall_column_hz(p, 0), df = p->bin_hz;
+        uint64_t u;
+        uint32_t v;
+
+        memset(h, 0, sizeof(h));
+        memcpy(h, "WFL1", 4);
+        put32(h + 4, BIN_HEADER_BYTES);
+        put32(h + 8, p->width);
+        put32(h + 16, p->cfg.rate);
+        put32(h + 20, p->cfg.nfft);
+        put32(h + 24, p->cfg.hop);
+        put32(h + 28, p->cfg.iq ? 1u : 0u);
+        memcpy(&u, &f0, 8);
+        put64(h + 32, u);
+        memcpy(&u, &df, 8);
+        put64(h + 40, u);
+        memcpy(&v, &p->cfg.db_floor, 4);
+        put32(h + 48, v);
+        memcpy(&v, &p->cfg.db_range, 4);
+        put32(h + 52, v);
+        w->rows_pos = 12;
+        fwrite(h, 1, sizeof(h), w->f);
+    }
+    if (ferror(w->f) || w->rows_pos < 0) {
+        fclose(w->f);
+        w->f = NULL;
+        set_err(err, err_size, "写入失败");
+        return -1;
+    }
+    return 0;
+}
+
+int wspr_wfall_writer_row(wspr_wfall_writer_t *w, const uint8_t *pix) {
+    if (fwrite(pix, 1, w->width, w->f) != w->width) return -1;
+    w->rows++;
+    return 0;
+}
+
+int wspr_wfall_writer_close(wspr_wfall_writer_t *w) {
+    int ret = 0;
+
+    if (!w->f) return -1;
+    if (fseek(w->f, w->rows_pos, SEEK_SET) != 0) {
+        ret = -1;
+    } else if (w->format == WSPR_WFALL_PGM) {
+        if (fprintf(w->f, "%10u", (uint32_t)w->rows) != 10) ret = -1;
+    } else {
+        uint8_t b[4];
+        put32(b, (uint32_t)w->rows);
+        if (fwrite(b, 1, 4, w->f) != 4) ret = -1;
+    }
+    if (fclose(w->f) != 0) ret = -1;
+    w->f = NULL;
+    return ret;
+}
@@ -0,0 +1,127 @@
+#ifndef WSPR_WFALL_H
+#define WSPR_WFALL_H
+
+/*
+ * wspr_wfall.h - 流式瀑布图（频谱图）引擎
+ *
+ * 输入样本按任意长度分块推入，每攒够nfft个样本做一次加窗FFT，之后前移hop个样本
+ * （重叠nfft-hop），每次输出一行：显示频段内各频点的功率（dBFS，满幅正弦在频点
+ * 中心为0dB）和映射到0~255的像素。
+ *
+ *   实信号：nfft点实数FFT，用nfft/2点复数FFT加一次拆分完成，只拆分显示频段内的频点
+ *   IQ：    nfft点复数FFT，频段可为负频率
+ *
+ * 加窗、FFT蝶形以及功率、对数和像素映射用SIMD（x86 SSE2/AVX2、ARM NEON，否则标量）
+ * 计算，对数为多项式近似，误差远小于0.001dB。FFT为结构数组（实部、虚部分开）的基2
+ * 频率抽取，各级旋转因子连续存放；输出留在比特反转顺序，只读出显示频段内的频点。
+ *
+ * wspr_wfall_plan_t只在创建时写入，之后只读，可被任意多个线程的流共用；
+ * 每个wspr_wfall_t是一路信号（一个声道、一个文件或一个接收机）的状态。
+ *
+ * 输出文件（wspr_wfall_writer_t）：
+ *   PGM  P5灰度图，每行一帧，注释行中记录首列频率和频点间隔
+ *   BIN  64字节小端文件头后接每行width字节的像素：
+ *        0 "WFL1"  4 头长度  8 width  12 行数  16 采样率  20 nfft  24 hop  28 标志（bit0：IQ）
+ *        32 首列频率Hz（double）  40 频点间隔Hz（double）  48 floor dB（float）  52 range dB（float）
+ *        像素p对应 floor + p * range / 255 dBFS
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define WSPR_WFALL_MIN_FFT 16
+#define WSPR_WFALL_MAX_FFT 1048576
+
+typedef enum {
+    WSPR_WFALL_HANN = 0,
+    WSPR_WFALL_BLACKMAN_HARRIS = 1, // 4项，旁瓣-92dB
+    WSPR_WFALL_RECT = 2,
+} wspr_wfall_window_t;
+
+typedef struct {
+    uint32_t rate;                 // 采样率（Hz）
+    uint32_t nfft;                 // FFT长度，2的幂
+    uint32_t hop;                  // 行间隔（样本），1~nfft
+    int iq;                        // 非0为复数（IQ）输入
+    wspr_wfall_window_t window;
+    double f_lo, f_hi;             // 显示频段（Hz），相等时为全部频点（实信号0~rate/2，IQ为±rate/2）
+    float db_floor, db_range;      // 像素0为db_floor，255为db_floor + db_range
+} wspr_wfall_config_t;
+
+typedef struct {
+    wspr_wfall_config_t cfg;
+    uint32_t width;                // 每行频点数
+    int32_t bin_lo;                // 第一列的频点序号（IQ可为负）
+    double bin_hz;                 // 频点间隔
+    // 以下由wspr_wfall_plan()填写，供流使用
+    uint32_t m;                    // 复数FFT长度（实信号为nfft/2）
+    float db_offset;               // 窗增益归一化
+    float *window;                 // nfft
+    float *tw_re, *tw_im;          // m，半长为h的一级用[h, 2h)
+    uint32_t *rev;                 // 频点k的FFT输出在rev[k]处
+    float *split_re, *split_im;    // 实信号各列的拆分旋转因子
+} wspr_wfall_plan_t;
+
+typedef struct {
+    uint64_t index;                // 行号
+    uint64_t first;                // 本行窗口的第一个样本
+    const float *db;               // width个功率（dBFS）
+    const uint8_t *pix;            // width个像素
+} wspr_wfall_row_t;
+
+typedef void (*wspr_wfall_emit_t)(void *ctx, const wspr_wfall_row_t *row);
+
+typedef struct {
+    const wspr_wfall_plan_t *plan;
+    float *in_i, *in_q;            // 最近的fill个样本（至多nfft）
+    size_t fill;
+    float *re, *im;                // FFT工作区
+    float *xr, *xi;                // 显示频段内的频谱
+    float *db;
+    uint8_t *pix;
+    uint64_t rows;                 // 已输出的行数
+} wspr_wfall_t;
+
+// 检查配置并计算窗、旋转因子等。失败返回-1，并在err（可为NULL）中写入原因
+int wspr_wfall_plan(wspr_wfall_plan_t *p, const wspr_wfall_config_t *cfg, char *err, size_t err_size);
+void wspr_wfall_plan_free(wspr_wfall_plan_t *p);
+// 第col列的频率（Hz）
+double wspr_wfall_column_hz(const wspr_wfall_plan_t *p, uint32_t col);
+// frames个样本产生的行数
+uint64_t wspr_wfall_rows_for(const wspr_wfall_plan_t *p, uint64_t frames);
+
+// 成功返回0
+int wspr_wfall_init(wspr_wfall_t *s, const wspr_wfall_plan_t *p);
+void wspr_wfall_free(wspr_wfall_t *s);
+// 清空历史样本，行号归零
+void wspr_wfall_reset(wspr_wfall_t *s);
+/*
+ * 推入n个样本（IQ输入时q为NULL按0处理），每完成一行调用一次emit（可为NULL）。
+ * 行中的指针只在回调期间有效。返回本次输出的行数。
+ */
+size_t wspr_wfall_push(wspr_wfall_t *s, const float *i, const float *q, size_t n, wspr_wfall_emit_t emit, void *ctx);
+
+// 本次构建使用的SIMD实现（"avx2"、"sse2"、"neon"或"scalar"）
+const char *wspr_wfall_simd(void);
+
+// ---------------------------------------------------------------- 输出文件
+
+typedef enum { WSPR_WFALL_PGM = 0, WSPR_WFALL_BIN = 1 } wspr_wfall_format_t;
+
+typedef struct {
+    FILE *f;
+    wspr_wfall_format_t format;
+    uint32_t width;
+    uint64_t rows;
+    long rows_pos;                 // 文件头中行数字段的位置，关闭时回填
+} wspr_wfall_writer_t;
+
+// 行数在关闭时回填，path须为可定位的普通文件
+int wspr_wfall_writer_open(wspr_wfall_writer_t *w, const char *path, wspr_wfall_format_t format,
+                           const wspr_wfall_plan_t *p, char *err, size_t err_size);
+int wspr_wfall_writer_row(wspr_wfall_writer_t *w, const uint8_t *pix);
+// 回填行数并关闭，成功返回0
+int wspr_wfall_writer_close(wspr_wfall_writer_t *w);
+
+#endif